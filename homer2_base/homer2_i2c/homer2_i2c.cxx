@@ -1,9 +1,14 @@
+#include <algorithm>
 #include <ostream>
 #include <map>
 #include <array>
 #include <memory>
 #include <utility>
 
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+
 #include <homer2_util.hpp>
 #include <homer2_logging.hpp>
 
@@ -15,6 +20,23 @@ namespace homer2::i2c {
 
         const char* const TAG = "I2C";
 
+        // The bus of each I2C instance taking transactions, for its interrupt.
+        std::array<Homer2I2c*, 2> buses{};
+
+        void on_i2c0_irq() {
+
+            if (nullptr != buses[0])
+                buses[0]->handleInterrupt();
+        }
+
+        void on_i2c1_irq() {
+
+            if (nullptr != buses[1])
+                buses[1]->handleInterrupt();
+        }
+
+        constexpr uint64_t ABORT_TIMEOUT_US = 1000;
+
     }
 
     namespace Helper {
@@ -125,6 +147,8 @@ namespace homer2::i2c {
             {Homer2I2cError::write_missing_data,  "write_missing_data"},
             {Homer2I2cError::write_too_much_data, "write_too_much_data"},
             {Homer2I2cError::buffer_too_small,    "buffer_too_small"},
+            {Homer2I2cError::queue_full,          "queue_full"},
+            {Homer2I2cError::dma_unavailable,     "dma_unavailable"},
         };
 
         return out << strings[value];
@@ -199,6 +223,22 @@ namespace homer2::i2c {
             throw std::logic_error{"Homer2I2c: i2c not set"};
     }
 
+    Homer2I2c::~Homer2I2c() {
+
+        if (this->_txChannel < 0)
+            return;
+
+        this->drain();
+
+        const auto index = i2c_hw_index(this->_i2c);
+        irq_set_enabled(I2C0_IRQ + index, false);
+        irq_remove_handler(I2C0_IRQ + index, 0 == index ? on_i2c0_irq : on_i2c1_irq);
+        buses[index] = nullptr;
+
+        dma_channel_unclaim(this->_txChannel);
+        dma_channel_unclaim(this->_rxChannel);
+    }
+
 
     [[nodiscard]]
     Homer2I2cError Homer2I2c::read(
@@ -218,6 +258,8 @@ namespace homer2::i2c {
             return err;
         }
 
+        this->drain();
+
         const auto read = i2c_read_blocking_until(
             this->_i2c,
             addr,
@@ -258,7 +300,7 @@ namespace homer2::i2c {
         const uint64_t timeoutMillis,
         const uint8_t addr,
         const uint8_t len
-    ) const noexcept {
+    ) noexcept {
 
         return this->doWrite(timeoutMillis, addr, len, false);
     }
@@ -268,7 +310,7 @@ namespace homer2::i2c {
         const uint64_t timeoutMillis,
         const uint8_t addr,
         const uint8_t len
-    ) const noexcept {
+    ) noexcept {
 
         return this->doWrite(timeoutMillis, addr, len, true);
     }
@@ -279,7 +321,7 @@ namespace homer2::i2c {
         const uint8_t addr,
         const uint8_t len,
         const bool nonStop
-    ) const noexcept {
+    ) noexcept {
 
 #if DEBUG_ENABLED_AT_LEVEL(6)
         for (int i = 0; i < len; ++i)
@@ -295,6 +337,8 @@ namespace homer2::i2c {
                            << ", len: " << len);
 #endif
 
+        this->drain();
+
         const int result = i2c_write_blocking_until(
             this->_i2c,
             addr,
@@ -355,3 +399,344 @@ namespace homer2::i2c {
 
 }
 
+
+namespace homer2::i2c {
+
+    [[nodiscard]]
+    Homer2I2cError Homer2I2c::submit(
+        Homer2I2cTransaction& transaction
+    ) noexcept {
+
+        if (transaction.writeLen > BUFFER_CAPACITY || transaction.readLen > BUFFER_CAPACITY) {
+            E(TAG, "transaction will not fit into i2c buffer: " << BUFFER_CAPACITY << " < "
+                << static_cast<uint64_t>(std::max(transaction.writeLen, transaction.readLen)));
+            return Homer2I2cError::buffer_too_small;
+        }
+
+        if (0 != transaction.writeLen && nullptr == transaction.writeData) {
+            E(TAG, "transaction has nothing to write from");
+            return Homer2I2cError::write_missing_data;
+        }
+
+        if (0 != transaction.readLen && nullptr == transaction.readInto) {
+            E(TAG, "transaction has nothing to read into");
+            return Homer2I2cError::read_missing_data;
+        }
+
+        if (!this->claimDma())
+            return Homer2I2cError::dma_unavailable;
+
+        transaction.error = Homer2I2cError::no_error;
+        transaction.done.store(false);
+
+        if (0 == transaction.writeLen && 0 == transaction.readLen) {
+            W(TAG, "nothing to transfer");
+            complete(transaction);
+            return Homer2I2cError::no_error;
+        }
+
+        D(5, TAG, std::hex << "i2c submit"
+                           << ", addr: 0x" << static_cast<uint64_t>(transaction.addr)
+                           << std::dec << ", write: " << static_cast<uint64_t>(transaction.writeLen)
+                           << ", read: " << static_cast<uint64_t>(transaction.readLen));
+
+        const auto interrupts = save_and_disable_interrupts();
+
+        if (TRANSACTION_QUEUE_CAPACITY == this->_queueSize) {
+            restore_interrupts(interrupts);
+            W(TAG, "transaction queue full, addr: 0x" << std::hex << static_cast<uint64_t>(transaction.addr));
+            return Homer2I2cError::queue_full;
+        }
+
+        this->_queue[(this->_queueHead + this->_queueSize) % TRANSACTION_QUEUE_CAPACITY] = &transaction;
+        this->_queueSize++;
+
+        if (1 == this->_queueSize)
+            this->start();
+
+        restore_interrupts(interrupts);
+
+        return Homer2I2cError::no_error;
+    }
+
+    [[nodiscard]]
+    Homer2I2cError Homer2I2c::wait(
+        Homer2I2cTransaction& transaction
+    ) noexcept {
+
+        while (!transaction.done.load()) {
+            const auto deadline = this->deadlineMillis();
+            if (0 == deadline)
+                break;
+
+            // Woken up by the interrupt finishing a transaction, or at the deadline.
+            (void) best_effort_wfe_or_timeout(from_us_since_boot(deadline * 1000));
+            (void) this->poll();
+        }
+
+        return transaction.error;
+    }
+
+    [[nodiscard]]
+    bool Homer2I2c::poll() noexcept {
+
+        const auto interrupts = save_and_disable_interrupts();
+
+        if (0 == this->_queueSize) {
+            restore_interrupts(interrupts);
+            return false;
+        }
+
+        const auto& head = *this->_queue[this->_queueHead];
+        const auto late = now() >= head.deadlineMillis;
+
+        // Stopped on the bus, only the last bytes read were still being moved.
+        if (this->_stopped && (late || !dma_channel_is_busy(this->_rxChannel))) {
+            auto err = Homer2I2cError::no_error;
+            if (dma_channel_is_busy(this->_rxChannel)) {
+                dma_channel_abort(this->_rxChannel);
+                err = Homer2I2cError::read_missing_data;
+            }
+
+            auto& done = this->finish(err);
+            const auto pending = 0 != this->_queueSize;
+
+            restore_interrupts(interrupts);
+
+            complete(done);
+            return pending;
+        }
+
+        if (this->_stopped || !late) {
+            restore_interrupts(interrupts);
+            return true;
+        }
+
+        auto* const hw = i2c_get_hw(this->_i2c);
+        hw->intr_mask = 0;
+        dma_channel_abort(this->_txChannel);
+        dma_channel_abort(this->_rxChannel);
+
+        // Ends the transfer with a stop on the bus, the bit is cleared by the controller once done.
+        hw->enable = I2C_IC_ENABLE_ENABLE_BITS | I2C_IC_ENABLE_ABORT_BITS;
+        const auto until = time_us_64() + ABORT_TIMEOUT_US;
+        while (0 != (hw->enable & I2C_IC_ENABLE_ABORT_BITS) && time_us_64() < until);
+        (void) hw->clr_tx_abrt;
+        (void) hw->clr_stop_det;
+
+        auto& done = this->finish(
+            0 == head.readLen ? Homer2I2cError::write_timeout : Homer2I2cError::read_timeout
+        );
+        const auto pending = 0 != this->_queueSize;
+
+        restore_interrupts(interrupts);
+
+        E(TAG, "i2c transaction timed out, addr: 0x" << std::hex << static_cast<uint64_t>(done.addr)
+            << ", timeout set to: " << std::dec << done.timeoutMillis << "ms");
+        complete(done);
+
+        return pending;
+    }
+
+    void Homer2I2c::handleInterrupt() noexcept {
+
+        auto* const hw = i2c_get_hw(this->_i2c);
+        const auto status = hw->intr_stat;
+
+        if (0 == this->_queueSize) {
+            hw->intr_mask = 0;
+            return;
+        }
+
+        const auto& head = *this->_queue[this->_queueHead];
+
+        // The address or a byte was not acknowledged, or the bus was lost. The controller
+        // flushes what is left and sends a stop, the transaction is done once it is seen. The
+        // channels are stopped before the abort is cleared, the controller takes commands again
+        // from then on.
+        if (0 != (status & I2C_IC_INTR_STAT_R_TX_ABRT_BITS)) {
+            dma_channel_abort(this->_txChannel);
+            dma_channel_abort(this->_rxChannel);
+            (void) hw->clr_tx_abrt;
+            this->_abortError = 0 == head.readLen
+                                ? Homer2I2cError::write_generic_error
+                                : Homer2I2cError::read_generic_error;
+        }
+
+        if (0 == (status & I2C_IC_INTR_STAT_R_STOP_DET_BITS))
+            return;
+
+        (void) hw->clr_stop_det;
+
+        // The last bytes read may still be on their way from the FIFO, not waited for here but
+        // left to poll(), woken up by the event.
+        if (Homer2I2cError::no_error == this->_abortError &&
+            0 != head.readLen &&
+            dma_channel_is_busy(this->_rxChannel)) {
+            this->_stopped = true;
+            __sev();
+            return;
+        }
+
+        complete(this->finish(this->_abortError));
+    }
+
+    [[nodiscard]]
+    bool Homer2I2c::claimDma() noexcept {
+
+        if (this->_txChannel >= 0)
+            return true;
+
+        const auto tx = dma_claim_unused_channel(false);
+        const auto rx = dma_claim_unused_channel(false);
+
+        if (tx < 0 || rx < 0) {
+            E(TAG, "no dma channel available for i2c transactions");
+            if (tx >= 0)
+                dma_channel_unclaim(tx);
+            if (rx >= 0)
+                dma_channel_unclaim(rx);
+            return false;
+        }
+
+        this->_txChannel = tx;
+        this->_rxChannel = rx;
+
+        const auto index = i2c_hw_index(this->_i2c);
+        buses[index] = this;
+        irq_set_exclusive_handler(I2C0_IRQ + index, 0 == index ? on_i2c0_irq : on_i2c1_irq);
+        irq_set_enabled(I2C0_IRQ + index, true);
+
+        return true;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2I2c::deadlineMillis() const noexcept {
+
+        const auto interrupts = save_and_disable_interrupts();
+        const auto deadline = 0 == this->_queueSize
+                              ? 0
+                              : this->_stopped
+                                ? now()
+                                : this->_queue[this->_queueHead]->deadlineMillis;
+        restore_interrupts(interrupts);
+
+        return deadline;
+    }
+
+    void Homer2I2c::drain() noexcept {
+
+        for (auto deadline = this->deadlineMillis(); 0 != deadline; deadline = this->deadlineMillis()) {
+            (void) best_effort_wfe_or_timeout(from_us_since_boot(deadline * 1000));
+            (void) this->poll();
+        }
+    }
+
+    void Homer2I2c::start() noexcept {
+
+        auto& transaction = *this->_queue[this->_queueHead];
+        auto* const hw = i2c_get_hw(this->_i2c);
+
+        // The target can only be changed with the controller disabled, which it only is once it
+        // says so, a few bus clocks later.
+        hw->enable = 0;
+        const auto until = time_us_64() + ABORT_TIMEOUT_US;
+        while (0 != (hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS) && time_us_64() < until);
+
+        // Left to poll() to time out, the next transaction gets another chance.
+        if (0 != (hw->enable_status & I2C_IC_ENABLE_STATUS_IC_EN_BITS)) {
+            transaction.deadlineMillis = now();
+            return;
+        }
+
+        hw->tar = transaction.addr;
+        hw->enable = I2C_IC_ENABLE_ENABLE_BITS;
+
+        (void) hw->clr_tx_abrt;
+        (void) hw->clr_stop_det;
+        this->_abortError = Homer2I2cError::no_error;
+        this->_stopped = false;
+
+        // One command per byte: the byte to write, or a read, the first read after a write
+        // preceded by a restart and the last command followed by a stop.
+        const size_t count = transaction.writeLen + transaction.readLen;
+        for (size_t i = 0; i < count; i++) {
+            uint16_t command = i < transaction.writeLen
+                               ? transaction.writeData[i]
+                               : I2C_IC_DATA_CMD_CMD_BITS;
+            if (0 != transaction.writeLen && i == transaction.writeLen)
+                command |= I2C_IC_DATA_CMD_RESTART_BITS;
+            if (i + 1 == count)
+                command |= I2C_IC_DATA_CMD_STOP_BITS;
+            transaction.commands[i] = command;
+        }
+
+        if (0 != transaction.readLen) {
+            auto config = dma_channel_get_default_config(this->_rxChannel);
+            channel_config_set_transfer_data_size(&config, DMA_SIZE_8);
+            channel_config_set_read_increment(&config, false);
+            channel_config_set_write_increment(&config, true);
+            channel_config_set_dreq(&config, i2c_get_dreq(this->_i2c, false));
+            dma_channel_configure(
+                this->_rxChannel,
+                &config,
+                transaction.readInto,
+                &hw->data_cmd,
+                transaction.readLen,
+                true
+            );
+        }
+
+        hw->intr_mask = I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS;
+
+        auto config = dma_channel_get_default_config(this->_txChannel);
+        channel_config_set_transfer_data_size(&config, DMA_SIZE_16);
+        channel_config_set_read_increment(&config, true);
+        channel_config_set_write_increment(&config, false);
+        channel_config_set_dreq(&config, i2c_get_dreq(this->_i2c, true));
+        dma_channel_configure(
+            this->_txChannel,
+            &config,
+            &hw->data_cmd,
+            transaction.commands.data(),
+            count,
+            true
+        );
+
+        transaction.deadlineMillis = now() + transaction.timeoutMillis;
+    }
+
+    [[nodiscard]]
+    Homer2I2cTransaction& Homer2I2c::finish(
+        const Homer2I2cError err
+    ) noexcept {
+
+        i2c_get_hw(this->_i2c)->intr_mask = 0;
+        this->_stopped = false;
+
+        auto& transaction = *this->_queue[this->_queueHead];
+        transaction.error = err;
+
+        this->_queueHead = (this->_queueHead + 1) % TRANSACTION_QUEUE_CAPACITY;
+        this->_queueSize--;
+
+        if (0 != this->_queueSize)
+            this->start();
+
+        return transaction;
+    }
+
+    void Homer2I2c::complete(
+        Homer2I2cTransaction& transaction
+    ) noexcept {
+
+        if (nullptr != transaction.callback)
+            transaction.callback(transaction, transaction.any);
+
+        transaction.done.store(true);
+
+        // Wakes up whoever is waiting on it.
+        __sev();
+    }
+
+}
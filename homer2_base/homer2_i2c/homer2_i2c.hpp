@@ -2,6 +2,7 @@
 
 #include <cstdint>
 #include <array>
+#include <atomic>
 #include <memory>
 
 #include <hardware/i2c.h>
@@ -10,6 +11,8 @@ namespace homer2::i2c {
 
     constexpr size_t BUFFER_CAPACITY = 64;
 
+    constexpr size_t TRANSACTION_QUEUE_CAPACITY = 8;
+
     enum class Homer2I2cError : int8_t {
         no_error = 0,
         buffer_too_small = -1,
@@ -24,6 +27,8 @@ namespace homer2::i2c {
         write_unknown_error = -10,
         write_missing_data = -11,
         write_too_much_data = -12,
+        queue_full = -13,
+        dma_unavailable = -14,
     };
 
     std::ostream& operator<<(
@@ -32,6 +37,42 @@ namespace homer2::i2c {
     );
 
 
+    struct Homer2I2cTransaction;
+
+    using Homer2I2cCallback = void (*)(
+        Homer2I2cTransaction& transaction,
+        void* any
+    );
+
+    // A write, a read, or a write followed by a read after a restart (reading a register), always
+    // ending with a stop. The buffers are the caller's and must outlive the transaction.
+    struct Homer2I2cTransaction {
+
+        uint8_t addr{0};
+
+        const uint8_t* writeData{nullptr};
+        uint8_t writeLen{0};
+
+        uint8_t* readInto{nullptr};
+        uint8_t readLen{0};
+
+        // From the moment the transaction is put on the bus, not from when it is queued.
+        uint64_t timeoutMillis{0};
+
+        // Optional, called from the I2C interrupt once the transaction is done, keep it short.
+        Homer2I2cCallback callback{nullptr};
+        void* any{nullptr};
+
+        // Set once the transaction is done, successfully or not, after the callback.
+        std::atomic<bool> done{false};
+        Homer2I2cError error{Homer2I2cError::no_error};
+
+        // Owned by Homer2I2c while the transaction is queued.
+        std::array<uint16_t, 2 * BUFFER_CAPACITY> commands{};
+        uint64_t deadlineMillis{0};
+
+    };
+
     class Homer2I2c {
     public:
 
@@ -48,6 +89,8 @@ namespace homer2::i2c {
 
         explicit Homer2I2c(i2c_inst_t* i2c);
 
+        ~Homer2I2c();
+
         [[nodiscard]]
         Homer2I2cError read(
             uint64_t timeoutMillis,
@@ -60,14 +103,40 @@ namespace homer2::i2c {
             uint64_t timeoutMillis,
             uint8_t addr,
             uint8_t len
-        ) const noexcept;
+        ) noexcept;
 
         [[nodiscard]]
         Homer2I2cError writeNonStop(
             uint64_t timeoutMillis,
             uint8_t addr,
             uint8_t len
-        ) const noexcept;
+        ) noexcept;
+
+        // Queues the transaction, put on the bus right away when the bus is free. It is then
+        // carried out by DMA and the I2C interrupt, the CPU is free in the meantime. The
+        // transaction tells it is done by its done flag, and its callback if set.
+        //
+        // The blocking calls above wait for the queued transactions to be done first. Use from
+        // the core the bus was first used on, the interrupt is taken there.
+        [[nodiscard]]
+        Homer2I2cError submit(
+            Homer2I2cTransaction& transaction
+        ) noexcept;
+
+        // Sleeps until the transaction is done, returns its error.
+        [[nodiscard]]
+        Homer2I2cError wait(
+            Homer2I2cTransaction& transaction
+        ) noexcept;
+
+        // Fails the transaction on the bus once past its timeout, true while any is queued. Only
+        // needed when not waiting on the transactions, the interrupt does the rest, but for a read
+        // whose last bytes were still moved by the DMA when the stop was seen: this finishes it.
+        [[nodiscard]]
+        bool poll() noexcept;
+
+        // Called from the I2C interrupt.
+        void handleInterrupt() noexcept;
 
         [[nodiscard]]
         uint8_t operator[](size_t index) const;
@@ -85,11 +154,47 @@ namespace homer2::i2c {
             uint8_t addr,
             uint8_t len,
             bool nonStop
-        ) const noexcept;
+        ) noexcept;
+
+        [[nodiscard]]
+        bool claimDma() noexcept;
+
+        // Deadline of the transaction on the bus, now when it only waits on poll(), 0 when there is
+        // none.
+        [[nodiscard]]
+        uint64_t deadlineMillis() const noexcept;
+
+        void drain() noexcept;
+
+        // With interrupts disabled, the queue not empty.
+        void start() noexcept;
+
+        // With interrupts disabled, returns the transaction done, after starting the next one.
+        [[nodiscard]]
+        Homer2I2cTransaction& finish(
+            Homer2I2cError err
+        ) noexcept;
+
+        static void complete(
+            Homer2I2cTransaction& transaction
+        ) noexcept;
 
         i2c_inst_t* const _i2c;
         std::array<uint8_t, BUFFER_CAPACITY> _buffer;
 
+        std::array<Homer2I2cTransaction*, TRANSACTION_QUEUE_CAPACITY> _queue{};
+        size_t _queueHead{0};
+        size_t _queueSize{0};
+
+        // Set by the interrupt on an abort, reported once the stop is seen.
+        Homer2I2cError _abortError{Homer2I2cError::no_error};
+
+        // Set by the interrupt on the stop of a read the DMA was not done with, see poll().
+        bool _stopped{false};
+
+        int _txChannel{-1};
+        int _rxChannel{-1};
+
     };
 
     class I2cConnection {
@@ -6,7 +6,9 @@
 
 #include <pico/mutex.h>
 
-#define HOMER2_LOG_USE_MUTEX false
+// Both cores log, a line of one would otherwise be cut into by the other, and the flags of
+// std::cout saved and restored around it would be those the other one set.
+#define HOMER2_LOG_USE_MUTEX true
 
 namespace homer2::logging {
 
@@ -26,8 +28,35 @@ namespace homer2::logging {
 
     }
 
+    // Must be called before the second core is launched.
     void init();
 
+    // Holds the console for lines written to std::cout other than by the logging macros, which
+    // must not be used while it is held.
+    class Homer2ConsoleLock {
+    public:
+
+        Homer2ConsoleLock& operator=(const Homer2ConsoleLock& other) noexcept = delete;
+
+        Homer2ConsoleLock& operator=(Homer2ConsoleLock&& other) = delete;
+
+        Homer2ConsoleLock(Homer2ConsoleLock&& other) = delete;
+
+        Homer2ConsoleLock(const Homer2ConsoleLock& other) noexcept = delete;
+
+
+        Homer2ConsoleLock() {
+
+            internal::enter();
+        }
+
+        ~Homer2ConsoleLock() {
+
+            internal::exit();
+        }
+
+    };
+
 }
 
 #define HOMER2_USE_COLOR true
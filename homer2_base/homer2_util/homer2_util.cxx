@@ -1 +1,46 @@
+#include <algorithm>
+
+#include <malloc.h>
+
 #include "homer2_util.hpp"
+
+namespace homer2::util {
+
+    namespace {
+
+        // glibc deprecated mallinfo() in favour of mallinfo2(), newlib only has the former.
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        struct mallinfo2 heap_info() noexcept {
+
+            return mallinfo2();
+        }
+#else
+        struct mallinfo heap_info() noexcept {
+
+            return mallinfo();
+        }
+#endif
+
+    }
+
+    [[nodiscard]]
+    size_t heap_used_bytes() noexcept {
+
+        return static_cast<size_t>(heap_info().uordblks);
+    }
+
+    [[nodiscard]]
+    size_t heap_reserved_peak_bytes() noexcept {
+
+#ifdef __NEWLIB__
+        // newlib keeps the most it ever took from sbrk, trimming the heap does not lower it.
+        return static_cast<size_t>(heap_info().usmblks);
+#else
+        // glibc does not keep it, the arena shrinks again when trimmed.
+        static size_t peak = 0;
+        peak = std::max(peak, static_cast<size_t>(heap_info().arena));
+        return peak;
+#endif
+    }
+
+}
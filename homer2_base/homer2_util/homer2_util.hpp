@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include <pico/time.h>
@@ -12,6 +13,20 @@
 
 #define remaining(START_TIME_MILLIS, EXPIRY_DURATION_MILLIS) (((START_TIME_MILLIS) + (EXPIRY_DURATION_MILLIS)) - (now()))
 
+namespace homer2::util {
+
+    // Bytes allocated from the heap and not yet freed.
+    [[nodiscard]]
+    size_t heap_used_bytes() noexcept;
+
+    // High-water mark of the memory the heap took from the system, which the bytes in use never
+    // exceeded. Neither libc tracks the peak of the bytes in use itself. On glibc this is only the
+    // largest seen by the calls made to it.
+    [[nodiscard]]
+    size_t heap_reserved_peak_bytes() noexcept;
+
+}
+
 inline uint16_t merge(
     const uint8_t hi,
     const uint8_t lo
@@ -243,4 +243,10 @@ namespace homer2::sensor::bme68x {
         this->_task = BME68xTask::idle;
     }
 
+    [[nodiscard]]
+    uint64_t BME68x::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
+
 }
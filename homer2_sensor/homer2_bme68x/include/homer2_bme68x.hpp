@@ -113,6 +113,10 @@ namespace homer2::sensor::bme68x {
         std::optional<BME68xData> measure(uint64_t nowMillis);
 
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
@@ -257,4 +257,10 @@ namespace homer2::sensor::bme68x::internal::sensor {
         return this->_gasResistanceOhms;
     }
 
+    [[nodiscard]]
+    uint64_t BME68xSensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
+
 }
@@ -56,6 +56,10 @@ namespace homer2::sensor::bme68x::internal::sensor {
         float getGasResistanceOhms() const noexcept;
 
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void doRequestMeasurement(uint64_t nowMillis);
@@ -225,5 +225,10 @@ namespace homer2::sensor::bmp3xx {
         this->_task = BMP3Task::idle;
     }
 
+    [[nodiscard]]
+    uint64_t BMP3xx::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
 
 }
@@ -99,6 +99,10 @@ namespace homer2::sensor::bmp3xx {
         std::optional<bool> reset(uint64_t nowMillis);
 
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
@@ -323,5 +323,10 @@ namespace homer2::sensor::bmp3xx::internal::sensor {
         return this->_data.pressure;
     }
 
+    [[nodiscard]]
+    uint64_t BMP3xxSensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
 
 }
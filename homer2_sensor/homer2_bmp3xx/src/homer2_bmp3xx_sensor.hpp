@@ -49,6 +49,10 @@ namespace homer2::sensor::bmp3xx::internal::sensor {
         double getPressureHPa() const noexcept;
 
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void validateTrimmingParameters();
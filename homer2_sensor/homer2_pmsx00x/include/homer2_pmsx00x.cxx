@@ -223,4 +223,10 @@ namespace homer2::sensor::pmsx00x {
         this->_task = PMSx00xTask::idle;
     }
 
+    [[nodiscard]]
+    uint64_t PMSx00x::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
+
 }
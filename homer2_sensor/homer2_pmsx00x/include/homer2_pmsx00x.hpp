@@ -129,6 +129,10 @@ namespace homer2::sensor::pmsx00x {
         [[nodiscard]]
         std::optional<PMSx00xData> measure(uint64_t nowMillis);
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
@@ -279,4 +279,10 @@ namespace homer2::sensor::pmsx00x::internal::sensor {
         return this->_particles100;
     }
 
+    [[nodiscard]]
+    uint64_t PMSx00xSensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
+
 }
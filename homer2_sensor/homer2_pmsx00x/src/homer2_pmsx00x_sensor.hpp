@@ -67,6 +67,10 @@ namespace homer2::sensor::pmsx00x::internal::sensor {
         [[nodiscard]]
         uint16_t getParticles100() const noexcept;
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void doRequestMeasurement(uint64_t nowMillis);
@@ -274,4 +274,10 @@ namespace homer2::sensor::sgp40 {
         this->_task = SGP40Task::idle;
     }
 
+    [[nodiscard]]
+    uint64_t SGP40::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
+
 }
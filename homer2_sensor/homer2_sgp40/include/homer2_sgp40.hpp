@@ -96,6 +96,10 @@ namespace homer2::sensor::sgp40 {
         [[nodiscard]]
         std::optional<bool> turnHeaterOff(uint64_t nowMillis);
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
@@ -602,4 +602,10 @@ namespace homer2::sensor::sgp40::internal::sensor {
         return Homer2I2cError::no_error;
     }
 
+    [[nodiscard]]
+    uint64_t SGP40Sensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
+
 }
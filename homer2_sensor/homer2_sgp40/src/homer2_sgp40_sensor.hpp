@@ -72,6 +72,10 @@ namespace homer2::sensor::sgp40::internal::sensor {
         [[nodiscard]]
         uint16_t getFeatureSet() const noexcept;
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void doRequestMeasurement(
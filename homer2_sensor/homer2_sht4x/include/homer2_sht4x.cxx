@@ -220,4 +220,10 @@ namespace homer2::sensor::sht4x {
         this->_task = SHT4xTask::idle;
     }
 
+    [[nodiscard]]
+    uint64_t SHT4x::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
+
 }
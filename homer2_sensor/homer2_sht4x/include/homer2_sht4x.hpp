@@ -89,6 +89,10 @@ namespace homer2::sensor::sht4x {
         [[nodiscard]]
         std::optional<bool> reset(uint64_t nowMillis);
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
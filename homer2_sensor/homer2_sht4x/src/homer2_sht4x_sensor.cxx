@@ -464,4 +464,10 @@ namespace homer2::sensor::sht4x::internal::sensor {
         return this->_serial;
     }
 
+    [[nodiscard]]
+    uint64_t SHT4xSensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
+
 }
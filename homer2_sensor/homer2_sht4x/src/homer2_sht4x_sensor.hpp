@@ -54,6 +54,10 @@ namespace homer2::sensor::sht4x::internal::sensor {
         uint32_t getSerial() const noexcept;
 
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void doRequestMeasurement(uint64_t nowMillis);
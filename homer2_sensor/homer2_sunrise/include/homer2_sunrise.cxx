@@ -123,4 +123,10 @@ namespace homer2::sensor::sunrise {
         this->_task = SunriseTask::idle;
     }
 
+    [[nodiscard]]
+    uint64_t Sunrise::readyAtMillis() const noexcept {
+
+        return nullptr == this->_sensor ? 0 : this->_sensor->getDataReadyAtMillis();
+    }
+
 }
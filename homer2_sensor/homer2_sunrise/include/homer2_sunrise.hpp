@@ -73,6 +73,10 @@ namespace homer2::sensor::sunrise {
         [[nodiscard]]
         std::optional<SunriseData> measure(uint64_t nowMillis);
 
+        // Time the measurement in progress can be read at, 0 when none is in progress.
+        [[nodiscard]]
+        uint64_t readyAtMillis() const noexcept;
+
     private:
 
         void init();
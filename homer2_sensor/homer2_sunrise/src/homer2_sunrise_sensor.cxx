@@ -326,4 +326,10 @@ namespace homer2::sensor::sunrise::internal::sensor {
         return this->_errorStatus;
     }
 
+    [[nodiscard]]
+    uint64_t SunriseSensor::getDataReadyAtMillis() const noexcept {
+
+        return this->_dataReadyAtMillis;
+    }
+
 }
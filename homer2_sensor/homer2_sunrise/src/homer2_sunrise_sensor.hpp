@@ -53,6 +53,10 @@ namespace homer2::sensor::sunrise::internal::sensor {
         [[maybe_unused]]
         uint8_t getErrorStatus() const noexcept;
 
+        // Time the pending operation can be completed at, 0 when none is pending.
+        [[nodiscard]]
+        uint64_t getDataReadyAtMillis() const noexcept;
+
     private:
 
         void wakeup();
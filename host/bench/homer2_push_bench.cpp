@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Ahead of homer2's headers, their now() macro breaks std::chrono.
+#include "homer2_mock_vm.hpp"
+#include "homer2_shim.hpp"
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_clock.hpp"
+#include "homer2_deflate.hpp"
+#include "homer2_pusher.hpp"
+
+// Pushes synthetic samples through Homer2Pusher, lwIP being served by host sockets, to the mock
+// VictoriaMetrics server running in-process, and reports the pushes per second, the bytes on the
+// wire per datapoint and the tail latency of a sample, from push() to the server's answer.
+// Built with HOMER2_VICTORIA_GZIP as homer2_push_bench_gzip, bodies are gzipped and the
+// compression ratio and time per KiB of body are reported too.
+//
+//   homer2_push_bench [--samples N] [--period-ms N] [--batch N] [--window N]
+//                     [--keep-alive 0|1] [--latency-ms N] [--reset-rate R]
+//                     [--error-rate R] [--timeout-s N]
+
+namespace {
+
+    struct Options {
+
+        uint64_t samples{2'000};
+
+        // Between the capture times of two samples, as read by the board's loop. Samples are
+        // pushed as fast as they are taken regardless.
+        uint64_t periodMillis{HOMER2_SENSOR_LOOP_DELAY_MILLIS};
+
+        size_t batchSize{HOMER2_VICTORIA_BATCH_SIZE};
+
+        // Samples pushed but not answered yet. Kept within the queue, so that no sample is ever
+        // spilled and each answer can be matched to the samples it covers.
+        size_t window{HOMER2_VICTORIA_QUEUE_CAPACITY};
+
+        bool keepAlive{true};
+
+        uint64_t timeoutSeconds{60};
+
+        homer2::mock::Homer2MockVmOptions vm{0};
+
+    };
+
+    void usage() {
+
+        std::cerr << "usage: homer2_push_bench [--samples N] [--period-ms N] [--batch N] [--window N]" << std::endl
+                  << "                         [--keep-alive 0|1] [--latency-ms N] [--reset-rate R]" << std::endl
+                  << "                         [--error-rate R] [--timeout-s N]" << std::endl;
+    }
+
+    bool parse(
+        const int argc,
+        char** const argv,
+        Options& options
+    ) {
+        for (int i = 1; i + 1 < argc; i += 2) {
+            const auto* const value = argv[i + 1];
+
+            if (0 == strcmp("--samples", argv[i]))
+                options.samples = std::strtoull(value, nullptr, 10);
+            else if (0 == strcmp("--period-ms", argv[i]))
+                options.periodMillis = std::strtoull(value, nullptr, 10);
+            else if (0 == strcmp("--batch", argv[i]))
+                options.batchSize = std::strtoull(value, nullptr, 10);
+            else if (0 == strcmp("--window", argv[i]))
+                options.window = std::strtoull(value, nullptr, 10);
+            else if (0 == strcmp("--keep-alive", argv[i]))
+                options.keepAlive = 0 != std::strtoul(value, nullptr, 10);
+            else if (0 == strcmp("--latency-ms", argv[i]))
+                options.vm.latencyMillis = std::strtoull(value, nullptr, 10);
+            else if (0 == strcmp("--reset-rate", argv[i]))
+                options.vm.resetRate = std::strtod(value, nullptr);
+            else if (0 == strcmp("--error-rate", argv[i]))
+                options.vm.errorRate = std::strtod(value, nullptr);
+            else if (0 == strcmp("--timeout-s", argv[i]))
+                options.timeoutSeconds = std::strtoull(value, nullptr, 10);
+            else
+                return false;
+        }
+
+        if (0 == argc % 2)
+            return false;
+
+        options.window = std::clamp<size_t>(options.window, 1, HOMER2_VICTORIA_QUEUE_CAPACITY);
+        return options.samples > 0;
+    }
+
+    // Every value moves on each sample, as on a live board all sensors are read every loop. The
+    // VOC index always moves past its deadband, no sample is left empty and skipped.
+    homer2::Homer2SensorsData sample(
+        const uint64_t i,
+        const uint64_t capturedAtMillis
+    ) {
+        const auto wave = static_cast<float>(i % 100);
+        const auto small = static_cast<uint16_t>(i % 1'000);
+
+        return homer2::Homer2SensorsData{}
+            .withSgp40Data(homer2::SGP40Data{static_cast<uint16_t>(30'000 + small), static_cast<int32_t>(100 + i % 400)},
+                           capturedAtMillis)
+            .withBme68xData(homer2::BME68xData{20.F + wave / 10, 1'000.F + wave, 40.F + wave / 5, 50'000.F + wave * 100},
+                            capturedAtMillis)
+            .withSht4xData(homer2::SHT4xData{21.F + wave / 10, 41.F + wave / 5},
+                           capturedAtMillis)
+            .withBmp3xxData(homer2::BMP3xxData{22.F + wave / 10, 1'001.F + wave},
+                            capturedAtMillis)
+            .withSunriseData(homer2::SunriseData{static_cast<uint16_t>(400 + small), 0},
+                             capturedAtMillis)
+            .withPmsx00xData(homer2::PMSx00xData{small, small, small, small, small, small,
+                                                 small, small, small, small, small, small},
+                             capturedAtMillis);
+    }
+
+    // A batch as big as the payload allows, serialized as the pusher does.
+    void fill_batch(
+        homer2::Homer2Encoder& encoder,
+        homer2::Homer2Payload& body,
+        const uint64_t periodMillis
+    ) {
+        encoder.begin(body);
+
+        for (uint64_t i = 0; i < HOMER2_VICTORIA_QUEUE_CAPACITY; i++) {
+            const auto mark = body.size();
+            const auto reading = homer2::make_reading(sample(i, 1'000 + i * periodMillis));
+            if (!encoder.append(body, reading, 1'700'000'000'000 + i * periodMillis) ||
+                body.overflowed() ||
+                body.size() + encoder.trailerSize() > body.capacity()) {
+                body.truncate(mark);
+                break;
+            }
+        }
+
+        encoder.end(body);
+    }
+
+    // Compressing the same batch over and over, how long it takes per KiB of body.
+    double gzip_micros_per_kib(
+        const homer2::Homer2Payload& body,
+        homer2::Homer2Payload& compressed
+    ) {
+        constexpr int ROUNDS = 200;
+
+        const auto startedUs = time_us_64();
+        for (int i = 0; i < ROUNDS; i++) {
+            compressed.clear();
+            (void) homer2::gzip_compress(body.data(), body.size(), compressed);
+        }
+        const auto elapsedUs = static_cast<double>(time_us_64() - startedUs);
+
+        return elapsedUs / ROUNDS / (static_cast<double>(body.size()) / 1024.0);
+    }
+
+    double percentile(
+        const std::vector<uint64_t>& sorted,
+        const double p
+    ) {
+        if (sorted.empty())
+            return 0.0;
+
+        const auto rank = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1) + 0.5);
+        return static_cast<double>(sorted[rank]) / 1'000.0;
+    }
+
+}
+
+int main(
+    const int argc,
+    char** const argv
+) {
+    homer2::logging::init();
+
+    Options options{};
+    if (!parse(argc, argv, options)) {
+        usage();
+        return 2;
+    }
+
+    homer2::mock::Homer2MockVm vm{options.vm};
+    if (!vm.start()) {
+        std::cerr << "could not start the mock server" << std::endl;
+        return 1;
+    }
+
+    // Time 0 stands for not set, the board's main loop waits past it too.
+    while (now() <= 100)
+        sleep_ms(10);
+
+    // Synced right away by the shim, the samples carry timestamps as on a synced board.
+    homer2::clock::init_sntp("host");
+
+    homer2::Homer2Pusher pusher{
+        {{"127.0.0.1", vm.port()}},
+        homer2::PushTransport::tcp,
+        0,
+        options.keepAlive,
+        HOMER2_VICTORIA_GZIP,
+        options.batchSize,
+        0,
+        HOMER2_VICTORIA_MAX_PAYLOAD_BYTES,
+        homer2::make_encoder(homer2::PushFormat::opentsdb_json),
+        0
+    };
+
+    std::deque<uint64_t> pushedAtUs{};
+    std::vector<uint64_t> latenciesUs{};
+    latenciesUs.reserve(options.samples);
+
+    uint64_t pushed = 0;
+    uint64_t answered = 0;
+
+    const auto startedUs = time_us_64();
+    const auto deadlineUs = startedUs + options.timeoutSeconds * 1'000'000;
+
+    while (answered < options.samples && time_us_64() < deadlineUs) {
+
+        if (pushed < options.samples && pushed - answered < options.window) {
+            const auto at = time_us_64();
+            pusher.push(sample(pushed, startedUs / 1000 + pushed * options.periodMillis), 0);
+            pushedAtUs.push_back(at);
+            pushed++;
+        }
+        else {
+            pusher.poll();
+        }
+
+        const auto full = pushed == options.samples || pushed - answered == options.window;
+        homer2::shim::poll(full ? 1 : 0);
+
+        // Delivered and rejected samples leave the queue in the order they were pushed.
+        const auto done = pusher.deliveredSamples() + pusher.rejectedSamples();
+        const auto nowUs = time_us_64();
+        for (; answered < done && !pushedAtUs.empty(); answered++) {
+            latenciesUs.push_back(nowUs - pushedAtUs.front());
+            pushedAtUs.pop_front();
+        }
+    }
+
+    const auto elapsedSeconds = static_cast<double>(time_us_64() - startedUs) / 1e6;
+
+    vm.stop();
+
+    const auto stats = vm.stats();
+    std::sort(latenciesUs.begin(), latenciesUs.end());
+
+    const auto perDatapoint = [&stats](const uint64_t bytes) {
+        return 0 == stats.datapoints ? 0.0 : static_cast<double>(bytes) / static_cast<double>(stats.datapoints);
+    };
+
+    std::cout << std::fixed << std::setprecision(2)
+              << "samples:          " << answered << '/' << options.samples
+              << (answered < options.samples ? " (timed out)" : "") << std::endl
+              << "elapsed:          " << elapsedSeconds << " s" << std::endl
+              << "pushes:           " << stats.accepted << " accepted of " << stats.requests << " requests, "
+              << stats.connections << " connections" << std::endl
+              << "failures:         " << stats.resets << " resets, " << stats.errors << " 5xx, "
+              << stats.invalid << " invalid" << std::endl
+              << "pushes/s:         " << static_cast<double>(stats.accepted) / elapsedSeconds << std::endl
+              << "samples/s:        " << static_cast<double>(answered) / elapsedSeconds << std::endl
+              << "datapoints:       " << stats.datapoints << std::endl
+              << "bytes/sample:     " << (0 == answered ? 0.0 : static_cast<double>(stats.wireBytes) / static_cast<double>(answered))
+              << " on the wire" << std::endl
+              << "bytes/datapoint:  " << perDatapoint(stats.wireBytes) << " on the wire, "
+              << perDatapoint(stats.bodyBytes) << " of body" << std::endl
+              << "latency ms:       p50 " << percentile(latenciesUs, 0.50)
+              << ", p90 " << percentile(latenciesUs, 0.90)
+              << ", p99 " << percentile(latenciesUs, 0.99)
+              << ", p99.9 " << percentile(latenciesUs, 0.999)
+              << ", max " << percentile(latenciesUs, 1.0) << std::endl
+              << "heap bytes:       " << homer2::util::heap_used_bytes() << " in use, "
+              << homer2::util::heap_reserved_peak_bytes() << " reserved at most" << std::endl;
+
+    if (HOMER2_VICTORIA_GZIP) {
+        static std::array<char, HOMER2_VICTORIA_MAX_PAYLOAD_BYTES> bodyBuffer{};
+        static std::array<char, homer2::gzip_max_compressed_length(HOMER2_VICTORIA_MAX_PAYLOAD_BYTES)> gzipBuffer{};
+
+        homer2::Homer2Payload body{bodyBuffer.data(), bodyBuffer.size()};
+        homer2::Homer2Payload compressed{gzipBuffer.data(), gzipBuffer.size()};
+        fill_batch(*homer2::make_encoder(homer2::PushFormat::opentsdb_json), body, options.periodMillis);
+        const auto microsPerKib = gzip_micros_per_kib(body, compressed);
+
+        std::cout << "gzip ratio:       " << (0 == stats.bodyBytes ? 0.0 : static_cast<double>(stats.decodedBytes) / static_cast<double>(stats.bodyBytes))
+                  << " of the bodies pushed, " << static_cast<double>(body.size()) / static_cast<double>(compressed.size())
+                  << " of a full batch (" << body.size() << " -> " << compressed.size() << " bytes)" << std::endl
+                  << "gzip us/KiB:      " << microsPerKib << std::endl;
+    }
+
+    return answered == options.samples && 0 == stats.invalid ? 0 : 1;
+}
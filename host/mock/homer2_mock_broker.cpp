@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "homer2_mock_broker.hpp"
+
+namespace homer2::mock {
+
+    namespace {
+
+        // How often the loop looks up from the sockets to see whether it is stopped.
+        constexpr int IDLE_POLL_MILLIS = 50;
+
+        constexpr size_t MAX_PACKET_BYTES = 64 * 1024;
+
+        constexpr uint8_t CONNECT = 1;
+        constexpr uint8_t PUBLISH = 3;
+        constexpr uint8_t PINGREQ = 12;
+        constexpr uint8_t DISCONNECT = 14;
+
+        const std::string CONNACK_ACCEPTED{"\x20\x02\x00\x00", 4};
+        const std::string PINGRESP{"\xd0\x00", 2};
+
+        struct Connection {
+
+            int fd{-1};
+            bool closed{false};
+
+            // Counted from 1, in the order accepted.
+            uint64_t number{0};
+            bool connected{false};
+            // Publishes are neither acknowledged nor is the connection kept once one arrived.
+            bool unacked{false};
+
+            std::string in{};
+            std::string out{};
+
+        };
+
+        // Reads what the MQTT 3.1.1 specification lays out within a packet, failing past its end.
+        class Cursor {
+        public:
+
+            explicit Cursor(
+                const std::string_view data
+            ) noexcept: _data{data} {
+            }
+
+            [[nodiscard]]
+            bool u8(
+                uint8_t& value
+            ) noexcept {
+
+                if (this->_at + 1 > this->_data.size())
+                    return false;
+                value = static_cast<uint8_t>(this->_data[this->_at++]);
+                return true;
+            }
+
+            [[nodiscard]]
+            bool u16(
+                uint16_t& value
+            ) noexcept {
+
+                uint8_t msb = 0;
+                uint8_t lsb = 0;
+                if (!this->u8(msb) || !this->u8(lsb))
+                    return false;
+                value = static_cast<uint16_t>((msb << 8) | lsb);
+                return true;
+            }
+
+            [[nodiscard]]
+            bool string(
+                std::string& value
+            ) noexcept {
+
+                uint16_t len = 0;
+                if (!this->u16(len) || this->_at + len > this->_data.size())
+                    return false;
+                value.assign(this->_data.substr(this->_at, len));
+                this->_at += len;
+                return true;
+            }
+
+            [[nodiscard]]
+            std::string_view rest() noexcept {
+
+                const auto rest = this->_data.substr(this->_at);
+                this->_at = this->_data.size();
+                return rest;
+            }
+
+            [[nodiscard]]
+            bool done() const noexcept {
+
+                return this->_at == this->_data.size();
+            }
+
+        private:
+
+            const std::string_view _data;
+            size_t _at{0};
+
+        };
+
+        // The length of the fixed header and the remaining length of the packet starting the
+        // data, 0 for the header when more bytes are needed and -1 when it is malformed.
+        int header_length(
+            const std::string& data,
+            size_t& remaining
+        ) {
+            remaining = 0;
+            size_t multiplier = 1;
+            for (size_t i = 1; i <= 4; i++) {
+                if (i >= data.size())
+                    return 0;
+
+                const auto byte = static_cast<uint8_t>(data[i]);
+                remaining += (byte & 0x7f) * multiplier;
+                multiplier *= 128;
+
+                if (0 == (byte & 0x80))
+                    return static_cast<int>(i + 1);
+            }
+            return -1;
+        }
+
+    }
+
+    Homer2MockBroker::Homer2MockBroker(
+        const Homer2MockBrokerOptions& options
+    ) noexcept: _options{options} {
+    }
+
+    Homer2MockBroker::~Homer2MockBroker() {
+
+        this->stop();
+    }
+
+    [[nodiscard]]
+    bool Homer2MockBroker::start() {
+
+        this->_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (this->_listenFd < 0)
+            return false;
+
+        const int on = 1;
+        (void) setsockopt(this->_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(this->_options.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        socklen_t len = sizeof(addr);
+        if (0 != ::bind(this->_listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+            0 != ::listen(this->_listenFd, SOMAXCONN) ||
+            0 != getsockname(this->_listenFd, reinterpret_cast<sockaddr*>(&addr), &len)) {
+            ::close(this->_listenFd);
+            this->_listenFd = -1;
+            return false;
+        }
+
+        this->_port = ntohs(addr.sin_port);
+        this->_running = true;
+        this->_thread = std::thread{[this]() { this->run(); }};
+
+        return true;
+    }
+
+    void Homer2MockBroker::stop() noexcept {
+
+        if (!this->_running.exchange(false))
+            return;
+
+        this->_thread.join();
+        ::close(this->_listenFd);
+        this->_listenFd = -1;
+    }
+
+    [[nodiscard]]
+    uint16_t Homer2MockBroker::port() const noexcept {
+
+        return this->_port;
+    }
+
+    [[nodiscard]]
+    Homer2MockBrokerStats Homer2MockBroker::stats() const noexcept {
+
+        std::lock_guard<std::mutex> lock{this->_statsMutex};
+        return this->_stats;
+    }
+
+    void Homer2MockBroker::run() noexcept {
+
+        std::vector<Connection> connections{};
+        std::vector<pollfd> fds{};
+
+        // Takes one packet, false when it is not one a publisher may send at that point.
+        const auto packet = [&](Connection& c, const uint8_t header, const std::string_view body) {
+            const auto type = static_cast<uint8_t>(header >> 4);
+            const auto flags = static_cast<uint8_t>(header & 0x0f);
+            Cursor cursor{body};
+
+            if (!c.connected && CONNECT != type)
+                return false;
+
+            std::lock_guard<std::mutex> lock{this->_statsMutex};
+
+            switch (type) {
+                case CONNECT: {
+                    std::string protocol{};
+                    uint8_t level = 0;
+                    uint8_t connectFlags = 0;
+                    uint16_t keepAlive = 0;
+                    std::string clientId{};
+                    if (c.connected || 0 != flags ||
+                        !cursor.string(protocol) || "MQTT" != protocol ||
+                        !cursor.u8(level) || 4 != level ||
+                        !cursor.u8(connectFlags) || !cursor.u16(keepAlive) ||
+                        !cursor.string(clientId))
+                        return false;
+
+                    // Reserved, a will, or a password without a username.
+                    if (0 != (connectFlags & 0x01) || 0 != (connectFlags & 0x04) ||
+                        (0 != (connectFlags & 0x40) && 0 == (connectFlags & 0x80)))
+                        return false;
+
+                    std::string username{};
+                    std::string password{};
+                    if ((0 != (connectFlags & 0x80) && !cursor.string(username)) ||
+                        (0 != (connectFlags & 0x40) && !cursor.string(password)) ||
+                        !cursor.done())
+                        return false;
+
+                    c.connected = true;
+                    c.out += CONNACK_ACCEPTED;
+
+                    this->_stats.connects++;
+                    this->_stats.clientId = clientId;
+                    this->_stats.username = username;
+                    this->_stats.password = password;
+                    this->_stats.keepAliveSeconds = keepAlive;
+                    return true;
+                }
+
+                case PUBLISH: {
+                    Homer2MockBrokerMessage message{};
+                    message.connection = c.number;
+                    message.qos = static_cast<uint8_t>((flags >> 1) & 0x03);
+                    message.dup = 0 != (flags & 0x08);
+
+                    if (message.qos > 1 || (0 == message.qos && message.dup) ||
+                        !cursor.string(message.topic) || message.topic.empty())
+                        return false;
+
+                    if (1 == message.qos && (!cursor.u16(message.packetId) || 0 == message.packetId))
+                        return false;
+
+                    message.payload = std::string{cursor.rest()};
+
+                    if (1 == message.qos && !c.unacked) {
+                        const std::array<char, 4> puback{
+                            0x40, 0x02,
+                            static_cast<char>(message.packetId >> 8), static_cast<char>(message.packetId)
+                        };
+                        c.out.append(puback.data(), puback.size());
+                        this->_stats.pubacks++;
+                    }
+
+                    this->_stats.messages.push_back(std::move(message));
+                    return true;
+                }
+
+                case PINGREQ:
+                    if (0 != flags || !body.empty())
+                        return false;
+
+                    c.out += PINGRESP;
+                    this->_stats.pingreqs++;
+                    return true;
+
+                case DISCONNECT:
+                    if (0 != flags || !body.empty())
+                        return false;
+
+                    this->_stats.disconnects++;
+                    c.closed = true;
+                    return true;
+
+                default:
+                    return false;
+            }
+        };
+
+        // Takes every packet that arrived whole, closes the connection on one that is not valid.
+        const auto take = [&](Connection& c) {
+            auto published = false;
+
+            while (!c.closed && !c.in.empty()) {
+                size_t remaining = 0;
+                const auto headerLen = header_length(c.in, remaining);
+                if (0 == headerLen)
+                    break;
+
+                if (headerLen < 0 || remaining > MAX_PACKET_BYTES) {
+                    c.closed = true;
+                    break;
+                }
+
+                const auto packetLen = static_cast<size_t>(headerLen) + remaining;
+                if (c.in.size() < packetLen)
+                    break;
+
+                const auto header = static_cast<uint8_t>(c.in[0]);
+                if (!packet(c, header, std::string_view{c.in}.substr(static_cast<size_t>(headerLen), remaining))) {
+                    std::lock_guard<std::mutex> lock{this->_statsMutex};
+                    this->_stats.invalid++;
+                    c.closed = true;
+                    break;
+                }
+
+                published |= PUBLISH == (header >> 4);
+                c.in.erase(0, packetLen);
+            }
+
+            if (c.unacked && published)
+                c.closed = true;
+
+            if (c.closed) {
+                ::close(c.fd);
+                c.out.clear();
+            }
+        };
+
+        while (this->_running) {
+
+            fds.clear();
+            fds.push_back({this->_listenFd, POLLIN, 0});
+
+            for (const auto& c: connections) {
+                auto events = static_cast<short>(c.out.empty() ? POLLIN : POLLIN | POLLOUT);
+                fds.push_back({c.fd, events, 0});
+            }
+
+            (void) ::poll(fds.data(), fds.size(), IDLE_POLL_MILLIS);
+
+            for (size_t i = 0; i < connections.size(); i++) {
+                auto& c = connections[i];
+                const auto revents = fds[i + 1].revents;
+
+                if (0 != (revents & (POLLIN | POLLHUP | POLLERR))) {
+                    std::array<char, 4096> chunk{};
+                    const auto read = ::recv(c.fd, chunk.data(), chunk.size(), 0);
+                    if (0 == read || (read < 0 && EAGAIN != errno && EWOULDBLOCK != errno)) {
+                        ::close(c.fd);
+                        c.closed = true;
+                        continue;
+                    }
+                    if (read > 0)
+                        c.in.append(chunk.data(), static_cast<size_t>(read));
+                }
+
+                take(c);
+
+                if (c.closed || c.out.empty())
+                    continue;
+
+                const auto written = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                if (written > 0)
+                    c.out.erase(0, static_cast<size_t>(written));
+            }
+
+            connections.erase(
+                std::remove_if(connections.begin(), connections.end(), [](const Connection& c) { return c.closed; }),
+                connections.end()
+            );
+
+            if (0 != (fds[0].revents & POLLIN)) {
+                const auto fd = ::accept(this->_listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+                    std::lock_guard<std::mutex> lock{this->_statsMutex};
+                    this->_stats.connections++;
+
+                    Connection c{fd};
+                    c.number = this->_stats.connections;
+                    c.unacked = c.number <= this->_options.unackedConnections;
+                    connections.push_back(std::move(c));
+                }
+            }
+        }
+
+        for (const auto& c: connections)
+            ::close(c.fd);
+    }
+
+}
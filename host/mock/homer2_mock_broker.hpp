@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace homer2::mock {
+
+    struct Homer2MockBrokerOptions {
+
+        // 0 picks a free port, see Homer2MockBroker::port().
+        uint16_t port{0};
+
+        // The first this many connections have their publishes left unacknowledged, and are
+        // closed once one arrives, as when a broker goes away with messages in flight.
+        uint32_t unackedConnections{0};
+
+    };
+
+    struct Homer2MockBrokerMessage {
+
+        // Of the connection it arrived on, counted from 1.
+        uint64_t connection{0};
+
+        std::string topic{};
+
+        std::string payload{};
+
+        uint8_t qos{0};
+
+        bool dup{false};
+
+        // 0 for qos 0.
+        uint16_t packetId{0};
+
+    };
+
+    struct Homer2MockBrokerStats {
+
+        uint64_t connections{0};
+
+        // Accepted with a CONNACK, their client id, credentials and keep alive are those of the
+        // latest one.
+        uint64_t connects{0};
+        std::string clientId{};
+        std::string username{};
+        std::string password{};
+        uint16_t keepAliveSeconds{0};
+
+        std::vector<Homer2MockBrokerMessage> messages{};
+
+        uint64_t pubacks{0};
+
+        uint64_t pingreqs{0};
+
+        uint64_t disconnects{0};
+
+        // Not valid MQTT 3.1.1 from a publisher, the connection is closed.
+        uint64_t invalid{0};
+
+    };
+
+    // Stand-in for an MQTT 3.1.1 broker on 127.0.0.1, serving a thread of its own. Takes what a
+    // publisher sends, validates it and answers as a broker would, keeping every message. Never
+    // forwards anything, there are no subscribers.
+    class Homer2MockBroker {
+    public:
+
+        Homer2MockBroker& operator=(const Homer2MockBroker& other) noexcept = delete;
+
+        Homer2MockBroker& operator=(Homer2MockBroker&& other) = delete;
+
+        Homer2MockBroker(Homer2MockBroker&& other) = delete;
+
+        Homer2MockBroker(const Homer2MockBroker& other) noexcept = delete;
+
+
+        explicit Homer2MockBroker(
+            const Homer2MockBrokerOptions& options
+        ) noexcept;
+
+        ~Homer2MockBroker();
+
+
+        [[nodiscard]]
+        bool start();
+
+        void stop() noexcept;
+
+        [[nodiscard]]
+        uint16_t port() const noexcept;
+
+        [[nodiscard]]
+        Homer2MockBrokerStats stats() const noexcept;
+
+    private:
+
+        void run() noexcept;
+
+        const Homer2MockBrokerOptions _options;
+
+        int _listenFd{-1};
+        uint16_t _port{0};
+
+        std::atomic<bool> _running{false};
+        std::thread _thread{};
+
+        mutable std::mutex _statsMutex{};
+        Homer2MockBrokerStats _stats{};
+
+    };
+
+}
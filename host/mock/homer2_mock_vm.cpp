@@ -0,0 +1,649 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include "homer2_mock_vm.hpp"
+
+namespace homer2::mock {
+
+    namespace {
+
+        // How often the loop looks up from the sockets to see whether it is stopped.
+        constexpr int IDLE_POLL_MILLIS = 50;
+
+        constexpr size_t MAX_REQUEST_BYTES = 1024 * 1024;
+
+        uint64_t now_millis() {
+
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        // Just enough of JSON to hold the body against what OpenTSDB's /api/put takes: a single
+        // datapoint or an array of them, each with a metric, a numeric value, an optional integer
+        // timestamp and at least one string tag.
+        class OpenTsdbParser {
+        public:
+
+            explicit OpenTsdbParser(
+                const std::string_view json
+            ) noexcept: _p{json.data()},
+                        _end{json.data() + json.size()} {
+            }
+
+            // The number of datapoints, or -1 if the body is not valid.
+            [[nodiscard]]
+            int64_t count() noexcept {
+
+                int64_t datapoints = 0;
+
+                this->ws();
+                if (this->peek('[')) {
+                    this->_p++;
+                    this->ws();
+                    if (this->peek(']')) {
+                        this->_p++;
+                    }
+                    else {
+                        do {
+                            this->ws();
+                            if (!this->datapoint())
+                                return -1;
+                            datapoints++;
+                            this->ws();
+                        } while (this->accept(','));
+
+                        if (!this->accept(']'))
+                            return -1;
+                    }
+                }
+                else {
+                    if (!this->datapoint())
+                        return -1;
+                    datapoints++;
+                }
+
+                this->ws();
+                return this->_p == this->_end ? datapoints : -1;
+            }
+
+        private:
+
+            [[nodiscard]]
+            bool datapoint() noexcept {
+
+                if (!this->accept('{'))
+                    return false;
+
+                bool metric = false;
+                bool value = false;
+                bool tags = false;
+
+                this->ws();
+                if (this->accept('}'))
+                    return false;
+
+                do {
+                    this->ws();
+                    std::string key;
+                    if (!this->string(&key))
+                        return false;
+                    this->ws();
+                    if (!this->accept(':'))
+                        return false;
+                    this->ws();
+
+                    if ("metric" == key) {
+                        std::string name;
+                        if (!this->string(&name) || name.empty())
+                            return false;
+                        metric = true;
+                    }
+                    else if ("value" == key) {
+                        bool integer = false;
+                        if (!this->number(&integer))
+                            return false;
+                        value = true;
+                    }
+                    else if ("timestamp" == key) {
+                        bool integer = false;
+                        if (!this->number(&integer) || !integer)
+                            return false;
+                    }
+                    else if ("tags" == key) {
+                        if (!this->tags())
+                            return false;
+                        tags = true;
+                    }
+                    else if (!this->value()) {
+                        return false;
+                    }
+
+                    this->ws();
+                } while (this->accept(','));
+
+                return this->accept('}') && metric && value && tags;
+            }
+
+            [[nodiscard]]
+            bool tags() noexcept {
+
+                if (!this->accept('{'))
+                    return false;
+
+                size_t count = 0;
+                this->ws();
+                if (this->accept('}'))
+                    return false;
+
+                do {
+                    this->ws();
+                    std::string key;
+                    std::string tag;
+                    if (!this->string(&key) || key.empty())
+                        return false;
+                    this->ws();
+                    if (!this->accept(':'))
+                        return false;
+                    this->ws();
+                    if (!this->string(&tag) || tag.empty())
+                        return false;
+                    count++;
+                    this->ws();
+                } while (this->accept(','));
+
+                return this->accept('}') && count > 0;
+            }
+
+            [[nodiscard]]
+            bool value() noexcept {
+
+                bool integer = false;
+
+                if (this->peek('"'))
+                    return this->string(nullptr);
+
+                if (this->peek('{') || this->peek('[')) {
+                    const char close = *this->_p == '{' ? '}' : ']';
+                    const bool object = close == '}';
+                    this->_p++;
+                    this->ws();
+                    if (this->accept(close))
+                        return true;
+                    do {
+                        this->ws();
+                        if (object) {
+                            if (!this->string(nullptr))
+                                return false;
+                            this->ws();
+                            if (!this->accept(':'))
+                                return false;
+                            this->ws();
+                        }
+                        if (!this->value())
+                            return false;
+                        this->ws();
+                    } while (this->accept(','));
+                    return this->accept(close);
+                }
+
+                for (const auto* const literal: {"true", "false", "null"}) {
+                    const auto len = strlen(literal);
+                    if (static_cast<size_t>(this->_end - this->_p) >= len && 0 == strncmp(this->_p, literal, len)) {
+                        this->_p += len;
+                        return true;
+                    }
+                }
+
+                return this->number(&integer);
+            }
+
+            [[nodiscard]]
+            bool string(
+                std::string* const out
+            ) noexcept {
+
+                if (!this->accept('"'))
+                    return false;
+
+                while (this->_p < this->_end && *this->_p != '"') {
+                    if (static_cast<unsigned char>(*this->_p) < 0x20)
+                        return false;
+
+                    if (*this->_p == '\\') {
+                        this->_p++;
+                        if (this->_p == this->_end || '\0' == *this->_p || nullptr == strchr("\"\\/bfnrtu", *this->_p))
+                            return false;
+                    }
+
+                    if (nullptr != out)
+                        out->push_back(*this->_p);
+                    this->_p++;
+                }
+
+                return this->accept('"');
+            }
+
+            [[nodiscard]]
+            bool number(
+                bool* const integer
+            ) noexcept {
+
+                const auto* const start = this->_p;
+                *integer = true;
+
+                (void) this->accept('-');
+                if (!this->digits())
+                    return false;
+
+                if (this->accept('.')) {
+                    *integer = false;
+                    if (!this->digits())
+                        return false;
+                }
+
+                if (this->accept('e') || this->accept('E')) {
+                    *integer = false;
+                    if (!this->accept('+'))
+                        (void) this->accept('-');
+                    if (!this->digits())
+                        return false;
+                }
+
+                return this->_p > start;
+            }
+
+            [[nodiscard]]
+            bool digits() noexcept {
+
+                const auto* const start = this->_p;
+                while (this->_p < this->_end && *this->_p >= '0' && *this->_p <= '9')
+                    this->_p++;
+                return this->_p > start;
+            }
+
+            void ws() noexcept {
+
+                while (this->_p < this->_end &&
+                       (*this->_p == ' ' || *this->_p == '\t' || *this->_p == '\r' || *this->_p == '\n'))
+                    this->_p++;
+            }
+
+            [[nodiscard]]
+            bool peek(
+                const char c
+            ) const noexcept {
+
+                return this->_p < this->_end && *this->_p == c;
+            }
+
+            [[nodiscard]]
+            bool accept(
+                const char c
+            ) noexcept {
+
+                if (!this->peek(c))
+                    return false;
+                this->_p++;
+                return true;
+            }
+
+            const char* _p;
+            const char* const _end;
+
+        };
+
+        enum class Action {
+            NONE,
+            RESPOND,
+            RESET,
+        };
+
+        struct Connection {
+
+            int fd{-1};
+            bool closed{false};
+
+            std::string in{};
+            std::string out{};
+
+            // The request being answered, only one at a time.
+            Action action{Action::NONE};
+            uint64_t dueMillis{0};
+            std::string response{};
+            bool closeAfter{false};
+
+        };
+
+        std::string header_value(
+            const std::string_view headers,
+            const std::string_view name
+        ) {
+            size_t at = 0;
+            while (at < headers.size()) {
+                const auto eol = headers.find("\r\n", at);
+                const auto line = headers.substr(at, eol == std::string_view::npos ? std::string_view::npos : eol - at);
+                const auto colon = line.find(':');
+
+                if (colon == name.size() &&
+                    std::equal(name.begin(), name.end(), line.begin(), [](const char a, const char b) {
+                        return tolower(static_cast<unsigned char>(a)) == tolower(static_cast<unsigned char>(b));
+                    })) {
+                    auto value = line.substr(colon + 1);
+                    while (!value.empty() && value.front() == ' ')
+                        value.remove_prefix(1);
+                    return std::string{value};
+                }
+
+                if (eol == std::string_view::npos)
+                    break;
+                at = eol + 2;
+            }
+            return "";
+        }
+
+        std::string response(
+            const int status,
+            const char* const reason,
+            const bool close
+        ) {
+            return "HTTP/1.1 " + std::to_string(status) + " " + reason +
+                   "\r\nContent-Length: 0" +
+                   (close ? "\r\nConnection: close" : "") +
+                   "\r\n\r\n";
+        }
+
+        // A whole gzip stream, as sent with Content-Encoding: gzip. Returns false if it is not
+        // valid, has data trailing it or inflates past MAX_REQUEST_BYTES.
+        bool gunzip(
+            const std::string_view compressed,
+            std::string& out
+        ) {
+            z_stream stream{};
+            if (Z_OK != inflateInit2(&stream, 16 + MAX_WBITS))
+                return false;
+
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+            stream.avail_in = static_cast<uInt>(compressed.size());
+
+            auto status = Z_OK;
+            std::array<char, 4096> chunk{};
+            while (Z_OK == status && out.size() <= MAX_REQUEST_BYTES) {
+                stream.next_out = reinterpret_cast<Bytef*>(chunk.data());
+                stream.avail_out = static_cast<uInt>(chunk.size());
+                status = inflate(&stream, Z_NO_FLUSH);
+                out.append(chunk.data(), chunk.size() - stream.avail_out);
+            }
+
+            inflateEnd(&stream);
+            return Z_STREAM_END == status && 0 == stream.avail_in && out.size() <= MAX_REQUEST_BYTES;
+        }
+
+        void reset(
+            Connection& connection
+        ) {
+            const linger zero{1, 0};
+            (void) setsockopt(connection.fd, SOL_SOCKET, SO_LINGER, &zero, sizeof(zero));
+            ::close(connection.fd);
+            connection.closed = true;
+        }
+
+    }
+
+    Homer2MockVm::Homer2MockVm(
+        const Homer2MockVmOptions& options
+    ) noexcept: _options{options} {
+    }
+
+    Homer2MockVm::~Homer2MockVm() {
+
+        this->stop();
+    }
+
+    [[nodiscard]]
+    bool Homer2MockVm::start() {
+
+        this->_listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (this->_listenFd < 0)
+            return false;
+
+        const int on = 1;
+        (void) setsockopt(this->_listenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(this->_options.port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        socklen_t len = sizeof(addr);
+        if (0 != ::bind(this->_listenFd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+            0 != ::listen(this->_listenFd, SOMAXCONN) ||
+            0 != getsockname(this->_listenFd, reinterpret_cast<sockaddr*>(&addr), &len)) {
+            ::close(this->_listenFd);
+            this->_listenFd = -1;
+            return false;
+        }
+
+        this->_port = ntohs(addr.sin_port);
+        this->_running = true;
+        this->_thread = std::thread{[this]() { this->run(); }};
+
+        return true;
+    }
+
+    void Homer2MockVm::stop() noexcept {
+
+        if (!this->_running.exchange(false))
+            return;
+
+        this->_thread.join();
+        ::close(this->_listenFd);
+        this->_listenFd = -1;
+    }
+
+    [[nodiscard]]
+    uint16_t Homer2MockVm::port() const noexcept {
+
+        return this->_port;
+    }
+
+    [[nodiscard]]
+    Homer2MockVmStats Homer2MockVm::stats() const noexcept {
+
+        std::lock_guard<std::mutex> lock{this->_statsMutex};
+        return this->_stats;
+    }
+
+    void Homer2MockVm::run() noexcept {
+
+        std::mt19937 generator{std::random_device{}()};
+        std::uniform_real_distribution<double> chance{0.0, 1.0};
+
+        std::vector<Connection> connections{};
+        std::vector<pollfd> fds{};
+
+        // Takes the next request off the connection, if all of it arrived, and decides its fate.
+        const auto take = [&](Connection& c) {
+            const auto headerEnd = c.in.find("\r\n\r\n");
+            if (headerEnd == std::string::npos) {
+                if (c.in.size() > MAX_REQUEST_BYTES)
+                    reset(c);
+                return;
+            }
+
+            const std::string_view head{c.in.data(), headerEnd};
+            const auto lineEnd = head.find("\r\n");
+            const auto line = head.substr(0, lineEnd);
+            const auto headers = lineEnd == std::string_view::npos ? std::string_view{} : head.substr(lineEnd + 2);
+
+            const auto lengthHeader = header_value(headers, "Content-Length");
+            const auto length = lengthHeader.empty() ? 0 : std::strtoull(lengthHeader.c_str(), nullptr, 10);
+            if (length > MAX_REQUEST_BYTES) {
+                reset(c);
+                return;
+            }
+
+            const auto wire = headerEnd + 4 + length;
+            if (c.in.size() < wire)
+                return;
+
+            const std::string_view body{c.in.data() + headerEnd + 4, length};
+            const auto close = 0 == strcasecmp(header_value(headers, "Connection").c_str(), "close");
+
+            std::lock_guard<std::mutex> lock{this->_statsMutex};
+            this->_stats.requests++;
+
+            c.action = Action::RESPOND;
+            c.dueMillis = now_millis() + this->_options.latencyMillis;
+            c.closeAfter = close;
+
+            if (chance(generator) < this->_options.resetRate) {
+                this->_stats.resets++;
+                c.action = Action::RESET;
+            }
+            else if (chance(generator) < this->_options.errorRate) {
+                this->_stats.errors++;
+                c.response = response(503, "Service Unavailable", close);
+            }
+            else if (0 != line.rfind("POST /api/put ", 0)) {
+                this->_stats.invalid++;
+                c.response = response(404, "Not Found", close);
+            }
+            else if (const auto encoding = header_value(headers, "Content-Encoding");
+                     !encoding.empty() && 0 != strcasecmp(encoding.c_str(), "gzip")) {
+                this->_stats.invalid++;
+                c.response = response(415, "Unsupported Media Type", close);
+            }
+            else {
+                std::string inflated{};
+                const auto gzipped = !encoding.empty();
+                const auto datapoints = gzipped && !gunzip(body, inflated)
+                                        ? -1
+                                        : OpenTsdbParser{gzipped ? std::string_view{inflated} : body}.count();
+                if (datapoints < 0) {
+                    this->_stats.invalid++;
+                    c.response = response(400, "Bad Request", close);
+                }
+                else {
+                    this->_stats.accepted++;
+                    this->_stats.datapoints += static_cast<uint64_t>(datapoints);
+                    this->_stats.bodyBytes += length;
+                    this->_stats.decodedBytes += gzipped ? inflated.size() : length;
+                    this->_stats.wireBytes += wire;
+                    c.response = response(204, "No Content", close);
+                }
+            }
+
+            c.in.erase(0, wire);
+        };
+
+        while (this->_running) {
+
+            fds.clear();
+            fds.push_back({this->_listenFd, POLLIN, 0});
+
+            auto timeout = IDLE_POLL_MILLIS;
+            const auto now = now_millis();
+            for (const auto& c: connections) {
+                auto events = static_cast<short>(c.out.empty() ? POLLIN : POLLIN | POLLOUT);
+                fds.push_back({c.fd, events, 0});
+                if (c.action != Action::NONE)
+                    timeout = std::min<int>(timeout, c.dueMillis > now ? static_cast<int>(c.dueMillis - now) : 0);
+            }
+
+            (void) ::poll(fds.data(), fds.size(), timeout);
+
+            for (size_t i = 0; i < connections.size(); i++) {
+                auto& c = connections[i];
+                const auto revents = fds[i + 1].revents;
+
+                if (0 != (revents & (POLLIN | POLLHUP | POLLERR))) {
+                    std::array<char, 4096> chunk{};
+                    const auto read = ::recv(c.fd, chunk.data(), chunk.size(), 0);
+                    if (0 == read || (read < 0 && EAGAIN != errno && EWOULDBLOCK != errno)) {
+                        ::close(c.fd);
+                        c.closed = true;
+                        continue;
+                    }
+                    if (read > 0)
+                        c.in.append(chunk.data(), static_cast<size_t>(read));
+                }
+
+                if (c.action == Action::NONE && c.out.empty())
+                    take(c);
+
+                if (c.closed || c.action == Action::NONE || now_millis() < c.dueMillis)
+                    continue;
+
+                if (c.action == Action::RESET) {
+                    reset(c);
+                    continue;
+                }
+
+                c.out = std::move(c.response);
+                c.action = Action::NONE;
+
+                const auto written = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                if (written > 0)
+                    c.out.erase(0, static_cast<size_t>(written));
+
+                if (c.out.empty() && c.closeAfter) {
+                    ::close(c.fd);
+                    c.closed = true;
+                }
+            }
+
+            for (size_t i = 0; i < connections.size(); i++) {
+                auto& c = connections[i];
+                if (c.closed || c.out.empty() || 0 == (fds[i + 1].revents & POLLOUT))
+                    continue;
+
+                const auto written = ::send(c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL);
+                if (written > 0)
+                    c.out.erase(0, static_cast<size_t>(written));
+
+                if (c.out.empty() && c.closeAfter) {
+                    ::close(c.fd);
+                    c.closed = true;
+                }
+            }
+
+            connections.erase(
+                std::remove_if(connections.begin(), connections.end(), [](const Connection& c) { return c.closed; }),
+                connections.end()
+            );
+
+            if (0 != (fds[0].revents & POLLIN)) {
+                const auto fd = ::accept(this->_listenFd, nullptr, nullptr);
+                if (fd >= 0) {
+                    (void) fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+                    connections.push_back(Connection{fd});
+
+                    std::lock_guard<std::mutex> lock{this->_statsMutex};
+                    this->_stats.connections++;
+                }
+            }
+        }
+
+        for (const auto& c: connections)
+            ::close(c.fd);
+    }
+
+}
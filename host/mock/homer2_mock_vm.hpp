@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+namespace homer2::mock {
+
+    struct Homer2MockVmOptions {
+
+        // 0 picks a free port, see Homer2MockVm::port().
+        uint16_t port{4242};
+
+        // Added before answering each request.
+        uint64_t latencyMillis{0};
+
+        // Chance of a request having its connection reset instead of being answered.
+        double resetRate{0.0};
+
+        // Chance of a request being answered with a 503.
+        double errorRate{0.0};
+
+    };
+
+    struct Homer2MockVmStats {
+
+        uint64_t connections{0};
+
+        uint64_t requests{0};
+
+        // Answered with a 204, their datapoints counted.
+        uint64_t accepted{0};
+
+        // Not valid OpenTSDB JSON, plain or gzipped, or not a POST to /api/put.
+        uint64_t invalid{0};
+
+        uint64_t resets{0};
+
+        uint64_t errors{0};
+
+        uint64_t datapoints{0};
+
+        // Of the accepted requests only, the headers included in the wire bytes.
+        uint64_t bodyBytes{0};
+        uint64_t wireBytes{0};
+
+        // Of the accepted requests only, their bodies once uncompressed.
+        uint64_t decodedBytes{0};
+
+    };
+
+    // Stand-in for VictoriaMetrics' OpenTSDB HTTP endpoint, serving /api/put on 127.0.0.1 from a
+    // thread of its own. Every body, gzipped or not, is validated and its datapoints counted, and
+    // failures can be injected to see how the pusher copes.
+    class Homer2MockVm {
+    public:
+
+        Homer2MockVm& operator=(const Homer2MockVm& other) noexcept = delete;
+
+        Homer2MockVm& operator=(Homer2MockVm&& other) = delete;
+
+        Homer2MockVm(Homer2MockVm&& other) = delete;
+
+        Homer2MockVm(const Homer2MockVm& other) noexcept = delete;
+
+
+        explicit Homer2MockVm(
+            const Homer2MockVmOptions& options
+        ) noexcept;
+
+        ~Homer2MockVm();
+
+
+        [[nodiscard]]
+        bool start();
+
+        void stop() noexcept;
+
+        [[nodiscard]]
+        uint16_t port() const noexcept;
+
+        [[nodiscard]]
+        Homer2MockVmStats stats() const noexcept;
+
+    private:
+
+        void run() noexcept;
+
+        const Homer2MockVmOptions _options;
+
+        int _listenFd{-1};
+        uint16_t _port{0};
+
+        std::atomic<bool> _running{false};
+        std::thread _thread{};
+
+        mutable std::mutex _statsMutex{};
+        Homer2MockVmStats _stats{};
+
+    };
+
+}
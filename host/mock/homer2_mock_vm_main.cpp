@@ -0,0 +1,86 @@
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include "homer2_mock_vm.hpp"
+
+// Runs the mock on its own, for pointing a pico or another host build at it:
+//   homer2_mock_vm [--port N] [--latency-ms N] [--reset-rate R] [--error-rate R]
+
+namespace {
+
+    volatile std::sig_atomic_t stopped = 0;
+
+    void usage() {
+
+        std::cerr << "usage: homer2_mock_vm [--port N] [--latency-ms N] [--reset-rate R] [--error-rate R]"
+                  << std::endl;
+    }
+
+    void print(
+        const homer2::mock::Homer2MockVmStats& stats
+    ) {
+        std::cout << "connections: " << stats.connections
+                  << ", requests: " << stats.requests
+                  << ", accepted: " << stats.accepted
+                  << ", invalid: " << stats.invalid
+                  << ", resets: " << stats.resets
+                  << ", 5xx: " << stats.errors
+                  << ", datapoints: " << stats.datapoints
+                  << std::endl;
+    }
+
+}
+
+int main(
+    const int argc,
+    char** const argv
+) {
+    homer2::mock::Homer2MockVmOptions options{};
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 == argc) {
+            usage();
+            return 2;
+        }
+
+        const auto* const value = argv[i + 1];
+        if (0 == strcmp("--port", argv[i]))
+            options.port = static_cast<uint16_t>(std::strtoul(value, nullptr, 10));
+        else if (0 == strcmp("--latency-ms", argv[i]))
+            options.latencyMillis = std::strtoull(value, nullptr, 10);
+        else if (0 == strcmp("--reset-rate", argv[i]))
+            options.resetRate = std::strtod(value, nullptr);
+        else if (0 == strcmp("--error-rate", argv[i]))
+            options.errorRate = std::strtod(value, nullptr);
+        else {
+            usage();
+            return 2;
+        }
+        i++;
+    }
+
+    homer2::mock::Homer2MockVm vm{options};
+    if (!vm.start()) {
+        std::cerr << "could not listen on port: " << options.port << std::endl;
+        return 1;
+    }
+
+    std::signal(SIGINT, [](int) { stopped = 1; });
+    std::signal(SIGTERM, [](int) { stopped = 1; });
+
+    std::cout << "listening on 127.0.0.1:" << vm.port() << std::endl;
+
+    for (uint64_t tick = 1; 0 == stopped; tick++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds{100});
+        if (0 == tick % 50)
+            print(vm.stats());
+    }
+
+    vm.stop();
+    print(vm.stats());
+
+    return 0;
+}
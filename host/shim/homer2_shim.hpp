@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace homer2::shim {
+
+    // Waits up to the timeout for the sockets, then invokes the lwIP callbacks that are due.
+    // What the cyw43 background worker does on the pico, it must be called from the thread
+    // driving homer2.
+    void poll(
+        uint64_t timeoutMillis
+    ) noexcept;
+
+    // Open tcp and udp pcbs, for telling a leak apart from a slow server.
+    [[nodiscard]]
+    size_t open_pcbs() noexcept;
+
+    // The simulated flash behind XIP_BASE, PICO_FLASH_SIZE_BYTES long, for inspecting what was
+    // programmed or damaging it. Erased when the program starts.
+    [[nodiscard]]
+    uint8_t* flash() noexcept;
+
+    // Erases the whole flash, as a fresh chip.
+    void flash_erase() noexcept;
+
+    // Raises the interrupt as the hardware would, its handler runs right away when one is set and
+    // the interrupt enabled. Nothing else raises one on the host.
+    void irq_raise(
+        uint32_t num
+    ) noexcept;
+
+    // Keeps the channel busy, as if still transferring, until it is set idle again or aborted.
+    // Channels are idle unless set busy, they never transfer anything.
+    void dma_set_busy(
+        uint32_t channel,
+        bool busy
+    ) noexcept;
+
+    // Times the channel was aborted.
+    [[nodiscard]]
+    size_t dma_aborts(
+        uint32_t channel
+    ) noexcept;
+
+}
@@ -0,0 +1,709 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// The kernel's, lwIP's own follows.
+#undef TCP_MSS
+
+#include <pico/time.h>
+#include <lwip/dns.h>
+#include <lwip/tcp.h>
+#include <lwip/udp.h>
+
+#include "homer2_shim.hpp"
+
+// lwIP's raw api on top of non-blocking sockets. The callbacks are only ever invoked from
+// homer2::shim::poll(), never from within a call made by homer2, as on the pico where they run
+// in the background worker with the lwIP lock held.
+
+struct tcp_pcb {
+
+    int fd{-1};
+    bool established{false};
+    bool remoteClosed{false};
+
+    // Closed by homer2 or by an error, freed once no callback is running anymore.
+    bool freed{false};
+
+    u8_t soOptions{0};
+
+    void* arg{nullptr};
+    tcp_recv_fn recv{nullptr};
+    tcp_sent_fn sent{nullptr};
+    tcp_poll_fn poll{nullptr};
+    tcp_err_fn err{nullptr};
+    tcp_connected_fn connected{nullptr};
+
+    uint64_t pollIntervalMillis{0};
+    uint64_t nextPollMillis{0};
+
+    // Written by homer2 but not taken by the kernel yet, bounded by TCP_SND_BUF.
+    std::vector<char> queue{};
+
+    // Taken by the kernel, reported through the sent callback as if acked.
+    size_t unreported{0};
+
+};
+
+struct udp_pcb {
+
+    int fd{-1};
+    bool freed{false};
+
+    udp_recv_fn recv{nullptr};
+    void* arg{nullptr};
+
+};
+
+const ip_addr_t ip_addr_any{IPADDR_ANY};
+
+namespace {
+
+    // lwIP's slow timer, tcp_poll() intervals are counted in its ticks.
+    constexpr uint64_t SLOW_TIMER_MILLIS = 500;
+
+    constexpr size_t RECV_CHUNK_BYTES = TCP_MSS;
+
+    std::vector<tcp_pcb*> tcp_pcbs{};
+
+    std::vector<udp_pcb*> udp_pcbs{};
+
+    uint64_t now_millis() {
+
+        return time_us_64() / 1000;
+    }
+
+    bool non_blocking(
+        const int fd
+    ) {
+        const auto flags = fcntl(fd, F_GETFL, 0);
+        return flags >= 0 && 0 == fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+    }
+
+    sockaddr_in to_sockaddr(
+        const ip_addr_t* const ip,
+        const u16_t port
+    ) {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = ip->addr;
+        return addr;
+    }
+
+    err_t translate(
+        const int error
+    ) {
+        switch (error) {
+            case ECONNREFUSED:
+            case ECONNRESET:
+            case EPIPE:
+                return ERR_RST;
+
+            case ETIMEDOUT:
+                return ERR_TIMEOUT;
+
+            case ENETUNREACH:
+            case EHOSTUNREACH:
+                return ERR_RTE;
+
+            default:
+                return ERR_ABRT;
+        }
+    }
+
+    void release(
+        tcp_pcb* const pcb
+    ) {
+        if (pcb->fd >= 0)
+            ::close(pcb->fd);
+
+        pcb->fd = -1;
+        pcb->freed = true;
+    }
+
+    // lwIP frees the pcb before reporting a fatal error, so does the shim.
+    void fail(
+        tcp_pcb* const pcb,
+        const err_t err
+    ) {
+        const auto callback = pcb->err;
+        const auto arg = pcb->arg;
+
+        release(pcb);
+
+        if (nullptr != callback)
+            callback(arg, err);
+    }
+
+    // Hands as much of the queue to the kernel as it takes.
+    bool flush(
+        tcp_pcb* const pcb
+    ) {
+        while (!pcb->queue.empty()) {
+
+            const auto written = ::send(pcb->fd, pcb->queue.data(), pcb->queue.size(), MSG_NOSIGNAL);
+
+            if (written < 0) {
+                if (EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno)
+                    return true;
+
+                fail(pcb, translate(errno));
+                return false;
+            }
+
+            pcb->queue.erase(pcb->queue.begin(), pcb->queue.begin() + written);
+            pcb->unreported += static_cast<size_t>(written);
+        }
+
+        return true;
+    }
+
+    void on_connect(
+        tcp_pcb* const pcb
+    ) {
+        int error = 0;
+        socklen_t len = sizeof(error);
+        if (0 != getsockopt(pcb->fd, SOL_SOCKET, SO_ERROR, &error, &len))
+            error = errno;
+
+        if (0 != error) {
+            fail(pcb, translate(error));
+            return;
+        }
+
+        pcb->established = true;
+
+        if (nullptr != pcb->connected)
+            (void) pcb->connected(pcb->arg, pcb, ERR_OK);
+    }
+
+    void on_readable(
+        tcp_pcb* const pcb
+    ) {
+        if (pcb->remoteClosed)
+            return;
+
+        std::array<char, RECV_CHUNK_BYTES> chunk{};
+        const auto read = ::recv(pcb->fd, chunk.data(), chunk.size(), 0);
+
+        if (read < 0) {
+            if (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)
+                fail(pcb, translate(errno));
+            return;
+        }
+
+        if (0 == read) {
+            pcb->remoteClosed = true;
+
+            if (nullptr != pcb->recv)
+                (void) pcb->recv(pcb->arg, pcb, nullptr, ERR_OK);
+            else
+                (void) tcp_close(pcb);
+
+            return;
+        }
+
+        auto* const pBuf = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(read), PBUF_RAM);
+        if (nullptr == pBuf) {
+            fail(pcb, ERR_MEM);
+            return;
+        }
+        memcpy(pBuf->payload, chunk.data(), static_cast<size_t>(read));
+
+        if (nullptr != pcb->recv)
+            (void) pcb->recv(pcb->arg, pcb, pBuf, ERR_OK);
+        else
+            pbuf_free(pBuf);
+    }
+
+    void report_sent(
+        tcp_pcb* const pcb
+    ) {
+        while (!pcb->freed && pcb->unreported > 0) {
+
+            const auto len = std::min<size_t>(pcb->unreported, UINT16_MAX);
+            pcb->unreported -= len;
+
+            if (nullptr != pcb->sent)
+                (void) pcb->sent(pcb->arg, pcb, static_cast<u16_t>(len));
+        }
+    }
+
+    void on_udp_readable(
+        udp_pcb* const pcb
+    ) {
+        std::array<char, UINT16_MAX> datagram{};
+        sockaddr_in from{};
+        socklen_t fromLen = sizeof(from);
+
+        const auto read = ::recvfrom(
+            pcb->fd,
+            datagram.data(),
+            datagram.size(),
+            0,
+            reinterpret_cast<sockaddr*>(&from),
+            &fromLen
+        );
+
+        if (read < 0)
+            return;
+
+        auto* const pBuf = pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(read), PBUF_RAM);
+        if (nullptr == pBuf)
+            return;
+        memcpy(pBuf->payload, datagram.data(), static_cast<size_t>(read));
+
+        if (nullptr == pcb->recv) {
+            pbuf_free(pBuf);
+            return;
+        }
+
+        const ip_addr_t addr{from.sin_addr.s_addr};
+        pcb->recv(pcb->arg, pcb, pBuf, &addr, ntohs(from.sin_port));
+    }
+
+    template<typename T>
+    void sweep(
+        std::vector<T*>& pcbs
+    ) {
+        pcbs.erase(
+            std::remove_if(
+                pcbs.begin(),
+                pcbs.end(),
+                [](T* const pcb) {
+                    if (!pcb->freed)
+                        return false;
+                    delete pcb;
+                    return true;
+                }
+            ),
+            pcbs.end()
+        );
+    }
+
+    uint64_t next_timer_millis() {
+
+        uint64_t next = UINT64_MAX;
+        for (const auto* const pcb: tcp_pcbs)
+            if (!pcb->freed && nullptr != pcb->poll)
+                next = std::min(next, pcb->nextPollMillis);
+        return next;
+    }
+
+}
+
+namespace homer2::shim {
+
+    void poll(
+        const uint64_t timeoutMillis
+    ) noexcept {
+
+        sweep(tcp_pcbs);
+        sweep(udp_pcbs);
+
+        // Callbacks may open new pcbs, those wait for the next round.
+        const auto tcps = tcp_pcbs;
+        const auto udps = udp_pcbs;
+
+        std::vector<pollfd> fds{};
+        for (const auto* const pcb: tcps) {
+            auto events = static_cast<short>(0);
+            if (!pcb->established || !pcb->queue.empty())
+                events |= POLLOUT;
+            if (pcb->established && !pcb->remoteClosed)
+                events |= POLLIN;
+            fds.push_back({pcb->fd, events, 0});
+        }
+        for (const auto* const pcb: udps)
+            fds.push_back({pcb->fd, POLLIN, 0});
+
+        // Pending acks are reported without waiting, as lwIP would on the next segment.
+        auto timeout = timeoutMillis;
+        for (const auto* const pcb: tcps)
+            if (pcb->unreported > 0)
+                timeout = 0;
+
+        const auto timer = next_timer_millis();
+        const auto at = now_millis();
+        if (timer != UINT64_MAX)
+            timeout = std::min(timeout, timer > at ? timer - at : 0);
+
+        (void) ::poll(fds.data(), fds.size(), static_cast<int>(std::min<uint64_t>(timeout, INT32_MAX)));
+
+        for (size_t i = 0; i < tcps.size(); i++) {
+            auto* const pcb = tcps[i];
+            const auto revents = fds[i].revents;
+
+            if (pcb->freed || 0 == revents)
+                continue;
+
+            if (!pcb->established) {
+                on_connect(pcb);
+                continue;
+            }
+
+            if (0 != (revents & POLLOUT) && !flush(pcb))
+                continue;
+
+            if (0 != (revents & (POLLIN | POLLHUP | POLLERR)))
+                on_readable(pcb);
+        }
+
+        for (auto* const pcb: tcps)
+            report_sent(pcb);
+
+        for (size_t i = 0; i < udps.size(); i++)
+            if (!udps[i]->freed && 0 != (fds[tcps.size() + i].revents & POLLIN))
+                on_udp_readable(udps[i]);
+
+        const auto now = now_millis();
+        for (auto* const pcb: tcps) {
+            if (pcb->freed || nullptr == pcb->poll || now < pcb->nextPollMillis)
+                continue;
+
+            pcb->nextPollMillis = now + pcb->pollIntervalMillis;
+            (void) pcb->poll(pcb->arg, pcb);
+        }
+
+        sweep(tcp_pcbs);
+        sweep(udp_pcbs);
+    }
+
+    [[nodiscard]]
+    size_t open_pcbs() noexcept {
+
+        return std::count_if(tcp_pcbs.begin(), tcp_pcbs.end(), [](const tcp_pcb* p) { return !p->freed; }) +
+               std::count_if(udp_pcbs.begin(), udp_pcbs.end(), [](const udp_pcb* p) { return !p->freed; });
+    }
+
+}
+
+extern "C" {
+
+int ip4addr_aton(
+    const char* const cp,
+    ip4_addr_t* const addr
+) {
+    in_addr parsed{};
+    if (1 != inet_pton(AF_INET, cp, &parsed))
+        return 0;
+
+    if (nullptr != addr)
+        addr->addr = parsed.s_addr;
+
+    return 1;
+}
+
+char* ip4addr_ntoa(
+    const ip4_addr_t* const addr
+) {
+    static char str[INET_ADDRSTRLEN];
+
+    in_addr in{};
+    in.s_addr = addr->addr;
+    return const_cast<char*>(inet_ntop(AF_INET, &in, str, sizeof(str)));
+}
+
+const ip_addr_t* dns_getserver(
+    const u8_t numdns
+) {
+    static ip_addr_t server{IPADDR_ANY};
+    static bool loaded = false;
+
+    if (0 != numdns)
+        return &ip_addr_any;
+
+    if (!loaded) {
+        loaded = true;
+
+        std::ifstream resolv{"/etc/resolv.conf"};
+        std::string line;
+        while (std::getline(resolv, line)) {
+            std::istringstream words{line};
+            std::string key;
+            std::string value;
+            if (words >> key >> value && "nameserver" == key && 1 == ip4addr_aton(value.c_str(), &server))
+                break;
+        }
+    }
+
+    return &server;
+}
+
+struct pbuf* pbuf_alloc(
+    const pbuf_layer layer,
+    const u16_t length,
+    const pbuf_type type
+) {
+    (void) layer;
+    (void) type;
+
+    auto* const p = static_cast<struct pbuf*>(std::malloc(sizeof(struct pbuf) + length));
+    if (nullptr == p)
+        return nullptr;
+
+    p->next = nullptr;
+    p->payload = reinterpret_cast<char*>(p) + sizeof(struct pbuf);
+    p->tot_len = length;
+    p->len = length;
+    return p;
+}
+
+u8_t pbuf_free(
+    struct pbuf* const p
+) {
+    std::free(p);
+    return 1;
+}
+
+u16_t pbuf_copy_partial(
+    const struct pbuf* const p,
+    void* const dataptr,
+    const u16_t len,
+    const u16_t offset
+) {
+    if (offset >= p->len)
+        return 0;
+
+    const auto copied = std::min<u16_t>(len, static_cast<u16_t>(p->len - offset));
+    memcpy(dataptr, static_cast<const char*>(p->payload) + offset, copied);
+    return copied;
+}
+
+void tcp_set_option(
+    struct tcp_pcb* const pcb,
+    const u8_t opt
+) {
+    pcb->soOptions |= opt;
+}
+
+void tcp_nagle_disable(
+    struct tcp_pcb* const pcb
+) {
+    const int on = 1;
+    (void) setsockopt(pcb->fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+u16_t tcp_sndbuf_available(
+    const struct tcp_pcb* const pcb
+) {
+    return static_cast<u16_t>(TCP_SND_BUF - pcb->queue.size());
+}
+
+struct tcp_pcb* tcp_new_ip_type(
+    const u8_t type
+) {
+    (void) type;
+
+    const auto fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return nullptr;
+
+    if (!non_blocking(fd)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto* const pcb = new tcp_pcb{};
+    pcb->fd = fd;
+    pcb->queue.reserve(TCP_SND_BUF);
+    tcp_pcbs.push_back(pcb);
+    return pcb;
+}
+
+void tcp_arg(
+    struct tcp_pcb* const pcb,
+    void* const arg
+) {
+    pcb->arg = arg;
+}
+
+void tcp_recv(
+    struct tcp_pcb* const pcb,
+    const tcp_recv_fn recv
+) {
+    pcb->recv = recv;
+}
+
+void tcp_sent(
+    struct tcp_pcb* const pcb,
+    const tcp_sent_fn sent
+) {
+    pcb->sent = sent;
+}
+
+void tcp_poll(
+    struct tcp_pcb* const pcb,
+    const tcp_poll_fn poll,
+    const u8_t interval
+) {
+    pcb->poll = poll;
+    pcb->pollIntervalMillis = interval * SLOW_TIMER_MILLIS;
+    pcb->nextPollMillis = now_millis() + pcb->pollIntervalMillis;
+}
+
+void tcp_err(
+    struct tcp_pcb* const pcb,
+    const tcp_err_fn err
+) {
+    pcb->err = err;
+}
+
+void tcp_recved(
+    struct tcp_pcb* const pcb,
+    const u16_t len
+) {
+    // The kernel opens the window by itself.
+    (void) pcb;
+    (void) len;
+}
+
+err_t tcp_connect(
+    struct tcp_pcb* const pcb,
+    const ip_addr_t* const ipaddr,
+    const u16_t port,
+    const tcp_connected_fn connected
+) {
+    if (0 != (pcb->soOptions & SOF_KEEPALIVE)) {
+        const int on = 1;
+        (void) setsockopt(pcb->fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+    }
+
+    pcb->connected = connected;
+
+    const auto addr = to_sockaddr(ipaddr, port);
+    if (0 == ::connect(pcb->fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) ||
+        EINPROGRESS == errno)
+        return ERR_OK;
+
+    return translate(errno);
+}
+
+err_t tcp_write(
+    struct tcp_pcb* const pcb,
+    const void* const dataptr,
+    const u16_t len,
+    const u8_t apiflags
+) {
+    (void) apiflags;
+
+    if (!pcb->established)
+        return ERR_CONN;
+
+    if (len > tcp_sndbuf_available(pcb))
+        return ERR_MEM;
+
+    const auto* const data = static_cast<const char*>(dataptr);
+    pcb->queue.insert(pcb->queue.end(), data, data + len);
+    return ERR_OK;
+}
+
+err_t tcp_output(
+    struct tcp_pcb* const pcb
+) {
+    // A failure is reported through the err callback on the next poll, as lwIP does.
+    if (pcb->established && !pcb->queue.empty()) {
+        const auto written = ::send(pcb->fd, pcb->queue.data(), pcb->queue.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (written > 0) {
+            pcb->queue.erase(pcb->queue.begin(), pcb->queue.begin() + written);
+            pcb->unreported += static_cast<size_t>(written);
+        }
+    }
+
+    return ERR_OK;
+}
+
+err_t tcp_close(
+    struct tcp_pcb* const pcb
+) {
+    release(pcb);
+    return ERR_OK;
+}
+
+void tcp_abort(
+    struct tcp_pcb* const pcb
+) {
+    // A zero linger makes close() send a reset, as lwIP's abort does.
+    const linger reset{1, 0};
+    (void) setsockopt(pcb->fd, SOL_SOCKET, SO_LINGER, &reset, sizeof(reset));
+
+    fail(pcb, ERR_ABRT);
+}
+
+struct udp_pcb* udp_new_ip_type(
+    const u8_t type
+) {
+    (void) type;
+
+    const auto fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+        return nullptr;
+
+    if (!non_blocking(fd)) {
+        ::close(fd);
+        return nullptr;
+    }
+
+    auto* const pcb = new udp_pcb{};
+    pcb->fd = fd;
+    udp_pcbs.push_back(pcb);
+    return pcb;
+}
+
+void udp_recv(
+    struct udp_pcb* const pcb,
+    const udp_recv_fn recv,
+    void* const recv_arg
+) {
+    pcb->recv = recv;
+    pcb->arg = recv_arg;
+}
+
+err_t udp_sendto(
+    struct udp_pcb* const pcb,
+    struct pbuf* const p,
+    const ip_addr_t* const dst_ip,
+    const u16_t dst_port
+) {
+    const auto addr = to_sockaddr(dst_ip, dst_port);
+    const auto sent = ::sendto(
+        pcb->fd,
+        p->payload,
+        p->len,
+        0,
+        reinterpret_cast<const sockaddr*>(&addr),
+        sizeof(addr)
+    );
+
+    if (sent < 0)
+        return EAGAIN == errno || EWOULDBLOCK == errno ? ERR_MEM : translate(errno);
+
+    return ERR_OK;
+}
+
+void udp_remove(
+    struct udp_pcb* const pcb
+) {
+    if (pcb->fd >= 0)
+        ::close(pcb->fd);
+
+    pcb->fd = -1;
+    pcb->freed = true;
+}
+
+}
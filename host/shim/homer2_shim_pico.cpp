@@ -0,0 +1,588 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include <pico/stdio.h>
+#include <pico/time.h>
+#include <pico/rand.h>
+#include <pico/flash.h>
+#include <pico/mutex.h>
+#include <pico/unique_id.h>
+#include <pico/cyw43_arch.h>
+#include <hardware/flash.h>
+#include <hardware/regs/addressmap.h>
+#include <hardware/gpio.h>
+#include <hardware/i2c.h>
+#include <hardware/dma.h>
+#include <hardware/irq.h>
+#include <hardware/sync.h>
+#include <hardware/uart.h>
+#include <lwip/apps/sntp.h>
+
+#include "homer2_shim.hpp"
+
+// The sdk as far as homer2 uses it, on top of the host's clock. Everything attached to a pin
+// is absent: the i2c bus and the uart never answer, unless a test plays the part of the
+// controller through the registers, the dma channels and the interrupts. The flash is an array
+// in RAM.
+
+struct i2c_inst {
+
+    i2c_hw_t hw;
+
+    uint index;
+
+};
+
+struct uart_inst {
+};
+
+i2c_inst_t i2c0_inst{{}, 0};
+i2c_inst_t i2c1_inst{{}, 1};
+
+uart_inst_t uart1_inst{};
+
+cyw43_t cyw43_state{};
+
+extern "C" {
+
+    alignas(FLASH_SECTOR_SIZE) uint8_t homer2_shim_flash[PICO_FLASH_SIZE_BYTES];
+
+    // Referenced by the flash log to find where the firmware ends: the image takes no room in
+    // the simulated flash, all of it is free for the log.
+    extern char __flash_binary_end __attribute__((alias("homer2_shim_flash")));
+
+}
+
+namespace {
+
+    const auto boot = std::chrono::steady_clock::now();
+
+    constexpr uint DMA_CHANNELS = 12;
+
+    uint32_t claimed_dma_channels = 0;
+
+    uint32_t busy_dma_channels = 0;
+
+    std::array<size_t, DMA_CHANNELS> dma_channel_aborts{};
+
+    constexpr uint IRQS = 32;
+
+    std::array<irq_handler_t, IRQS> irq_handlers{};
+
+    uint32_t enabled_irqs = 0;
+
+    // Flash comes out of the factory erased.
+    const bool flash_erased = (homer2::shim::flash_erase(), true);
+
+}
+
+extern "C" {
+
+// What lwipopts wires SNTP_SET_SYSTEM_TIME_US to.
+void homer2_sntp_set_system_time_us(
+    uint32_t sec,
+    uint32_t us
+);
+
+void panic(
+    const char* const fmt,
+    ...
+) {
+    va_list args;
+    va_start(args, fmt);
+    std::fputs("*** PANIC ***\n", stderr);
+    std::vfprintf(stderr, fmt, args);
+    std::fputc('\n', stderr);
+    va_end(args);
+    std::abort();
+}
+
+uint64_t time_us_64() {
+
+    const auto elapsed = std::chrono::steady_clock::now() - boot;
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+}
+
+absolute_time_t from_us_since_boot(
+    const uint64_t us
+) {
+    return us;
+}
+
+void sleep_ms(
+    const uint32_t ms
+) {
+    std::this_thread::sleep_for(std::chrono::milliseconds{ms});
+}
+
+void sleep_us(
+    const uint64_t us
+) {
+    std::this_thread::sleep_for(std::chrono::microseconds{us});
+}
+
+bool best_effort_wfe_or_timeout(
+    const absolute_time_t timeout_timestamp
+) {
+    const auto now = time_us_64();
+    if (timeout_timestamp > now)
+        sleep_us(timeout_timestamp - now);
+    return true;
+}
+
+uint32_t get_rand_32() {
+
+    static std::mt19937 generator{std::random_device{}()};
+    return generator();
+}
+
+void pico_get_unique_board_id_string(
+    char* const id_out,
+    const uint len
+) {
+    std::snprintf(id_out, len, "%s", "484F5354484F5354");
+}
+
+bool stdio_init_all() {
+
+    return true;
+}
+
+int flash_safe_execute(
+    void (* const func)(void*),
+    void* const param,
+    const uint32_t enter_exit_timeout_ms
+) {
+    (void) enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+void flash_range_erase(
+    const uint32_t flash_offs,
+    const size_t count
+) {
+    if (0 != flash_offs % FLASH_SECTOR_SIZE || 0 != count % FLASH_SECTOR_SIZE
+        || flash_offs + count > PICO_FLASH_SIZE_BYTES)
+        std::abort();
+
+    std::fill_n(homer2_shim_flash + flash_offs, count, 0xff);
+}
+
+// Programming only clears bits, as on NOR flash: a byte not erased since it was last programmed
+// reads back as the AND of both.
+void flash_range_program(
+    const uint32_t flash_offs,
+    const uint8_t* const data,
+    const size_t count
+) {
+    if (0 != flash_offs % FLASH_PAGE_SIZE || 0 != count % FLASH_PAGE_SIZE
+        || flash_offs + count > PICO_FLASH_SIZE_BYTES)
+        std::abort();
+
+    for (size_t i = 0; i < count; i++)
+        homer2_shim_flash[flash_offs + i] &= data[i];
+}
+
+void gpio_set_function(
+    const uint gpio,
+    const enum gpio_function fn
+) {
+    (void) gpio;
+    (void) fn;
+}
+
+void gpio_pull_up(
+    const uint gpio
+) {
+    (void) gpio;
+}
+
+uint i2c_init(
+    i2c_inst_t* const i2c,
+    const uint baudrate
+) {
+    (void) i2c;
+    return baudrate;
+}
+
+int i2c_write_blocking_until(
+    i2c_inst_t* const i2c,
+    const uint8_t addr,
+    const uint8_t* const src,
+    const size_t len,
+    const bool nostop,
+    const absolute_time_t until
+) {
+    (void) i2c;
+    (void) addr;
+    (void) src;
+    (void) len;
+    (void) nostop;
+    (void) until;
+    return PICO_ERROR_GENERIC;
+}
+
+int i2c_read_blocking_until(
+    i2c_inst_t* const i2c,
+    const uint8_t addr,
+    uint8_t* const dst,
+    const size_t len,
+    const bool nostop,
+    const absolute_time_t until
+) {
+    (void) i2c;
+    (void) addr;
+    (void) dst;
+    (void) len;
+    (void) nostop;
+    (void) until;
+    return PICO_ERROR_GENERIC;
+}
+
+i2c_hw_t* i2c_get_hw(
+    i2c_inst_t* const i2c
+) {
+    return &i2c->hw;
+}
+
+uint i2c_hw_index(
+    i2c_inst_t* const i2c
+) {
+    return i2c->index;
+}
+
+uint i2c_get_dreq(
+    i2c_inst_t* const i2c,
+    const bool is_tx
+) {
+    // DREQ_I2C0_TX onwards, as on the RP2040.
+    return 32 + 2 * i2c->index + (is_tx ? 0 : 1);
+}
+
+int dma_claim_unused_channel(
+    const bool required
+) {
+    for (uint channel = 0; channel < DMA_CHANNELS; channel++) {
+        if (0 == (claimed_dma_channels & (1u << channel))) {
+            claimed_dma_channels |= 1u << channel;
+            return static_cast<int>(channel);
+        }
+    }
+
+    if (required)
+        panic("No DMA channels are available");
+
+    return -1;
+}
+
+void dma_channel_unclaim(
+    const uint channel
+) {
+    claimed_dma_channels &= ~(1u << channel);
+}
+
+dma_channel_config dma_channel_get_default_config(
+    const uint channel
+) {
+    (void) channel;
+    return dma_channel_config{0};
+}
+
+void channel_config_set_transfer_data_size(
+    dma_channel_config* const c,
+    const enum dma_channel_transfer_size size
+) {
+    (void) c;
+    (void) size;
+}
+
+void channel_config_set_read_increment(
+    dma_channel_config* const c,
+    const bool incr
+) {
+    (void) c;
+    (void) incr;
+}
+
+void channel_config_set_write_increment(
+    dma_channel_config* const c,
+    const bool incr
+) {
+    (void) c;
+    (void) incr;
+}
+
+void channel_config_set_dreq(
+    dma_channel_config* const c,
+    const uint dreq
+) {
+    (void) c;
+    (void) dreq;
+}
+
+void dma_channel_configure(
+    const uint channel,
+    const dma_channel_config* const config,
+    volatile void* const write_addr,
+    const volatile void* const read_addr,
+    const uint transfer_count,
+    const bool trigger
+) {
+    (void) channel;
+    (void) config;
+    (void) write_addr;
+    (void) read_addr;
+    (void) transfer_count;
+    (void) trigger;
+}
+
+void dma_channel_abort(
+    const uint channel
+) {
+    busy_dma_channels &= ~(1u << channel);
+    dma_channel_aborts[channel]++;
+}
+
+bool dma_channel_is_busy(
+    const uint channel
+) {
+    return 0 != (busy_dma_channels & (1u << channel));
+}
+
+void irq_set_exclusive_handler(
+    const uint num,
+    const irq_handler_t handler
+) {
+    if (nullptr != irq_handlers[num])
+        panic("Exclusive IRQ handler already set for: %u", num);
+
+    irq_handlers[num] = handler;
+}
+
+void irq_remove_handler(
+    const uint num,
+    const irq_handler_t handler
+) {
+    if (handler == irq_handlers[num])
+        irq_handlers[num] = nullptr;
+}
+
+void irq_set_enabled(
+    const uint num,
+    const bool enabled
+) {
+    if (enabled)
+        enabled_irqs |= 1u << num;
+    else
+        enabled_irqs &= ~(1u << num);
+}
+
+void mutex_init(
+    mutex_t* const mtx
+) {
+    *mtx = mutex_t{true, false};
+}
+
+bool mutex_is_initialized(
+    mutex_t* const mtx
+) {
+    return mtx->initialized;
+}
+
+void mutex_enter_blocking(
+    mutex_t* const mtx
+) {
+    if (!mtx->initialized || mtx->owned)
+        panic("mutex not initialized or entered again");
+
+    mtx->owned = true;
+}
+
+void mutex_exit(
+    mutex_t* const mtx
+) {
+    mtx->owned = false;
+}
+
+uint32_t save_and_disable_interrupts() {
+
+    return 0;
+}
+
+void restore_interrupts(
+    const uint32_t status
+) {
+    (void) status;
+}
+
+void __sev() {
+}
+
+void __wfe() {
+}
+
+uint uart_init(
+    uart_inst_t* const uart,
+    const uint baudrate
+) {
+    (void) uart;
+    return baudrate;
+}
+
+void uart_set_hw_flow(
+    uart_inst_t* const uart,
+    const bool cts,
+    const bool rts
+) {
+    (void) uart;
+    (void) cts;
+    (void) rts;
+}
+
+void uart_set_format(
+    uart_inst_t* const uart,
+    const uint data_bits,
+    const uint stop_bits,
+    const uart_parity_t parity
+) {
+    (void) uart;
+    (void) data_bits;
+    (void) stop_bits;
+    (void) parity;
+}
+
+void uart_set_fifo_enabled(
+    uart_inst_t* const uart,
+    const bool enabled
+) {
+    (void) uart;
+    (void) enabled;
+}
+
+bool uart_is_readable(
+    uart_inst_t* const uart
+) {
+    (void) uart;
+    return false;
+}
+
+void uart_read_blocking(
+    uart_inst_t* const uart,
+    uint8_t* const dst,
+    const size_t len
+) {
+    (void) uart;
+    std::fill(dst, dst + len, 0);
+}
+
+int cyw43_arch_init_with_country(
+    const uint32_t country
+) {
+    (void) country;
+    return PICO_OK;
+}
+
+void cyw43_arch_enable_sta_mode() {
+}
+
+int cyw43_arch_wifi_connect_timeout_ms(
+    const char* const ssid,
+    const char* const pw,
+    const uint32_t auth,
+    const uint32_t timeout
+) {
+    (void) ssid;
+    (void) pw;
+    (void) auth;
+    (void) timeout;
+    return PICO_OK;
+}
+
+void cyw43_arch_lwip_begin() {
+}
+
+void cyw43_arch_lwip_end() {
+}
+
+struct netif* netif_get_by_index(
+    const u8_t idx
+) {
+    (void) idx;
+    return nullptr;
+}
+
+void sntp_setoperatingmode(
+    const u8_t operating_mode
+) {
+    (void) operating_mode;
+}
+
+void sntp_setservername(
+    const u8_t idx,
+    const char* const server
+) {
+    (void) idx;
+    (void) server;
+}
+
+void sntp_init() {
+
+    const auto epoch = std::chrono::system_clock::now().time_since_epoch();
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(epoch).count();
+
+    homer2_sntp_set_system_time_us(
+        static_cast<uint32_t>(us / 1'000'000),
+        static_cast<uint32_t>(us % 1'000'000)
+    );
+}
+
+}
+
+namespace homer2::shim {
+
+    [[nodiscard]]
+    uint8_t* flash() noexcept {
+
+        return homer2_shim_flash;
+    }
+
+    void flash_erase() noexcept {
+
+        std::fill_n(homer2_shim_flash, PICO_FLASH_SIZE_BYTES, 0xff);
+    }
+
+    void irq_raise(
+        const uint32_t num
+    ) noexcept {
+
+        if (nullptr != irq_handlers[num] && 0 != (enabled_irqs & (1u << num)))
+            irq_handlers[num]();
+    }
+
+    void dma_set_busy(
+        const uint32_t channel,
+        const bool busy
+    ) noexcept {
+
+        if (busy)
+            busy_dma_channels |= 1u << channel;
+        else
+            busy_dma_channels &= ~(1u << channel);
+    }
+
+    [[nodiscard]]
+    size_t dma_aborts(
+        const uint32_t channel
+    ) noexcept {
+
+        return dma_channel_aborts[channel];
+    }
+
+}
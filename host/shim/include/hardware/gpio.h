@@ -0,0 +1,20 @@
+#pragma once
+
+#include "pico/types.h"
+
+enum gpio_function {
+    GPIO_FUNC_UART = 2,
+    GPIO_FUNC_I2C = 3,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void gpio_set_function(uint gpio, enum gpio_function fn);
+
+void gpio_pull_up(uint gpio);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "pico/time.h"
+#include "hardware/structs/i2c.h"
+
+typedef struct i2c_inst i2c_inst_t;
+
+extern i2c_inst_t i2c0_inst;
+extern i2c_inst_t i2c1_inst;
+
+#define i2c0 (&i2c0_inst)
+#define i2c1 (&i2c1_inst)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// No device ever answers on the host's bus.
+
+uint i2c_init(i2c_inst_t* i2c, uint baudrate);
+
+int i2c_write_blocking_until(i2c_inst_t* i2c, uint8_t addr, const uint8_t* src, size_t len, bool nostop,
+                             absolute_time_t until);
+
+int i2c_read_blocking_until(i2c_inst_t* i2c, uint8_t addr, uint8_t* dst, size_t len, bool nostop,
+                            absolute_time_t until);
+
+i2c_hw_t* i2c_get_hw(i2c_inst_t* i2c);
+
+uint i2c_hw_index(i2c_inst_t* i2c);
+
+uint i2c_get_dreq(i2c_inst_t* i2c, bool is_tx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "pico/types.h"
+
+#define I2C0_IRQ 23
+#define I2C1_IRQ 24
+
+typedef void (* irq_handler_t)(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Handlers are kept, but no interrupt is raised on the host but by a test, see
+// homer2::shim::irq_raise().
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler);
+
+void irq_remove_handler(uint num, irq_handler_t handler);
+
+void irq_set_enabled(uint num, bool enabled);
+
+#ifdef __cplusplus
+}
+#endif
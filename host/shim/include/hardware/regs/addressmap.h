@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+// The flash is simulated in RAM, see homer2_shim.hpp.
+#ifdef __cplusplus
+extern "C"
+#endif
+uint8_t homer2_shim_flash[];
+
+#define XIP_BASE ((uintptr_t) homer2_shim_flash)
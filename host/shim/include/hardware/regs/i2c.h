@@ -0,0 +1,18 @@
+#pragma once
+
+// The bits of the i2c registers homer2 touches, as in the sdk.
+
+#define I2C_IC_ENABLE_ENABLE_BITS 0x00000001u
+#define I2C_IC_ENABLE_ABORT_BITS 0x00000002u
+
+#define I2C_IC_ENABLE_STATUS_IC_EN_BITS 0x00000001u
+
+#define I2C_IC_DATA_CMD_CMD_BITS 0x00000100u
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_DATA_CMD_RESTART_BITS 0x00000400u
+
+#define I2C_IC_INTR_STAT_R_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_STAT_R_STOP_DET_BITS 0x00000200u
+
+#define I2C_IC_INTR_MASK_M_TX_ABRT_BITS 0x00000040u
+#define I2C_IC_INTR_MASK_M_STOP_DET_BITS 0x00000200u
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "pico/types.h"
+#include "hardware/regs/i2c.h"
+
+// Only the registers homer2 touches, plain memory on the host.
+typedef struct {
+    volatile uint32_t enable;
+    volatile uint32_t tar;
+    volatile uint32_t data_cmd;
+    volatile uint32_t intr_stat;
+    volatile uint32_t intr_mask;
+    volatile uint32_t clr_tx_abrt;
+    volatile uint32_t clr_stop_det;
+    volatile uint32_t enable_status;
+} i2c_hw_t;
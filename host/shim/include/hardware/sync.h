@@ -0,0 +1,21 @@
+#pragma once
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// A single thread drives homer2 on the host, with no interrupt to mask.
+
+uint32_t save_and_disable_interrupts(void);
+
+void restore_interrupts(uint32_t status);
+
+void __sev(void);
+
+void __wfe(void);
+
+#ifdef __cplusplus
+}
+#endif
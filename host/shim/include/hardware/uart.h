@@ -0,0 +1,35 @@
+#pragma once
+
+#include "pico/types.h"
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t uart1_inst;
+
+#define uart1 (&uart1_inst)
+
+typedef enum {
+    UART_PARITY_NONE,
+    UART_PARITY_EVEN,
+    UART_PARITY_ODD,
+} uart_parity_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint uart_init(uart_inst_t* uart, uint baudrate);
+
+void uart_set_hw_flow(uart_inst_t* uart, bool cts, bool rts);
+
+void uart_set_format(uart_inst_t* uart, uint data_bits, uint stop_bits, uart_parity_t parity);
+
+void uart_set_fifo_enabled(uart_inst_t* uart, bool enabled);
+
+bool uart_is_readable(uart_inst_t* uart);
+
+void uart_read_blocking(uart_inst_t* uart, uint8_t* dst, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "lwip/arch.h"
+
+#define SNTP_OPMODE_POLL 0
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void sntp_setoperatingmode(u8_t operating_mode);
+
+void sntp_setservername(u8_t idx, const char* server);
+
+// Syncs right away to the host's clock, there is no server involved.
+void sntp_init(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "lwip/arch.h"
+#include "lwip/ip_addr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The first nameserver of /etc/resolv.conf stands in for the one handed out by dhcp.
+const ip_addr_t* dns_getserver(u8_t numdns);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "lwip/arch.h"
+
+// IPv4 only, same as the firmware's lwipopts. The address is kept in network byte order.
+typedef struct ip4_addr {
+    u32_t addr;
+} ip4_addr_t;
+
+typedef ip4_addr_t ip_addr_t;
+
+#define IPADDR_ANY ((u32_t) 0x00000000UL)
+
+#define IPADDR_TYPE_V4 0U
+
+#define IP_GET_TYPE(ipaddr) IPADDR_TYPE_V4
+
+#define ip_addr_isany(ipaddr) ((ipaddr) == NULL || (ipaddr)->addr == IPADDR_ANY)
+
+#define ip_addr_cmp(addr1, addr2) ((addr1)->addr == (addr2)->addr)
+
+#define ipaddr_aton(cp, addr) ip4addr_aton(cp, addr)
+
+#define ipaddr_ntoa(ipaddr) ip4addr_ntoa(ipaddr)
+
+extern const ip_addr_t ip_addr_any;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int ip4addr_aton(const char* cp, ip4_addr_t* addr);
+
+char* ip4addr_ntoa(const ip4_addr_t* addr);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "lwip/arch.h"
+#include "lwip/ip_addr.h"
+
+struct netif {
+    ip_addr_t ip_addr;
+    u8_t hwaddr[6];
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The host's interfaces are not listed, there is none.
+struct netif* netif_get_by_index(u8_t idx);
+
+#ifdef __cplusplus
+}
+#endif
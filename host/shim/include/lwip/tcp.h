@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lwip/arch.h"
+#include "lwip/err.h"
+#include "lwip/ip_addr.h"
+#include "lwip/pbuf.h"
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+#define SOF_KEEPALIVE 0x08
+
+// Same as the firmware's lwipopts, so that writes are chunked the way they are on the pico.
+#define TCP_MSS 1460
+#define TCP_SND_BUF (8 * TCP_MSS)
+
+// Opaque on the host, a socket whose writes are queued in the pcb and flushed by the shim's
+// poll, which also invokes the callbacks.
+struct tcp_pcb;
+
+typedef err_t (* tcp_recv_fn)(void* arg, struct tcp_pcb* tpcb, struct pbuf* p, err_t err);
+
+typedef err_t (* tcp_sent_fn)(void* arg, struct tcp_pcb* tpcb, u16_t len);
+
+typedef err_t (* tcp_poll_fn)(void* arg, struct tcp_pcb* tpcb);
+
+typedef void  (* tcp_err_fn)(void* arg, err_t err);
+
+typedef err_t (* tcp_connected_fn)(void* arg, struct tcp_pcb* tpcb, err_t err);
+
+#define ip_set_option(pcb, opt) tcp_set_option(pcb, opt)
+
+#define tcp_sndbuf(pcb) tcp_sndbuf_available(pcb)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void tcp_set_option(struct tcp_pcb* pcb, u8_t opt);
+
+void tcp_nagle_disable(struct tcp_pcb* pcb);
+
+u16_t tcp_sndbuf_available(const struct tcp_pcb* pcb);
+
+struct tcp_pcb* tcp_new_ip_type(u8_t type);
+
+void tcp_arg(struct tcp_pcb* pcb, void* arg);
+
+void tcp_recv(struct tcp_pcb* pcb, tcp_recv_fn recv);
+
+void tcp_sent(struct tcp_pcb* pcb, tcp_sent_fn sent);
+
+void tcp_poll(struct tcp_pcb* pcb, tcp_poll_fn poll, u8_t interval);
+
+void tcp_err(struct tcp_pcb* pcb, tcp_err_fn err);
+
+void tcp_recved(struct tcp_pcb* pcb, u16_t len);
+
+err_t tcp_connect(struct tcp_pcb* pcb, const ip_addr_t* ipaddr, u16_t port, tcp_connected_fn connected);
+
+err_t tcp_write(struct tcp_pcb* pcb, const void* dataptr, u16_t len, u8_t apiflags);
+
+err_t tcp_output(struct tcp_pcb* pcb);
+
+err_t tcp_close(struct tcp_pcb* pcb);
+
+void tcp_abort(struct tcp_pcb* pcb);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,4 @@
+#pragma once
+
+#define bi_decl(x)
+#define bi_2pins_with_func(p0, p1, func)
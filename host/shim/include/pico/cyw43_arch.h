@@ -0,0 +1,34 @@
+#pragma once
+
+#include "pico/types.h"
+#include "lwip/netif.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+
+#define CYW43_COUNTRY(A, B, REV) ((unsigned char)(A) | ((unsigned char)(B) << 8) | ((REV) << 16))
+#define CYW43_AUTH_WPA2_AES_PSK 0x00400004
+
+typedef struct cyw43_t {
+    uint8_t mac[6];
+} cyw43_t;
+
+extern cyw43_t cyw43_state;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int cyw43_arch_init_with_country(uint32_t country);
+
+void cyw43_arch_enable_sta_mode(void);
+
+int cyw43_arch_wifi_connect_timeout_ms(const char* ssid, const char* pw, uint32_t auth, uint32_t timeout);
+
+// The shim calls back from the same thread that drives homer2, there is nothing to lock.
+void cyw43_arch_lwip_begin(void);
+
+void cyw43_arch_lwip_end(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "pico/types.h"
+
+// A single thread drives homer2 on the host, the mutex only catches it being entered again by
+// its owner, which would never return on the pico.
+typedef struct mutex {
+    bool initialized;
+    bool owned;
+} mutex_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void mutex_init(mutex_t* mtx);
+
+bool mutex_is_initialized(mutex_t* mtx);
+
+void mutex_enter_blocking(mutex_t* mtx);
+
+void mutex_exit(mutex_t* mtx);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t get_rand_32(void);
+
+#ifdef __cplusplus
+}
+#endif
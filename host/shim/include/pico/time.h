@@ -0,0 +1,22 @@
+#pragma once
+
+#include "pico/types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t time_us_64(void);
+
+absolute_time_t from_us_since_boot(uint64_t us);
+
+void sleep_ms(uint32_t ms);
+
+void sleep_us(uint64_t us);
+
+// Nothing raises an event on the host, sleeps until the timeout.
+bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// Microseconds since the process started, same as the sdk's representation without debug checks.
+typedef uint64_t absolute_time_t;
+
+#define PICO_OK 0
+#define PICO_ERROR_GENERIC -1
+#define PICO_ERROR_TIMEOUT -2
+
+#define hard_assert(x) assert(x)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void panic(const char* fmt, ...);
+
+#ifdef __cplusplus
+}
+#endif
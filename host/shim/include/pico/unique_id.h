@@ -0,0 +1,15 @@
+#pragma once
+
+#include "pico/types.h"
+
+#define PICO_UNIQUE_BOARD_ID_SIZE_BYTES 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void pico_get_unique_board_id_string(char* id_out, uint len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdlib>
+#include <iostream>
+
+// Just enough of a test framework for the host tests: a failed check is reported with where it
+// failed and makes the test exit with an error once it is done.
+
+namespace homer2::test {
+
+    inline int failures = 0;
+
+    inline int result() noexcept {
+
+        if (0 == failures)
+            std::cout << "all checks passed" << std::endl;
+        else
+            std::cout << "checks failed: " << failures << std::endl;
+
+        return 0 == failures ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+}
+
+#define HOMER2_CHECK(X)                                                                     \
+    do {                                                                                    \
+        if (!(X)) {                                                                         \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #X << std::endl; \
+            homer2::test::failures++;                                                       \
+        }                                                                                   \
+    } while (false)
+
+#define HOMER2_CHECK_EQ(A, B)                                                               \
+    do {                                                                                    \
+        const auto& homer2_a = (A);                                                         \
+        const auto& homer2_b = (B);                                                         \
+        if (!(homer2_a == homer2_b)) {                                                      \
+            std::cout << __FILE__ << ":" << __LINE__ << ": check failed: " #A " == " #B     \
+                << " (" << homer2_a << " != " << homer2_b << ")" << std::endl;              \
+            homer2::test::failures++;                                                       \
+        }                                                                                   \
+    } while (false)
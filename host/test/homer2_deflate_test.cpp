@@ -0,0 +1,140 @@
+#include <array>
+#include <random>
+#include <string>
+
+#include <zlib.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_deflate.hpp>
+#include <homer2_payload.hpp>
+
+#include "homer2_check.hpp"
+
+// gzip_compress() against zlib: whatever it compresses inflates back to the input, and never
+// takes more room than gzip_max_compressed_length() allows for.
+
+namespace {
+
+    constexpr size_t MAX_INPUT_BYTES = 200 * 1024;
+
+    std::array<char, homer2::gzip_max_compressed_length(MAX_INPUT_BYTES)> output_buffer{};
+
+    // Returns false if the stream is not a valid gzip member, or has data trailing it.
+    bool gunzip(
+        const char* const data,
+        const size_t len,
+        std::string& out
+    ) {
+        z_stream stream{};
+        if (Z_OK != inflateInit2(&stream, 16 + MAX_WBITS))
+            return false;
+
+        out.resize(MAX_INPUT_BYTES + 1);
+        stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        stream.avail_in = static_cast<uInt>(len);
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = static_cast<uInt>(out.size());
+
+        const auto status = inflate(&stream, Z_FINISH);
+        const auto ok = Z_STREAM_END == status && 0 == stream.avail_in;
+
+        out.resize(stream.total_out);
+        inflateEnd(&stream);
+        return ok;
+    }
+
+    // Compresses the input, and returns the compressed size.
+    size_t check_round_trip(
+        const std::string& input
+    ) {
+        homer2::Homer2Payload output{output_buffer.data(), output_buffer.size()};
+
+        HOMER2_CHECK(homer2::gzip_compress(input.data(), input.size(), output));
+        HOMER2_CHECK(output.size() <= homer2::gzip_max_compressed_length(input.size()));
+
+        std::string inflated{};
+        HOMER2_CHECK(gunzip(output.data(), output.size(), inflated));
+        HOMER2_CHECK(inflated == input);
+
+        return output.size();
+    }
+
+    std::string random_bytes(
+        const size_t len,
+        const int alphabet
+    ) {
+        std::mt19937 generator{42};
+        std::uniform_int_distribution<int> byte{0, alphabet - 1};
+
+        std::string bytes(len, '\0');
+        for (auto& c: bytes)
+            c = static_cast<char>(byte(generator));
+        return bytes;
+    }
+
+    // Shaped like what the pusher sends, repetitive enough to compress well.
+    std::string json_batch(
+        const size_t samples
+    ) {
+        std::string json{"["};
+        for (size_t i = 0; i < samples; i++) {
+            if (i > 0)
+                json += ",";
+            json += R"({"metric":"sunrise_co2","timestamp":)" + std::to_string(1'700'000'000'000 + i * 1000)
+                    + R"(,"value":)" + std::to_string(400 + i % 37)
+                    + R"(,"tags":{"agent":"homer2","sensor":"sunrise"}})";
+        }
+        return json + "]";
+    }
+
+    void test_edge_cases() {
+
+        check_round_trip("");
+        check_round_trip("a");
+        check_round_trip("abc");
+        check_round_trip(std::string(10'000, 'x'));
+        check_round_trip("abcabcabcabcabcabcabcabcabcabcabcabcabcabc");
+    }
+
+    void test_json() {
+
+        const auto json = json_batch(60);
+        const auto compressed = check_round_trip(json);
+
+        // Well below a third, as measured when gzip was added.
+        HOMER2_CHECK(compressed * 3 < json.size());
+    }
+
+    void test_incompressible() {
+
+        // Stored blocks, several of them past 64KiB.
+        check_round_trip(random_bytes(MAX_INPUT_BYTES, 256));
+        check_round_trip(random_bytes(5'000, 256));
+
+        // Matches far apart and close together, across the 4KiB window.
+        check_round_trip(random_bytes(50'000, 4));
+        check_round_trip(json_batch(20) + random_bytes(8'000, 256) + json_batch(20));
+    }
+
+    void test_does_not_fit() {
+
+        const auto json = json_batch(60);
+
+        std::array<char, 64> small{};
+        homer2::Homer2Payload output{small.data(), small.size()};
+        HOMER2_CHECK(!homer2::gzip_compress(json.data(), json.size(), output));
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    test_edge_cases();
+    test_json();
+    test_incompressible();
+    test_does_not_fit();
+
+    return homer2::test::result();
+}
@@ -0,0 +1,232 @@
+#include <cstring>
+
+#include <hardware/flash.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_flash_log.hpp>
+#include <homer2_shim.hpp>
+
+#include "homer2_check.hpp"
+
+// The flash log against the shim's simulated flash: records survive a reboot, the oldest sector
+// is dropped when the log wraps around, consumed sectors are invalidated and a damaged record is
+// skipped.
+
+namespace {
+
+    using homer2::Homer2FlashLog;
+    using homer2::Homer2Metric;
+    using homer2::Homer2Reading;
+
+    constexpr size_t SECTORS = 4;
+    constexpr size_t LOG_BYTES = SECTORS * FLASH_SECTOR_SIZE;
+    constexpr uint32_t LOG_OFFSET = PICO_FLASH_SIZE_BYTES - LOG_BYTES;
+
+    // Kept in sync with homer2_flash_log.cpp.
+    constexpr size_t RECORDS_PER_SECTOR = 38;
+    constexpr size_t SECTOR_HEADER_BYTES = 64;
+
+    Homer2Reading reading_of(
+        const uint64_t n
+    ) {
+        Homer2Reading reading{};
+        reading.mask = 1ULL << static_cast<size_t>(Homer2Metric::sunrise_co2);
+        reading.values[static_cast<size_t>(Homer2Metric::sunrise_co2)] = static_cast<float>(400 + n);
+        return reading;
+    }
+
+    void append(
+        Homer2FlashLog& log,
+        const uint64_t from,
+        const uint64_t count
+    ) {
+        for (auto n = from; n < from + count; n++)
+            HOMER2_CHECK(log.append(n, reading_of(n)));
+    }
+
+    // The records left in the log are those appended with the given numbers, in order.
+    void check_records(
+        const Homer2FlashLog& log,
+        const uint64_t from,
+        const uint64_t count
+    ) {
+        HOMER2_CHECK_EQ(log.size(), count);
+        for (size_t i = 0; i < log.size() && i < count; i++) {
+            const auto& record = log[i];
+            HOMER2_CHECK_EQ(record.timestampMillis, from + i);
+            HOMER2_CHECK_EQ(record.reading.mask, reading_of(from + i).mask);
+            HOMER2_CHECK_EQ(
+                record.reading.values[static_cast<size_t>(Homer2Metric::sunrise_co2)],
+                static_cast<float>(400 + from + i)
+            );
+        }
+    }
+
+    uint32_t sector_magic(
+        const size_t sector
+    ) {
+        uint32_t magic;
+        std::memcpy(&magic, homer2::shim::flash() + LOG_OFFSET + sector * FLASH_SECTOR_SIZE, sizeof(magic));
+        return magic;
+    }
+
+    void test_empty() {
+
+        homer2::shim::flash_erase();
+
+        Homer2FlashLog log{LOG_BYTES};
+        log.init();
+
+        HOMER2_CHECK(log.enabled());
+        HOMER2_CHECK(log.empty());
+
+        Homer2FlashLog disabled{0};
+        disabled.init();
+
+        HOMER2_CHECK(!disabled.enabled());
+        HOMER2_CHECK(!disabled.append(0, reading_of(0)));
+    }
+
+    void test_recovery() {
+
+        homer2::shim::flash_erase();
+
+        {
+            Homer2FlashLog log{LOG_BYTES};
+            log.init();
+            append(log, 0, RECORDS_PER_SECTOR + 5);
+            check_records(log, 0, RECORDS_PER_SECTOR + 5);
+        }
+
+        Homer2FlashLog log{LOG_BYTES};
+        log.init();
+        check_records(log, 0, RECORDS_PER_SECTOR + 5);
+
+        // Appending carries on after the recovered records.
+        append(log, RECORDS_PER_SECTOR + 5, 3);
+        check_records(log, 0, RECORDS_PER_SECTOR + 8);
+    }
+
+    void test_pop_and_sync() {
+
+        homer2::shim::flash_erase();
+
+        Homer2FlashLog log{LOG_BYTES};
+        log.init();
+        append(log, 0, 2 * RECORDS_PER_SECTOR + 10);
+
+        // Popping alone does not touch the flash: a reboot sends them again.
+        log.pop(RECORDS_PER_SECTOR + 4);
+        check_records(log, RECORDS_PER_SECTOR + 4, RECORDS_PER_SECTOR + 6);
+        HOMER2_CHECK_EQ(sector_magic(0), 0x48324c4cu);
+
+        {
+            Homer2FlashLog rebooted{LOG_BYTES};
+            rebooted.init();
+            check_records(rebooted, 0, 2 * RECORDS_PER_SECTOR + 10);
+        }
+
+        // Syncing invalidates the consumed sector and marks what was taken from the next.
+        log.sync();
+        HOMER2_CHECK_EQ(sector_magic(0), 0u);
+        HOMER2_CHECK_EQ(sector_magic(1), 0x48324c4cu);
+
+        {
+            Homer2FlashLog rebooted{LOG_BYTES};
+            rebooted.init();
+            check_records(rebooted, RECORDS_PER_SECTOR + 4, RECORDS_PER_SECTOR + 6);
+        }
+
+        // A second sync with nothing popped in between changes nothing.
+        log.sync();
+        log.pop(2);
+        log.sync();
+
+        {
+            Homer2FlashLog rebooted{LOG_BYTES};
+            rebooted.init();
+            check_records(rebooted, RECORDS_PER_SECTOR + 6, RECORDS_PER_SECTOR + 4);
+        }
+
+        // Emptied, the next record goes after the consumed ones and is the only one recovered.
+        log.pop(log.size());
+        log.sync();
+        HOMER2_CHECK(log.empty());
+        append(log, 1000, 1);
+        check_records(log, 1000, 1);
+
+        Homer2FlashLog rebooted{LOG_BYTES};
+        rebooted.init();
+        check_records(rebooted, 1000, 1);
+    }
+
+    void test_wraparound() {
+
+        homer2::shim::flash_erase();
+
+        Homer2FlashLog log{LOG_BYTES};
+        log.init();
+
+        // One sector more than fits, the first is dropped to make room.
+        append(log, 0, SECTORS * RECORDS_PER_SECTOR + 10);
+        HOMER2_CHECK_EQ(log.dropped(), RECORDS_PER_SECTOR);
+        check_records(log, RECORDS_PER_SECTOR, (SECTORS - 1) * RECORDS_PER_SECTOR + 10);
+
+        Homer2FlashLog rebooted{LOG_BYTES};
+        rebooted.init();
+        check_records(rebooted, RECORDS_PER_SECTOR, (SECTORS - 1) * RECORDS_PER_SECTOR + 10);
+
+        // Partly replayed, the partly consumed tail is dropped with only what was left of it.
+        log.pop(5);
+        log.sync();
+        append(log, SECTORS * RECORDS_PER_SECTOR + 10, RECORDS_PER_SECTOR);
+        HOMER2_CHECK_EQ(log.dropped(), 2 * RECORDS_PER_SECTOR - 5);
+        check_records(log, 2 * RECORDS_PER_SECTOR, (SECTORS - 1) * RECORDS_PER_SECTOR + 10);
+
+        Homer2FlashLog again{LOG_BYTES};
+        again.init();
+        check_records(again, 2 * RECORDS_PER_SECTOR, (SECTORS - 1) * RECORDS_PER_SECTOR + 10);
+    }
+
+    void test_corrupted_record() {
+
+        homer2::shim::flash_erase();
+
+        Homer2FlashLog log{LOG_BYTES};
+        log.init();
+        append(log, 0, 5);
+
+        // A bit lost from the top byte of the third record's value.
+        const auto record = LOG_OFFSET + SECTOR_HEADER_BYTES + 2 * sizeof(homer2::Homer2FlashRecord);
+        const auto value = offsetof(homer2::Homer2FlashRecord, reading) + offsetof(Homer2Reading, values)
+                           + static_cast<size_t>(Homer2Metric::sunrise_co2) * sizeof(float);
+        homer2::shim::flash()[record + value + sizeof(float) - 1] &= 0xfe;
+
+        HOMER2_CHECK_EQ(log.size(), 5u);
+        HOMER2_CHECK_EQ(log[2].reading.mask, 0u);
+        HOMER2_CHECK_EQ(log[2].timestampMillis, 0u);
+        HOMER2_CHECK_EQ(log[3].timestampMillis, 3u);
+
+        // Still counted, so that replay moves past it.
+        Homer2FlashLog rebooted{LOG_BYTES};
+        rebooted.init();
+        HOMER2_CHECK_EQ(rebooted.size(), 5u);
+        HOMER2_CHECK_EQ(rebooted[1].timestampMillis, 1u);
+        HOMER2_CHECK_EQ(rebooted[2].reading.mask, 0u);
+        HOMER2_CHECK_EQ(rebooted[4].timestampMillis, 4u);
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    test_empty();
+    test_recovery();
+    test_pop_and_sync();
+    test_wraparound();
+    test_corrupted_record();
+
+    return homer2::test::result();
+}
@@ -0,0 +1,310 @@
+#include <array>
+#include <vector>
+
+#include <hardware/i2c.h>
+#include <hardware/irq.h>
+#include <hardware/dma.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_i2c.hpp>
+#include <homer2_shim.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_check.hpp"
+
+// The queued transactions of the i2c bus, the test playing the controller: it raises the
+// interrupt with the status the controller would report and keeps the dma channels busy. Queued
+// transactions are put on the bus one after the other, an abort fails only the transaction it
+// hit, a read whose last bytes are still moved by the dma is finished by poll() and a
+// transaction past its timeout is failed by it.
+
+namespace {
+
+    using homer2::i2c::Homer2I2c;
+    using homer2::i2c::Homer2I2cError;
+    using homer2::i2c::Homer2I2cTransaction;
+    using homer2::i2c::TRANSACTION_QUEUE_CAPACITY;
+
+    // Claimed by the first bus taking a transaction, the first channels of a fresh process.
+    constexpr uint32_t TX_CHANNEL = 0;
+    constexpr uint32_t RX_CHANNEL = 1;
+
+    constexpr uint64_t TIMEOUT_MILLIS = 1'000;
+
+    const std::array<uint8_t, 2> command{0x24, 0x0b};
+
+    // Addresses of the transactions done, in the order their callbacks were called.
+    std::vector<uint8_t> completed{};
+
+    void on_done(
+        Homer2I2cTransaction& transaction,
+        void* const any
+    ) {
+        (void) any;
+        completed.push_back(transaction.addr);
+    }
+
+    void prepare_write(
+        Homer2I2cTransaction& transaction,
+        const uint8_t addr,
+        const uint64_t timeoutMillis = TIMEOUT_MILLIS
+    ) {
+        transaction.addr = addr;
+        transaction.writeData = command.data();
+        transaction.writeLen = static_cast<uint8_t>(command.size());
+        transaction.timeoutMillis = timeoutMillis;
+        transaction.callback = on_done;
+    }
+
+    void prepare_read(
+        Homer2I2cTransaction& transaction,
+        const uint8_t addr,
+        uint8_t* const into,
+        const uint8_t len,
+        const uint64_t timeoutMillis = TIMEOUT_MILLIS
+    ) {
+        prepare_write(transaction, addr, timeoutMillis);
+        transaction.readInto = into;
+        transaction.readLen = len;
+    }
+
+    // The controller reporting the status on the bus of i2c0.
+    void interrupt(
+        const uint32_t status
+    ) {
+        i2c_get_hw(i2c0)->intr_stat = status;
+        homer2::shim::irq_raise(I2C0_IRQ);
+        i2c_get_hw(i2c0)->intr_stat = 0;
+    }
+
+    void check_invalid(
+        Homer2I2c& bus
+    ) {
+        std::array<uint8_t, 2 * homer2::i2c::BUFFER_CAPACITY> data{};
+
+        Homer2I2cTransaction tooLong{};
+        tooLong.writeData = data.data();
+        tooLong.writeLen = static_cast<uint8_t>(data.size());
+        HOMER2_CHECK_EQ(bus.submit(tooLong), Homer2I2cError::buffer_too_small);
+
+        Homer2I2cTransaction noWriteData{};
+        noWriteData.writeLen = 1;
+        HOMER2_CHECK_EQ(bus.submit(noWriteData), Homer2I2cError::write_missing_data);
+
+        Homer2I2cTransaction noReadInto{};
+        noReadInto.readLen = 1;
+        HOMER2_CHECK_EQ(bus.submit(noReadInto), Homer2I2cError::read_missing_data);
+
+        // Done right away, never put on the bus.
+        completed.clear();
+        Homer2I2cTransaction empty{};
+        empty.addr = 0x10;
+        empty.callback = on_done;
+        HOMER2_CHECK_EQ(bus.submit(empty), Homer2I2cError::no_error);
+        HOMER2_CHECK(empty.done.load());
+        HOMER2_CHECK_EQ(completed.size(), 1U);
+        HOMER2_CHECK(!bus.poll());
+    }
+
+    void check_queue(
+        Homer2I2c& bus
+    ) {
+        auto* const hw = i2c_get_hw(i2c0);
+        completed.clear();
+
+        std::array<Homer2I2cTransaction, TRANSACTION_QUEUE_CAPACITY + 1> transactions{};
+        for (size_t i = 0; i < transactions.size(); i++)
+            prepare_write(transactions[i], static_cast<uint8_t>(0x40 + i));
+
+        for (size_t i = 0; i < TRANSACTION_QUEUE_CAPACITY; i++)
+            HOMER2_CHECK_EQ(bus.submit(transactions[i]), Homer2I2cError::no_error);
+        HOMER2_CHECK_EQ(bus.submit(transactions[TRANSACTION_QUEUE_CAPACITY]), Homer2I2cError::queue_full);
+
+        // Only the first one is on the bus, the others wait for it.
+        HOMER2_CHECK_EQ(hw->tar, 0x40U);
+        HOMER2_CHECK_EQ(hw->intr_mask, I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS);
+        HOMER2_CHECK(bus.poll());
+
+        for (size_t i = 0; i < TRANSACTION_QUEUE_CAPACITY; i++) {
+            HOMER2_CHECK_EQ(hw->tar, 0x40U + i);
+            HOMER2_CHECK(!transactions[i].done.load());
+
+            interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+
+            HOMER2_CHECK(transactions[i].done.load());
+            HOMER2_CHECK_EQ(transactions[i].error, Homer2I2cError::no_error);
+        }
+
+        HOMER2_CHECK_EQ(completed.size(), TRANSACTION_QUEUE_CAPACITY);
+        for (size_t i = 0; i < completed.size(); i++)
+            HOMER2_CHECK_EQ(completed[i], 0x40U + i);
+
+        HOMER2_CHECK_EQ(hw->intr_mask, 0U);
+        HOMER2_CHECK(!bus.poll());
+
+        // Room again once the queue is done.
+        HOMER2_CHECK_EQ(bus.submit(transactions[TRANSACTION_QUEUE_CAPACITY]), Homer2I2cError::no_error);
+        interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK_EQ(bus.wait(transactions[TRANSACTION_QUEUE_CAPACITY]), Homer2I2cError::no_error);
+    }
+
+    void check_abort(
+        Homer2I2c& bus
+    ) {
+        auto* const hw = i2c_get_hw(i2c0);
+        completed.clear();
+
+        std::array<uint8_t, 4> into{};
+        Homer2I2cTransaction write{};
+        Homer2I2cTransaction read{};
+        Homer2I2cTransaction after{};
+        prepare_write(write, 0x50);
+        prepare_read(read, 0x51, into.data(), static_cast<uint8_t>(into.size()));
+        prepare_write(after, 0x52);
+
+        HOMER2_CHECK_EQ(bus.submit(write), Homer2I2cError::no_error);
+        HOMER2_CHECK_EQ(bus.submit(read), Homer2I2cError::no_error);
+        HOMER2_CHECK_EQ(bus.submit(after), Homer2I2cError::no_error);
+
+        // Not acknowledged: both channels are stopped, the transaction done once the stop that
+        // follows is seen.
+        const auto txAborts = homer2::shim::dma_aborts(TX_CHANNEL);
+        const auto rxAborts = homer2::shim::dma_aborts(RX_CHANNEL);
+        homer2::shim::dma_set_busy(TX_CHANNEL, true);
+        interrupt(I2C_IC_INTR_STAT_R_TX_ABRT_BITS);
+        HOMER2_CHECK_EQ(homer2::shim::dma_aborts(TX_CHANNEL), txAborts + 1);
+        HOMER2_CHECK_EQ(homer2::shim::dma_aborts(RX_CHANNEL), rxAborts + 1);
+        HOMER2_CHECK(!dma_channel_is_busy(TX_CHANNEL));
+        HOMER2_CHECK(!write.done.load());
+
+        interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK(write.done.load());
+        HOMER2_CHECK_EQ(write.error, Homer2I2cError::write_generic_error);
+        HOMER2_CHECK_EQ(hw->tar, 0x51U);
+
+        // Both at once, as when the address is not acknowledged.
+        interrupt(I2C_IC_INTR_STAT_R_TX_ABRT_BITS | I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK(read.done.load());
+        HOMER2_CHECK_EQ(read.error, Homer2I2cError::read_generic_error);
+        HOMER2_CHECK_EQ(hw->tar, 0x52U);
+
+        // Only the transactions hit fail.
+        interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK(after.done.load());
+        HOMER2_CHECK_EQ(after.error, Homer2I2cError::no_error);
+
+        HOMER2_CHECK_EQ(completed.size(), 3U);
+    }
+
+    void check_read_moved_after_stop(
+        Homer2I2c& bus
+    ) {
+        std::array<uint8_t, 4> into{};
+        Homer2I2cTransaction read{};
+        prepare_read(read, 0x60, into.data(), static_cast<uint8_t>(into.size()));
+
+        HOMER2_CHECK_EQ(bus.submit(read), Homer2I2cError::no_error);
+
+        // The stop is seen while the last bytes are still moved, left to poll().
+        homer2::shim::dma_set_busy(RX_CHANNEL, true);
+        interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK(!read.done.load());
+        HOMER2_CHECK(bus.poll());
+        HOMER2_CHECK(!read.done.load());
+
+        homer2::shim::dma_set_busy(RX_CHANNEL, false);
+        HOMER2_CHECK(!bus.poll());
+        HOMER2_CHECK(read.done.load());
+        HOMER2_CHECK_EQ(read.error, Homer2I2cError::no_error);
+
+        // Never done moving: given up on at the timeout, the channel stopped.
+        Homer2I2cTransaction stuck{};
+        prepare_read(stuck, 0x61, into.data(), static_cast<uint8_t>(into.size()), 5);
+        HOMER2_CHECK_EQ(bus.submit(stuck), Homer2I2cError::no_error);
+
+        const auto rxAborts = homer2::shim::dma_aborts(RX_CHANNEL);
+        homer2::shim::dma_set_busy(RX_CHANNEL, true);
+        interrupt(I2C_IC_INTR_STAT_R_STOP_DET_BITS);
+        HOMER2_CHECK_EQ(bus.wait(stuck), Homer2I2cError::read_missing_data);
+        HOMER2_CHECK_EQ(homer2::shim::dma_aborts(RX_CHANNEL), rxAborts + 1);
+        HOMER2_CHECK(!dma_channel_is_busy(RX_CHANNEL));
+    }
+
+    void check_timeout(
+        Homer2I2c& bus
+    ) {
+        auto* const hw = i2c_get_hw(i2c0);
+
+        std::array<uint8_t, 4> into{};
+        Homer2I2cTransaction write{};
+        Homer2I2cTransaction read{};
+        prepare_write(write, 0x70, 5);
+        prepare_read(read, 0x71, into.data(), static_cast<uint8_t>(into.size()), 5);
+
+        HOMER2_CHECK_EQ(bus.submit(write), Homer2I2cError::no_error);
+        HOMER2_CHECK_EQ(bus.submit(read), Homer2I2cError::no_error);
+
+        // Nothing answers: failed once past its timeout, counted from when it was put on the bus.
+        const auto started = now();
+        HOMER2_CHECK_EQ(bus.wait(write), Homer2I2cError::write_timeout);
+        HOMER2_CHECK(now() - started >= 5);
+        HOMER2_CHECK(!read.done.load());
+        HOMER2_CHECK_EQ(hw->tar, 0x71U);
+        HOMER2_CHECK_EQ(hw->intr_mask, I2C_IC_INTR_MASK_M_STOP_DET_BITS | I2C_IC_INTR_MASK_M_TX_ABRT_BITS);
+
+        HOMER2_CHECK_EQ(bus.wait(read), Homer2I2cError::read_timeout);
+        HOMER2_CHECK(!bus.poll());
+
+        // A blocking call waits for the queue first.
+        Homer2I2cTransaction queued{};
+        prepare_write(queued, 0x72, 5);
+        HOMER2_CHECK_EQ(bus.submit(queued), Homer2I2cError::no_error);
+        HOMER2_CHECK_EQ(bus.read(5, 0x73, 1), Homer2I2cError::read_generic_error);
+        HOMER2_CHECK(queued.done.load());
+        HOMER2_CHECK_EQ(queued.error, Homer2I2cError::write_timeout);
+    }
+
+    void check_dma_unavailable() {
+
+        std::vector<int> claimed{};
+        for (auto channel = dma_claim_unused_channel(false); channel >= 0; channel = dma_claim_unused_channel(false))
+            claimed.push_back(channel);
+
+        Homer2I2c bus{i2c1};
+        Homer2I2cTransaction write{};
+        prepare_write(write, 0x80);
+        HOMER2_CHECK_EQ(bus.submit(write), Homer2I2cError::dma_unavailable);
+        HOMER2_CHECK(!write.done.load());
+
+        for (const auto channel: claimed)
+            dma_channel_unclaim(channel);
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    // Time 0 stands for no deadline, the board is long past it once sensors are read.
+    while (now() <= 100)
+        sleep_ms(10);
+
+    {
+        Homer2I2c bus{i2c0};
+
+        check_invalid(bus);
+        check_queue(bus);
+        check_abort(bus);
+        check_read_moved_after_stop(bus);
+        check_timeout(bus);
+    }
+
+    // Handed back with the bus.
+    HOMER2_CHECK_EQ(dma_claim_unused_channel(false), static_cast<int>(TX_CHANNEL));
+    dma_channel_unclaim(TX_CHANNEL);
+
+    check_dma_unavailable();
+
+    return homer2::test::result();
+}
@@ -0,0 +1,148 @@
+#include <array>
+#include <initializer_list>
+#include <string>
+
+#include <homer2_logging.hpp>
+#include <homer2_mqtt_packet.hpp>
+#include <homer2_payload.hpp>
+
+#include "homer2_check.hpp"
+
+// The packets homer2 sends, byte for byte as laid out by the MQTT 3.1.1 specification, and
+// those a broker answers with, parsed however they are split across segments.
+
+namespace {
+
+    using homer2::Homer2MqttReader;
+    using homer2::mqtt::PacketType;
+
+    std::array<char, 1024> buffer{};
+
+    template<typename Append>
+    std::string encoded(
+        const Append& append
+    ) {
+        homer2::Homer2Payload out{buffer.data(), buffer.size()};
+        append(out);
+        HOMER2_CHECK(!out.overflowed());
+        return std::string{out.data(), out.size()};
+    }
+
+    std::string bytes(
+        const std::initializer_list<int> values
+    ) {
+        std::string s{};
+        for (const auto value: values)
+            s.push_back(static_cast<char>(value));
+        return s;
+    }
+
+    void test_connect() {
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_connect(out, "homer2", "user", "pass", 60);
+        }) == bytes({
+            0x10, 30,
+            0x00, 4, 'M', 'Q', 'T', 'T', 4,
+            // Username, password and clean session.
+            0xc2,
+            0x00, 60,
+            0x00, 6, 'h', 'o', 'm', 'e', 'r', '2',
+            0x00, 4, 'u', 's', 'e', 'r',
+            0x00, 4, 'p', 'a', 's', 's',
+        }));
+
+        // Neither is sent without a username, a password alone is not allowed.
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_connect(out, "h2", "", "pass", 300);
+        }) == bytes({
+            0x10, 14,
+            0x00, 4, 'M', 'Q', 'T', 'T', 4,
+            0x02,
+            0x01, 0x2c,
+            0x00, 2, 'h', '2',
+        }));
+    }
+
+    void test_publish() {
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_publish(out, "a/b", "hi", 2, 0, 0x1234, true);
+        }) == bytes({0x30, 7, 0x00, 3, 'a', '/', 'b', 'h', 'i'}));
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_publish(out, "a/b", "hi", 2, 1, 0x1234, false);
+        }) == bytes({0x32, 9, 0x00, 3, 'a', '/', 'b', 0x12, 0x34, 'h', 'i'}));
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_publish(out, "a/b", "hi", 2, 1, 0x1234, true);
+        }) == bytes({0x3a, 9, 0x00, 3, 'a', '/', 'b', 0x12, 0x34, 'h', 'i'}));
+
+        // Past 127 bytes the remaining length takes a second byte.
+        const std::string payload(200, 'x');
+        const auto packet = encoded([&payload](auto& out) {
+            homer2::mqtt::append_publish(out, "t", payload.data(), payload.size(), 0, 0, false);
+        });
+        HOMER2_CHECK(packet == bytes({0x30, 0xcb, 0x01, 0x00, 1, 't'}) + payload);
+    }
+
+    void test_pingreq_and_disconnect() {
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_pingreq(out);
+        }) == bytes({0xc0, 0x00}));
+
+        HOMER2_CHECK(encoded([](auto& out) {
+            homer2::mqtt::append_disconnect(out);
+        }) == bytes({0xe0, 0x00}));
+    }
+
+    void test_reader() {
+
+        Homer2MqttReader reader{};
+
+        // A byte at a time.
+        const auto connack = bytes({0x20, 0x02, 0x00, 0x05});
+        for (size_t i = 0; i < connack.size(); i++) {
+            HOMER2_CHECK(!reader.complete());
+            HOMER2_CHECK_EQ(reader.feed(connack.data() + i, 1), 1u);
+        }
+        HOMER2_CHECK(reader.complete());
+        HOMER2_CHECK(PacketType::CONNACK == reader.type());
+        HOMER2_CHECK_EQ(static_cast<int>(reader.returnCode()), 5);
+
+        // Several packets in one segment, each fed up to its end.
+        const auto segment = bytes({0x40, 0x02, 0xbe, 0xef, 0xd0, 0x00, 0x40});
+        HOMER2_CHECK_EQ(reader.feed(segment.data(), segment.size()), 4u);
+        HOMER2_CHECK(reader.complete());
+        HOMER2_CHECK(PacketType::PUBACK == reader.type());
+        HOMER2_CHECK_EQ(reader.packetId(), 0xbeefu);
+
+        HOMER2_CHECK_EQ(reader.feed(segment.data() + 4, segment.size() - 4), 2u);
+        HOMER2_CHECK(reader.complete());
+        HOMER2_CHECK(PacketType::PINGRESP == reader.type());
+
+        HOMER2_CHECK_EQ(reader.feed(segment.data() + 6, 1), 1u);
+        HOMER2_CHECK(!reader.complete());
+        HOMER2_CHECK(!reader.invalid());
+
+        // A remaining length longer than four bytes.
+        reader.reset();
+        const auto invalid = bytes({0x30, 0x80, 0x80, 0x80, 0x80, 0x01});
+        reader.feed(invalid.data(), invalid.size());
+        HOMER2_CHECK(reader.invalid());
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    test_connect();
+    test_publish();
+    test_pingreq_and_disconnect();
+    test_reader();
+
+    return homer2::test::result();
+}
@@ -0,0 +1,222 @@
+#include <functional>
+#include <string>
+#include <vector>
+
+// Ahead of homer2's headers, their now() macro breaks std::chrono.
+#include "homer2_mock_broker.hpp"
+#include "homer2_shim.hpp"
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_clock.hpp"
+#include "homer2_mqtt.hpp"
+#include "homer2_sensor.hpp"
+
+#include "homer2_check.hpp"
+
+// The publisher over the shim against the mock broker: it connects and is acknowledged, its
+// qos 1 messages are sent again flagged as duplicates when the broker goes away before acking
+// them, a new reading takes new packet ids, an idle connection is kept alive with pings and the
+// connection ends with a disconnect.
+
+namespace {
+
+    using homer2::Homer2MqttPublisher;
+    using homer2::Homer2SensorsData;
+    using homer2::mock::Homer2MockBroker;
+    using homer2::mock::Homer2MockBrokerMessage;
+    using homer2::mock::Homer2MockBrokerOptions;
+    using homer2::mock::Homer2MockBrokerStats;
+
+    constexpr uint64_t TIMEOUT_MILLIS = 5'000;
+
+    // Two sensors, a message each.
+    Homer2SensorsData reading(
+        const uint16_t co2,
+        const float celsius
+    ) {
+        return Homer2SensorsData{}
+            .withSunriseData(homer2::SunriseData{co2, 0}, now())
+            .withSht4xData(homer2::SHT4xData{celsius, 40.F}, now());
+    }
+
+    // Polls the shim until the broker got what was waited for, handing the publisher an empty
+    // reading in between when driven, as the main loop does between readings.
+    bool run_until(
+        const Homer2MockBroker& broker,
+        Homer2MqttPublisher* const driven,
+        const std::function<bool(const Homer2MockBrokerStats&)>& done
+    ) {
+        const auto until = now() + TIMEOUT_MILLIS;
+        while (now() < until) {
+            if (nullptr != driven)
+                driven->publish(Homer2SensorsData{});
+            homer2::shim::poll(10);
+
+            if (done(broker.stats()))
+                return true;
+        }
+        return false;
+    }
+
+    // Lets the publisher take in what the broker answered after what was waited for was seen.
+    void settle() {
+
+        const auto until = now() + 100;
+        while (now() < until)
+            homer2::shim::poll(10);
+    }
+
+    std::vector<Homer2MockBrokerMessage> of_connection(
+        const Homer2MockBrokerStats& stats,
+        const uint64_t connection
+    ) {
+        std::vector<Homer2MockBrokerMessage> messages{};
+        for (const auto& message: stats.messages)
+            if (message.connection == connection)
+                messages.push_back(message);
+        return messages;
+    }
+
+    bool contains(
+        const std::string& s,
+        const std::string& part
+    ) {
+        return std::string::npos != s.find(part);
+    }
+
+    void test_qos1() {
+
+        Homer2MockBrokerOptions options{};
+        options.unackedConnections = 1;
+        Homer2MockBroker broker{options};
+        HOMER2_CHECK(broker.start());
+
+        Homer2MqttPublisher publisher{"127.0.0.1", broker.port(), "homer2", "test", "user", "pass", 1, 1};
+
+        // Dropped by the broker once published, then sent again on the next connection.
+        publisher.publish(reading(412, 21.5F));
+        HOMER2_CHECK(run_until(broker, &publisher, [](const auto& stats) {
+            return stats.connections >= 2 && stats.pubacks >= 2;
+        }));
+
+        auto stats = broker.stats();
+        HOMER2_CHECK_EQ(stats.connects, 2U);
+        HOMER2_CHECK_EQ(stats.clientId, std::string{"homer2-test"});
+        HOMER2_CHECK_EQ(stats.username, std::string{"user"});
+        HOMER2_CHECK_EQ(stats.password, std::string{"pass"});
+        HOMER2_CHECK_EQ(stats.keepAliveSeconds, 1U);
+        HOMER2_CHECK_EQ(stats.invalid, 0U);
+
+        const auto first = of_connection(stats, 1);
+        const auto again = of_connection(stats, 2);
+        HOMER2_CHECK_EQ(first.size(), 2U);
+        HOMER2_CHECK_EQ(again.size(), first.size());
+        for (size_t i = 0; i < first.size() && i < again.size(); i++) {
+            HOMER2_CHECK_EQ(first[i].qos, 1U);
+            HOMER2_CHECK(!first[i].dup);
+            HOMER2_CHECK(again[i].dup);
+            HOMER2_CHECK_EQ(again[i].topic, first[i].topic);
+            HOMER2_CHECK_EQ(again[i].payload, first[i].payload);
+            HOMER2_CHECK_EQ(again[i].packetId, first[i].packetId);
+        }
+
+        if (2 == first.size()) {
+            HOMER2_CHECK_EQ(first[0].topic, std::string{"homer2/test/sunrise"});
+            HOMER2_CHECK(contains(first[0].payload, R"("timestamp":)"));
+            HOMER2_CHECK(contains(first[0].payload, R"("co2":412)"));
+            HOMER2_CHECK_EQ(first[1].topic, std::string{"homer2/test/sht4x"});
+            HOMER2_CHECK(contains(first[1].payload, R"("temperature":21.5)"));
+            HOMER2_CHECK(contains(first[1].payload, R"("humidity":40)"));
+            HOMER2_CHECK(first[0].packetId != first[1].packetId);
+        }
+
+        HOMER2_CHECK_EQ(publisher.publishedMessages(), 4U);
+        settle();
+
+        // Acknowledged right away, on new packet ids.
+        publisher.publish(reading(415, 22.F));
+        HOMER2_CHECK(run_until(broker, &publisher, [](const auto& stats) {
+            return stats.pubacks >= 4;
+        }));
+
+        stats = broker.stats();
+        HOMER2_CHECK_EQ(stats.connections, 2U);
+        HOMER2_CHECK_EQ(stats.messages.size(), 6U);
+        for (size_t i = 4; i < stats.messages.size(); i++) {
+            HOMER2_CHECK(!stats.messages[i].dup);
+            for (const auto& message: first)
+                HOMER2_CHECK(message.packetId != stats.messages[i].packetId);
+        }
+        HOMER2_CHECK_EQ(publisher.skippedReadings(), 0U);
+
+        // Idle past half the keep alive, a ping goes out and the broker answering it keeps the
+        // connection.
+        const auto pings = stats.pingreqs;
+        HOMER2_CHECK(run_until(broker, &publisher, [pings](const auto& stats) {
+            return stats.pingreqs > pings;
+        }));
+        HOMER2_CHECK(run_until(broker, &publisher, [pings](const auto& stats) {
+            return stats.pingreqs > pings + 1;
+        }));
+        HOMER2_CHECK_EQ(broker.stats().connections, 2U);
+
+        publisher.disconnect();
+        HOMER2_CHECK(run_until(broker, nullptr, [](const auto& stats) {
+            return 1 == stats.disconnects;
+        }));
+
+        HOMER2_CHECK_EQ(broker.stats().invalid, 0U);
+        HOMER2_CHECK_EQ(homer2::shim::open_pcbs(), 0U);
+    }
+
+    void test_qos0() {
+
+        Homer2MockBroker broker{Homer2MockBrokerOptions{}};
+        HOMER2_CHECK(broker.start());
+
+        Homer2MqttPublisher publisher{"127.0.0.1", broker.port(), "h2", "qos0", "", "", 0, 0};
+
+        publisher.publish(reading(500, 20.F));
+        HOMER2_CHECK(run_until(broker, &publisher, [](const auto& stats) {
+            return 2 == stats.messages.size();
+        }));
+
+        const auto stats = broker.stats();
+        HOMER2_CHECK_EQ(stats.connects, 1U);
+        HOMER2_CHECK_EQ(stats.clientId, std::string{"homer2-qos0"});
+        HOMER2_CHECK(stats.username.empty());
+        HOMER2_CHECK_EQ(stats.keepAliveSeconds, 0U);
+        HOMER2_CHECK_EQ(stats.pubacks, 0U);
+        for (const auto& message: stats.messages) {
+            HOMER2_CHECK_EQ(message.qos, 0U);
+            HOMER2_CHECK_EQ(message.packetId, 0U);
+            HOMER2_CHECK(contains(message.topic, "h2/qos0/"));
+        }
+
+        publisher.disconnect();
+        HOMER2_CHECK(run_until(broker, nullptr, [](const auto& stats) {
+            return 1 == stats.disconnects;
+        }));
+        HOMER2_CHECK_EQ(broker.stats().invalid, 0U);
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    // Time 0 stands for not set, the board's main loop waits past it too.
+    while (now() <= 100)
+        sleep_ms(10);
+
+    // Synced right away by the shim, messages carry timestamps as on a synced board.
+    homer2::clock::init_sntp("host");
+
+    test_qos1();
+    test_qos0();
+
+    return homer2::test::result();
+}
@@ -0,0 +1,265 @@
+#include <array>
+#include <cstring>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <homer2_logging.hpp>
+#include <homer2_config.h>
+#include <homer2_encoder.hpp>
+#include <homer2_metric.hpp>
+#include <homer2_payload.hpp>
+#include <homer2_telemetry.hpp>
+
+#include "homer2_remote_write.pb.h"
+
+#include "homer2_check.hpp"
+
+// What the remote write encoder produces, uncompressed with a snappy decoder written from the
+// format description and parsed by the protobuf library: every series carries the labels of its
+// metric and exactly the samples appended for it.
+
+namespace {
+
+    using homer2::Homer2Metric;
+    using homer2::Homer2Reading;
+    using homer2::Homer2TelemetryReading;
+
+    // Snappy's raw format: the uncompressed length as a varint, then literals and copies of what
+    // was already uncompressed. Returns false on anything malformed.
+    bool snappy_uncompress(
+        const std::string& compressed,
+        std::string& out
+    ) {
+        const auto* in = reinterpret_cast<const uint8_t*>(compressed.data());
+        const auto* const end = in + compressed.size();
+
+        uint64_t length = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            if (in == end || shift > 28)
+                return false;
+            const auto byte = *in++;
+            length |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (0 == (byte & 0x80))
+                break;
+        }
+
+        out.clear();
+        while (in < end) {
+            const auto tag = *in++;
+
+            if (0 == (tag & 0x03)) {
+                size_t len = tag >> 2;
+                if (len >= 60) {
+                    const size_t bytes = len - 59;
+                    if (static_cast<size_t>(end - in) < bytes)
+                        return false;
+                    len = 0;
+                    for (size_t i = 0; i < bytes; i++)
+                        len |= static_cast<size_t>(in[i]) << (8 * i);
+                    in += bytes;
+                }
+                len++;
+                if (static_cast<size_t>(end - in) < len)
+                    return false;
+                out.append(reinterpret_cast<const char*>(in), len);
+                in += len;
+                continue;
+            }
+
+            size_t len;
+            size_t offset;
+            if (1 == (tag & 0x03)) {
+                if (end - in < 1)
+                    return false;
+                len = 4 + ((tag >> 2) & 0x07);
+                offset = (static_cast<size_t>(tag >> 5) << 8) | in[0];
+                in += 1;
+            }
+            else {
+                const size_t bytes = 2 == (tag & 0x03) ? 2 : 4;
+                if (static_cast<size_t>(end - in) < bytes)
+                    return false;
+                len = 1 + (tag >> 2);
+                offset = 0;
+                for (size_t i = 0; i < bytes; i++)
+                    offset |= static_cast<size_t>(in[i]) << (8 * i);
+                in += bytes;
+            }
+
+            if (0 == offset || offset > out.size())
+                return false;
+            // Byte by byte, a copy may overlap what it is producing.
+            for (size_t i = 0; i < len; i++)
+                out.push_back(out[out.size() - offset]);
+        }
+
+        return out.size() == length;
+    }
+
+    using Labels = std::vector<std::pair<std::string, std::string>>;
+
+    using Samples = std::vector<std::pair<double, int64_t>>;
+
+    Labels labels_of(
+        const Homer2Metric metric
+    ) {
+        const auto& info = homer2::metric_info(metric);
+
+        Labels labels{{"__name__", info.name}, {"agent", "homer2"}};
+        if (nullptr != info.cat)
+            labels.emplace_back("cat", info.cat);
+        if (nullptr != info.le)
+            labels.emplace_back("le", info.le);
+        labels.emplace_back("sensor", info.sensor);
+
+        return labels;
+    }
+
+    // Encodes the telemetry and as many of the readings as fit, and checks the decoded request
+    // against them. Returns how many readings fit.
+    size_t check_round_trip(
+        const std::vector<std::pair<Homer2Reading, uint64_t>>& readings,
+        const Homer2TelemetryReading& telemetry,
+        const uint64_t telemetryTimestampMillis
+    ) {
+        std::array<char, HOMER2_VICTORIA_MAX_PAYLOAD_BYTES> buffer{};
+        homer2::Homer2Payload body{buffer.data(), buffer.size()};
+        homer2::Homer2RemoteWriteEncoder encoder{};
+
+        encoder.begin(body);
+        HOMER2_CHECK(encoder.append(body, telemetry, telemetryTimestampMillis));
+        size_t appended = 0;
+        while (appended < readings.size()
+               && encoder.append(body, readings[appended].first, readings[appended].second))
+            appended++;
+        encoder.end(body);
+
+        std::map<Labels, Samples> expected{};
+        for (size_t i = 0; i < homer2::METRIC_COUNT; i++) {
+            const auto metric = homer2::metric_at(i);
+            Samples samples{};
+            for (size_t r = 0; r < appended; r++) {
+                const auto& [reading, timestampMillis] = readings[r];
+                const auto value = homer2::metric_value(reading, metric);
+                if (value.has_value())
+                    samples.emplace_back(value.value(), static_cast<int64_t>(timestampMillis));
+            }
+            const auto value = homer2::metric_value(telemetry, metric);
+            if (value.has_value())
+                samples.emplace_back(
+                    static_cast<double>(value.value()),
+                    static_cast<int64_t>(telemetryTimestampMillis)
+                );
+            if (!samples.empty())
+                expected[labels_of(metric)] = samples;
+        }
+
+        std::string uncompressed{};
+        HOMER2_CHECK(snappy_uncompress(std::string{body.data(), body.size()}, uncompressed));
+
+        homer2::test::prompb::WriteRequest request{};
+        HOMER2_CHECK(request.ParseFromString(uncompressed));
+        HOMER2_CHECK_EQ(static_cast<size_t>(request.timeseries_size()), expected.size());
+
+        for (const auto& series: request.timeseries()) {
+            Labels labels{};
+            for (const auto& label: series.labels())
+                labels.emplace_back(label.name(), label.value());
+
+            // Remote write requires the labels sorted by name.
+            for (size_t i = 1; i < labels.size(); i++)
+                HOMER2_CHECK(labels[i - 1].first < labels[i].first);
+
+            const auto it = expected.find(labels);
+            HOMER2_CHECK(it != expected.end());
+            if (it == expected.end())
+                continue;
+
+            Samples samples{};
+            for (const auto& sample: series.samples())
+                samples.emplace_back(sample.value(), sample.timestamp());
+
+            HOMER2_CHECK(samples == it->second);
+            expected.erase(it);
+        }
+
+        HOMER2_CHECK(expected.empty());
+
+        return appended;
+    }
+
+    void set(
+        Homer2Reading& reading,
+        const Homer2Metric metric,
+        const float value
+    ) {
+        reading.mask |= 1ULL << static_cast<size_t>(metric);
+        reading.values[static_cast<size_t>(metric)] = value;
+    }
+
+    void set(
+        Homer2TelemetryReading& telemetry,
+        const Homer2Metric metric,
+        const uint64_t value
+    ) {
+        telemetry.mask |= 1ULL << static_cast<size_t>(metric);
+        telemetry.values[static_cast<size_t>(metric) - homer2::SENSOR_METRIC_COUNT] = value;
+    }
+
+    void test_few_samples() {
+
+        Homer2Reading first{};
+        set(first, Homer2Metric::sunrise_co2, 412.0f);
+        set(first, Homer2Metric::sht4x_temperature, 21.37f);
+
+        Homer2Reading second{};
+        set(second, Homer2Metric::sunrise_co2, 415.0f);
+        set(second, Homer2Metric::bmp3xx_pressure, 101325.5f);
+        set(second, Homer2Metric::pmsx00x_ptc0_3, 0.0f);
+
+        // Counters past what a float or a 32 bit varint holds.
+        Homer2TelemetryReading telemetry{};
+        for (size_t i = homer2::SENSOR_METRIC_COUNT; i < homer2::METRIC_COUNT; i++)
+            set(telemetry, homer2::metric_at(i), (1ULL << 40) + i);
+
+        HOMER2_CHECK_EQ(check_round_trip(
+            {{first, 1'700'000'000'000}, {second, 1'700'000'001'000}},
+            telemetry,
+            1'700'000'001'500
+        ), 2u);
+    }
+
+    void test_full_batch() {
+
+        // Every sensor value in more readings than fit, long enough for snappy to find copies.
+        std::vector<std::pair<Homer2Reading, uint64_t>> readings{};
+        for (size_t n = 0; n < HOMER2_VICTORIA_QUEUE_CAPACITY; n++) {
+            Homer2Reading reading{};
+            for (size_t i = 0; i < homer2::SENSOR_METRIC_COUNT; i++)
+                set(reading, homer2::metric_at(i), static_cast<float>(i) * 10.5f + static_cast<float>(n % 7));
+            readings.emplace_back(reading, 1'700'000'000'000 + n * 1000);
+        }
+
+        Homer2TelemetryReading telemetry{};
+        set(telemetry, Homer2Metric::homer2_sent_bytes, 123'456'789'012);
+
+        const auto appended = check_round_trip(readings, telemetry, 1'700'000'060'000);
+        HOMER2_CHECK(appended > 1);
+        HOMER2_CHECK(appended < readings.size());
+    }
+
+}
+
+int main() {
+
+    homer2::logging::init();
+
+    GOOGLE_PROTOBUF_VERIFY_VERSION;
+
+    test_few_samples();
+    test_full_batch();
+
+    return homer2::test::result();
+}
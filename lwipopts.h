@@ -22,6 +22,10 @@
 #define MEM_ALIGNMENT               4
 #define MEM_SIZE                    4000
 #define MEMP_NUM_TCP_SEG            32
+// Pusher endpoints, the mqtt publisher and the connections of the pull server.
+#define MEMP_NUM_TCP_PCB            10
+// dhcp, sntp, udp pushers, and a query of each resolver.
+#define MEMP_NUM_UDP_PCB            12
 #define MEMP_NUM_ARP_QUEUE          10
 #define PBUF_POOL_SIZE              24
 #define LWIP_ARP                    1
@@ -52,6 +56,23 @@
 #define DHCP_DOES_ARP_CHECK         0
 #define LWIP_DHCP_DOES_ACD_CHECK    0
 
+// SNTP, used to timestamp batched samples.
+#define SNTP_SERVER_DNS             1
+#define SNTP_STARTUP_DELAY          0
+// Often enough for the drift between syncs to be estimated and kept below a millisecond or so.
+#define SNTP_UPDATE_DELAY           (15 * 60 * 1000)
+#define MEMP_NUM_SYS_TIMEOUT        (LWIP_NUM_SYS_TIMEOUT_INTERNAL + 1)
+#define SNTP_SET_SYSTEM_TIME_US(sec, us) homer2_sntp_set_system_time_us(sec, us)
+
+#include <stdint.h>
+#ifdef __cplusplus
+extern "C" {
+#endif
+void homer2_sntp_set_system_time_us(uint32_t sec, uint32_t us);
+#ifdef __cplusplus
+}
+#endif
+
 #ifndef NDEBUG
 #define LWIP_DEBUG                  1
 #define LWIP_STATS                  1
@@ -0,0 +1,69 @@
+#include <homer2_logging.hpp>
+
+#include "homer2_alert.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Alert";
+
+    }
+
+    Homer2Alerts::Homer2Alerts(
+        std::vector<Homer2AlertRule> rules
+    ) noexcept: _rules{std::move(rules)} {
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Alerts::evaluate(
+        const Homer2SensorsData& data
+    ) noexcept {
+
+        uint64_t crossed = 0;
+
+        for (const auto& rule: this->_rules) {
+
+            const auto value = metric_value(data, rule.metric);
+
+            // A missing value keeps the alert as it is, there is nothing to tell it by.
+            if (!value.has_value())
+                continue;
+
+            const auto bit = 1ULL << static_cast<size_t>(rule.metric);
+            const auto raised = 0 != (this->_raised & bit);
+
+            if (!raised && *value > rule.threshold) {
+                W(TAG, "alert raised, " << metric_info(rule.metric).sensor << " "
+                    << metric_info(rule.metric).name << ": " << *value << " > " << rule.threshold);
+                this->_raised |= bit;
+            }
+            else if (raised && *value < rule.threshold * ALERT_CLEAR_RATIO) {
+                I(TAG, "alert cleared, " << metric_info(rule.metric).sensor << " "
+                    << metric_info(rule.metric).name << ": " << *value);
+                this->_raised &= ~bit;
+            }
+            else {
+                continue;
+            }
+
+            crossed |= bit;
+            this->_crossings++;
+        }
+
+        return crossed;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Alerts::raised() const noexcept {
+
+        return this->_raised;
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Alerts::crossings() const noexcept {
+
+        return this->_crossings;
+    }
+
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "homer2_metric.hpp"
+
+namespace homer2 {
+
+    struct Homer2AlertRule {
+
+        Homer2Metric metric;
+
+        // Raised once the value goes above it, cleared once it falls back below
+        // ALERT_CLEAR_RATIO of it, so that a value hovering around it does not flap.
+        float threshold;
+
+    };
+
+    constexpr float ALERT_CLEAR_RATIO = 0.9F;
+
+    // Threshold rules on the values alerted on, evaluated on every reading so that a crossing is
+    // pushed right away instead of waiting for the next push.
+    class Homer2Alerts {
+    public:
+
+        Homer2Alerts& operator=(const Homer2Alerts& other) noexcept = delete;
+
+        Homer2Alerts& operator=(Homer2Alerts&& other) = delete;
+
+        Homer2Alerts(Homer2Alerts&& other) = delete;
+
+        Homer2Alerts(const Homer2Alerts& other) noexcept = delete;
+
+
+        explicit Homer2Alerts(
+            std::vector<Homer2AlertRule> rules
+        ) noexcept;
+
+
+        // Bit i is set when the value of metric_at(i) raised or cleared its alert.
+        [[nodiscard]]
+        uint64_t evaluate(
+            const Homer2SensorsData& data
+        ) noexcept;
+
+        // Bit i is set while the alert of metric_at(i) is raised.
+        [[nodiscard]]
+        uint64_t raised() const noexcept;
+
+        [[nodiscard]]
+        uint32_t crossings() const noexcept;
+
+    private:
+
+        const std::vector<Homer2AlertRule> _rules;
+
+        uint64_t _raised{0};
+        uint32_t _crossings{0};
+
+    };
+
+}
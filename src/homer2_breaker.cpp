@@ -0,0 +1,106 @@
+#include <algorithm>
+#include <limits>
+
+#include <pico/rand.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_breaker.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Breaker";
+
+        // Doubling stops long before the shift could overflow, the maximum is reached way earlier.
+        constexpr uint8_t MAX_DOUBLINGS = 20;
+
+    }
+
+    Homer2Breaker::Homer2Breaker(
+        const char* const name,
+        const uint8_t threshold,
+        const uint64_t initialBackoffMillis,
+        const uint64_t maxBackoffMillis
+    ) noexcept: _name{name},
+                _threshold{threshold > 0 ? threshold : static_cast<uint8_t>(1)},
+                _initialBackoffMillis{initialBackoffMillis},
+                _maxBackoffMillis{std::max(initialBackoffMillis, maxBackoffMillis)} {
+    }
+
+    [[nodiscard]]
+    bool Homer2Breaker::allow() noexcept {
+
+        if (now() < this->_retryAtMillis)
+            return false;
+
+        if (this->_state == BreakerState::OPEN) {
+            I(TAG, "half-open, probing: " << this->_name);
+            this->_state = BreakerState::HALF_OPEN;
+        }
+
+        return true;
+    }
+
+    void Homer2Breaker::success() noexcept {
+
+        if (this->_state != BreakerState::CLOSED)
+            I(TAG, "closed, reachable again: " << this->_name);
+
+        this->_state = BreakerState::CLOSED;
+        this->_failures = 0;
+        this->_retryAtMillis = 0;
+    }
+
+    void Homer2Breaker::failure() noexcept {
+
+        // Nothing is attempted while open, this is a late error of the attempt that opened it.
+        if (this->_state == BreakerState::OPEN)
+            return;
+
+        if (this->_failures < std::numeric_limits<uint8_t>::max())
+            this->_failures++;
+
+        const auto doublings = std::min<uint8_t>(this->_failures - 1, MAX_DOUBLINGS);
+        const auto backoff = std::min(this->_initialBackoffMillis << doublings, this->_maxBackoffMillis);
+
+        // At least half the backoff so that the server does get its rest, the other half is
+        // random so that a fleet of picos does not retry in lockstep.
+        const auto half = backoff / 2;
+        const auto delay = half + get_rand_32() % (half + 1);
+        this->_retryAtMillis = now() + delay;
+
+        if (this->_state == BreakerState::HALF_OPEN || this->_failures >= this->_threshold) {
+            if (this->_state == BreakerState::CLOSED)
+                this->_trips++;
+            this->_state = BreakerState::OPEN;
+            W(TAG, "open, failures: " << std::to_string(this->_failures)
+                << ", next probe in: " << delay << "ms, " << this->_name);
+        }
+        else {
+            D(3, TAG, "backing off: " << delay << "ms, failures: " << std::to_string(this->_failures)
+                << ", " << this->_name);
+        }
+    }
+
+    [[nodiscard]]
+    BreakerState Homer2Breaker::state() const noexcept {
+
+        return this->_state;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Breaker::retryAtMillis() const noexcept {
+
+        return this->_retryAtMillis;
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Breaker::trips() const noexcept {
+
+        return this->_trips;
+    }
+
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace homer2 {
+
+    // Ordered by severity, the value is what is reported as the breaker_state metric.
+    enum class BreakerState : uint8_t {
+        CLOSED = 0,
+        HALF_OPEN = 1,
+        OPEN = 2,
+    };
+
+    // Paces the attempts of one connection: every failure in a row doubles the wait before the
+    // next attempt, up to a maximum. Once enough failures piled up the breaker opens, and a single
+    // probing attempt is let through each time the wait is over, until one succeeds.
+    class Homer2Breaker {
+    public:
+
+        Homer2Breaker& operator=(const Homer2Breaker& other) noexcept = delete;
+
+        Homer2Breaker& operator=(Homer2Breaker&& other) = delete;
+
+        Homer2Breaker(Homer2Breaker&& other) = delete;
+
+        Homer2Breaker(const Homer2Breaker& other) noexcept = delete;
+
+
+        Homer2Breaker(
+            const char* name,
+            uint8_t threshold,
+            uint64_t initialBackoffMillis,
+            uint64_t maxBackoffMillis
+        ) noexcept;
+
+
+        // Whether an attempt may be started now, an open breaker turns half-open once its wait
+        // is over.
+        [[nodiscard]]
+        bool allow() noexcept;
+
+        void success() noexcept;
+
+        void failure() noexcept;
+
+        [[nodiscard]]
+        BreakerState state() const noexcept;
+
+        // When allow() lets the next attempt through, 0 when it is not backing off.
+        [[nodiscard]]
+        uint64_t retryAtMillis() const noexcept;
+
+        // Times the breaker opened.
+        [[nodiscard]]
+        uint32_t trips() const noexcept;
+
+    private:
+
+        const char* const _name;
+        const uint8_t _threshold;
+        const uint64_t _initialBackoffMillis;
+        const uint64_t _maxBackoffMillis;
+
+        BreakerState _state{BreakerState::CLOSED};
+        uint8_t _failures{0};
+        uint64_t _retryAtMillis{0};
+        uint32_t _trips{0};
+
+    };
+
+}
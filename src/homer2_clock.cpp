@@ -0,0 +1,139 @@
+#include <pico/cyw43_arch.h>
+#include <lwip/apps/sntp.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_clock.hpp"
+
+namespace homer2::clock {
+
+    namespace {
+
+        const char* const TAG = "Clock";
+
+        // Drift is only estimated over long enough intervals, the error of a single sync (tens of
+        // ms) would swamp it otherwise.
+        constexpr uint64_t MIN_DRIFT_INTERVAL_MILLIS = 10 * 60 * 1000;
+
+        // Crystals are specified to tens of ppm, anything beyond is a bad sync, not drift.
+        constexpr double MAX_DRIFT = 200e-6;
+
+        // A correction this large is a step of the server's clock, not drift.
+        constexpr int64_t MAX_CORRECTION_MILLIS = 1000;
+
+        // Set from lwIP's context, read from the main loop under the lwIP lock.
+        struct Sync {
+
+            // Wall clock minus monotonic clock at the last sync.
+            int64_t offsetMillis;
+
+            uint64_t atMillis;
+
+            // How much faster the wall clock runs than the monotonic one, in ms per ms.
+            double drift;
+
+        };
+
+        Sync last_sync{0, 0, 0.0};
+        bool synced = false;
+
+        int64_t drift_corrected_offset(
+            const Sync& sync,
+            const uint64_t monotonicMillis
+        ) noexcept {
+            const auto elapsed = static_cast<double>(static_cast<int64_t>(monotonicMillis - sync.atMillis));
+            return sync.offsetMillis + static_cast<int64_t>(sync.drift * elapsed);
+        }
+
+    }
+
+    void init_sntp(
+        const char* const server
+    ) noexcept {
+
+        I(TAG, "init sntp, server: " << server);
+
+        cyw43_arch_lwip_begin();
+        sntp_setoperatingmode(SNTP_OPMODE_POLL);
+        sntp_setservername(0, server);
+        sntp_init();
+        cyw43_arch_lwip_end();
+    }
+
+    [[nodiscard]]
+    bool is_synced() noexcept {
+
+        return synced;
+    }
+
+    [[nodiscard]]
+    uint64_t epoch_millis(
+        const uint64_t monotonicMillis
+    ) noexcept {
+
+        cyw43_arch_lwip_begin();
+        const auto isSynced = synced;
+        const auto sync = last_sync;
+        cyw43_arch_lwip_end();
+
+        if (!isSynced)
+            return 0;
+
+        return static_cast<uint64_t>(
+            static_cast<int64_t>(monotonicMillis) + drift_corrected_offset(sync, monotonicMillis));
+    }
+
+}
+
+extern "C" {
+
+void homer2_sntp_set_system_time_us(
+    const uint32_t sec,
+    const uint32_t us
+) {
+    using namespace homer2::clock;
+
+    const auto monotonicMillis = now();
+    const auto epochMillis = static_cast<int64_t>(sec) * 1000 + static_cast<int64_t>(us / 1000);
+    const auto offset = epochMillis - static_cast<int64_t>(monotonicMillis);
+
+    auto drift = last_sync.drift;
+
+    if (synced) {
+        // What the previous sync and drift predicted against what the server says now, the
+        // difference is the drift still unaccounted for.
+        const auto correction = offset - drift_corrected_offset(last_sync, monotonicMillis);
+        const auto elapsed = monotonicMillis - last_sync.atMillis;
+
+        if (correction > MAX_CORRECTION_MILLIS || correction < -MAX_CORRECTION_MILLIS) {
+            W(TAG, "sntp stepped by " << correction << "ms, resetting drift");
+            drift = 0.0;
+        }
+        else if (elapsed >= MIN_DRIFT_INTERVAL_MILLIS) {
+            drift += static_cast<double>(correction) / static_cast<double>(elapsed);
+            if (drift > MAX_DRIFT)
+                drift = MAX_DRIFT;
+            else if (drift < -MAX_DRIFT)
+                drift = -MAX_DRIFT;
+        }
+        else {
+            // Too close to the previous sync to tell drift from noise, keep the old anchor.
+            D(3, TAG, "sntp sync, correction: " << correction << "ms, too early for drift");
+            return;
+        }
+
+        I(TAG, "sntp sync, correction: " << correction << "ms over " << elapsed
+            << "ms, drift: " << static_cast<int64_t>(drift * 1e9) << "ppb");
+    }
+    else {
+        I(TAG, "sntp sync, epoch: " << epochMillis << "ms, offset: " << offset << "ms");
+    }
+
+    cyw43_arch_lwip_begin();
+    last_sync = {offset, monotonicMillis, drift};
+    synced = true;
+    cyw43_arch_lwip_end();
+}
+
+}
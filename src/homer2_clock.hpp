@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstdint>
+
+namespace homer2::clock {
+
+    void init_sntp(
+        const char* server
+    ) noexcept;
+
+    [[nodiscard]]
+    bool is_synced() noexcept;
+
+    [[nodiscard]]
+    uint64_t epoch_millis(
+        uint64_t monotonicMillis
+    ) noexcept;
+
+}
+
+extern "C" {
+
+void homer2_sntp_set_system_time_us(
+    uint32_t sec,
+    uint32_t us
+);
+
+}
@@ -0,0 +1,79 @@
+#include <cmath>
+
+#include "homer2_deadband.hpp"
+
+namespace homer2 {
+
+    Homer2Deadband::Homer2Deadband(
+        const uint64_t heartbeatMillis
+    ) noexcept: _heartbeatMillis{heartbeatMillis} {
+    }
+
+    void Homer2Deadband::filter(
+        Homer2Reading& reading,
+        const uint64_t freshMask,
+        const uint64_t urgentMask,
+        const uint64_t nowMillis
+    ) noexcept {
+
+        for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++) {
+
+            const auto bit = 1ULL << i;
+
+            // A metric coming back after missing is reported right away.
+            if (0 == (reading.mask & bit)) {
+                this->_reportedMask &= ~bit;
+                this->_dueAtMillis[i] = 0;
+                continue;
+            }
+
+            if (0 == (freshMask & bit)) {
+                reading.mask &= ~bit;
+                continue;
+            }
+
+            const auto urgent = 0 != (urgentMask & bit);
+
+            if (!urgent && nowMillis < this->_dueAtMillis[i]) {
+                reading.mask &= ~bit;
+                this->_suppressed++;
+                continue;
+            }
+
+            const auto value = reading.values[i];
+
+            if (!urgent &&
+                0 != this->_heartbeatMillis &&
+                0 != (this->_reportedMask & bit) &&
+                nowMillis - this->_reportedAtMillis[i] < this->_heartbeatMillis) {
+
+                // Compared with the last reported value, not the last read one, so that a slow
+                // drift is still reported once it adds up.
+                const auto& info = sensor_metric_info(metric_at(i));
+                const auto last = this->_reported[i];
+                const auto band = std::fmax(info.deadbandAbs, info.deadbandRel * std::fabs(last));
+
+                if (std::fabs(value - last) < band) {
+                    reading.mask &= ~bit;
+                    this->_suppressed++;
+                    continue;
+                }
+            }
+
+            this->_reportedMask |= bit;
+            this->_reported[i] = value;
+            this->_reportedAtMillis[i] = nowMillis;
+
+            const auto cadence = sensor_metric_info(metric_at(i)).cadenceMillis;
+            const auto due = this->_dueAtMillis[i];
+            this->_dueAtMillis[i] = 0 != due && nowMillis - due < cadence ? due + cadence : nowMillis + cadence;
+        }
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Deadband::suppressed() const noexcept {
+
+        return this->_suppressed;
+    }
+
+}
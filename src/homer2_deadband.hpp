@@ -0,0 +1,61 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "homer2_metric.hpp"
+
+namespace homer2 {
+
+    // Report-by-exception: a value is only reported when it moved past its metric's deadband
+    // since it was last reported, or when it was not reported for a whole heartbeat. Either way
+    // not more often than its metric's cadence.
+    class Homer2Deadband {
+    public:
+
+        Homer2Deadband& operator=(const Homer2Deadband& other) noexcept = delete;
+
+        Homer2Deadband& operator=(Homer2Deadband&& other) = delete;
+
+        Homer2Deadband(Homer2Deadband&& other) = delete;
+
+        Homer2Deadband(const Homer2Deadband& other) noexcept = delete;
+
+
+        // A heartbeat of 0 disables the deadbands, every value due is reported.
+        explicit Homer2Deadband(
+            uint64_t heartbeatMillis
+        ) noexcept;
+
+
+        // Clears the values of the reading not worth reporting. Values not in freshMask repeat
+        // one already seen, they are cleared too but, unlike missing ones, keep their state.
+        // Fresh values in urgentMask are reported regardless of their deadband and cadence.
+        void filter(
+            Homer2Reading& reading,
+            uint64_t freshMask,
+            uint64_t urgentMask,
+            uint64_t nowMillis
+        ) noexcept;
+
+        [[nodiscard]]
+        uint64_t suppressed() const noexcept;
+
+    private:
+
+        const uint64_t _heartbeatMillis;
+
+        // Bit i is set once metric_at(i) was reported, cleared while the metric is missing.
+        uint64_t _reportedMask{0};
+        std::array<float, SENSOR_METRIC_COUNT> _reported{};
+        std::array<uint64_t, SENSOR_METRIC_COUNT> _reportedAtMillis{};
+
+        // Kept on a grid of the cadence, so that values read a little late do not add up to a
+        // longer cadence.
+        std::array<uint64_t, SENSOR_METRIC_COUNT> _dueAtMillis{};
+
+        uint64_t _suppressed{0};
+
+    };
+
+}
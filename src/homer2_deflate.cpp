@@ -0,0 +1,262 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "homer2_deflate.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        constexpr size_t WINDOW_SIZE = 1 << 12;
+
+        constexpr size_t HASH_BITS = 11;
+
+        constexpr size_t MIN_MATCH = 3;
+        constexpr size_t MAX_MATCH = 258;
+
+        constexpr size_t MAX_STORED_BLOCK = 0xffff;
+
+        // Input offsets + 1, 0 marks an empty slot. Statically allocated to keep the heap untouched.
+        std::array<uint16_t, 1 << HASH_BITS> hash_table{};
+
+        constexpr std::array<uint16_t, 29> LENGTH_BASE{
+            3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+        };
+
+        constexpr std::array<uint8_t, 29> LENGTH_EXTRA{
+            0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+        };
+
+        constexpr std::array<uint16_t, 30> DISTANCE_BASE{
+            1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577,
+        };
+
+        constexpr std::array<uint8_t, 30> DISTANCE_EXTRA{
+            0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+        };
+
+        static_assert(WINDOW_SIZE <= 32768, "deflate window is at most 32KiB");
+        static_assert(WINDOW_SIZE <= 0xffff, "hash table holds 16 bit offsets");
+
+        // Deflate packs bits starting from the least significant one.
+        class BitWriter {
+        public:
+
+            explicit BitWriter(
+                Homer2Payload& output
+            ) noexcept: _output{output} {
+            }
+
+            void bits(
+                const uint32_t value,
+                const uint8_t count
+            ) noexcept {
+                this->_buffer |= value << this->_count;
+                this->_count += count;
+                while (this->_count >= 8) {
+                    this->_output.append(static_cast<char>(this->_buffer));
+                    this->_buffer >>= 8;
+                    this->_count -= 8;
+                }
+            }
+
+            // Huffman codes are defined starting from their most significant bit.
+            void code(
+                const uint32_t value,
+                const uint8_t count
+            ) noexcept {
+                uint32_t reversed = 0;
+                for (uint8_t i = 0; i < count; i++)
+                    reversed |= ((value >> i) & 1U) << (count - 1 - i);
+                this->bits(reversed, count);
+            }
+
+            void flush() noexcept {
+                if (this->_count > 0)
+                    this->_output.append(static_cast<char>(this->_buffer));
+                this->_buffer = 0;
+                this->_count = 0;
+            }
+
+        private:
+
+            Homer2Payload& _output;
+            uint32_t _buffer{0};
+            uint8_t _count{0};
+
+        };
+
+        // RFC 1951 3.2.6, fixed literal/length codes.
+        void emit_symbol(
+            BitWriter& writer,
+            const uint16_t symbol
+        ) noexcept {
+            if (symbol < 144)
+                writer.code(0x30 + symbol, 8);
+            else if (symbol < 256)
+                writer.code(0x190 + symbol - 144, 9);
+            else if (symbol < 280)
+                writer.code(symbol - 256, 7);
+            else
+                writer.code(0xc0 + symbol - 280, 8);
+        }
+
+        void emit_match(
+            BitWriter& writer,
+            const size_t length,
+            const size_t distance
+        ) noexcept {
+            size_t l = LENGTH_BASE.size() - 1;
+            while (LENGTH_BASE[l] > length)
+                l--;
+            emit_symbol(writer, static_cast<uint16_t>(257 + l));
+            writer.bits(static_cast<uint32_t>(length - LENGTH_BASE[l]), LENGTH_EXTRA[l]);
+
+            size_t d = DISTANCE_BASE.size() - 1;
+            while (DISTANCE_BASE[d] > distance)
+                d--;
+            writer.code(static_cast<uint32_t>(d), 5);
+            writer.bits(static_cast<uint32_t>(distance - DISTANCE_BASE[d]), DISTANCE_EXTRA[d]);
+        }
+
+        uint32_t hash(
+            const char* const p
+        ) noexcept {
+            const auto value = static_cast<uint32_t>(static_cast<uint8_t>(p[0])) |
+                               static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 8 |
+                               static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 16;
+            return (value * 0x1e35a7bdu) >> (32 - HASH_BITS);
+        }
+
+        // A single block with fixed codes, matches found through the last position of each hash.
+        void deflate_fixed(
+            const char* const input,
+            const size_t len,
+            Homer2Payload& output
+        ) noexcept {
+            hash_table.fill(0);
+
+            BitWriter writer{output};
+            writer.bits(1, 1);
+            writer.bits(1, 2);
+
+            size_t ip = 0;
+            while (ip < len) {
+
+                size_t matched = 0;
+                size_t distance = 0;
+
+                if (ip + MIN_MATCH <= len) {
+                    auto& slot = hash_table[hash(input + ip)];
+                    if (slot > 0 && ip - (slot - 1) <= WINDOW_SIZE) {
+                        const size_t candidate = slot - 1;
+                        const auto limit = len - ip < MAX_MATCH ? len - ip : MAX_MATCH;
+                        while (matched < limit && input[candidate + matched] == input[ip + matched])
+                            matched++;
+                        distance = ip - candidate;
+                    }
+                    // Offsets past the 16 bit range can not be stored, hashing just stops there.
+                    if (ip + 1 <= 0xffff)
+                        slot = static_cast<uint16_t>(ip + 1);
+                }
+
+                if (matched >= MIN_MATCH) {
+                    emit_match(writer, matched, distance);
+                    ip += matched;
+                }
+                else {
+                    emit_symbol(writer, static_cast<uint8_t>(input[ip]));
+                    ip++;
+                }
+            }
+
+            emit_symbol(writer, 256);
+            writer.flush();
+        }
+
+        void deflate_stored(
+            const char* const input,
+            const size_t len,
+            Homer2Payload& output
+        ) noexcept {
+            size_t offset = 0;
+            do {
+                const auto blockLen = len - offset < MAX_STORED_BLOCK ? len - offset : MAX_STORED_BLOCK;
+                const auto last = offset + blockLen == len;
+                output.append(static_cast<char>(last ? 1 : 0))
+                    .append(static_cast<char>(blockLen))
+                    .append(static_cast<char>(blockLen >> 8))
+                    .append(static_cast<char>(~blockLen))
+                    .append(static_cast<char>(~blockLen >> 8))
+                    .append(input + offset, blockLen);
+                offset += blockLen;
+            } while (offset < len);
+        }
+
+        uint32_t crc32(
+            const char* const input,
+            const size_t len
+        ) noexcept {
+            // Half-byte table, a fair trade of speed for 64 bytes of flash.
+            constexpr std::array<uint32_t, 16> TABLE{
+                0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+                0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+                0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+                0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c,
+            };
+
+            uint32_t crc = 0xffffffff;
+            for (size_t i = 0; i < len; i++) {
+                crc ^= static_cast<uint8_t>(input[i]);
+                crc = (crc >> 4) ^ TABLE[crc & 0x0f];
+                crc = (crc >> 4) ^ TABLE[crc & 0x0f];
+            }
+            return ~crc;
+        }
+
+        void append_le32(
+            Homer2Payload& output,
+            const uint32_t value
+        ) noexcept {
+            output.append(static_cast<char>(value))
+                .append(static_cast<char>(value >> 8))
+                .append(static_cast<char>(value >> 16))
+                .append(static_cast<char>(value >> 24));
+        }
+
+    }
+
+    [[nodiscard]]
+    bool gzip_compress(
+        const char* const input,
+        const size_t len,
+        Homer2Payload& output
+    ) noexcept {
+
+        // No name, no modification time, unknown OS.
+        constexpr std::array<uint8_t, 10> HEADER{0x1f, 0x8b, 0x08, 0, 0, 0, 0, 0, 0, 0xff};
+        output.append(reinterpret_cast<const char*>(HEADER.data()), HEADER.size());
+        if (output.overflowed())
+            return false;
+
+        const auto mark = output.size();
+        deflate_fixed(input, len, output);
+
+        const auto storedSize = len + 5 * (len / MAX_STORED_BLOCK + 1);
+        if (output.overflowed() || output.size() - mark > storedSize) {
+            output.truncate(mark);
+            deflate_stored(input, len, output);
+        }
+
+        append_le32(output, crc32(input, len));
+        append_le32(output, static_cast<uint32_t>(len));
+
+        return !output.overflowed();
+    }
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+
+#include "homer2_payload.hpp"
+
+namespace homer2 {
+
+    // Deflate falls back to stored blocks, 5 bytes each, when compressing does not pay off. The
+    // gzip header and trailer take another 18 bytes.
+    constexpr size_t gzip_max_compressed_length(
+        const size_t len
+    ) noexcept {
+
+        return 18 + len + 5 * (len / 0xffff + 1);
+    }
+
+    // Compresses into a single gzip member, using fixed Huffman codes and a 4KiB window so that
+    // only a small, statically allocated hash table is needed. Returns false if the output did
+    // not fit.
+    [[nodiscard]]
+    bool gzip_compress(
+        const char* input,
+        size_t len,
+        Homer2Payload& output
+    ) noexcept;
+
+}
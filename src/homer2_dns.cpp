@@ -0,0 +1,411 @@
+#include <cctype>
+#include <cstring>
+#include <limits>
+
+#include <pico/rand.h>
+#include <lwip/dns.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_dns.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Dns";
+
+        constexpr uint16_t DNS_PORT = 53;
+
+        constexpr uint64_t QUERY_TIMEOUT_MILLIS = 3'000;
+
+        // A name server not answering a refresh is not asked again for this long, the cached
+        // addresses are served meanwhile.
+        constexpr uint64_t REFRESH_RETRY_MILLIS = 30'000;
+
+        constexpr uint16_t TYPE_A = 1;
+        constexpr uint16_t CLASS_IN = 1;
+
+        // Plain DNS over UDP, answers are at most this long.
+        constexpr size_t MAX_MESSAGE_BYTES = 512;
+
+        // Shared by every resolver, a response is parsed right where it is received.
+        std::array<uint8_t, MAX_MESSAGE_BYTES> message_buffer{};
+
+        uint16_t read_u16(
+            const uint8_t* const data
+        ) noexcept {
+            return static_cast<uint16_t>((data[0] << 8) | data[1]);
+        }
+
+        uint32_t read_u32(
+            const uint8_t* const data
+        ) noexcept {
+            return (static_cast<uint32_t>(read_u16(data)) << 16) | read_u16(data + 2);
+        }
+
+        // Skips a possibly compressed name, returns the offset past it or 0 when malformed.
+        size_t skip_name(
+            const uint8_t* const data,
+            const size_t len,
+            size_t offset
+        ) noexcept {
+            while (offset < len) {
+                const auto label = data[offset];
+
+                if (0 == label)
+                    return offset + 1;
+
+                // A pointer ends the name.
+                if (0xc0 == (label & 0xc0))
+                    return offset + 2 <= len ? offset + 2 : 0;
+
+                offset += 1 + label;
+            }
+
+            return 0;
+        }
+
+        // Matches the uncompressed name of a question against name, ignoring case as DNS does.
+        // Returns the offset past it or 0 when it is another name or malformed.
+        size_t match_name(
+            const uint8_t* const data,
+            const size_t len,
+            size_t offset,
+            const char* name
+        ) noexcept {
+            while (offset < len) {
+                const auto label = data[offset++];
+
+                if (0 == label)
+                    return '\0' == *name ? offset : 0;
+
+                if (0 != (label & 0xc0) || offset + label > len)
+                    return 0;
+
+                for (size_t i = 0; i < label; i++, name++) {
+                    if ('\0' == *name || tolower(data[offset + i]) != tolower(*name))
+                        return 0;
+                }
+                offset += label;
+
+                if ('.' == *name)
+                    name++;
+                else if ('\0' != *name)
+                    return 0;
+            }
+
+            return 0;
+        }
+
+    }
+
+    Homer2Resolver::Homer2Resolver(
+        const char* const name,
+        Homer2Histogram* const latency
+    ) noexcept: _name{name},
+                _latency{latency} {
+
+        ip_addr_t ip{};
+        if (strlen(name) > 0 && 1 == ipaddr_aton(name, &ip)) {
+            this->_literal = true;
+            this->_addresses[0] = ip;
+            this->_count = 1;
+        }
+    }
+
+    Homer2Resolver::~Homer2Resolver() noexcept {
+
+        this->finish();
+    }
+
+    [[nodiscard]]
+    bool Homer2Resolver::resolve(
+        ip_addr_t& ip
+    ) noexcept {
+
+        if (this->_literal) {
+            ip = this->_addresses[0];
+            return true;
+        }
+
+        if (nullptr != this->_pcb && is_expired(this->_queriedAtMillis, QUERY_TIMEOUT_MILLIS)) {
+            W(TAG, "query timed out: " << this->_name);
+            this->fail();
+        }
+
+        // Refreshed once three quarters of the TTL are gone, well ahead of the expiry.
+        const auto stale = 0 == this->_count ||
+                           is_expired(this->_resolvedAtMillis, this->_ttlMillis / 4 * 3);
+        if (stale && nullptr == this->_pcb && now() >= this->_retryAfterMillis)
+            this->query();
+
+        if (0 == this->_count)
+            return false;
+
+        ip = this->_addresses[this->_current];
+        return true;
+    }
+
+    void Homer2Resolver::failover() noexcept {
+
+        if (this->_literal || 0 == this->_count)
+            return;
+
+        this->_current = (this->_current + 1) % this->_count;
+        this->_failedOver++;
+
+        D(3, TAG, "failing over to address #" << this->_current << " of: " << this->_name);
+
+        // Every address failed, the name may well point elsewhere by now.
+        if (this->_failedOver >= this->_count) {
+            I(TAG, "every address failed, resolving again: " << this->_name);
+            this->_failedOver = 0;
+            this->_ttlMillis = 0;
+            this->_retryAfterMillis = 0;
+        }
+    }
+
+    [[nodiscard]]
+    uint8_t Homer2Resolver::failures() const noexcept {
+
+        return this->_failures;
+    }
+
+    void Homer2Resolver::query() noexcept {
+
+        // Every other attempt goes to the configured server, in case the one handed out by
+        // DHCP is not answering.
+        auto& server = this->_server;
+        server = ip_addr_t{};
+        const auto* const dhcpServer = dns_getserver(0);
+        if (0 == this->_attempts % 2 && nullptr != dhcpServer && !ip_addr_isany(dhcpServer))
+            server = *dhcpServer;
+        else
+            (void) ipaddr_aton(HOMER2_DNS_SERVER, &server);
+        this->_attempts++;
+
+        // Header: id, recursion desired, one question.
+        this->_queryId = static_cast<uint16_t>(get_rand_32());
+        size_t len = 0;
+        auto& msg = message_buffer;
+        const uint8_t header[12] = {
+            static_cast<uint8_t>(this->_queryId >> 8), static_cast<uint8_t>(this->_queryId),
+            0x01, 0x00,
+            0x00, 0x01,
+            0x00, 0x00,
+            0x00, 0x00,
+            0x00, 0x00,
+        };
+        memcpy(msg.data(), header, sizeof(header));
+        len += sizeof(header);
+
+        // The name as length prefixed labels.
+        const auto nameLen = strlen(this->_name);
+        if (nameLen + 2 + 4 + len > msg.size()) {
+            E(TAG, "name too long: " << this->_name);
+            this->fail();
+            return;
+        }
+        size_t labelStart = len++;
+        for (size_t i = 0; i <= nameLen; i++) {
+            if (i == nameLen || '.' == this->_name[i]) {
+                msg[labelStart] = static_cast<uint8_t>(len - labelStart - 1);
+                labelStart = len++;
+            }
+            else {
+                msg[len++] = static_cast<uint8_t>(this->_name[i]);
+            }
+        }
+        msg[labelStart] = 0;
+        msg[len++] = TYPE_A >> 8;
+        msg[len++] = TYPE_A & 0xff;
+        msg[len++] = CLASS_IN >> 8;
+        msg[len++] = CLASS_IN & 0xff;
+
+        D(4, TAG, "querying: " << this->_name << " at: " << ipaddr_ntoa(&server));
+
+        this->_pcb = udp_new_ip_type(IPADDR_TYPE_V4);
+        struct pbuf* const pBuf = nullptr == this->_pcb
+                                  ? nullptr
+                                  : pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(len), PBUF_RAM);
+        if (nullptr == pBuf) {
+            E(TAG, "out of memory for query: " << this->_name);
+            this->fail();
+            return;
+        }
+
+        udp_recv(
+            this->_pcb,
+            [](
+                void* const arg,
+                struct udp_pcb* const pcb,
+                struct pbuf* const p,
+                const ip_addr_t* const addr,
+                const u16_t port
+            ) {
+                (void) pcb;
+                static_cast<Homer2Resolver*>(arg)->onResponse(p, addr, port);
+            },
+            this
+        );
+
+        memcpy(pBuf->payload, msg.data(), len);
+        const auto err = udp_sendto(this->_pcb, pBuf, &server, DNS_PORT);
+        pbuf_free(pBuf);
+
+        if (ERR_OK != err) {
+            E(TAG, "could not send query: " << std::to_string(err));
+            this->fail();
+            return;
+        }
+
+        this->_queriedAtMillis = now();
+    }
+
+    void Homer2Resolver::finish() noexcept {
+
+        if (nullptr == this->_pcb)
+            return;
+
+        udp_remove(this->_pcb);
+        this->_pcb = nullptr;
+    }
+
+    void Homer2Resolver::onResponse(
+        struct pbuf* const pBuf,
+        const ip_addr_t* const addr,
+        const u16_t port
+    ) noexcept {
+
+        const auto len = pbuf_copy_partial(pBuf, message_buffer.data(), message_buffer.size(), 0);
+        pbuf_free(pBuf);
+
+        // Anything but the answer to the outstanding query, from the server it went to, is
+        // dropped, the query stays outstanding until it is answered or times out.
+        const auto* const data = message_buffer.data();
+        if (nullptr == addr || !ip_addr_cmp(addr, &this->_server) || DNS_PORT != port) {
+            D(3, TAG, "ignoring response from another source, port: " << port);
+            return;
+        }
+
+        if (len < 12 || read_u16(data) != this->_queryId || 1 != read_u16(data + 4) ||
+            0 == match_name(data, len, 12, this->_name)) {
+            D(3, TAG, "ignoring unrelated response");
+            return;
+        }
+
+        this->finish();
+
+        if (!this->parse(message_buffer.data(), len))
+            this->fail();
+    }
+
+    [[nodiscard]]
+    bool Homer2Resolver::parse(
+        const uint8_t* const data,
+        const size_t len
+    ) noexcept {
+
+        const auto flags = read_u16(data + 2);
+        const auto rcode = flags & 0x0f;
+        if (0 == (flags & 0x8000) || 0 != rcode) {
+            E(TAG, "failed to resolve: " << this->_name << ", rcode: " << rcode);
+            return false;
+        }
+
+        const auto questions = read_u16(data + 4);
+        const auto answers = read_u16(data + 6);
+
+        size_t offset = 12;
+        for (uint16_t i = 0; i < questions; i++) {
+            offset = skip_name(data, len, offset);
+            if (0 == offset || offset + 4 > len)
+                return false;
+            offset += 4;
+        }
+
+        std::array<ip_addr_t, HOMER2_DNS_MAX_ADDRESSES> addresses{};
+        size_t count = 0;
+        uint32_t ttl = HOMER2_DNS_MAX_TTL_SECONDS;
+
+        // Aliases come before the addresses, the shortest TTL on the way bounds them all.
+        for (uint16_t i = 0; i < answers; i++) {
+            offset = skip_name(data, len, offset);
+            if (0 == offset || offset + 10 > len)
+                return false;
+
+            const auto type = read_u16(data + offset);
+            const auto cls = read_u16(data + offset + 2);
+            const auto recordTtl = read_u32(data + offset + 4);
+            const auto rdLen = read_u16(data + offset + 8);
+            offset += 10;
+            if (offset + rdLen > len)
+                return false;
+
+            if (recordTtl < ttl)
+                ttl = recordTtl;
+
+            if (TYPE_A == type && CLASS_IN == cls && 4 == rdLen && count < addresses.size())
+                memcpy(&addresses[count++].addr, data + offset, 4);
+
+            offset += rdLen;
+        }
+
+        if (0 == count) {
+            E(TAG, "no address for: " << this->_name);
+            return false;
+        }
+
+        if (ttl < HOMER2_DNS_MIN_TTL_SECONDS)
+            ttl = HOMER2_DNS_MIN_TTL_SECONDS;
+
+        // Stays with the address in use if it is still among them, a connection works already.
+        size_t current = 0;
+        if (this->_count > 0) {
+            auto kept = false;
+            for (size_t i = 0; i < count; i++) {
+                if (addresses[i].addr == this->_addresses[this->_current].addr) {
+                    current = i;
+                    kept = true;
+                }
+            }
+
+            if (!kept)
+                I(TAG, "address changed: " << this->_name);
+        }
+
+        this->_addresses = addresses;
+        this->_count = count;
+        this->_current = current;
+        this->_failedOver = 0;
+        this->_resolvedAtMillis = now();
+        this->_ttlMillis = ttl * 1000ULL;
+        this->_attempts = 0;
+        this->_failures = 0;
+
+        if (nullptr != this->_latency)
+            this->_latency->observe(now() - this->_queriedAtMillis);
+
+        I(TAG, "resolved: " << this->_name << " => " << ipaddr_ntoa(&this->_addresses[current])
+            << ", addresses: " << count << ", ttl: " << ttl << "s");
+
+        return true;
+    }
+
+    void Homer2Resolver::fail() noexcept {
+
+        this->finish();
+
+        // With addresses at hand a failed refresh is not an outage, those are served meanwhile.
+        if (this->_count > 0) {
+            this->_retryAfterMillis = now() + REFRESH_RETRY_MILLIS;
+            return;
+        }
+
+        if (this->_failures < std::numeric_limits<uint8_t>::max())
+            this->_failures++;
+    }
+
+}
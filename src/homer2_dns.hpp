@@ -0,0 +1,100 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <lwip/udp.h>
+#include <lwip/ip_addr.h>
+
+#include "homer2_config.h"
+#include "homer2_telemetry.hpp"
+
+namespace homer2 {
+
+    // Resolves one host name and keeps every address of the answer for as long as its TTL allows.
+    // Queries are sent by the resolver itself, lwIP's resolver keeps neither the TTL nor more than
+    // one address.
+    //
+    // Once resolved, an address is always at hand: it is refreshed in the background ahead of its
+    // expiry, and served past it while the name server can not be reached.
+    class Homer2Resolver {
+    public:
+
+        Homer2Resolver& operator=(const Homer2Resolver& other) noexcept = delete;
+
+        Homer2Resolver& operator=(Homer2Resolver&& other) = delete;
+
+        Homer2Resolver(Homer2Resolver&& other) = delete;
+
+        Homer2Resolver() = delete;
+
+        Homer2Resolver(const Homer2Resolver& other) noexcept = delete;
+
+
+        // The time every successful query took is observed into latency, unless it is null.
+        Homer2Resolver(
+            const char* name,
+            Homer2Histogram* latency
+        ) noexcept;
+
+        ~Homer2Resolver() noexcept;
+
+
+        // Must be called holding the lwIP lock. False until the name is resolved for the first
+        // time, a query is started or kept going as needed either way.
+        [[nodiscard]]
+        bool resolve(
+            ip_addr_t& ip
+        ) noexcept;
+
+        // The address last handed out could not be connected to, the next one is used from now
+        // on. Once every address failed the name is queried again right away.
+        void failover() noexcept;
+
+        // Queries failed in a row while no address is known.
+        [[nodiscard]]
+        uint8_t failures() const noexcept;
+
+    private:
+
+        void query() noexcept;
+
+        void finish() noexcept;
+
+        void onResponse(
+            struct pbuf* pBuf,
+            const ip_addr_t* addr,
+            u16_t port
+        ) noexcept;
+
+        [[nodiscard]]
+        bool parse(
+            const uint8_t* data,
+            size_t len
+        ) noexcept;
+
+        void fail() noexcept;
+
+        const char* const _name;
+        Homer2Histogram* const _latency;
+        bool _literal{false};
+
+        std::array<ip_addr_t, HOMER2_DNS_MAX_ADDRESSES> _addresses{};
+        size_t _count{0};
+        size_t _current{0};
+        size_t _failedOver{0};
+
+        uint64_t _resolvedAtMillis{0};
+        uint64_t _ttlMillis{0};
+        uint64_t _retryAfterMillis{0};
+
+        struct udp_pcb* _pcb{nullptr};
+        ip_addr_t _server{};
+        uint16_t _queryId{0};
+        uint64_t _queriedAtMillis{0};
+        uint8_t _attempts{0};
+        uint8_t _failures{0};
+
+    };
+
+}
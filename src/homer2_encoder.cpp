@@ -0,0 +1,694 @@
+#include <cstring>
+#include <stdexcept>
+
+#include "homer2_snappy.hpp"
+#include "homer2_encoder.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        constexpr uint8_t FLOAT_DECIMALS = 3;
+
+        bool same_tag(
+            const char* const a,
+            const char* const b
+        ) noexcept {
+            return a == b || (nullptr != a && nullptr != b && 0 == strcmp(a, b));
+        }
+
+        // Sensor values are floats, homer2's own counters integers.
+        void append_value(
+            Homer2Payload& body,
+            const float value
+        ) noexcept {
+            body.appendFloat(value, FLOAT_DECIMALS);
+        }
+
+        void append_value(
+            Homer2Payload& body,
+            const uint64_t value
+        ) noexcept {
+            body.appendUnsigned(value);
+        }
+
+        // Values: a Homer2Reading or a Homer2TelemetryReading.
+        template<typename Values>
+        bool append_json(
+            Homer2Payload& body,
+            const Values& values,
+            const uint64_t timestampMillis
+        ) noexcept {
+
+            for (size_t i = 0; i < METRIC_COUNT; i++) {
+
+                const auto metric = metric_at(i);
+                const auto value = metric_value(values, metric);
+                if (!value.has_value())
+                    continue;
+
+                const auto& info = metric_info(metric);
+
+                body.append(R"({"metric":")")
+                    .append(info.name)
+                    .append(R"(","tags":{"agent":"homer2","sensor":")")
+                    .append(info.sensor);
+                if (nullptr != info.cat)
+                    body.append(R"(","cat":")")
+                        .append(info.cat);
+                if (nullptr != info.le)
+                    body.append(R"(","le":")")
+                        .append(info.le);
+                body.append(R"("},)");
+                if (timestampMillis > 0)
+                    body.append(R"("timestamp":)")
+                        .appendUnsigned(timestampMillis)
+                        .append(',');
+                body.append(R"("value":)");
+                append_value(body, value.value());
+                body.append("},");
+            }
+
+            return !body.overflowed();
+        }
+
+        template<typename Values>
+        bool append_influx(
+            Homer2Payload& body,
+            const Values& values,
+            const uint64_t timestampMillis
+        ) noexcept {
+
+            // Metrics share a line as long as they share their tags.
+            const Homer2MetricInfo* line = nullptr;
+
+            for (size_t i = 0; i < METRIC_COUNT; i++) {
+
+                const auto metric = metric_at(i);
+                const auto value = metric_value(values, metric);
+                if (!value.has_value())
+                    continue;
+
+                const auto& info = metric_info(metric);
+
+                if (nullptr == line ||
+                    0 != strcmp(info.sensor, line->sensor) ||
+                    !same_tag(info.cat, line->cat) ||
+                    !same_tag(info.le, line->le)) {
+                    if (nullptr != line) {
+                        if (timestampMillis > 0)
+                            body.append(' ').appendUnsigned(timestampMillis);
+                        body.append('\n');
+                    }
+
+                    line = &info;
+
+                    // The sensor tag keeps series identical to the JSON ones when VictoriaMetrics
+                    // runs with -influxSkipMeasurement.
+                    body.append(info.sensor)
+                        .append(",agent=homer2,sensor=")
+                        .append(info.sensor);
+                    if (nullptr != info.cat)
+                        body.append(",cat=")
+                            .append(info.cat);
+                    if (nullptr != info.le)
+                        body.append(",le=")
+                            .append(info.le);
+                    body.append(' ');
+                }
+                else {
+                    body.append(',');
+                }
+
+                body.append(info.name)
+                    .append('=');
+                append_value(body, value.value());
+            }
+
+            if (nullptr != line) {
+                if (timestampMillis > 0)
+                    body.append(' ').appendUnsigned(timestampMillis);
+                body.append('\n');
+            }
+
+            return !body.overflowed();
+        }
+
+        template<typename Values>
+        bool append_graphite(
+            Homer2Payload& body,
+            const Values& values,
+            const uint64_t timestampMillis
+        ) noexcept {
+
+            for (size_t i = 0; i < METRIC_COUNT; i++) {
+
+                const auto metric = metric_at(i);
+                const auto value = metric_value(values, metric);
+                if (!value.has_value())
+                    continue;
+
+                const auto& info = metric_info(metric);
+
+                body.append(info.name)
+                    .append(";agent=homer2");
+                if (nullptr != info.cat)
+                    body.append(";cat=")
+                        .append(info.cat);
+                if (nullptr != info.le)
+                    body.append(";le=")
+                        .append(info.le);
+                body.append(";sensor=")
+                    .append(info.sensor)
+                    .append(' ');
+                append_value(body, value.value());
+
+                // Graphite timestamps are in seconds, VictoriaMetrics keeps the fraction.
+                if (timestampMillis > 0) {
+                    const auto millis = timestampMillis % 1000;
+                    body.append(' ')
+                        .appendUnsigned(timestampMillis / 1000)
+                        .append('.');
+                    if (millis < 100)
+                        body.append('0');
+                    if (millis < 10)
+                        body.append('0');
+                    body.appendUnsigned(millis);
+                }
+
+                body.append('\n');
+            }
+
+            return !body.overflowed();
+        }
+
+    }
+
+    [[nodiscard]]
+    const char* Homer2JsonEncoder::path() const noexcept {
+
+        return "/api/put";
+    }
+
+    [[nodiscard]]
+    const char* Homer2JsonEncoder::contentType() const noexcept {
+
+        return "application/json";
+    }
+
+    [[nodiscard]]
+    const char* Homer2JsonEncoder::headers() const noexcept {
+
+        return "";
+    }
+
+    [[nodiscard]]
+    size_t Homer2JsonEncoder::trailerSize() const noexcept {
+
+        return 1;
+    }
+
+    [[nodiscard]]
+    bool Homer2JsonEncoder::requiresTimestamps() const noexcept {
+
+        return false;
+    }
+
+    void Homer2JsonEncoder::begin(
+        Homer2Payload& body
+    ) noexcept {
+
+        body.append('[');
+    }
+
+    [[nodiscard]]
+    bool Homer2JsonEncoder::append(
+        Homer2Payload& body,
+        const Homer2Reading& reading,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_json(body, reading, timestampMillis);
+    }
+
+    [[nodiscard]]
+    bool Homer2JsonEncoder::append(
+        Homer2Payload& body,
+        const Homer2TelemetryReading& telemetry,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_json(body, telemetry, timestampMillis);
+    }
+
+    void Homer2JsonEncoder::end(
+        Homer2Payload& body
+    ) noexcept {
+
+        if (body.back() == ',')
+            body.truncate(body.size() - 1);
+
+        body.append(']');
+    }
+
+}
+
+namespace homer2 {
+
+    [[nodiscard]]
+    const char* Homer2InfluxEncoder::path() const noexcept {
+
+        return "/write?precision=ms";
+    }
+
+    [[nodiscard]]
+    const char* Homer2InfluxEncoder::contentType() const noexcept {
+
+        return "text/plain; charset=utf-8";
+    }
+
+    [[nodiscard]]
+    const char* Homer2InfluxEncoder::headers() const noexcept {
+
+        return "";
+    }
+
+    [[nodiscard]]
+    size_t Homer2InfluxEncoder::trailerSize() const noexcept {
+
+        return 0;
+    }
+
+    [[nodiscard]]
+    bool Homer2InfluxEncoder::requiresTimestamps() const noexcept {
+
+        return false;
+    }
+
+    void Homer2InfluxEncoder::begin(
+        Homer2Payload& body
+    ) noexcept {
+
+        (void) body;
+    }
+
+    [[nodiscard]]
+    bool Homer2InfluxEncoder::append(
+        Homer2Payload& body,
+        const Homer2Reading& reading,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_influx(body, reading, timestampMillis);
+    }
+
+    [[nodiscard]]
+    bool Homer2InfluxEncoder::append(
+        Homer2Payload& body,
+        const Homer2TelemetryReading& telemetry,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_influx(body, telemetry, timestampMillis);
+    }
+
+    void Homer2InfluxEncoder::end(
+        Homer2Payload& body
+    ) noexcept {
+
+        (void) body;
+    }
+
+}
+
+namespace homer2 {
+
+    [[nodiscard]]
+    const char* Homer2GraphiteEncoder::path() const noexcept {
+
+        return "";
+    }
+
+    [[nodiscard]]
+    const char* Homer2GraphiteEncoder::contentType() const noexcept {
+
+        return "text/plain";
+    }
+
+    [[nodiscard]]
+    const char* Homer2GraphiteEncoder::headers() const noexcept {
+
+        return "";
+    }
+
+    [[nodiscard]]
+    size_t Homer2GraphiteEncoder::trailerSize() const noexcept {
+
+        return 0;
+    }
+
+    [[nodiscard]]
+    bool Homer2GraphiteEncoder::requiresTimestamps() const noexcept {
+
+        return false;
+    }
+
+    void Homer2GraphiteEncoder::begin(
+        Homer2Payload& body
+    ) noexcept {
+
+        (void) body;
+    }
+
+    [[nodiscard]]
+    bool Homer2GraphiteEncoder::append(
+        Homer2Payload& body,
+        const Homer2Reading& reading,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_graphite(body, reading, timestampMillis);
+    }
+
+    [[nodiscard]]
+    bool Homer2GraphiteEncoder::append(
+        Homer2Payload& body,
+        const Homer2TelemetryReading& telemetry,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        return append_graphite(body, telemetry, timestampMillis);
+    }
+
+    void Homer2GraphiteEncoder::end(
+        Homer2Payload& body
+    ) noexcept {
+
+        (void) body;
+    }
+
+}
+
+namespace homer2 {
+
+    namespace {
+
+        // Protobuf keys, (field number << 3) | wire type, of the prometheus remote-write messages.
+        constexpr char WRITE_REQUEST_TIMESERIES = 0x0a;
+        constexpr char TIMESERIES_LABELS = 0x0a;
+        constexpr char TIMESERIES_SAMPLES = 0x12;
+        constexpr char LABEL_NAME = 0x0a;
+        constexpr char LABEL_VALUE = 0x12;
+        constexpr char SAMPLE_VALUE = 0x09;
+        constexpr char SAMPLE_TIMESTAMP = 0x10;
+
+        constexpr size_t DOUBLE_SIZE = 8;
+
+        // The uncompressed WriteRequest, snappy then compresses it into the body.
+        std::array<char, HOMER2_VICTORIA_MAX_PAYLOAD_BYTES> write_request_buffer{};
+
+        size_t varint_size(
+            uint64_t value
+        ) noexcept {
+            size_t size = 1;
+            while (value >= 0x80) {
+                value >>= 7;
+                size++;
+            }
+            return size;
+        }
+
+        size_t field_size(
+            const size_t len
+        ) noexcept {
+            return 1 + varint_size(len) + len;
+        }
+
+        size_t label_size(
+            const char* const name,
+            const char* const value
+        ) noexcept {
+            return field_size(field_size(strlen(name)) + field_size(strlen(value)));
+        }
+
+        // Labels must be sorted by name.
+        size_t labels_size(
+            const Homer2MetricInfo& info
+        ) noexcept {
+            size_t size = label_size("__name__", info.name) + label_size("agent", "homer2");
+            if (nullptr != info.cat)
+                size += label_size("cat", info.cat);
+            if (nullptr != info.le)
+                size += label_size("le", info.le);
+            return size + label_size("sensor", info.sensor);
+        }
+
+        size_t sample_size(
+            const uint64_t timestampMillis
+        ) noexcept {
+            return 1 + DOUBLE_SIZE + 1 + varint_size(timestampMillis);
+        }
+
+        void put_varint(
+            Homer2Payload& buffer,
+            uint64_t value
+        ) noexcept {
+            while (value >= 0x80) {
+                buffer.append(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            buffer.append(static_cast<char>(value));
+        }
+
+        void put_string(
+            Homer2Payload& buffer,
+            const char key,
+            const char* const value
+        ) noexcept {
+            const auto len = strlen(value);
+            buffer.append(key);
+            put_varint(buffer, len);
+            buffer.append(value, len);
+        }
+
+        void put_label(
+            Homer2Payload& buffer,
+            const char* const name,
+            const char* const value
+        ) noexcept {
+            buffer.append(TIMESERIES_LABELS);
+            put_varint(buffer, field_size(strlen(name)) + field_size(strlen(value)));
+            put_string(buffer, LABEL_NAME, name);
+            put_string(buffer, LABEL_VALUE, value);
+        }
+
+        void put_double(
+            Homer2Payload& buffer,
+            const double value
+        ) noexcept {
+            uint64_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            for (size_t i = 0; i < DOUBLE_SIZE; i++)
+                buffer.append(static_cast<char>(bits >> (8 * i)));
+        }
+
+        // Counters are exact as doubles up to 2^53.
+        void put_sample(
+            Homer2Payload& buffer,
+            const double value,
+            const uint64_t timestampMillis
+        ) noexcept {
+            buffer.append(TIMESERIES_SAMPLES);
+            put_varint(buffer, sample_size(timestampMillis));
+            buffer.append(SAMPLE_VALUE);
+            put_double(buffer, value);
+            buffer.append(SAMPLE_TIMESTAMP);
+            put_varint(buffer, timestampMillis);
+        }
+
+    }
+
+    [[nodiscard]]
+    const char* Homer2RemoteWriteEncoder::path() const noexcept {
+
+        return "/api/v1/write";
+    }
+
+    [[nodiscard]]
+    const char* Homer2RemoteWriteEncoder::contentType() const noexcept {
+
+        return "application/x-protobuf";
+    }
+
+    [[nodiscard]]
+    const char* Homer2RemoteWriteEncoder::headers() const noexcept {
+
+        return "\r\nContent-Encoding: snappy\r\nX-Prometheus-Remote-Write-Version: 0.1.0";
+    }
+
+    [[nodiscard]]
+    size_t Homer2RemoteWriteEncoder::trailerSize() const noexcept {
+
+        return 0;
+    }
+
+    [[nodiscard]]
+    bool Homer2RemoteWriteEncoder::requiresTimestamps() const noexcept {
+
+        return true;
+    }
+
+    void Homer2RemoteWriteEncoder::begin(
+        Homer2Payload& body
+    ) noexcept {
+
+        (void) body;
+
+        this->_count = 0;
+        this->_samplesSize.fill(0);
+        this->_telemetry = nullptr;
+    }
+
+    [[nodiscard]]
+    bool Homer2RemoteWriteEncoder::append(
+        Homer2Payload& body,
+        const Homer2Reading& reading,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        if (0 == timestampMillis || this->_count >= this->_entries.size())
+            return false;
+
+        auto samplesSize = this->_samplesSize;
+        for (size_t i = 0; i < METRIC_COUNT; i++)
+            if (metric_value(reading, metric_at(i)).has_value())
+                samplesSize[i] += field_size(sample_size(timestampMillis));
+
+        if (!this->fits(body, samplesSize))
+            return false;
+
+        this->_entries[this->_count++] = {&reading, timestampMillis};
+        this->_samplesSize = samplesSize;
+
+        return true;
+    }
+
+    [[nodiscard]]
+    bool Homer2RemoteWriteEncoder::append(
+        Homer2Payload& body,
+        const Homer2TelemetryReading& telemetry,
+        const uint64_t timestampMillis
+    ) noexcept {
+
+        if (0 == timestampMillis || nullptr != this->_telemetry)
+            return false;
+
+        auto samplesSize = this->_samplesSize;
+        for (size_t i = 0; i < METRIC_COUNT; i++)
+            if (metric_value(telemetry, metric_at(i)).has_value())
+                samplesSize[i] += field_size(sample_size(timestampMillis));
+
+        if (!this->fits(body, samplesSize))
+            return false;
+
+        this->_telemetry = &telemetry;
+        this->_telemetryTimestampMillis = timestampMillis;
+        this->_samplesSize = samplesSize;
+
+        return true;
+    }
+
+    void Homer2RemoteWriteEncoder::end(
+        Homer2Payload& body
+    ) noexcept {
+
+        Homer2Payload request{write_request_buffer.data(), write_request_buffer.size()};
+
+        for (size_t i = 0; i < METRIC_COUNT; i++) {
+            if (0 == this->_samplesSize[i])
+                continue;
+
+            const auto metric = metric_at(i);
+            const auto& info = metric_info(metric);
+
+            request.append(WRITE_REQUEST_TIMESERIES);
+            put_varint(request, labels_size(info) + this->_samplesSize[i]);
+
+            put_label(request, "__name__", info.name);
+            put_label(request, "agent", "homer2");
+            if (nullptr != info.cat)
+                put_label(request, "cat", info.cat);
+            if (nullptr != info.le)
+                put_label(request, "le", info.le);
+            put_label(request, "sensor", info.sensor);
+
+            for (size_t e = 0; e < this->_count; e++) {
+                const auto& entry = this->_entries[e];
+                const auto value = metric_value(*entry.reading, metric);
+                if (value.has_value())
+                    put_sample(request, value.value(), entry.timestampMillis);
+            }
+
+            if (nullptr != this->_telemetry) {
+                const auto value = metric_value(*this->_telemetry, metric);
+                if (value.has_value())
+                    put_sample(request, static_cast<double>(value.value()), this->_telemetryTimestampMillis);
+            }
+        }
+
+        // append() reserved the worst case, an overflow would still show on the body.
+        (void) snappy_compress(request.data(), request.size(), body);
+    }
+
+    // Accepted only if even incompressible data would still fit once compressed.
+    [[nodiscard]]
+    bool Homer2RemoteWriteEncoder::fits(
+        const Homer2Payload& body,
+        const std::array<size_t, METRIC_COUNT>& samplesSize
+    ) const noexcept {
+
+        const auto size = this->encodedSize(samplesSize);
+
+        return size <= write_request_buffer.size() &&
+               body.size() + snappy_max_compressed_length(size) <= body.capacity();
+    }
+
+    [[nodiscard]]
+    size_t Homer2RemoteWriteEncoder::encodedSize(
+        const std::array<size_t, METRIC_COUNT>& samplesSize
+    ) const noexcept {
+
+        size_t size = 0;
+        for (size_t i = 0; i < METRIC_COUNT; i++)
+            if (samplesSize[i] > 0)
+                size += field_size(labels_size(metric_info(metric_at(i))) + samplesSize[i]);
+
+        return size;
+    }
+
+}
+
+namespace homer2 {
+
+    [[nodiscard]]
+    std::unique_ptr<Homer2Encoder> make_encoder(
+        const PushFormat format
+    ) {
+        switch (format) {
+            case PushFormat::opentsdb_json:
+                return std::make_unique<Homer2JsonEncoder>();
+
+            case PushFormat::influx_line:
+                return std::make_unique<Homer2InfluxEncoder>();
+
+            case PushFormat::prometheus_remote_write:
+                return std::make_unique<Homer2RemoteWriteEncoder>();
+
+            case PushFormat::graphite_plaintext:
+                return std::make_unique<Homer2GraphiteEncoder>();
+        }
+
+        throw std::logic_error{"unknown push format"};
+    }
+
+}
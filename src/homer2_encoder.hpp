@@ -0,0 +1,278 @@
+#pragma once
+
+#include <array>
+#include <memory>
+
+#include "homer2_config.h"
+#include "homer2_init.hpp"
+#include "homer2_metric.hpp"
+#include "homer2_payload.hpp"
+#include "homer2_telemetry.hpp"
+
+namespace homer2 {
+
+    class Homer2Encoder {
+    public:
+
+        virtual ~Homer2Encoder() = default;
+
+
+        [[nodiscard]]
+        virtual const char* path() const noexcept = 0;
+
+        [[nodiscard]]
+        virtual const char* contentType() const noexcept = 0;
+
+        // Additional http header lines, each one preceded by CRLF, or empty.
+        [[nodiscard]]
+        virtual const char* headers() const noexcept = 0;
+
+        // Bytes end() may need, kept free while samples are appended.
+        [[nodiscard]]
+        virtual size_t trailerSize() const noexcept = 0;
+
+        // Whether samples can only be encoded with a wall clock timestamp.
+        [[nodiscard]]
+        virtual bool requiresTimestamps() const noexcept = 0;
+
+
+        virtual void begin(
+            Homer2Payload& body
+        ) noexcept = 0;
+
+        // Returns false if the sample did not fit, the caller then rolls the body back.
+        [[nodiscard]]
+        virtual bool append(
+            Homer2Payload& body,
+            const Homer2Reading& reading,
+            uint64_t timestampMillis
+        ) noexcept = 0;
+
+        // Homer2's own metrics, at most once per batch and after its readings. Counters are
+        // written as integers.
+        [[nodiscard]]
+        virtual bool append(
+            Homer2Payload& body,
+            const Homer2TelemetryReading& telemetry,
+            uint64_t timestampMillis
+        ) noexcept = 0;
+
+        virtual void end(
+            Homer2Payload& body
+        ) noexcept = 0;
+
+    };
+
+    // OpenTSDB JSON, one object per datapoint, POSTed to /api/put.
+    class Homer2JsonEncoder final : public Homer2Encoder {
+    public:
+
+        [[nodiscard]]
+        const char* path() const noexcept override;
+
+        [[nodiscard]]
+        const char* contentType() const noexcept override;
+
+        [[nodiscard]]
+        const char* headers() const noexcept override;
+
+        [[nodiscard]]
+        size_t trailerSize() const noexcept override;
+
+        [[nodiscard]]
+        bool requiresTimestamps() const noexcept override;
+
+
+        void begin(
+            Homer2Payload& body
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2Reading& reading,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2TelemetryReading& telemetry,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        void end(
+            Homer2Payload& body
+        ) noexcept override;
+
+    };
+
+    // Influx line protocol, one line per sensor, POSTed to /write.
+    class Homer2InfluxEncoder final : public Homer2Encoder {
+    public:
+
+        [[nodiscard]]
+        const char* path() const noexcept override;
+
+        [[nodiscard]]
+        const char* contentType() const noexcept override;
+
+        [[nodiscard]]
+        const char* headers() const noexcept override;
+
+        [[nodiscard]]
+        size_t trailerSize() const noexcept override;
+
+        [[nodiscard]]
+        bool requiresTimestamps() const noexcept override;
+
+
+        void begin(
+            Homer2Payload& body
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2Reading& reading,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2TelemetryReading& telemetry,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        void end(
+            Homer2Payload& body
+        ) noexcept override;
+
+    };
+
+    // Graphite plaintext with tags, one line per datapoint, only sent as udp datagrams.
+    class Homer2GraphiteEncoder final : public Homer2Encoder {
+    public:
+
+        [[nodiscard]]
+        const char* path() const noexcept override;
+
+        [[nodiscard]]
+        const char* contentType() const noexcept override;
+
+        [[nodiscard]]
+        const char* headers() const noexcept override;
+
+        [[nodiscard]]
+        size_t trailerSize() const noexcept override;
+
+        [[nodiscard]]
+        bool requiresTimestamps() const noexcept override;
+
+
+        void begin(
+            Homer2Payload& body
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2Reading& reading,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2TelemetryReading& telemetry,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        void end(
+            Homer2Payload& body
+        ) noexcept override;
+
+    };
+
+    // Prometheus remote-write, a snappy compressed protobuf WriteRequest POSTed to /api/v1/write.
+    // Samples are only referenced while appending, the series are laid out in end(), which keeps
+    // the labels of each metric once per push instead of once per sample.
+    class Homer2RemoteWriteEncoder final : public Homer2Encoder {
+    public:
+
+        [[nodiscard]]
+        const char* path() const noexcept override;
+
+        [[nodiscard]]
+        const char* contentType() const noexcept override;
+
+        [[nodiscard]]
+        const char* headers() const noexcept override;
+
+        [[nodiscard]]
+        size_t trailerSize() const noexcept override;
+
+        [[nodiscard]]
+        bool requiresTimestamps() const noexcept override;
+
+
+        void begin(
+            Homer2Payload& body
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2Reading& reading,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        [[nodiscard]]
+        bool append(
+            Homer2Payload& body,
+            const Homer2TelemetryReading& telemetry,
+            uint64_t timestampMillis
+        ) noexcept override;
+
+        void end(
+            Homer2Payload& body
+        ) noexcept override;
+
+    private:
+
+        struct Entry {
+
+            const Homer2Reading* reading;
+
+            uint64_t timestampMillis;
+
+        };
+
+        [[nodiscard]]
+        bool fits(
+            const Homer2Payload& body,
+            const std::array<size_t, METRIC_COUNT>& samplesSize
+        ) const noexcept;
+
+        // Encoded size of the WriteRequest if the samples selected so far were sent.
+        [[nodiscard]]
+        size_t encodedSize(
+            const std::array<size_t, METRIC_COUNT>& samplesSize
+        ) const noexcept;
+
+        std::array<Entry, HOMER2_VICTORIA_QUEUE_CAPACITY> _entries{};
+        size_t _count{0};
+
+        const Homer2TelemetryReading* _telemetry{nullptr};
+        uint64_t _telemetryTimestampMillis{0};
+        std::array<size_t, METRIC_COUNT> _samplesSize{};
+
+    };
+
+    [[nodiscard]]
+    std::unique_ptr<Homer2Encoder> make_encoder(
+        PushFormat format
+    );
+
+}
@@ -0,0 +1,773 @@
+#include <algorithm>
+
+#include <pico/cyw43_arch.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_init.hpp"
+#include "homer2_pusher.hpp"
+#include "homer2_endpoint.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Endpoint";
+
+        const char* translate(
+            const err_t err
+        ) {
+            switch (err) {
+                case ERR_OK:
+                    return "tcp - no error";
+
+                case ERR_MEM:
+                    return "tcp - out of memory";
+
+                case ERR_BUF:
+                    return "tcp - buffer error";
+
+                case ERR_TIMEOUT:
+                    return "tcp - timeout";
+
+                case ERR_RTE:
+                    return "tcp - routing problem";
+
+                case ERR_INPROGRESS:
+                    return "tcp - in progress";
+
+                case ERR_VAL:
+                    return "tcp - illegal value";
+
+                case ERR_WOULDBLOCK:
+                    return "tcp - operation would block";
+
+                case ERR_USE:
+                    return "tcp - address in use";
+
+                case ERR_ALREADY:
+                    return "tcp - already connecting";
+
+                case ERR_ISCONN:
+                    return "tcp - connection already established";
+
+                case ERR_CONN:
+                    return "tcp - not connected";
+
+                case ERR_IF:
+                    return "tcp - low-level netif error";
+
+                case ERR_ABRT:
+                    return "tcp - connection aborted";
+
+                case ERR_RST:
+                    return "tcp - connection reset";
+
+                case ERR_CLSD:
+                    return "tcp - connection closed";
+
+                case ERR_ARG:
+                    return "tcp - illegal argument";
+
+                default:
+                    return "tcp - unknown error";
+            }
+        }
+
+        // A connect or a write not progressing for this long is given up on.
+        constexpr uint64_t PENDING_TIMEOUT_MILLIS = 5'000;
+
+        void header(
+            Homer2Payload& buffer,
+            const char* addr,
+            const uint16_t port,
+            const bool keepAlive,
+            const bool gzip,
+            const Homer2Encoder& encoder
+        ) {
+            buffer
+                .append("POST ")
+                .append(encoder.path())
+                .append(" HTTP/1.1\r\nHost: ")
+                .append(addr)
+                .append(':')
+                .appendUnsigned(port)
+                .append("\r\nUser-Agent: homer2/")
+                .appendUnsigned(HOMER2_VERSION_MAJOR)
+                .append('.')
+                .appendUnsigned(HOMER2_VERSION_MINOR)
+                .append(keepAlive ? "\r\nConnection: keep-alive" : "\r\nConnection: close")
+                .append("\r\nAccept: */*\r\nContent-Type: ")
+                .append(encoder.contentType())
+                .append(encoder.headers())
+                .append(gzip ? "\r\nContent-Encoding: gzip" : "")
+                .append("\r\nContent-Length: ");
+        }
+
+    }
+
+}
+
+namespace homer2 {
+
+    Homer2Endpoint::Homer2Endpoint(
+        Homer2Pusher& pusher,
+        const size_t lane,
+        const char* addr,
+        const uint16_t port,
+        const PushTransport transport,
+        const uint64_t pushFrequencyMillis,
+        const bool keepAlive,
+        const bool gzip,
+        const Homer2Encoder& encoder,
+        const uint64_t pushStartAfterTimestamp
+    ) : _pusher{pusher},
+        _lane{lane},
+        _pushStartAfterTimestamp{pushStartAfterTimestamp},
+        _pushFrequencyMillis{pushFrequencyMillis},
+        _keepAlive{keepAlive},
+        _addr{addr},
+        _port{port},
+        _resolver{addr, &pusher.telemetry().dns},
+        _breaker{addr, net::breaker_threshold(), net::backoff_initial_millis(), net::backoff_max_millis()},
+        _transport{transport},
+        _header{_headerBuffer.data(), _headerBuffer.size()} {
+
+        if (transport == PushTransport::udp)
+            return;
+
+        header(this->_header, addr, port, keepAlive, gzip, encoder);
+        if (this->_header.overflowed())
+            throw std::logic_error{"http header does not fit into header buffer"};
+
+        this->_headerPrefixSize = this->_header.size();
+    }
+
+    [[nodiscard]]
+    BreakerState Homer2Endpoint::breakerState() const noexcept {
+
+        return this->_breaker.state();
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Endpoint::sentDatagrams() const noexcept {
+
+        return this->_sentDatagrams;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Endpoint::sentBytes() const noexcept {
+
+        return this->_sentBytes;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Endpoint::deliveredSamples() const noexcept {
+
+        return this->_deliveredSamples;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Endpoint::rejectedSamples() const noexcept {
+
+        return this->_rejectedSamples;
+    }
+
+    void Homer2Endpoint::advance() noexcept {
+
+        switch (this->_connection.load()) {
+            case internal::ConnectionStatus::CONNECTING:
+                D(4, TAG, "connection in progress");
+                return;
+
+            case internal::ConnectionStatus::SENDING:
+                D(4, TAG, "write in progress");
+                (void) this->send();
+                return;
+
+            case internal::ConnectionStatus::AWAITING_RESPONSE:
+                D(4, TAG, "waiting for server response");
+                return;
+
+            case internal::ConnectionStatus::DISCONNECTED:
+            case internal::ConnectionStatus::CONNECTED:
+                break;
+        }
+
+        const auto due = this->_expedited || is_expired(this->_lastPushMillis, this->_pushFrequencyMillis);
+
+        // Stored samples are replayed in between regular pushes, one batch at a time and only
+        // while the server keeps accepting them.
+        const auto replay = this->_lastDelivered && this->_pusher.stored(this->_lane) > 0;
+
+        if (!due && !replay) {
+            D(4, TAG, "next push time not arrived yet, ignoring cycle, remaining: "
+                << remaining(this->_lastPushMillis, this->_pushFrequencyMillis)
+                << "ms");
+            return;
+        }
+
+        if (!this->_breaker.allow()) {
+            D(4, TAG, "backing off, holding samples: " << this->_pusher.pending(this->_lane));
+            return;
+        }
+
+        // Started even before the first push is due, so that the push does not wait on it. A
+        // failed query counts against the breaker just like a failed connection.
+        const auto resolved = this->_resolver.resolve(this->_ip);
+        if (this->_resolver.failures() > this->_dnsFailures)
+            this->_breaker.failure();
+        this->_dnsFailures = this->_resolver.failures();
+
+        if (!resolved) {
+            D(4, TAG, "dns resolver in progress");
+            return;
+        }
+
+        if (now() <= this->_pushStartAfterTimestamp) {
+            I(TAG, "still in warmup period, not writing to server. Left: "
+                << (this->_pushStartAfterTimestamp - now()) << "ms");
+            return;
+        }
+
+        this->_replaying = !due || 0 == this->_pusher.pending(this->_lane);
+
+        if (this->_replaying && !replay) {
+            D(4, TAG, "no sample to push");
+            return;
+        }
+
+        if (!this->_pusher.ready(this->_replaying)) {
+            D(3, TAG, "clock not synced yet, holding samples: " << this->_pusher.pending(this->_lane));
+            return;
+        }
+
+        this->_pusher.telemetry().attempts++;
+
+        // Whatever is pending goes with it, an expedited sample is never pushed on its own.
+        if (!this->_replaying)
+            this->_expedited = false;
+
+        if (this->_transport == PushTransport::udp) {
+            (void) this->sendDatagram();
+        }
+        else if (this->_connection == internal::ConnectionStatus::CONNECTED) {
+            D(4, TAG, "reusing kept-alive connection");
+            (void) this->startSend();
+        }
+        else if (this->open()) {
+            // The connected callback starts sending.
+            (void) this->connect();
+        }
+    }
+
+    void Homer2Endpoint::expedite() noexcept {
+
+        this->_expedited = true;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Endpoint::nextDeadlineMillis() const noexcept {
+
+        switch (this->_connection.load()) {
+            case internal::ConnectionStatus::CONNECTING:
+            case internal::ConnectionStatus::SENDING:
+            case internal::ConnectionStatus::AWAITING_RESPONSE:
+                return this->_lastProgressMillis + PENDING_TIMEOUT_MILLIS;
+
+            case internal::ConnectionStatus::DISCONNECTED:
+            case internal::ConnectionStatus::CONNECTED:
+                break;
+        }
+
+        const auto replay = this->_lastDelivered && this->_pusher.stored(this->_lane) > 0;
+        const auto due = this->_expedited || replay
+                         ? 0
+                         : this->_lastPushMillis + this->_pushFrequencyMillis;
+
+        return std::max({due, this->_breaker.retryAtMillis(), this->_pushStartAfterTimestamp + 1});
+    }
+
+    void Homer2Endpoint::transition(
+        const internal::ConnectionStatus status
+    ) noexcept {
+
+        this->_connection = status;
+        this->_lastProgressMillis = now();
+    }
+
+    // Fire and forget, nothing is kept between pushes but the pcb, and nothing waits on the server.
+    [[nodiscard]]
+    bool Homer2Endpoint::sendDatagram() noexcept {
+
+        const auto count = this->_pusher.fill(this->_lane, this->_replaying);
+        if (0 == count)
+            return false;
+
+        this->beginBatch();
+
+        D(5, TAG, "sending udp datagram");
+
+        const auto& body = this->_pusher.wire();
+        const auto size = body.size();
+        err_t err = ERR_MEM;
+
+        if (nullptr == this->_udpPcb)
+            this->_udpPcb = udp_new_ip_type(IP_GET_TYPE(&this->_ip));
+
+        struct pbuf* const pBuf = nullptr == this->_udpPcb
+                                  ? nullptr
+                                  : pbuf_alloc(PBUF_TRANSPORT, static_cast<u16_t>(size), PBUF_RAM);
+        if (nullptr != pBuf) {
+            memcpy(pBuf->payload, body.data(), size);
+            err = udp_sendto(this->_udpPcb, pBuf, &this->_ip, this->_port);
+            pbuf_free(pBuf);
+        }
+
+        if (ERR_OK != err) {
+            E(TAG, "could not send datagram: " << std::to_string(err));
+            this->incTcpErr();
+            this->_pusher.abandon(this->_lane);
+            return false;
+        }
+
+        this->_pusher.consume(this->_lane);
+        this->_lastDelivered = true;
+        this->_sentDatagrams++;
+        this->_sentBytes += size;
+        this->_breaker.success();
+        this->_pusher.telemetry().successes++;
+        this->_pusher.telemetry().sentBytes += size;
+
+        D(0, TAG, "sent datagram, samples: " << count
+            << ", datagrams: " << this->_sentDatagrams
+            << ", bytes: " << this->_sentBytes);
+
+        return true;
+    }
+
+    [[nodiscard]]
+    bool Homer2Endpoint::open() noexcept {
+
+        D(5, TAG, "opening tcp");
+
+        this->transition(internal::ConnectionStatus::CONNECTING);
+        this->_openedAtMillis = now();
+
+        this->_tcpPcb = tcp_new_ip_type(IP_GET_TYPE(&this->_ip));
+        if (!this->_tcpPcb) {
+            E(TAG, "failed to create tcp pcb");
+            this->incTcpErr();
+            this->close();
+            return false;
+        }
+
+        tcp_arg(this->_tcpPcb, this);
+
+        if (this->_keepAlive)
+            ip_set_option(this->_tcpPcb, SOF_KEEPALIVE);
+
+        tcp_poll(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb
+            ) {
+                (void) tcpPcb;
+                auto that = static_cast<Homer2Endpoint*>(arg);
+
+                if (that->_connection == internal::ConnectionStatus::CONNECTED) {
+                    D(5, TAG, "kept-alive connection idle");
+                    return static_cast<err_t>(ERR_OK);
+                }
+
+                if (!is_expired(that->_lastProgressMillis, PENDING_TIMEOUT_MILLIS))
+                    return static_cast<err_t>(ERR_OK);
+
+                E(TAG, "connection timeout");
+                that->incTcpErr();
+                return that->close();
+            },
+            2
+        );
+
+        tcp_sent(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                const u16_t len
+            ) {
+                (void) tcpPcb;
+                auto that = static_cast<Homer2Endpoint*>(arg);
+
+                I(TAG, "tcp sent, wrote to sever: " << std::to_string(len));
+                return that->onSent(len);
+            }
+        );
+
+        tcp_recv(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                struct pbuf* const pBuf,
+                const err_t err
+            ) {
+                (void) err;
+                auto that = static_cast<Homer2Endpoint*>(arg);
+
+                if (nullptr == pBuf)
+                    return that->onRemoteClosed();
+
+                D(4, TAG, "tcp recv");
+                return that->onReceived(tcpPcb, pBuf);
+            }
+        );
+
+        tcp_err(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                const err_t err
+            ) {
+                auto that = static_cast<Homer2Endpoint*>(arg);
+
+                E(TAG, "TCP fatal error: " << translate(err));
+
+                // The pcb is already freed by lwIP when this callback is invoked.
+                that->_tcpPcb = nullptr;
+                that->incTcpErr();
+                that->close();
+            }
+        );
+
+        return true;
+    }
+
+    [[nodiscard]]
+    bool Homer2Endpoint::connect() noexcept {
+
+        D(5, TAG, "connecting tcp to: " << this->ipAddr());
+
+        const err_t err = tcp_connect(
+            this->_tcpPcb,
+            &this->_ip,
+            this->_port,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                const err_t err
+            ) {
+                (void) tcpPcb;
+                auto that = static_cast<Homer2Endpoint*>(arg);
+
+                if (ERR_OK != err) {
+                    E(TAG, "connection failed: " << translate(err));
+                    that->incTcpErr();
+                    const auto closeErr = that->close();
+                    return ERR_OK == closeErr ? err : closeErr;
+                }
+
+                D(4, TAG, "connection successful");
+                that->_pusher.telemetry().connect.observe(now() - that->_openedAtMillis);
+                that->transition(internal::ConnectionStatus::CONNECTED);
+                return that->startSend();
+            }
+        );
+
+        if (ERR_OK != err) {
+            E(TAG, "connection failed: " << translate(err));
+            this->incTcpErr();
+            this->close();
+            return false;
+        }
+
+        return true;
+    }
+
+    err_t Homer2Endpoint::startSend() noexcept {
+
+        // Serialized only now, so that an endpoint still connecting does not hold the payload.
+        const auto count = this->_pusher.fill(this->_lane, this->_replaying);
+        if (0 == count) {
+            if (!this->_keepAlive)
+                return this->close();
+
+            D(4, TAG, "nothing to write, keeping connection alive");
+            this->transition(internal::ConnectionStatus::CONNECTED);
+            return ERR_OK;
+        }
+
+        this->beginBatch();
+
+        D(5, TAG, "writing tcp");
+
+        const auto& body = this->_pusher.wire();
+
+        // Body is already serialized, so Content-Length is known before the header is written.
+        this->_header.truncate(this->_headerPrefixSize);
+        this->_header
+            .appendUnsigned(body.size())
+            .append("\r\n\r\n");
+
+        this->_writeSize = this->_header.size() + body.size();
+        this->_writeStartedAtMillis = now();
+        this->_writeOffset = 0;
+        this->_writeAcked = 0;
+        this->_response.reset();
+
+        this->transition(internal::ConnectionStatus::SENDING);
+        return this->send();
+    }
+
+    // Queues as much as the send buffer takes, the rest follows as acks free it up.
+    err_t Homer2Endpoint::send() noexcept {
+
+        const auto headerSize = this->_header.size();
+
+        while (this->_writeOffset < this->_writeSize) {
+
+            const auto available = static_cast<size_t>(tcp_sndbuf(this->_tcpPcb));
+            if (0 == available)
+                break;
+
+            // The only copy of the payload: from the static buffers into lwIP's segments.
+            const auto inHeader = this->_writeOffset < headerSize;
+            const char* const chunk = inHeader
+                                      ? this->_header.data() + this->_writeOffset
+                                      : this->_pusher.wire().data() + (this->_writeOffset - headerSize);
+            const auto left = inHeader
+                              ? headerSize - this->_writeOffset
+                              : this->_writeSize - this->_writeOffset;
+            const auto len = left < available ? left : available;
+            const auto more = this->_writeOffset + len < this->_writeSize;
+
+            const auto err = tcp_write(
+                this->_tcpPcb,
+                chunk,
+                static_cast<u16_t>(len),
+                static_cast<u8_t>(TCP_WRITE_FLAG_COPY | (more ? TCP_WRITE_FLAG_MORE : 0))
+            );
+
+            if (ERR_MEM == err) {
+                D(4, TAG, "tcp queue full, continuing once acked");
+                break;
+            }
+
+            if (ERR_OK != err) {
+                E(TAG, "could not write body: " << std::to_string(err));
+                this->incTcpErr();
+                return this->close();
+            }
+
+            this->_writeOffset += len;
+        }
+
+        tcp_output(this->_tcpPcb);
+
+        if (this->_writeOffset < this->_writeSize)
+            return ERR_OK;
+
+        D(0, TAG, "wrote to server, samples: " << this->_pusher.inFlight(this->_lane));
+        this->_pusher.telemetry().sentBytes += this->_writeSize;
+        this->_pusher.release(this->_lane);
+        this->transition(internal::ConnectionStatus::AWAITING_RESPONSE);
+
+        return ERR_OK;
+    }
+
+    err_t Homer2Endpoint::onSent(
+        const u16_t len
+    ) noexcept {
+
+        this->_writeAcked += len;
+        this->_lastProgressMillis = now();
+
+        if (this->_connection == internal::ConnectionStatus::SENDING)
+            return this->send();
+
+        if (this->_writeAcked >= this->_writeSize)
+            D(4, TAG, "write acked, waiting for server response");
+
+        return ERR_OK;
+    }
+
+    // Walks the segments in place, then always hands them back so the pbuf pool never runs dry.
+    err_t Homer2Endpoint::onReceived(
+        struct tcp_pcb* const tcpPcb,
+        struct pbuf* const pBuf
+    ) noexcept {
+
+        for (auto q = pBuf; nullptr != q; q = q->next)
+            this->_response.feed(static_cast<const char*>(q->payload), q->len);
+
+        tcp_recved(tcpPcb, pBuf->tot_len);
+        pbuf_free(pBuf);
+
+        if (this->_connection != internal::ConnectionStatus::SENDING &&
+            this->_connection != internal::ConnectionStatus::AWAITING_RESPONSE) {
+            W(TAG, "unexpected data from server, ignoring");
+            return ERR_OK;
+        }
+
+        this->_lastProgressMillis = now();
+
+        if (this->_response.invalid()) {
+            E(TAG, "malformed http response, keeping samples: " << this->_pusher.inFlight(this->_lane));
+            this->incHttpErr();
+            return this->close();
+        }
+
+        if (!this->_response.complete())
+            return ERR_OK;
+
+        return this->onResponse();
+    }
+
+    // Samples leave the queue only once the server answered for them, an ack only says the
+    // bytes arrived.
+    err_t Homer2Endpoint::onResponse() noexcept {
+
+        const auto status = this->_response.status();
+        const auto inFlight = this->_pusher.inFlight(this->_lane);
+
+        this->_pusher.telemetry().ack.observe(now() - this->_writeStartedAtMillis);
+
+        if (status >= 200 && status < 300) {
+            D(4, TAG, "delivered, status: " << status << ", samples: " << inFlight);
+            this->_pusher.consume(this->_lane);
+            this->_deliveredSamples += inFlight;
+            this->_lastDelivered = true;
+            this->_breaker.success();
+            this->_pusher.telemetry().successes++;
+        }
+        else if (status >= 500 || 429 == status) {
+            // An overloaded server is given a rest, same as an unreachable one.
+            W(TAG, "server unavailable, status: " << status
+                << ", keeping samples for retry: " << inFlight);
+            this->_pusher.abandon(this->_lane);
+            this->incHttpErr();
+            this->_breaker.failure();
+        }
+        else {
+            // Resending what the server refused would be refused again.
+            E(TAG, "rejected by server, status: " << status
+                << ", dropping samples: " << inFlight);
+            this->_pusher.consume(this->_lane);
+            this->_rejectedSamples += inFlight;
+            this->incHttpErr();
+            this->_breaker.success();
+            this->_pusher.telemetry().droppedBatches++;
+        }
+
+        // An early response leaves the rest of the request unsent, the connection can't be reused.
+        if (!this->_keepAlive ||
+            !this->_response.keepAlive() ||
+            this->_connection != internal::ConnectionStatus::AWAITING_RESPONSE)
+            return this->close();
+
+        D(4, TAG, "keeping connection alive");
+        this->transition(internal::ConnectionStatus::CONNECTED);
+
+        return ERR_OK;
+    }
+
+    err_t Homer2Endpoint::onRemoteClosed() noexcept {
+
+        I(TAG, "connection closed by server, will reconnect on next push");
+
+        if (this->_connection == internal::ConnectionStatus::SENDING ||
+            this->_connection == internal::ConnectionStatus::AWAITING_RESPONSE) {
+            W(TAG, "server closed connection before responding");
+            this->incTcpErr();
+        }
+
+        return this->close();
+    }
+
+    err_t Homer2Endpoint::close() noexcept {
+
+        D(5, TAG, "tcp close");
+
+        // Samples not delivered stay queued for the next push.
+        this->_pusher.abandon(this->_lane);
+
+        // Never got through, the next address of the name gets its turn.
+        if (this->_connection == internal::ConnectionStatus::CONNECTING)
+            this->_resolver.failover();
+
+        if (this->_connection == internal::ConnectionStatus::DISCONNECTED) {
+            D(5, TAG, "already disconnected");
+            return ERR_OK;
+        }
+        this->transition(internal::ConnectionStatus::DISCONNECTED);
+
+        if (this->_tcpPcb != nullptr) {
+
+            D(4, TAG, "closing tcp");
+
+            cyw43_arch_lwip_begin();
+            tcp_arg(this->_tcpPcb, nullptr);
+            tcp_poll(this->_tcpPcb, nullptr, 0);
+            tcp_sent(this->_tcpPcb, nullptr);
+            tcp_recv(this->_tcpPcb, nullptr);
+            tcp_err(this->_tcpPcb, nullptr);
+            const auto err = tcp_close(this->_tcpPcb);
+            cyw43_arch_lwip_end();
+
+            if (ERR_OK != err) {
+                E(TAG, "failed to close tcp connection, aborting: " << translate(err));
+                this->incTcpErr();
+                cyw43_arch_lwip_begin();
+                tcp_abort(this->_tcpPcb);
+                cyw43_arch_lwip_end();
+                this->_tcpPcb = nullptr;
+                return ERR_ABRT;
+            }
+            else {
+                this->_tcpPcb = nullptr;
+            }
+        }
+
+        this->_lastPushMillis = now();
+        return ERR_OK;
+    }
+
+
+    [[nodiscard]]
+    std::string Homer2Endpoint::ipAddr() const noexcept {
+
+        cyw43_arch_lwip_begin();
+        const char* const addr = ipaddr_ntoa(&this->_ip);
+        std::string ipStr{addr};
+        cyw43_arch_lwip_end();
+
+        return ipStr;
+    }
+
+    void Homer2Endpoint::beginBatch() noexcept {
+
+        this->_pusher.telemetry().payload.observe(this->_pusher.wire().size());
+
+        if (this->_replaying)
+            D(3, TAG, "replaying stored samples: " << this->_pusher.inFlight(this->_lane)
+                << "/" << this->_pusher.stored(this->_lane));
+        else
+            this->_lastPushMillis = now();
+    }
+
+    void Homer2Endpoint::incHttpErr() noexcept {
+
+        this->_lastDelivered = false;
+        this->_pusher.telemetry().httpErrors++;
+    }
+
+    void Homer2Endpoint::incTcpErr() noexcept {
+
+        this->_lastDelivered = false;
+        this->_breaker.failure();
+    }
+
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <atomic>
+
+#include <lwip/tcp.h>
+#include <lwip/udp.h>
+#include <lwip/ip_addr.h>
+
+#include "homer2_init.hpp"
+#include "homer2_dns.hpp"
+#include "homer2_breaker.hpp"
+#include "homer2_payload.hpp"
+#include "homer2_encoder.hpp"
+#include "homer2_http_response.hpp"
+
+namespace homer2 {
+
+    class Homer2Pusher;
+
+    namespace internal {
+
+        // DISCONNECTED and CONNECTED are idle, every other state is left from lwIP callbacks.
+        enum class ConnectionStatus {
+            DISCONNECTED,
+            CONNECTING,
+            CONNECTED,
+            SENDING,
+            AWAITING_RESPONSE,
+        };
+
+    }
+
+    // One server the samples are pushed to, with its own connection, dns and breaker state. The
+    // samples and their payload are owned by the pusher and shared with the other endpoints.
+    class Homer2Endpoint {
+    public:
+
+        Homer2Endpoint& operator=(const Homer2Endpoint& other) noexcept = delete;
+
+        Homer2Endpoint& operator=(Homer2Endpoint&& other) = delete;
+
+        Homer2Endpoint(Homer2Endpoint&& other) = delete;
+
+        Homer2Endpoint(const Homer2Endpoint& other) noexcept = delete;
+
+
+        Homer2Endpoint(
+            Homer2Pusher& pusher,
+            size_t lane,
+            const char* addr,
+            uint16_t port,
+            PushTransport transport,
+            uint64_t pushFrequencyMillis,
+            bool keepAlive,
+            bool gzip,
+            const Homer2Encoder& encoder,
+            uint64_t pushStartAfterTimestamp
+        );
+
+        // Must be called holding the lwIP lock.
+        void advance() noexcept;
+
+        // The next push is made as soon as the connection allows, without waiting for the push
+        // frequency.
+        void expedite() noexcept;
+
+        // When advance() has something to do next. While a request is in progress its callbacks
+        // drive it, this only bounds the wait for them. Must be called holding the lwIP lock.
+        [[nodiscard]]
+        uint64_t nextDeadlineMillis() const noexcept;
+
+        [[nodiscard]]
+        BreakerState breakerState() const noexcept;
+
+        [[nodiscard]]
+        uint32_t sentDatagrams() const noexcept;
+
+        [[nodiscard]]
+        uint64_t sentBytes() const noexcept;
+
+        [[nodiscard]]
+        uint64_t deliveredSamples() const noexcept;
+
+        [[nodiscard]]
+        uint64_t rejectedSamples() const noexcept;
+
+
+    private:
+
+        void transition(
+            internal::ConnectionStatus status
+        ) noexcept;
+
+        [[nodiscard]]
+        bool sendDatagram() noexcept;
+
+        [[nodiscard]]
+        bool open() noexcept;
+
+        [[nodiscard]]
+        bool connect() noexcept;
+
+        err_t startSend() noexcept;
+
+        err_t send() noexcept;
+
+        err_t close() noexcept;
+
+        err_t onRemoteClosed() noexcept;
+
+        err_t onSent(u16_t len) noexcept;
+
+        err_t onReceived(
+            struct tcp_pcb* tcpPcb,
+            struct pbuf* pBuf
+        ) noexcept;
+
+        err_t onResponse() noexcept;
+
+        void beginBatch() noexcept;
+
+        void incHttpErr() noexcept;
+
+        void incTcpErr() noexcept;
+
+        [[nodiscard]]
+        std::string ipAddr() const noexcept;
+
+        Homer2Pusher& _pusher;
+        const size_t _lane;
+
+        const uint64_t _pushStartAfterTimestamp;
+        const uint64_t _pushFrequencyMillis;
+        const bool _keepAlive;
+        uint64_t _lastPushMillis{0};
+        bool _expedited{false};
+
+        const char* _addr;
+        const uint16_t _port;
+        Homer2Resolver _resolver;
+        uint8_t _dnsFailures{0};
+        ip_addr_t _ip{.addr = IPADDR_ANY};
+        Homer2Breaker _breaker;
+
+        const PushTransport _transport;
+
+        struct tcp_pcb* _tcpPcb{nullptr};
+        std::atomic<internal::ConnectionStatus> _connection{internal::ConnectionStatus::DISCONNECTED};
+        uint64_t _lastProgressMillis{0};
+        uint64_t _openedAtMillis{0};
+        uint64_t _writeStartedAtMillis{0};
+
+        struct udp_pcb* _udpPcb{nullptr};
+        uint32_t _sentDatagrams{0};
+        uint64_t _sentBytes{0};
+
+        bool _replaying{false};
+        bool _lastDelivered{false};
+
+        // The Host header differs between endpoints, so each one has its own.
+        std::array<char, HOMER2_VICTORIA_HEADER_BUFFER_BYTES> _headerBuffer{};
+        Homer2Payload _header;
+        size_t _headerPrefixSize{0};
+        size_t _writeSize{0};
+        size_t _writeOffset{0};
+        size_t _writeAcked{0};
+        Homer2HttpResponse _response{};
+        uint64_t _deliveredSamples{0};
+        uint64_t _rejectedSamples{0};
+
+    };
+
+}
@@ -0,0 +1,427 @@
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <pico/flash.h>
+#include <hardware/flash.h>
+#include <hardware/regs/addressmap.h>
+
+#include <homer2_logging.hpp>
+
+#include "homer2_flash_log.hpp"
+
+extern "C" {
+    // End of the firmware image, provided by the linker script.
+    extern char __flash_binary_end;
+}
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "FlashLog";
+
+        // Changed along with the record layout, sectors written by an older firmware are ignored.
+        constexpr uint32_t SECTOR_MAGIC = 0x48324c4c;
+        constexpr uint32_t RECORD_MAGIC = 0x48325244;
+        constexpr uint32_t ERASED = 0xffffffff;
+        constexpr uint32_t INVALIDATED = 0x00000000;
+
+        constexpr size_t SECTOR_HEADER_BYTES = 64;
+        constexpr size_t RECORDS_PER_SECTOR =
+            (FLASH_SECTOR_SIZE - SECTOR_HEADER_BYTES) / sizeof(Homer2FlashRecord);
+
+        constexpr uint32_t FLASH_SAFE_TIMEOUT_MILLIS = 100;
+
+        static_assert(sizeof(Homer2FlashRecord) == 104, "flash record layout changed");
+        static_assert(RECORDS_PER_SECTOR == 38, "flash record layout changed");
+
+        struct SectorHeader {
+
+            uint32_t magic;
+
+            uint32_t sequence;
+
+            // Slots already sent, cleared bit by bit from the lowest as they are consumed,
+            // programmed over the erased value without erasing the sector again.
+            uint64_t consumed;
+
+        };
+
+        static_assert(sizeof(SectorHeader) <= SECTOR_HEADER_BYTES, "sector header too long");
+        static_assert(RECORDS_PER_SECTOR <= 64, "consumed mask too narrow");
+
+        struct FlashOp {
+
+            uint32_t offset;
+
+            const uint8_t* data;
+
+            size_t len;
+
+        };
+
+        // Pages are programmed whole, a record may span two of them.
+        std::array<uint8_t, 2 * FLASH_PAGE_SIZE> page_buffer{};
+
+        const Homer2FlashRecord corrupted_record{};
+
+        const void* flash_at(
+            const uint32_t offset
+        ) noexcept {
+            return reinterpret_cast<const void*>(XIP_BASE + offset);
+        }
+
+        bool erase_sector(
+            const uint32_t offset
+        ) noexcept {
+            FlashOp op{offset, nullptr, FLASH_SECTOR_SIZE};
+
+            return PICO_OK == flash_safe_execute(
+                [](void* const param) {
+                    const auto op = static_cast<const FlashOp*>(param);
+                    flash_range_erase(op->offset, op->len);
+                },
+                &op,
+                FLASH_SAFE_TIMEOUT_MILLIS
+            );
+        }
+
+        // Bytes outside the given range are programmed as 0xff, which leaves them untouched.
+        bool program(
+            const uint32_t offset,
+            const void* const data,
+            const size_t len
+        ) noexcept {
+            const uint32_t start = offset & ~(FLASH_PAGE_SIZE - 1);
+            const uint32_t end = (offset + len + FLASH_PAGE_SIZE - 1) & ~(FLASH_PAGE_SIZE - 1);
+
+            page_buffer.fill(0xff);
+            memcpy(page_buffer.data() + (offset - start), data, len);
+
+            FlashOp op{start, page_buffer.data(), end - start};
+
+            return PICO_OK == flash_safe_execute(
+                [](void* const param) {
+                    const auto op = static_cast<const FlashOp*>(param);
+                    flash_range_program(op->offset, op->data, op->len);
+                },
+                &op,
+                FLASH_SAFE_TIMEOUT_MILLIS
+            );
+        }
+
+        // FNV-1a over everything following the checksum.
+        uint32_t checksum(
+            const Homer2FlashRecord& record
+        ) noexcept {
+            const auto bytes = reinterpret_cast<const uint8_t*>(&record.timestampMillis);
+            const auto len = sizeof(record) - offsetof(Homer2FlashRecord, timestampMillis);
+
+            uint32_t hash = 0x811c9dc5;
+            for (size_t i = 0; i < len; i++) {
+                hash ^= bytes[i];
+                hash *= 0x01000193;
+            }
+
+            return hash;
+        }
+
+    }
+
+    Homer2FlashLog::Homer2FlashLog(
+        const size_t bytes
+    ) noexcept:
+        _bytes{bytes},
+        _sectorCount{bytes / FLASH_SECTOR_SIZE} {
+
+        this->_offset = PICO_FLASH_SIZE_BYTES - this->_sectorCount * FLASH_SECTOR_SIZE;
+    }
+
+    void Homer2FlashLog::init() noexcept {
+
+        if (0 == this->_bytes) {
+            I(TAG, "flash log disabled");
+            return;
+        }
+
+        if (this->_sectorCount < 2) {
+            E(TAG, "flash log needs at least two sectors, disabled: " << this->_bytes << " bytes");
+            return;
+        }
+
+        const auto binaryEnd = reinterpret_cast<uintptr_t>(&__flash_binary_end) - XIP_BASE;
+        if (binaryEnd > this->_offset) {
+            E(TAG, "flash log overlaps the firmware, disabled, firmware ends at: " << binaryEnd
+                << ", log starts at: " << this->_offset);
+            return;
+        }
+
+        this->_enabled = true;
+
+        size_t valid = 0;
+        uint32_t tailSequence = 0;
+
+        for (size_t sector = 0; sector < this->_sectorCount; sector++) {
+            const auto& header = *static_cast<const SectorHeader*>(flash_at(this->sectorOffset(sector)));
+            if (SECTOR_MAGIC != header.magic)
+                continue;
+
+            if (0 == valid || header.sequence > this->_headSequence) {
+                this->_headSector = sector;
+                this->_headSequence = header.sequence;
+            }
+
+            if (0 == valid || header.sequence < tailSequence) {
+                this->_tailSector = sector;
+                tailSequence = header.sequence;
+            }
+
+            valid++;
+        }
+
+        if (0 == valid) {
+            I(TAG, "flash log empty, sectors: " << this->_sectorCount);
+            return;
+        }
+
+        this->_hasHead = true;
+
+        while (this->_headSlot < RECORDS_PER_SECTOR) {
+            const auto& record = *static_cast<const Homer2FlashRecord*>(
+                flash_at(this->recordOffset(this->_headSector, this->_headSlot))
+            );
+            if (ERASED == record.magic)
+                break;
+            this->_headSlot++;
+        }
+
+        const auto& tail = *static_cast<const SectorHeader*>(flash_at(this->sectorOffset(this->_tailSector)));
+        const auto end = this->_tailSector == this->_headSector ? this->_headSlot : RECORDS_PER_SECTOR;
+
+        this->_tailSlot = 0;
+        while (this->_tailSlot < end && 0 == (tail.consumed & (1ULL << this->_tailSlot)))
+            this->_tailSlot++;
+
+        this->_syncedTailSector = this->_tailSector;
+        this->_syncedTailSlot = this->_tailSlot;
+        this->_size = (valid - 1) * RECORDS_PER_SECTOR + this->_headSlot - this->_tailSlot;
+
+        I(TAG, "recovered flash log, records: " << this->_size);
+    }
+
+    [[nodiscard]]
+    bool Homer2FlashLog::append(
+        const uint64_t timestampMillis,
+        const Homer2Reading& reading
+    ) noexcept {
+
+        if (!this->_enabled)
+            return false;
+
+        if ((!this->_hasHead || RECORDS_PER_SECTOR == this->_headSlot) && !this->allocateSector())
+            return false;
+
+        Homer2FlashRecord record{RECORD_MAGIC, 0, timestampMillis, reading};
+        record.checksum = checksum(record);
+
+        if (!program(this->recordOffset(this->_headSector, this->_headSlot), &record, sizeof(record))) {
+            E(TAG, "could not program flash record");
+            return false;
+        }
+
+        if (0 == this->_size) {
+            this->_tailSector = this->_headSector;
+            this->_tailSlot = this->_headSlot;
+        }
+
+        this->_headSlot++;
+        this->_size++;
+
+        return true;
+    }
+
+    [[nodiscard]]
+    const Homer2FlashRecord& Homer2FlashLog::operator[](
+        const size_t index
+    ) const {
+
+        if (index >= this->_size)
+            throw std::out_of_range{"flash record index out of range"};
+
+        auto sector = this->_tailSector;
+        auto slot = this->_tailSlot + index;
+        while (slot >= RECORDS_PER_SECTOR) {
+            slot -= RECORDS_PER_SECTOR;
+            sector = this->next(sector);
+        }
+
+        const auto& record = *static_cast<const Homer2FlashRecord*>(
+            flash_at(this->recordOffset(sector, slot))
+        );
+
+        if (RECORD_MAGIC != record.magic || checksum(record) != record.checksum) {
+            W(TAG, "corrupted flash record, skipping");
+            return corrupted_record;
+        }
+
+        return record;
+    }
+
+    void Homer2FlashLog::pop(
+        const size_t count
+    ) noexcept {
+
+        auto n = count < this->_size ? count : this->_size;
+        this->_size -= n;
+
+        while (n > 0) {
+            const auto end = this->_tailSector == this->_headSector
+                             ? this->_headSlot
+                             : RECORDS_PER_SECTOR;
+            const auto available = end - this->_tailSlot;
+            const auto taken = n < available ? n : available;
+
+            this->_tailSlot += taken;
+            n -= taken;
+
+            if (RECORDS_PER_SECTOR == this->_tailSlot && this->_tailSector != this->_headSector) {
+                this->_tailSector = this->next(this->_tailSector);
+                this->_tailSlot = 0;
+            }
+            else if (0 == taken) {
+                break;
+            }
+        }
+    }
+
+    void Homer2FlashLog::sync() noexcept {
+
+        while (this->_syncedTailSector != this->_tailSector) {
+            D(4, TAG, "flash log sector consumed: " << this->_syncedTailSector);
+
+            const uint32_t invalidated = INVALIDATED;
+            if (!program(this->sectorOffset(this->_syncedTailSector), &invalidated, sizeof(invalidated))) {
+                E(TAG, "could not invalidate consumed sector");
+                return;
+            }
+
+            this->_syncedTailSector = this->next(this->_syncedTailSector);
+            this->_syncedTailSlot = 0;
+        }
+
+        if (this->_syncedTailSlot == this->_tailSlot)
+            return;
+
+        const uint64_t consumed = ~0ULL << this->_tailSlot;
+        if (!program(this->sectorOffset(this->_tailSector) + offsetof(SectorHeader, consumed),
+                     &consumed, sizeof(consumed))) {
+            E(TAG, "could not mark consumed records");
+            return;
+        }
+
+        this->_syncedTailSlot = this->_tailSlot;
+    }
+
+    [[nodiscard]]
+    size_t Homer2FlashLog::size() const noexcept {
+
+        return this->_size;
+    }
+
+    [[nodiscard]]
+    bool Homer2FlashLog::empty() const noexcept {
+
+        return 0 == this->_size;
+    }
+
+    [[nodiscard]]
+    bool Homer2FlashLog::enabled() const noexcept {
+
+        return this->_enabled;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2FlashLog::dropped() const noexcept {
+
+        return this->_dropped;
+    }
+
+    [[nodiscard]]
+    bool Homer2FlashLog::allocateSector() noexcept {
+
+        const auto target = this->_hasHead ? this->next(this->_headSector) : 0;
+        const auto pending = this->_syncedTailSector != this->_tailSector;
+
+        if (this->_hasHead && target == this->_tailSector && this->_size > 0) {
+            const auto dropped = RECORDS_PER_SECTOR - this->_tailSlot;
+            W(TAG, "flash log full, dropping oldest records: " << dropped);
+
+            this->_dropped += dropped;
+            this->_size -= dropped;
+            this->_tailSector = this->next(this->_tailSector);
+            this->_tailSlot = 0;
+            this->_syncedTailSector = this->_tailSector;
+            this->_syncedTailSlot = 0;
+        }
+        else if (pending && this->_syncedTailSector == target) {
+            // The reused sector is erased anyway, nothing left to invalidate in it.
+            this->_syncedTailSector = this->next(target);
+            this->_syncedTailSlot = 0;
+        }
+        else if (this->_syncedTailSector == target) {
+            // Nothing left in it either, its consumed mask goes with the erase.
+            this->_syncedTailSlot = 0;
+        }
+
+        if (!erase_sector(this->sectorOffset(target))) {
+            E(TAG, "could not erase flash sector: " << target);
+            return false;
+        }
+
+        const SectorHeader header{SECTOR_MAGIC, this->_headSequence + 1, ~0ULL};
+        if (!program(this->sectorOffset(target), &header, sizeof(header))) {
+            E(TAG, "could not program flash sector header: " << target);
+            return false;
+        }
+
+        this->_hasHead = true;
+        this->_headSector = target;
+        this->_headSlot = 0;
+        this->_headSequence = header.sequence;
+
+        if (0 == this->_size) {
+            this->_tailSector = target;
+            this->_tailSlot = 0;
+        }
+
+        return true;
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2FlashLog::sectorOffset(
+        const size_t sector
+    ) const noexcept {
+
+        return this->_offset + static_cast<uint32_t>(sector * FLASH_SECTOR_SIZE);
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2FlashLog::recordOffset(
+        const size_t sector,
+        const size_t slot
+    ) const noexcept {
+
+        return this->sectorOffset(sector) +
+               static_cast<uint32_t>(SECTOR_HEADER_BYTES + slot * sizeof(Homer2FlashRecord));
+    }
+
+    [[nodiscard]]
+    size_t Homer2FlashLog::next(
+        const size_t sector
+    ) const noexcept {
+
+        return (sector + 1) % this->_sectorCount;
+    }
+
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "homer2_metric.hpp"
+
+namespace homer2 {
+
+    struct Homer2FlashRecord {
+
+        uint32_t magic;
+
+        uint32_t checksum;
+
+        uint64_t timestampMillis;
+
+        Homer2Reading reading;
+
+    };
+
+    // Append-only log of timestamped readings in a reserved region at the end of the flash,
+    // keeping samples the server could not be reached for across reboots.
+    //
+    // The region is used as a ring of sectors, each starting with a header carrying an increasing
+    // sequence number, so writes (and erases) wear all sectors evenly. Replay progress is persisted
+    // on sync(): a sector is invalidated once all its records are consumed, the one being replayed
+    // marks its consumed slots in its header. After a reboot, only the records consumed since the
+    // last sync() are sent twice.
+    class Homer2FlashLog {
+    public:
+
+        Homer2FlashLog& operator=(const Homer2FlashLog& other) noexcept = delete;
+
+        Homer2FlashLog& operator=(Homer2FlashLog&& other) = delete;
+
+        Homer2FlashLog(Homer2FlashLog&& other) = delete;
+
+        Homer2FlashLog() = delete;
+
+        Homer2FlashLog(const Homer2FlashLog& other) noexcept = delete;
+
+
+        // Zero bytes disables the log.
+        explicit Homer2FlashLog(
+            size_t bytes
+        ) noexcept;
+
+
+        // Recovers the log left by a previous boot.
+        void init() noexcept;
+
+        // Returns false if the record could not be stored. When the log is full, its oldest
+        // sector is dropped.
+        [[nodiscard]]
+        bool append(
+            uint64_t timestampMillis,
+            const Homer2Reading& reading
+        ) noexcept;
+
+        // Records failing their checksum read as a reading without values.
+        [[nodiscard]]
+        const Homer2FlashRecord& operator[](size_t index) const;
+
+        // Only moves the replay position, safe to call from lwIP callbacks. Consumed sectors are
+        // invalidated on the next sync().
+        void pop(
+            size_t count
+        ) noexcept;
+
+        // Persists the replay position, touches the flash and so must not run in an interrupt.
+        void sync() noexcept;
+
+        [[nodiscard]]
+        size_t size() const noexcept;
+
+        [[nodiscard]]
+        bool empty() const noexcept;
+
+        [[nodiscard]]
+        bool enabled() const noexcept;
+
+        [[nodiscard]]
+        uint64_t dropped() const noexcept;
+
+    private:
+
+        [[nodiscard]]
+        bool allocateSector() noexcept;
+
+        [[nodiscard]]
+        uint32_t sectorOffset(
+            size_t sector
+        ) const noexcept;
+
+        [[nodiscard]]
+        uint32_t recordOffset(
+            size_t sector,
+            size_t slot
+        ) const noexcept;
+
+        [[nodiscard]]
+        size_t next(
+            size_t sector
+        ) const noexcept;
+
+        const size_t _bytes;
+        uint32_t _offset{0};
+        size_t _sectorCount{0};
+        bool _enabled{false};
+
+        bool _hasHead{false};
+        size_t _headSector{0};
+        size_t _headSlot{0};
+        uint32_t _headSequence{0};
+
+        size_t _tailSector{0};
+        size_t _tailSlot{0};
+        size_t _syncedTailSector{0};
+        size_t _syncedTailSlot{0};
+
+        size_t _size{0};
+        uint64_t _dropped{0};
+
+    };
+
+}
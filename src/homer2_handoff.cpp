@@ -0,0 +1,65 @@
+#include "homer2_handoff.hpp"
+
+namespace homer2 {
+
+    [[nodiscard]]
+    bool Homer2Handoff::push(
+        const Homer2Snapshot& snapshot
+    ) noexcept {
+
+        const auto head = this->_head.load(std::memory_order_relaxed);
+        const auto tail = this->_tail.load(std::memory_order_acquire);
+
+        if (head - tail == this->_snapshots.size()) {
+            this->_carriedMask |= snapshot.crossedMask;
+            this->_dropped.store(this->_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return false;
+        }
+
+        auto& slot = this->_snapshots[head % this->_snapshots.size()];
+        slot = snapshot;
+        slot.crossedMask |= this->_carriedMask;
+        this->_carriedMask = 0;
+
+        // Publishes the slot, the consumer does not look at it before seeing the new head.
+        this->_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]]
+    bool Homer2Handoff::pop(
+        Homer2Snapshot& snapshot
+    ) noexcept {
+
+        const auto tail = this->_tail.load(std::memory_order_relaxed);
+        const auto head = this->_head.load(std::memory_order_acquire);
+
+        if (head == tail)
+            return false;
+
+        snapshot = this->_snapshots[tail % this->_snapshots.size()];
+
+        // Gives the slot back, the producer does not overwrite it before seeing the new tail.
+        this->_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Handoff::pushed() const noexcept {
+
+        return this->_head.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Handoff::popped() const noexcept {
+
+        return this->_tail.load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]]
+    uint32_t Homer2Handoff::dropped() const noexcept {
+
+        return this->_dropped.load(std::memory_order_relaxed);
+    }
+
+}
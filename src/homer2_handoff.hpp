@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include "homer2_config.h"
+#include "homer2_sensor.hpp"
+
+namespace homer2 {
+
+    struct Homer2Snapshot {
+
+        Homer2SensorsData data{};
+
+        // Values that raised or cleared their alert, see Homer2Alerts::evaluate().
+        uint64_t crossedMask{0};
+
+        // Printed to the console, once per loop delay.
+        bool print{false};
+
+    };
+
+    // Lock free ring of readings from the sensors on core 0 to the network on core 1, one
+    // producer and one consumer.
+    //
+    // The producer never waits: with the ring full the snapshot is not handed off and counted as
+    // dropped, its alert crossings are carried over to the next one that is. Each side only writes
+    // its own index, the indices are never wrapped so they count the copies made.
+    class Homer2Handoff {
+    public:
+
+        Homer2Handoff& operator=(const Homer2Handoff& other) noexcept = delete;
+
+        Homer2Handoff& operator=(Homer2Handoff&& other) = delete;
+
+        Homer2Handoff(Homer2Handoff&& other) = delete;
+
+        Homer2Handoff(const Homer2Handoff& other) noexcept = delete;
+
+
+        Homer2Handoff() noexcept = default;
+
+
+        // Core 0 only.
+        [[nodiscard]]
+        bool push(
+            const Homer2Snapshot& snapshot
+        ) noexcept;
+
+        // Core 1 only.
+        [[nodiscard]]
+        bool pop(
+            Homer2Snapshot& snapshot
+        ) noexcept;
+
+        // Snapshots copied into the ring.
+        [[nodiscard]]
+        uint32_t pushed() const noexcept;
+
+        // Snapshots copied out of the ring.
+        [[nodiscard]]
+        uint32_t popped() const noexcept;
+
+        // Snapshots not handed off as the ring was full.
+        [[nodiscard]]
+        uint32_t dropped() const noexcept;
+
+    private:
+
+        static_assert(0 == (HOMER2_CORE_HANDOFF_CAPACITY & (HOMER2_CORE_HANDOFF_CAPACITY - 1)),
+                      "handoff capacity must be a power of 2");
+
+        std::array<Homer2Snapshot, HOMER2_CORE_HANDOFF_CAPACITY> _snapshots{};
+
+        std::atomic<uint32_t> _head{0};
+        std::atomic<uint32_t> _tail{0};
+        std::atomic<uint32_t> _dropped{0};
+
+        // Producer's own, not shared.
+        uint64_t _carriedMask{0};
+
+    };
+
+}
@@ -0,0 +1,203 @@
+#include <cctype>
+#include <cstring>
+
+#include "homer2_http_response.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        // Compares the start of a line, case-insensitively, with a lower case header name.
+        bool is_header(
+            const char* const line,
+            const size_t len,
+            const char* const name
+        ) noexcept {
+            const auto nameLen = strlen(name);
+            if (len <= nameLen || ':' != line[nameLen])
+                return false;
+
+            for (size_t i = 0; i < nameLen; i++)
+                if (tolower(static_cast<unsigned char>(line[i])) != name[i])
+                    return false;
+
+            return true;
+        }
+
+        bool contains_token(
+            const char* const value,
+            const size_t len,
+            const char* const token
+        ) noexcept {
+            const auto tokenLen = strlen(token);
+
+            for (size_t start = 0; start + tokenLen <= len; start++) {
+                size_t i = 0;
+                while (i < tokenLen &&
+                       tolower(static_cast<unsigned char>(value[start + i])) == token[i])
+                    i++;
+                if (i == tokenLen)
+                    return true;
+            }
+
+            return false;
+        }
+
+    }
+
+    void Homer2HttpResponse::reset() noexcept {
+
+        this->_state = State::STATUS_LINE;
+        this->_lineLen = 0;
+        this->_status = 0;
+        this->_http10 = false;
+        this->_close = false;
+        this->_hasContentLength = false;
+        this->_chunked = false;
+        this->_remaining = 0;
+    }
+
+    void Homer2HttpResponse::feed(
+        const char* const data,
+        const size_t len
+    ) noexcept {
+
+        for (size_t i = 0; i < len; i++) {
+            switch (this->_state) {
+                case State::STATUS_LINE:
+                case State::HEADER_LINE: {
+                    const auto c = data[i];
+                    if ('\n' == c) {
+                        this->onLine();
+                        this->_lineLen = 0;
+                    }
+                    else if ('\r' != c) {
+                        if (this->_lineLen < sizeof(this->_line))
+                            this->_line[this->_lineLen] = c;
+                        // Counted past the buffer, a truncated line is still told from an empty one.
+                        this->_lineLen++;
+                    }
+                }
+                    break;
+
+                case State::BODY: {
+                    const auto left = len - i;
+                    const auto skipped = left < this->_remaining ? left : this->_remaining;
+                    this->_remaining -= skipped;
+                    i += skipped - 1;
+                    if (0 == this->_remaining)
+                        this->_state = State::COMPLETE;
+                }
+                    break;
+
+                case State::COMPLETE:
+                case State::INVALID:
+                    return;
+            }
+        }
+    }
+
+    [[nodiscard]]
+    bool Homer2HttpResponse::complete() const noexcept {
+
+        return State::COMPLETE == this->_state;
+    }
+
+    [[nodiscard]]
+    bool Homer2HttpResponse::invalid() const noexcept {
+
+        return State::INVALID == this->_state;
+    }
+
+    [[nodiscard]]
+    uint16_t Homer2HttpResponse::status() const noexcept {
+
+        return this->_status;
+    }
+
+    [[nodiscard]]
+    bool Homer2HttpResponse::keepAlive() const noexcept {
+
+        if (this->_close || this->_http10 || this->_chunked)
+            return false;
+
+        // Without a length the body of these responses lasts until the connection is closed.
+        const auto bodiless = 204 == this->_status || 304 == this->_status;
+        return bodiless || this->_hasContentLength;
+    }
+
+    void Homer2HttpResponse::onLine() noexcept {
+
+        if (State::STATUS_LINE == this->_state)
+            this->onStatusLine();
+        else if (0 == this->_lineLen)
+            this->onHeadersEnd();
+        else
+            this->onHeaderLine();
+    }
+
+    // HTTP/1.x SP 3DIGIT SP reason
+    void Homer2HttpResponse::onStatusLine() noexcept {
+
+        const auto line = this->_line;
+
+        if (this->_lineLen < 12 ||
+            0 != strncmp(line, "HTTP/1.", 7) ||
+            ' ' != line[8] ||
+            !isdigit(static_cast<unsigned char>(line[9])) ||
+            !isdigit(static_cast<unsigned char>(line[10])) ||
+            !isdigit(static_cast<unsigned char>(line[11]))) {
+            this->_state = State::INVALID;
+            return;
+        }
+
+        this->_http10 = '0' == line[7];
+        this->_status = static_cast<uint16_t>(
+            (line[9] - '0') * 100 + (line[10] - '0') * 10 + (line[11] - '0')
+        );
+        this->_state = State::HEADER_LINE;
+    }
+
+    void Homer2HttpResponse::onHeaderLine() noexcept {
+
+        const auto len = this->_lineLen < sizeof(this->_line) ? this->_lineLen : sizeof(this->_line);
+        const auto line = this->_line;
+
+        if (is_header(line, len, "content-length")) {
+            size_t value = 0;
+            size_t digits = 0;
+            for (size_t i = strlen("content-length:"); i < len; i++) {
+                if (isdigit(static_cast<unsigned char>(line[i]))) {
+                    value = value * 10 + (line[i] - '0');
+                    digits++;
+                }
+                else if (' ' != line[i] && '\t' != line[i]) {
+                    break;
+                }
+            }
+            this->_hasContentLength = digits > 0;
+            this->_remaining = value;
+        }
+        else if (is_header(line, len, "connection")) {
+            this->_close = contains_token(line, len, "close");
+        }
+        else if (is_header(line, len, "transfer-encoding")) {
+            this->_chunked = contains_token(line, len, "chunked");
+        }
+    }
+
+    void Homer2HttpResponse::onHeadersEnd() noexcept {
+
+        // Interim responses are followed by the real one.
+        if (this->_status >= 100 && this->_status < 200) {
+            this->reset();
+            return;
+        }
+
+        if (!this->keepAlive() || 0 == this->_remaining)
+            this->_state = State::COMPLETE;
+        else
+            this->_state = State::BODY;
+    }
+
+}
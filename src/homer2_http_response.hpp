@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace homer2 {
+
+    // Incremental parser of an HTTP/1.x response, fed the received segments in place. Only the
+    // status, the framing and whether the connection can be reused are kept, the body is skipped.
+    class Homer2HttpResponse {
+    public:
+
+        Homer2HttpResponse& operator=(const Homer2HttpResponse& other) noexcept = delete;
+
+        Homer2HttpResponse& operator=(Homer2HttpResponse&& other) = delete;
+
+        Homer2HttpResponse(Homer2HttpResponse&& other) = delete;
+
+        Homer2HttpResponse(const Homer2HttpResponse& other) noexcept = delete;
+
+
+        Homer2HttpResponse() noexcept = default;
+
+
+        void reset() noexcept;
+
+        // Bytes following a complete response are ignored.
+        void feed(
+            const char* data,
+            size_t len
+        ) noexcept;
+
+
+        [[nodiscard]]
+        bool complete() const noexcept;
+
+        [[nodiscard]]
+        bool invalid() const noexcept;
+
+        [[nodiscard]]
+        uint16_t status() const noexcept;
+
+        // False if the server asked to close, or the end of the body is only marked by closing.
+        [[nodiscard]]
+        bool keepAlive() const noexcept;
+
+    private:
+
+        enum class State : uint8_t {
+            STATUS_LINE,
+            HEADER_LINE,
+            BODY,
+            COMPLETE,
+            INVALID,
+        };
+
+        void onLine() noexcept;
+
+        void onStatusLine() noexcept;
+
+        void onHeaderLine() noexcept;
+
+        void onHeadersEnd() noexcept;
+
+        State _state{State::STATUS_LINE};
+
+        // Only the start of a line is kept, enough for the status and the headers of interest.
+        char _line[32]{};
+        size_t _lineLen{0};
+
+        uint16_t _status{0};
+        bool _http10{false};
+        bool _close{false};
+        bool _hasContentLength{false};
+        bool _chunked{false};
+        size_t _remaining{0};
+
+    };
+
+}
@@ -1,3 +1,5 @@
+#include <array>
+#include <cstring>
 #include <map>
 #include <iomanip>
 #include <iostream>
@@ -6,6 +8,7 @@
 #include <pico/cyw43_arch.h>
 #include <pico/binary_info/code.h>
 #include <pico/time.h>
+#include <pico/unique_id.h>
 #include <hardware/gpio.h>
 #include <hardware/i2c.h>
 #include <hardware/uart.h>
@@ -14,6 +17,8 @@
 
 #include "homer2_config.h"
 #include "homer2_init.hpp"
+#include "homer2_alert.hpp"
+#include "homer2_clock.hpp"
 
 namespace {
 
@@ -23,14 +28,19 @@ namespace {
 
 namespace homer2::net {
 
-    uint8_t dns_max_tries() noexcept {
+    uint8_t breaker_threshold() noexcept {
 
-        return static_cast<uint8_t>(HOMER2_DNS_MAX_TRIES);
+        return static_cast<uint8_t>(HOMER2_BREAKER_THRESHOLD);
     }
 
-    uint8_t tcp_max_tries() noexcept {
+    uint64_t backoff_initial_millis() noexcept {
 
-        return static_cast<uint8_t>(HOMER2_TCP_MAX_TRIES);
+        return HOMER2_BACKOFF_INITIAL_MILLIS;
+    }
+
+    uint64_t backoff_max_millis() noexcept {
+
+        return HOMER2_BACKOFF_MAX_MILLIS;
     }
 
 
@@ -39,17 +49,63 @@ namespace homer2::net {
         return HOMER2_VICTORIA_ADDR;
     }
 
-    uint16_t victoria_port() {
+    std::vector<VictoriaEndpoint> victoria_endpoints() {
+
+        // Split in place, the addresses handed out must outlive the pushers.
+        static std::array<char, sizeof(HOMER2_VICTORIA_ADDR)> addrs{};
+        static std::array<char, sizeof(HOMER2_VICTORIA_PORT)> ports{};
+        memcpy(addrs.data(), HOMER2_VICTORIA_ADDR, addrs.size());
+        memcpy(ports.data(), HOMER2_VICTORIA_PORT, ports.size());
+
+        std::vector<VictoriaEndpoint> endpoints{};
+        std::vector<uint16_t> parsedPorts{};
+
+        for (char* port = ports.data(); nullptr != port;) {
+            char* const separator = strchr(port, ',');
+            if (nullptr != separator)
+                *separator = '\0';
+
+            char* endPtr;
+            const auto value = std::strtol(port, &endPtr, 10);
+            if (endPtr == port || *endPtr != '\0' || value < 0 || value > 65535) {
+                E(TAG, "invalid victoria metrics port: " << HOMER2_VICTORIA_PORT);
+                throw std::runtime_error{"invalid victoria metrics port"};
+            }
+            parsedPorts.push_back(static_cast<uint16_t>(value));
+
+            port = nullptr == separator ? nullptr : separator + 1;
+        }
+
+        for (char* addr = addrs.data(); nullptr != addr;) {
+            char* const separator = strchr(addr, ',');
+            if (nullptr != separator)
+                *separator = '\0';
 
-        char* endPtr;
-        const auto value = std::strtol(HOMER2_VICTORIA_PORT, &endPtr, 10);
+            if ('\0' == *addr) {
+                E(TAG, "empty victoria metrics address: " << HOMER2_VICTORIA_ADDR);
+                throw std::runtime_error{"empty victoria metrics address"};
+            }
 
-        if (*endPtr != '\0' || value < 0 || value > 65535) {
-            E(TAG, "invalid victoria metrics port: " << HOMER2_VICTORIA_PORT);
-            throw std::runtime_error{"invalid victoria metrics port"};
+            endpoints.push_back({addr, 0});
+
+            addr = nullptr == separator ? nullptr : separator + 1;
         }
 
-        return static_cast<uint16_t>(value);
+        if (parsedPorts.size() != 1 && parsedPorts.size() != endpoints.size()) {
+            E(TAG, "victoria metrics ports do not match addresses: "
+                << HOMER2_VICTORIA_PORT << " => " << HOMER2_VICTORIA_ADDR);
+            throw std::runtime_error{"victoria metrics ports do not match addresses"};
+        }
+
+        if (endpoints.size() > HOMER2_VICTORIA_MAX_ENDPOINTS) {
+            E(TAG, "too many victoria metrics endpoints: " << endpoints.size());
+            throw std::runtime_error{"too many victoria metrics endpoints"};
+        }
+
+        for (size_t i = 0; i < endpoints.size(); i++)
+            endpoints[i].port = parsedPorts[parsedPorts.size() == 1 ? 0 : i];
+
+        return endpoints;
     }
 
     uint64_t victoria_metrics_frequency_millis() noexcept {
@@ -57,6 +113,71 @@ namespace homer2::net {
         return static_cast<uint64_t>(HOMER2_VICTORIA_FREQUENCY_MILLIS);
     }
 
+    bool victoria_metrics_keep_alive() noexcept {
+
+        return HOMER2_VICTORIA_KEEP_ALIVE;
+    }
+
+    PushFormat victoria_metrics_format() noexcept {
+
+        return HOMER2_VICTORIA_FORMAT;
+    }
+
+    PushTransport victoria_metrics_transport() {
+
+        const auto transport = HOMER2_VICTORIA_TRANSPORT;
+        const auto format = victoria_metrics_format();
+
+        // Graphite has no http endpoint, and only the line based formats survive being cut into
+        // datagrams.
+        const auto datagramFormat = format == PushFormat::influx_line ||
+                                    format == PushFormat::graphite_plaintext;
+
+        if ((transport == PushTransport::udp) != datagramFormat) {
+            E(TAG, "push format not supported over transport, format="
+                << format << ", transport=" << transport);
+            throw std::runtime_error{"push format not supported over transport"};
+        }
+
+        return transport;
+    }
+
+    bool victoria_metrics_gzip() {
+
+        if (!HOMER2_VICTORIA_GZIP)
+            return false;
+
+        // Remote-write is snappy compressed already, and a datagram has no header to tell.
+        if (victoria_metrics_transport() == PushTransport::udp ||
+            victoria_metrics_format() == PushFormat::prometheus_remote_write) {
+            E(TAG, "gzip not supported for format over transport, format="
+                << victoria_metrics_format() << ", transport=" << victoria_metrics_transport());
+            throw std::runtime_error{"gzip not supported for format over transport"};
+        }
+
+        return true;
+    }
+
+    size_t victoria_metrics_batch_size() noexcept {
+
+        return static_cast<size_t>(HOMER2_VICTORIA_BATCH_SIZE);
+    }
+
+    uint64_t victoria_metrics_heartbeat_millis() noexcept {
+
+        return static_cast<uint64_t>(HOMER2_VICTORIA_HEARTBEAT_MILLIS);
+    }
+
+    size_t victoria_metrics_max_payload_bytes() noexcept {
+
+        // A datagram larger than the MTU is fragmented, and lost entirely when any fragment is.
+        if (HOMER2_VICTORIA_TRANSPORT == PushTransport::udp &&
+            HOMER2_VICTORIA_MAX_DATAGRAM_BYTES < HOMER2_VICTORIA_MAX_PAYLOAD_BYTES)
+            return static_cast<size_t>(HOMER2_VICTORIA_MAX_DATAGRAM_BYTES);
+
+        return static_cast<size_t>(HOMER2_VICTORIA_MAX_PAYLOAD_BYTES);
+    }
+
     uint64_t victoria_metrics_write_initial_delay_millis() noexcept {
 
         return HOMER2_VICTORIA_WRITE_INITIAL_DELAY_MILLIS;
@@ -75,6 +196,83 @@ namespace homer2::net {
 #pragma clang diagnostic pop
     }
 
+
+    const char* mqtt_addr() noexcept {
+
+        return HOMER2_MQTT_ADDR;
+    }
+
+    uint16_t mqtt_port() noexcept {
+
+        return static_cast<uint16_t>(HOMER2_MQTT_PORT);
+    }
+
+    const char* mqtt_topic_prefix() noexcept {
+
+        return HOMER2_MQTT_TOPIC_PREFIX;
+    }
+
+    const char* mqtt_device() noexcept {
+
+        if (strlen(HOMER2_MQTT_DEVICE) > 0)
+            return HOMER2_MQTT_DEVICE;
+
+        static std::array<char, 2 * PICO_UNIQUE_BOARD_ID_SIZE_BYTES + 1> boardId{};
+        if ('\0' == boardId[0])
+            pico_get_unique_board_id_string(boardId.data(), boardId.size());
+
+        return boardId.data();
+    }
+
+    const char* mqtt_username() noexcept {
+
+        return HOMER2_MQTT_USERNAME;
+    }
+
+    const char* mqtt_password() noexcept {
+
+        return HOMER2_MQTT_PASSWORD;
+    }
+
+    uint8_t mqtt_qos() noexcept {
+
+        return static_cast<uint8_t>(HOMER2_MQTT_QOS);
+    }
+
+    uint16_t mqtt_keep_alive_seconds() noexcept {
+
+        return static_cast<uint16_t>(HOMER2_MQTT_KEEP_ALIVE_SECONDS);
+    }
+
+    bool is_mqtt_enabled() noexcept {
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "Simplify"
+#pragma ide diagnostic ignored "UnreachableCode"
+#pragma ide diagnostic ignored "ConstantConditionsOC"
+        return HOMER2_WIFI &&
+               strlen(mqtt_addr()) > 0;
+#pragma clang diagnostic pop
+    }
+
+
+    uint16_t http_server_port() noexcept {
+
+        return static_cast<uint16_t>(HOMER2_HTTP_SERVER_PORT);
+    }
+
+    bool is_http_server_enabled() noexcept {
+
+#pragma clang diagnostic push
+#pragma ide diagnostic ignored "Simplify"
+#pragma ide diagnostic ignored "UnreachableCode"
+#pragma ide diagnostic ignored "ConstantConditionsOC"
+        return HOMER2_WIFI &&
+               HOMER2_HTTP_SERVER &&
+               http_server_port() > 0;
+#pragma clang diagnostic pop
+    }
+
 }
 
 namespace homer2 {
@@ -163,8 +361,8 @@ namespace homer2 {
 
     void init_dns() {
 
-        if (!net::is_victoria_metrics_enabled()) {
-            W(TAG, "victoria metrics not enabled, not initializing dns");
+        if (!net::is_victoria_metrics_enabled() && !net::is_mqtt_enabled()) {
+            W(TAG, "neither victoria metrics nor mqtt enabled, not initializing dns");
             return;
         }
 
@@ -173,6 +371,16 @@ namespace homer2 {
         server->addr = ipaddr_aton(HOMER2_DNS_SERVER, nullptr);
     }
 
+    void init_sntp() {
+
+        if (!net::is_victoria_metrics_enabled()) {
+            W(TAG, "victoria metrics not enabled, not initializing sntp");
+            return;
+        }
+
+        clock::init_sntp(HOMER2_SNTP_SERVER);
+    }
+
     bool init() {
 
         if (!stdio_init_all())
@@ -184,13 +392,19 @@ namespace homer2 {
 
         I("Init", "homer2 v" << HOMER2_VERSION_MAJOR << '.' << HOMER2_VERSION_MINOR);
 
+        init_i2c1();
+        init_uart1();
+
+        return true;
+    }
+
+    bool init_net() {
+
         if (!wifi_connect())
             return false;
 
         init_dns();
-
-        init_i2c1();
-        init_uart1();
+        init_sntp();
 
         return true;
     }
@@ -205,6 +419,29 @@ namespace homer2 {
         return HOMER2_TERMINATE_ON_NO_SENSOR;
     }
 
+    [[nodiscard]]
+    size_t flash_log_bytes() noexcept {
+
+        return static_cast<size_t>(HOMER2_FLASH_LOG_BYTES);
+    }
+
+    [[nodiscard]]
+    std::vector<Homer2AlertRule> alert_rules() {
+
+        std::vector<Homer2AlertRule> rules{};
+
+        if (HOMER2_ALERT_CO2_PPM > 0)
+            rules.push_back({Homer2Metric::sunrise_co2, static_cast<float>(HOMER2_ALERT_CO2_PPM)});
+
+        if (HOMER2_ALERT_PM2_5 > 0)
+            rules.push_back({Homer2Metric::pmsx00x_pm2_5, static_cast<float>(HOMER2_ALERT_PM2_5)});
+
+        if (HOMER2_ALERT_VOC_INDEX > 0)
+            rules.push_back({Homer2Metric::sgp40_voc_index, static_cast<float>(HOMER2_ALERT_VOC_INDEX)});
+
+        return rules;
+    }
+
 
     [[nodiscard]]
     bool is_enabled_bmp3xx() noexcept {
@@ -261,6 +498,32 @@ namespace homer2 {
         return out << strings[value];
     }
 
+    std::ostream& operator<<(
+        std::ostream& out,
+        PushFormat value
+    ) {
+        static std::map<PushFormat, std::string_view> strings{
+            {PushFormat::opentsdb_json,           "opentsdb_json"},
+            {PushFormat::influx_line,             "influx_line"},
+            {PushFormat::prometheus_remote_write, "prometheus_remote_write"},
+            {PushFormat::graphite_plaintext,      "graphite_plaintext"},
+        };
+
+        return out << strings[value];
+    }
+
+    std::ostream& operator<<(
+        std::ostream& out,
+        PushTransport value
+    ) {
+        static std::map<PushTransport, std::string_view> strings{
+            {PushTransport::tcp, "tcp"},
+            {PushTransport::udp, "udp"},
+        };
+
+        return out << strings[value];
+    }
+
     std::ostream& operator<<(
         std::ostream& out,
         HumiditySource value
@@ -1,26 +1,104 @@
 #pragma once
 
 #include <string_view>
+#include <vector>
 
 #include "homer2_config.h"
 
+namespace homer2 {
+
+    enum class PushFormat {
+        opentsdb_json,
+        influx_line,
+        prometheus_remote_write,
+        graphite_plaintext,
+    };
+
+    enum class PushTransport {
+        tcp,
+        udp,
+    };
+
+    std::ostream& operator<<(
+        std::ostream& out,
+        PushFormat value
+    );
+
+    std::ostream& operator<<(
+        std::ostream& out,
+        PushTransport value
+    );
+
+}
+
 namespace homer2::net {
 
-    uint8_t dns_max_tries() noexcept;
+    struct VictoriaEndpoint {
+
+        const char* addr;
+
+        uint16_t port;
+
+    };
+
+    uint8_t breaker_threshold() noexcept;
+
+    uint64_t backoff_initial_millis() noexcept;
 
-    uint8_t tcp_max_tries() noexcept;
+    uint64_t backoff_max_millis() noexcept;
 
 
     const char* victoria_addr() noexcept;
 
-    uint16_t victoria_port();
+    // One per comma separated address, the first one is the primary. A single port applies to
+    // all addresses.
+    std::vector<VictoriaEndpoint> victoria_endpoints();
 
     uint64_t victoria_metrics_frequency_millis() noexcept;
 
+    bool victoria_metrics_keep_alive() noexcept;
+
+    PushFormat victoria_metrics_format() noexcept;
+
+    PushTransport victoria_metrics_transport();
+
+    bool victoria_metrics_gzip();
+
+    size_t victoria_metrics_batch_size() noexcept;
+
+    uint64_t victoria_metrics_heartbeat_millis() noexcept;
+
+    size_t victoria_metrics_max_payload_bytes() noexcept;
+
     uint64_t victoria_metrics_write_initial_delay_millis() noexcept;
 
     bool is_victoria_metrics_enabled() noexcept;
 
+
+    const char* mqtt_addr() noexcept;
+
+    uint16_t mqtt_port() noexcept;
+
+    const char* mqtt_topic_prefix() noexcept;
+
+    // HOMER2_MQTT_DEVICE, or the unique id of the board if not set.
+    const char* mqtt_device() noexcept;
+
+    const char* mqtt_username() noexcept;
+
+    const char* mqtt_password() noexcept;
+
+    uint8_t mqtt_qos() noexcept;
+
+    uint16_t mqtt_keep_alive_seconds() noexcept;
+
+    bool is_mqtt_enabled() noexcept;
+
+
+    uint16_t http_server_port() noexcept;
+
+    bool is_http_server_enabled() noexcept;
+
 }
 
 namespace homer2 {
@@ -33,16 +111,32 @@ namespace homer2 {
 
     void init_dns();
 
+    void init_sntp();
+
+    // Console and sensor buses, on core 0.
     [[nodiscard]]
     bool init();
 
+    // Wifi, DNS and SNTP, on core 1 so that the network's interrupts are taken there.
+    [[nodiscard]]
+    bool init_net();
+
 }
 
 namespace homer2 {
 
+    // See homer2_alert.hpp, which includes this header through the sensors.
+    struct Homer2AlertRule;
+
     [[nodiscard]]
     bool terminate_on_no_sensor() noexcept;
 
+    [[nodiscard]]
+    size_t flash_log_bytes() noexcept;
+
+    [[nodiscard]]
+    std::vector<Homer2AlertRule> alert_rules();
+
 
     [[nodiscard]]
     bool is_enabled_bmp3xx() noexcept;
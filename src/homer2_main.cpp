@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <atomic>
 #include <memory>
 
+#include <pico/multicore.h>
+#include <hardware/sync.h>
 #include <hardware/watchdog.h>
 #include <hardware/uart.h>
 #include <hardware/i2c.h>
@@ -10,7 +14,12 @@
 #include "homer2_config.h"
 #include "homer2_init.hpp"
 #include "homer2_sensor.hpp"
+#include "homer2_alert.hpp"
+#include "homer2_handoff.hpp"
 #include "homer2_pusher.hpp"
+#include "homer2_server.hpp"
+#include "homer2_mqtt.hpp"
+#include "homer2_encoder.hpp"
 #include "homer2_main.h"
 
 using homer2::sensor::bme68x::BME68xOversampling;
@@ -48,15 +57,46 @@ namespace {
     const int TAG_WIDTH = static_cast<int>(strlen("PMSx00x"));
     const int TITLE_WIDTH = static_cast<int>(strlen("Relative Humidity"));
 
-    void homer2_main_loop_delay() {
+    // Readings from the sensors on core 0 to the network and console on core 1.
+    homer2::Homer2Handoff handoff{};
+
+    std::atomic<bool> net_ready{false};
+    std::atomic<bool> net_failed{false};
+
+    void homer2_main_loop_sleep_until(
+        const uint64_t deadlineMillis
+    ) {
+
+        if (deadlineMillis > now())
+            sleep_until(from_us_since_boot(deadlineMillis * 1000));
+
+        tight_loop_contents();
+    }
+
+    // Woken up early by any event, the network's interrupts or core 0 handing off a reading.
+    void homer2_main_loop_wait_until(
+        const uint64_t deadlineMillis
+    ) {
+
+        (void) best_effort_wfe_or_timeout(from_us_since_boot(
+            std::max(deadlineMillis, now() + HOMER2_VICTORIA_POLL_MILLIS) * 1000));
+    }
+
+    // Next point on the grid of HOMER2_SENSOR_LOOP_DELAY_MILLIS, skipping the ones already missed.
+    [[nodiscard]]
+    uint64_t homer2_main_loop_next_tick(
+        const uint64_t tickAtMillis,
+        const uint64_t nowMillis
+    ) {
 
 #pragma clang diagnostic push
 #pragma ide diagnostic ignored "Simplify"
-        if (HOMER2_SENSOR_LOOP_DELAY_MILLIS > 0)
-            sleep_ms(HOMER2_SENSOR_LOOP_DELAY_MILLIS);
+        if (HOMER2_SENSOR_LOOP_DELAY_MILLIS == 0 || tickAtMillis == 0)
+            return nowMillis + HOMER2_SENSOR_LOOP_DELAY_MILLIS;
 #pragma clang diagnostic pop
 
-        tight_loop_contents();
+        return tickAtMillis +
+               ((nowMillis - tickAtMillis) / HOMER2_SENSOR_LOOP_DELAY_MILLIS + 1) * HOMER2_SENSOR_LOOP_DELAY_MILLIS;
     }
 
     template<typename T>
@@ -83,6 +123,10 @@ namespace {
     void print(
         const homer2::Homer2SensorsData& data
     ) {
+
+        // Printed on core 1, kept in one piece against the logging of core 0.
+        const homer2::logging::Homer2ConsoleLock console{};
+
         if (data.bme68xData().has_value()) {
             const auto sData = data.bme68xData().value();
             print("BME68x", "Temperature", celsius, sData.getTemperatureCelsius());
@@ -162,32 +206,157 @@ namespace {
 
     void ring0(
         const std::unique_ptr<homer2::Homer2Sensors>& sensors,
-        const std::unique_ptr<homer2::Homer2Pusher>& pusher
+        const std::unique_ptr<homer2::Homer2Alerts>& alerts
+    ) {
+        uint64_t tickAtMillis = 0;
+
+        for (uint64_t i = 0; i < std::numeric_limits<uint64_t>::max(); i++) {
+
+            if (net_failed.load()) {
+                W(TAG, "core 1 exited, terminating");
+                return;
+            }
+
+            // Reconnecting and printing are kept to the loop delay, sensors are woken up for as
+            // they become due in between.
+            const auto tick = now() >= tickAtMillis;
+
+            if (tick) {
+                sensors->connectSensors();
+                if (!sensors->hasAnySensor()) {
+                    if (homer2::terminate_on_no_sensor()) {
+                        W(TAG, "no sensor was found, terminating");
+                        return;
+                    }
+                    else {
+                        continue;
+                    }
+                }
+            }
+
+            const auto read = sensors->querySensors();
+
+            if (read || tick) {
+                const auto data = sensors->data();
+
+                // Evaluated on every reading, whether pushed or not, so that alerts are logged.
+                const auto crossed = alerts->evaluate(data);
+
+                // Never waits on core 1, a reading it has no room for is dropped and counted.
+                if (handoff.push({data, crossed, tick}))
+                    __sev();
+
+                if (tick)
+                    tickAtMillis = homer2_main_loop_next_tick(tickAtMillis, now());
+            }
+
+            homer2_main_loop_sleep_until(std::min(tickAtMillis, sensors->nextDeadlineMillis()));
+        }
+    }
+
+    void ring0_net(
+        const std::unique_ptr<homer2::Homer2Pusher>& pusher,
+        const std::unique_ptr<homer2::Homer2MqttPublisher>& mqtt,
+        const std::unique_ptr<homer2::Homer2Server>& server
     ) {
+        homer2::Homer2Snapshot snapshot{};
+
         for (uint64_t i = 0; i < std::numeric_limits<uint64_t>::max(); i++) {
 
-            sensors->connectSensors();
-            if (!sensors->hasAnySensor()) {
-                if (homer2::terminate_on_no_sensor()) {
-                    W(TAG, "no sensor was found, terminating");
-                    return;
+            // Retries, backoff and replays move on without a new reading too.
+            if (!handoff.pop(snapshot)) {
+                if (pusher) {
+                    pusher->poll();
+                    homer2_main_loop_wait_until(pusher->nextDeadlineMillis());
                 }
                 else {
-                    continue;
+                    __wfe();
                 }
+                continue;
             }
 
-            sensors->querySensors();
+            if (homer2::net::is_victoria_metrics_enabled()) {
+                pusher->recordHandoffs(handoff.pushed(), handoff.dropped());
+                pusher->push(snapshot.data, snapshot.crossedMask);
+            }
 
-            const auto data = sensors->data();
+            if (mqtt)
+                mqtt->publish(snapshot.data);
 
-            if (homer2::net::is_victoria_metrics_enabled())
-                pusher->push(data);
+            if (server)
+                server->publish(snapshot.data);
 
-            print(data);
+            if (snapshot.print)
+                print(snapshot.data);
+        }
+    }
 
-            homer2_main_loop_delay();
+    void ring1_net() {
+
+        if (!homer2::init_net()) {
+            E(TAG, "network initialization failed");
+            return;
         }
+
+        auto pusher = homer2::net::is_victoria_metrics_enabled()
+                      ?
+                      std::make_unique<homer2::Homer2Pusher>(
+                          homer2::net::victoria_endpoints(),
+                          homer2::net::victoria_metrics_transport(),
+                          homer2::net::victoria_metrics_frequency_millis(),
+                          homer2::net::victoria_metrics_keep_alive(),
+                          homer2::net::victoria_metrics_gzip(),
+                          homer2::net::victoria_metrics_batch_size(),
+                          homer2::net::victoria_metrics_heartbeat_millis(),
+                          homer2::net::victoria_metrics_max_payload_bytes(),
+                          homer2::make_encoder(homer2::net::victoria_metrics_format()),
+                          homer2::net::victoria_metrics_write_initial_delay_millis() + now()
+                      )
+                      : nullptr;
+
+        auto mqtt = homer2::net::is_mqtt_enabled()
+                    ?
+                    std::make_unique<homer2::Homer2MqttPublisher>(
+                        homer2::net::mqtt_addr(),
+                        homer2::net::mqtt_port(),
+                        homer2::net::mqtt_topic_prefix(),
+                        homer2::net::mqtt_device(),
+                        homer2::net::mqtt_username(),
+                        homer2::net::mqtt_password(),
+                        homer2::net::mqtt_qos(),
+                        homer2::net::mqtt_keep_alive_seconds()
+                    )
+                    : nullptr;
+
+        auto server = homer2::net::is_http_server_enabled()
+                      ?
+                      std::make_unique<homer2::Homer2Server>(
+                          homer2::net::http_server_port()
+                      )
+                      : nullptr;
+        if (server && !server->start()) {
+            W(TAG, "http server failed to start, continuing without it");
+            server = nullptr;
+        }
+
+        net_ready.store(true);
+        __sev();
+
+        ring0_net(pusher, mqtt, server);
+    }
+
+    // Core 1 entry, the network and the console. Core 0 restarts the board once this exits.
+    void ring2_net() {
+
+        try {
+            ring1_net();
+        }
+        catch (...) {
+            E(TAG, "core 1 failed very badly");
+        }
+
+        net_failed.store(true);
+        __sev();
     }
 
     void ring1() {
@@ -196,6 +365,18 @@ namespace {
             E(TAG, "initialization failed");
             return;
         }
+
+        // Core 1 writing the flash log parks this core while the flash is busy.
+        multicore_lockout_victim_init();
+        multicore_launch_core1(ring2_net);
+
+        while (!net_ready.load()) {
+            if (net_failed.load()) {
+                E(TAG, "initialization failed");
+                return;
+            }
+            __wfe();
+        }
         I(TAG, "initialization finished successfully, entering homer2");
 
         // Homer2 sensors can't handle time=0 (they throw exception). Also, we have to wait for
@@ -210,17 +391,11 @@ namespace {
             uart1
         );
 
-        auto pusher = homer2::net::is_victoria_metrics_enabled()
-                      ?
-                      std::make_unique<homer2::Homer2Pusher>(
-                          homer2::net::victoria_addr(),
-                          homer2::net::victoria_port(),
-                          homer2::net::victoria_metrics_frequency_millis(),
-                          homer2::net::victoria_metrics_write_initial_delay_millis() + now()
-                      )
-                      : nullptr;
+        auto alerts = std::make_unique<homer2::Homer2Alerts>(
+            homer2::alert_rules()
+        );
 
-        ring0(sensors, pusher);
+        ring0(sensors, alerts);
     }
 
     void ring2() {
@@ -0,0 +1,412 @@
+#include <array>
+#include <cmath>
+
+#include "homer2_config.h"
+#include "homer2_metric.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        constexpr std::array<Homer2MetricInfo, METRIC_COUNT> METRICS{{
+            {"voc_index",                  "sgp40",   nullptr, nullptr},
+            {"co2",                        "sunrise", nullptr, nullptr},
+            {"pressure",                   "bmp3xx",  nullptr, nullptr},
+            {"temperature",                "bmp3xx",  nullptr, nullptr},
+            {"pressure",                   "bme68x",  nullptr, nullptr},
+            {"temperature",                "bme68x",  nullptr, nullptr},
+            {"humidity",                   "bme68x",  nullptr, nullptr},
+            {"gas_resistance",             "bme68x",  nullptr, nullptr},
+            {"temperature",                "sht4x",   nullptr, nullptr},
+            {"humidity",                   "sht4x",   nullptr, nullptr},
+            {"pm1_0",                      "pmsx00x", "env",   nullptr},
+            {"pm2_5",                      "pmsx00x", "env",   nullptr},
+            {"pm10_0",                     "pmsx00x", "env",   nullptr},
+            {"ptc0_3",                     "pmsx00x", "env",   nullptr},
+            {"ptc0_5",                     "pmsx00x", "env",   nullptr},
+            {"ptc1_0",                     "pmsx00x", "env",   nullptr},
+            {"ptc2_5",                     "pmsx00x", "env",   nullptr},
+            {"ptc5_0",                     "pmsx00x", "env",   nullptr},
+            {"ptc10_0",                    "pmsx00x", "env",   nullptr},
+            {"breaker_state",              "homer2",  nullptr, nullptr},
+            {"push_dns_millis_bucket",     "homer2",  nullptr, "10"},
+            {"push_dns_millis_bucket",     "homer2",  nullptr, "50"},
+            {"push_dns_millis_bucket",     "homer2",  nullptr, "250"},
+            {"push_dns_millis_bucket",     "homer2",  nullptr, "1000"},
+            {"push_dns_millis_bucket",     "homer2",  nullptr, "+Inf"},
+            {"push_dns_millis_sum",        "homer2",  nullptr, nullptr},
+            {"push_dns_millis_count",      "homer2",  nullptr, nullptr},
+            {"push_connect_millis_bucket", "homer2",  nullptr, "10"},
+            {"push_connect_millis_bucket", "homer2",  nullptr, "50"},
+            {"push_connect_millis_bucket", "homer2",  nullptr, "250"},
+            {"push_connect_millis_bucket", "homer2",  nullptr, "1000"},
+            {"push_connect_millis_bucket", "homer2",  nullptr, "+Inf"},
+            {"push_connect_millis_sum",    "homer2",  nullptr, nullptr},
+            {"push_connect_millis_count",  "homer2",  nullptr, nullptr},
+            {"push_ack_millis_bucket",     "homer2",  nullptr, "50"},
+            {"push_ack_millis_bucket",     "homer2",  nullptr, "250"},
+            {"push_ack_millis_bucket",     "homer2",  nullptr, "1000"},
+            {"push_ack_millis_bucket",     "homer2",  nullptr, "5000"},
+            {"push_ack_millis_bucket",     "homer2",  nullptr, "+Inf"},
+            {"push_ack_millis_sum",        "homer2",  nullptr, nullptr},
+            {"push_ack_millis_count",      "homer2",  nullptr, nullptr},
+            {"push_payload_bytes_bucket",  "homer2",  nullptr, "256"},
+            {"push_payload_bytes_bucket",  "homer2",  nullptr, "1024"},
+            {"push_payload_bytes_bucket",  "homer2",  nullptr, "4096"},
+            {"push_payload_bytes_bucket",  "homer2",  nullptr, "16384"},
+            {"push_payload_bytes_bucket",  "homer2",  nullptr, "+Inf"},
+            {"push_payload_bytes_sum",     "homer2",  nullptr, nullptr},
+            {"push_payload_bytes_count",   "homer2",  nullptr, nullptr},
+            {"push_attempts_total",        "homer2",  nullptr, nullptr},
+            {"push_successes_total",       "homer2",  nullptr, nullptr},
+            {"push_retries_total",         "homer2",  nullptr, nullptr},
+            {"push_http_errors_total",     "homer2",  nullptr, nullptr},
+            {"push_dropped_batches_total", "homer2",  nullptr, nullptr},
+            {"push_sent_bytes_total",      "homer2",  nullptr, nullptr},
+            {"push_dropped_samples_total", "homer2",  nullptr, nullptr},
+            {"core_handoffs_total",        "homer2",  nullptr, nullptr},
+            {"core_handoff_drops_total",   "homer2",  nullptr, nullptr},
+        }};
+
+        // Deadbands are set around the sensors' noise, well below their accuracy. The series alerted on
+        // are kept the longest when samples have to be dropped.
+        constexpr std::array<Homer2SensorMetricInfo, SENSOR_METRIC_COUNT> SENSOR_METRICS{{
+            {1.0F,  0.0F,  HOMER2_VICTORIA_CADENCE_VOC_MILLIS,            Homer2Priority::high},   // sgp40_voc_index
+            {5.0F,  0.0F,  HOMER2_VICTORIA_CADENCE_CO2_MILLIS,            Homer2Priority::high},   // sunrise_co2
+            {0.1F,  0.0F,  HOMER2_VICTORIA_CADENCE_PRESSURE_MILLIS,       Homer2Priority::low},    // bmp3xx_pressure
+            {0.1F,  0.0F,  HOMER2_VICTORIA_CADENCE_TEMPERATURE_MILLIS,    Homer2Priority::normal}, // bmp3xx_temperature
+            {0.1F,  0.0F,  HOMER2_VICTORIA_CADENCE_PRESSURE_MILLIS,       Homer2Priority::low},    // bme68x_pressure
+            {0.1F,  0.0F,  HOMER2_VICTORIA_CADENCE_TEMPERATURE_MILLIS,    Homer2Priority::normal}, // bme68x_temperature
+            {0.5F,  0.0F,  HOMER2_VICTORIA_CADENCE_HUMIDITY_MILLIS,       Homer2Priority::normal}, // bme68x_humidity
+            {0.0F,  0.02F, HOMER2_VICTORIA_CADENCE_GAS_MILLIS,            Homer2Priority::normal}, // bme68x_gas_resistance
+            {0.1F,  0.0F,  HOMER2_VICTORIA_CADENCE_TEMPERATURE_MILLIS,    Homer2Priority::normal}, // sht4x_temperature
+            {0.5F,  0.0F,  HOMER2_VICTORIA_CADENCE_HUMIDITY_MILLIS,       Homer2Priority::normal}, // sht4x_humidity
+            {1.0F,  0.0F,  HOMER2_VICTORIA_CADENCE_PM_MILLIS,             Homer2Priority::normal}, // pmsx00x_pm1_0
+            {1.0F,  0.0F,  HOMER2_VICTORIA_CADENCE_PM_MILLIS,             Homer2Priority::high},   // pmsx00x_pm2_5
+            {1.0F,  0.0F,  HOMER2_VICTORIA_CADENCE_PM_MILLIS,             Homer2Priority::normal}, // pmsx00x_pm10_0
+            {10.0F, 0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc0_3
+            {10.0F, 0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc0_5
+            {10.0F, 0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc1_0
+            {1.0F,  0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc2_5
+            {1.0F,  0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc5_0
+            {1.0F,  0.05F, HOMER2_VICTORIA_CADENCE_PARTICLE_COUNT_MILLIS, Homer2Priority::low},    // pmsx00x_ptc10_0
+        }};
+
+    }
+
+    [[nodiscard]]
+    const Homer2MetricInfo& metric_info(
+        const Homer2Metric metric
+    ) noexcept {
+
+        return METRICS[static_cast<size_t>(metric)];
+    }
+
+    [[nodiscard]]
+    Homer2Metric metric_at(
+        const size_t index
+    ) noexcept {
+
+        return static_cast<Homer2Metric>(index);
+    }
+
+    [[nodiscard]]
+    const Homer2SensorMetricInfo& sensor_metric_info(
+        const Homer2Metric metric
+    ) noexcept {
+
+        return SENSOR_METRICS[static_cast<size_t>(metric)];
+    }
+
+    [[nodiscard]]
+    std::optional<float> metric_value(
+        const Homer2SensorsData& data,
+        const Homer2Metric metric
+    ) noexcept {
+
+        switch (metric) {
+            case Homer2Metric::sgp40_voc_index:
+                if (!data.sgp40Data().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.sgp40Data()->getVocIndex());
+
+            case Homer2Metric::sunrise_co2:
+                if (!data.sunriseData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.sunriseData()->getCo2Ppm());
+
+            case Homer2Metric::bmp3xx_pressure:
+                if (!data.bmp3xxData().has_value())
+                    return std::nullopt;
+                return data.bmp3xxData()->getPressureHPa();
+
+            case Homer2Metric::bmp3xx_temperature:
+                if (!data.bmp3xxData().has_value())
+                    return std::nullopt;
+                return data.bmp3xxData()->getTemperatureCelsius();
+
+            case Homer2Metric::bme68x_pressure:
+                if (!data.bme68xData().has_value())
+                    return std::nullopt;
+                return data.bme68xData()->getPressureHPa();
+
+            case Homer2Metric::bme68x_temperature:
+                if (!data.bme68xData().has_value())
+                    return std::nullopt;
+                return data.bme68xData()->getTemperatureCelsius();
+
+            case Homer2Metric::bme68x_humidity:
+                if (!data.bme68xData().has_value())
+                    return std::nullopt;
+                return data.bme68xData()->getRelativeHumidityPercent();
+
+            case Homer2Metric::bme68x_gas_resistance:
+                if (!data.bme68xData().has_value())
+                    return std::nullopt;
+                return data.bme68xData()->getGasResistanceOhms();
+
+            case Homer2Metric::sht4x_temperature:
+                if (!data.sht4xData().has_value())
+                    return std::nullopt;
+                return data.sht4xData()->getTemperatureCelsius();
+
+            case Homer2Metric::sht4x_humidity:
+                if (!data.sht4xData().has_value())
+                    return std::nullopt;
+                return data.sht4xData()->getRelativeHumidityPercent();
+
+            case Homer2Metric::pmsx00x_pm1_0:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getPm10Env());
+
+            case Homer2Metric::pmsx00x_pm2_5:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getPm25Env());
+
+            case Homer2Metric::pmsx00x_pm10_0:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getPm100Env());
+
+            case Homer2Metric::pmsx00x_ptc0_3:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles03());
+
+            case Homer2Metric::pmsx00x_ptc0_5:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles05());
+
+            case Homer2Metric::pmsx00x_ptc1_0:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles10());
+
+            case Homer2Metric::pmsx00x_ptc2_5:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles25());
+
+            case Homer2Metric::pmsx00x_ptc5_0:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles50());
+
+            case Homer2Metric::pmsx00x_ptc10_0:
+                if (!data.pmsx00xData().has_value())
+                    return std::nullopt;
+                return static_cast<float>(data.pmsx00xData()->getParticles100());
+
+            case Homer2Metric::homer2_breaker_state:
+            case Homer2Metric::homer2_dns_millis_bucket_0:
+            case Homer2Metric::homer2_dns_millis_bucket_1:
+            case Homer2Metric::homer2_dns_millis_bucket_2:
+            case Homer2Metric::homer2_dns_millis_bucket_3:
+            case Homer2Metric::homer2_dns_millis_bucket_4:
+            case Homer2Metric::homer2_dns_millis_sum:
+            case Homer2Metric::homer2_dns_millis_count:
+            case Homer2Metric::homer2_connect_millis_bucket_0:
+            case Homer2Metric::homer2_connect_millis_bucket_1:
+            case Homer2Metric::homer2_connect_millis_bucket_2:
+            case Homer2Metric::homer2_connect_millis_bucket_3:
+            case Homer2Metric::homer2_connect_millis_bucket_4:
+            case Homer2Metric::homer2_connect_millis_sum:
+            case Homer2Metric::homer2_connect_millis_count:
+            case Homer2Metric::homer2_ack_millis_bucket_0:
+            case Homer2Metric::homer2_ack_millis_bucket_1:
+            case Homer2Metric::homer2_ack_millis_bucket_2:
+            case Homer2Metric::homer2_ack_millis_bucket_3:
+            case Homer2Metric::homer2_ack_millis_bucket_4:
+            case Homer2Metric::homer2_ack_millis_sum:
+            case Homer2Metric::homer2_ack_millis_count:
+            case Homer2Metric::homer2_payload_bytes_bucket_0:
+            case Homer2Metric::homer2_payload_bytes_bucket_1:
+            case Homer2Metric::homer2_payload_bytes_bucket_2:
+            case Homer2Metric::homer2_payload_bytes_bucket_3:
+            case Homer2Metric::homer2_payload_bytes_bucket_4:
+            case Homer2Metric::homer2_payload_bytes_sum:
+            case Homer2Metric::homer2_payload_bytes_count:
+            case Homer2Metric::homer2_push_attempts:
+            case Homer2Metric::homer2_push_successes:
+            case Homer2Metric::homer2_push_retries:
+            case Homer2Metric::homer2_http_errors:
+            case Homer2Metric::homer2_dropped_batches:
+            case Homer2Metric::homer2_sent_bytes:
+            case Homer2Metric::homer2_dropped_samples:
+            case Homer2Metric::homer2_core_handoffs:
+            case Homer2Metric::homer2_core_handoff_drops:
+                return std::nullopt;
+        }
+
+        return std::nullopt;
+    }
+
+    [[nodiscard]]
+    uint64_t metric_captured_at(
+        const Homer2SensorsData& data,
+        const Homer2Metric metric
+    ) noexcept {
+
+        switch (metric) {
+            case Homer2Metric::sgp40_voc_index:
+                return data.sgp40CapturedAtMillis();
+
+            case Homer2Metric::sunrise_co2:
+                return data.sunriseCapturedAtMillis();
+
+            case Homer2Metric::bmp3xx_pressure:
+            case Homer2Metric::bmp3xx_temperature:
+                return data.bmp3xxCapturedAtMillis();
+
+            case Homer2Metric::bme68x_pressure:
+            case Homer2Metric::bme68x_temperature:
+            case Homer2Metric::bme68x_humidity:
+            case Homer2Metric::bme68x_gas_resistance:
+                return data.bme68xCapturedAtMillis();
+
+            case Homer2Metric::sht4x_temperature:
+            case Homer2Metric::sht4x_humidity:
+                return data.sht4xCapturedAtMillis();
+
+            case Homer2Metric::pmsx00x_pm1_0:
+            case Homer2Metric::pmsx00x_pm2_5:
+            case Homer2Metric::pmsx00x_pm10_0:
+            case Homer2Metric::pmsx00x_ptc0_3:
+            case Homer2Metric::pmsx00x_ptc0_5:
+            case Homer2Metric::pmsx00x_ptc1_0:
+            case Homer2Metric::pmsx00x_ptc2_5:
+            case Homer2Metric::pmsx00x_ptc5_0:
+            case Homer2Metric::pmsx00x_ptc10_0:
+                return data.pmsx00xCapturedAtMillis();
+
+            case Homer2Metric::homer2_breaker_state:
+            case Homer2Metric::homer2_dns_millis_bucket_0:
+            case Homer2Metric::homer2_dns_millis_bucket_1:
+            case Homer2Metric::homer2_dns_millis_bucket_2:
+            case Homer2Metric::homer2_dns_millis_bucket_3:
+            case Homer2Metric::homer2_dns_millis_bucket_4:
+            case Homer2Metric::homer2_dns_millis_sum:
+            case Homer2Metric::homer2_dns_millis_count:
+            case Homer2Metric::homer2_connect_millis_bucket_0:
+            case Homer2Metric::homer2_connect_millis_bucket_1:
+            case Homer2Metric::homer2_connect_millis_bucket_2:
+            case Homer2Metric::homer2_connect_millis_bucket_3:
+            case Homer2Metric::homer2_connect_millis_bucket_4:
+            case Homer2Metric::homer2_connect_millis_sum:
+            case Homer2Metric::homer2_connect_millis_count:
+            case Homer2Metric::homer2_ack_millis_bucket_0:
+            case Homer2Metric::homer2_ack_millis_bucket_1:
+            case Homer2Metric::homer2_ack_millis_bucket_2:
+            case Homer2Metric::homer2_ack_millis_bucket_3:
+            case Homer2Metric::homer2_ack_millis_bucket_4:
+            case Homer2Metric::homer2_ack_millis_sum:
+            case Homer2Metric::homer2_ack_millis_count:
+            case Homer2Metric::homer2_payload_bytes_bucket_0:
+            case Homer2Metric::homer2_payload_bytes_bucket_1:
+            case Homer2Metric::homer2_payload_bytes_bucket_2:
+            case Homer2Metric::homer2_payload_bytes_bucket_3:
+            case Homer2Metric::homer2_payload_bytes_bucket_4:
+            case Homer2Metric::homer2_payload_bytes_sum:
+            case Homer2Metric::homer2_payload_bytes_count:
+            case Homer2Metric::homer2_push_attempts:
+            case Homer2Metric::homer2_push_successes:
+            case Homer2Metric::homer2_push_retries:
+            case Homer2Metric::homer2_http_errors:
+            case Homer2Metric::homer2_dropped_batches:
+            case Homer2Metric::homer2_sent_bytes:
+            case Homer2Metric::homer2_dropped_samples:
+            case Homer2Metric::homer2_core_handoffs:
+            case Homer2Metric::homer2_core_handoff_drops:
+                return 0;
+        }
+
+        return 0;
+    }
+
+    [[nodiscard]]
+    std::optional<float> metric_value(
+        const Homer2Reading& reading,
+        const Homer2Metric metric
+    ) noexcept {
+
+        const auto index = static_cast<size_t>(metric);
+        if (index >= SENSOR_METRIC_COUNT ||
+            0 == (reading.mask & (1ULL << index)) ||
+            !std::isfinite(reading.values[index]))
+            return std::nullopt;
+
+        return reading.values[index];
+    }
+
+    [[nodiscard]]
+    Homer2Priority reading_priority(
+        const Homer2Reading& reading
+    ) noexcept {
+
+        auto priority = Homer2Priority::low;
+        for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++)
+            if (0 != (reading.mask & (1ULL << i)) && SENSOR_METRICS[i].priority > priority)
+                priority = SENSOR_METRICS[i].priority;
+
+        return priority;
+    }
+
+    [[nodiscard]]
+    Homer2Reading make_reading(
+        const Homer2SensorsData& data
+    ) noexcept {
+
+        Homer2Reading reading{};
+
+        for (size_t i = 0; i < SENSOR_METRIC_COUNT; i++) {
+            // A sensor gone wrong reports NaN, nothing any format can carry nor worth reporting.
+            const auto value = metric_value(data, metric_at(i));
+            if (!value.has_value() || !std::isfinite(value.value()))
+                continue;
+
+            reading.mask |= 1ULL << i;
+            reading.values[i] = value.value();
+        }
+
+        return reading;
+    }
+
+    [[nodiscard]]
+    uint64_t captured_after(
+        const Homer2SensorsData& data,
+        const uint64_t afterMillis
+    ) noexcept {
+
+        uint64_t mask = 0;
+
+        for (size_t i = 0; i < METRIC_COUNT; i++)
+            if (metric_captured_at(data, metric_at(i)) > afterMillis)
+                mask |= 1ULL << i;
+
+        return mask;
+    }
+
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "homer2_sensor.hpp"
+
+namespace homer2 {
+
+    // Ordered by sensor, encoders rely on metrics of the same sensor being adjacent.
+    enum class Homer2Metric : uint8_t {
+        sgp40_voc_index,
+        sunrise_co2,
+        bmp3xx_pressure,
+        bmp3xx_temperature,
+        bme68x_pressure,
+        bme68x_temperature,
+        bme68x_humidity,
+        bme68x_gas_resistance,
+        sht4x_temperature,
+        sht4x_humidity,
+        pmsx00x_pm1_0,
+        pmsx00x_pm2_5,
+        pmsx00x_pm10_0,
+        pmsx00x_ptc0_3,
+        pmsx00x_ptc0_5,
+        pmsx00x_ptc1_0,
+        pmsx00x_ptc2_5,
+        pmsx00x_ptc5_0,
+        pmsx00x_ptc10_0,
+        // Homer2's own state, never read from a sensor but taken by the pusher for each batch, see
+        // Homer2TelemetryReading.
+        homer2_breaker_state,
+        // Histograms take HISTOGRAM_BUCKETS buckets, then their sum and count, in this order.
+        homer2_dns_millis_bucket_0,
+        homer2_dns_millis_bucket_1,
+        homer2_dns_millis_bucket_2,
+        homer2_dns_millis_bucket_3,
+        homer2_dns_millis_bucket_4,
+        homer2_dns_millis_sum,
+        homer2_dns_millis_count,
+        homer2_connect_millis_bucket_0,
+        homer2_connect_millis_bucket_1,
+        homer2_connect_millis_bucket_2,
+        homer2_connect_millis_bucket_3,
+        homer2_connect_millis_bucket_4,
+        homer2_connect_millis_sum,
+        homer2_connect_millis_count,
+        homer2_ack_millis_bucket_0,
+        homer2_ack_millis_bucket_1,
+        homer2_ack_millis_bucket_2,
+        homer2_ack_millis_bucket_3,
+        homer2_ack_millis_bucket_4,
+        homer2_ack_millis_sum,
+        homer2_ack_millis_count,
+        homer2_payload_bytes_bucket_0,
+        homer2_payload_bytes_bucket_1,
+        homer2_payload_bytes_bucket_2,
+        homer2_payload_bytes_bucket_3,
+        homer2_payload_bytes_bucket_4,
+        homer2_payload_bytes_sum,
+        homer2_payload_bytes_count,
+        homer2_push_attempts,
+        homer2_push_successes,
+        homer2_push_retries,
+        homer2_http_errors,
+        homer2_dropped_batches,
+        homer2_sent_bytes,
+        homer2_dropped_samples,
+        homer2_core_handoffs,
+        homer2_core_handoff_drops,
+    };
+
+    constexpr size_t METRIC_COUNT = static_cast<size_t>(Homer2Metric::homer2_core_handoff_drops) + 1;
+
+    // The metrics read from sensors, those a reading holds.
+    constexpr size_t SENSOR_METRIC_COUNT = static_cast<size_t>(Homer2Metric::pmsx00x_ptc10_0) + 1;
+
+    // Which samples to keep when not all of them can be, see Homer2SampleQueue::push().
+    enum class Homer2Priority : uint8_t {
+        low,
+        normal,
+        high,
+    };
+
+    struct Homer2MetricInfo {
+
+        const char* name;
+
+        const char* sensor;
+
+        // Optional, nullptr when the metric has no category.
+        const char* cat;
+
+        // Upper bound of a histogram bucket, nullptr when the metric is not one.
+        const char* le;
+
+    };
+
+    // How the values read from sensors are reported, homer2's own metrics have their own cadence
+    // and are never filtered nor dropped, see Homer2Pusher::appendTelemetry().
+    struct Homer2SensorMetricInfo {
+
+        // A value within max(deadbandAbs, deadbandRel * |last reported|) of the last reported one
+        // is not worth reporting again.
+        float deadbandAbs;
+
+        float deadbandRel;
+
+        // Least time between two reported values, 0 when every value is reported.
+        uint64_t cadenceMillis;
+
+        Homer2Priority priority;
+
+    };
+
+    // The sensor values of one reading, compact enough to be queued and stored in flash.
+    struct Homer2Reading {
+
+        // Bit i is set when the value of metric_at(i) is present.
+        uint64_t mask{0};
+
+        std::array<float, SENSOR_METRIC_COUNT> values{};
+
+    };
+
+    static_assert(METRIC_COUNT <= 64, "metric mask too narrow");
+
+    [[nodiscard]]
+    const Homer2MetricInfo& metric_info(
+        Homer2Metric metric
+    ) noexcept;
+
+    [[nodiscard]]
+    Homer2Metric metric_at(
+        size_t index
+    ) noexcept;
+
+    // Only for the metrics read from sensors, the first SENSOR_METRIC_COUNT.
+    [[nodiscard]]
+    const Homer2SensorMetricInfo& sensor_metric_info(
+        Homer2Metric metric
+    ) noexcept;
+
+    [[nodiscard]]
+    std::optional<float> metric_value(
+        const Homer2SensorsData& data,
+        Homer2Metric metric
+    ) noexcept;
+
+    // Monotonic time the value was read from its sensor, 0 when there is no value.
+    [[nodiscard]]
+    uint64_t metric_captured_at(
+        const Homer2SensorsData& data,
+        Homer2Metric metric
+    ) noexcept;
+
+    // Non-finite values are left out, none of the formats can carry them.
+    [[nodiscard]]
+    std::optional<float> metric_value(
+        const Homer2Reading& reading,
+        Homer2Metric metric
+    ) noexcept;
+
+    // The highest priority of the values present in the reading.
+    [[nodiscard]]
+    Homer2Priority reading_priority(
+        const Homer2Reading& reading
+    ) noexcept;
+
+    [[nodiscard]]
+    Homer2Reading make_reading(
+        const Homer2SensorsData& data
+    ) noexcept;
+
+    // Bit i is set when the value of metric_at(i) was captured after the given time, i.e. it is
+    // not a cached value seen before.
+    [[nodiscard]]
+    uint64_t captured_after(
+        const Homer2SensorsData& data,
+        uint64_t afterMillis
+    ) noexcept;
+
+}
@@ -0,0 +1,722 @@
+#include <cstring>
+#include <stdexcept>
+
+#include <pico/cyw43_arch.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_init.hpp"
+#include "homer2_clock.hpp"
+#include "homer2_mqtt.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Mqtt";
+
+        constexpr uint8_t FLOAT_DECIMALS = 3;
+
+        // A connect, a handshake, a write or an acknowledgement not progressing for this long is
+        // given up on.
+        constexpr uint64_t PENDING_TIMEOUT_MILLIS = 5'000;
+
+        // Every message of a reading, statically allocated so that publishing never touches the
+        // heap.
+        std::array<char, HOMER2_MQTT_BUFFER_BYTES> out_buffer{};
+
+        // One message at a time, copied into the packet once its length is known.
+        std::array<char, 384> message_buffer{};
+
+        // Metrics are ordered by sensor, so sensors are numbered in the order they appear.
+        struct SensorTable {
+
+            std::array<const char*, METRIC_COUNT> names{};
+
+            std::array<uint8_t, METRIC_COUNT> ofMetric{};
+
+            size_t count{0};
+
+        };
+
+        const SensorTable& sensor_table() noexcept {
+
+            static const SensorTable table = [] {
+                SensorTable t{};
+                for (size_t i = 0; i < METRIC_COUNT; i++) {
+                    const char* const sensor = metric_info(metric_at(i)).sensor;
+                    if (0 == t.count || 0 != strcmp(t.names[t.count - 1], sensor))
+                        t.names[t.count++] = sensor;
+                    t.ofMetric[i] = static_cast<uint8_t>(t.count - 1);
+                }
+                return t;
+            }();
+
+            return table;
+        }
+
+        uint32_t present_sensors(
+            const uint64_t metricMask
+        ) noexcept {
+            const auto& table = sensor_table();
+
+            uint32_t mask = 0;
+            for (size_t i = 0; i < METRIC_COUNT; i++)
+                if (0 != (metricMask & (1ULL << i)))
+                    mask |= 1u << table.ofMetric[i];
+
+            return mask;
+        }
+
+    }
+
+    Homer2MqttPublisher::Homer2MqttPublisher(
+        const char* const addr,
+        const uint16_t port,
+        const char* const topicPrefix,
+        const char* const device,
+        const char* const username,
+        const char* const password,
+        const uint8_t qos,
+        const uint16_t keepAliveSeconds
+    ) : _addr{addr},
+        _port{port},
+        _resolver{addr, nullptr},
+        _breaker{addr, net::breaker_threshold(), net::backoff_initial_millis(), net::backoff_max_millis()},
+        _qos{qos},
+        _keepAliveSeconds{keepAliveSeconds},
+        _username{username},
+        _password{password},
+        _clientId{_clientIdBuffer.data(), _clientIdBuffer.size() - 1},
+        _topic{_topicBuffer.data(), _topicBuffer.size() - 1},
+        _out{out_buffer.data(), out_buffer.size()} {
+
+        if (qos > 1)
+            throw std::logic_error{"mqtt qos must be 0 or 1"};
+
+        if (sensor_table().count > 32)
+            throw std::logic_error{"too many sensors for the pending mask"};
+
+        // Null terminated by the byte left out of the capacity.
+        this->_clientId
+            .append("homer2-")
+            .append(device);
+        this->_topic
+            .append(topicPrefix)
+            .append('/')
+            .append(device)
+            .append('/');
+        if (this->_clientId.overflowed() || this->_topic.overflowed())
+            throw std::logic_error{"mqtt device name too long"};
+
+        this->_topicPrefixSize = this->_topic.size();
+
+        I(TAG, "publishing to: " << addr << ":" << port
+            << ", topic: " << this->_topicBuffer.data() << "<sensor>"
+            << ", qos: " << std::to_string(qos));
+    }
+
+    Homer2MqttPublisher::~Homer2MqttPublisher() noexcept {
+
+        this->disconnect();
+    }
+
+    void Homer2MqttPublisher::publish(
+        const Homer2SensorsData& data
+    ) {
+        cyw43_arch_lwip_begin();
+
+        if (!data.empty()) {
+            // Once written, a reading is not replaced: with qos 1 it is awaiting its acks, with
+            // qos 0 part of it may already be out.
+            if (0 != this->_pendingSensors && this->_sentOnce) {
+                D(4, TAG, "previous reading not delivered yet, skipping reading");
+                this->_skippedReadings++;
+            }
+            else {
+                // Sensors with nothing new since the previous reading are not published again,
+                // unless the previous reading did not make it out yet.
+                auto reading = make_reading(data);
+                const auto fresh = captured_after(data, this->_lastCapturedMillis);
+                const auto held = present_sensors(reading.mask) & this->_pendingSensors;
+
+                this->_reading = reading;
+                this->_readAtMillis = data.capturedAtMillis();
+                this->_lastCapturedMillis = this->_readAtMillis;
+                this->_pendingSensors = held | present_sensors(reading.mask & fresh);
+                this->_sentOnce = false;
+            }
+        }
+
+        this->advance();
+
+        cyw43_arch_lwip_end();
+    }
+
+    void Homer2MqttPublisher::disconnect() noexcept {
+
+        if (this->_status == internal::MqttStatus::CONNECTED &&
+            this->_written == this->_out.size()) {
+            this->_out.clear();
+            this->_written = 0;
+            mqtt::append_disconnect(this->_out);
+            (void) this->flush();
+        }
+
+        (void) this->close();
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2MqttPublisher::publishedMessages() const noexcept {
+
+        return this->_publishedMessages;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2MqttPublisher::skippedReadings() const noexcept {
+
+        return this->_skippedReadings;
+    }
+
+    [[nodiscard]]
+    BreakerState Homer2MqttPublisher::breakerState() const noexcept {
+
+        return this->_breaker.state();
+    }
+
+    void Homer2MqttPublisher::transition(
+        const internal::MqttStatus status
+    ) noexcept {
+
+        this->_status = status;
+        this->_lastProgressMillis = now();
+    }
+
+    void Homer2MqttPublisher::advance() noexcept {
+
+        switch (this->_status.load()) {
+            case internal::MqttStatus::CONNECTING:
+                D(4, TAG, "connection in progress");
+                return;
+
+            case internal::MqttStatus::HANDSHAKE:
+                D(4, TAG, "waiting for connack");
+                return;
+
+            case internal::MqttStatus::CONNECTED:
+                (void) this->startSend();
+                return;
+
+            case internal::MqttStatus::DISCONNECTED:
+                break;
+        }
+
+        if (!this->_breaker.allow()) {
+            D(4, TAG, "backing off");
+            return;
+        }
+
+        const auto resolved = this->_resolver.resolve(this->_ip);
+        if (this->_resolver.failures() > this->_dnsFailures)
+            this->_breaker.failure();
+        this->_dnsFailures = this->_resolver.failures();
+
+        if (!resolved) {
+            D(4, TAG, "dns resolver in progress");
+            return;
+        }
+
+        if (this->open())
+            (void) this->connect();
+    }
+
+    [[nodiscard]]
+    bool Homer2MqttPublisher::open() noexcept {
+
+        D(5, TAG, "opening tcp");
+
+        this->transition(internal::MqttStatus::CONNECTING);
+
+        this->_tcpPcb = tcp_new_ip_type(IP_GET_TYPE(&this->_ip));
+        if (!this->_tcpPcb) {
+            E(TAG, "failed to create tcp pcb");
+            this->incTcpErr();
+            (void) this->close();
+            return false;
+        }
+
+        tcp_arg(this->_tcpPcb, this);
+
+        // Readings are small and latency matters more than filling segments.
+        tcp_nagle_disable(this->_tcpPcb);
+
+        tcp_poll(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb
+            ) {
+                (void) tcpPcb;
+                return static_cast<Homer2MqttPublisher*>(arg)->onPoll();
+            },
+            2
+        );
+
+        tcp_sent(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                const u16_t len
+            ) {
+                (void) tcpPcb;
+                (void) len;
+                auto that = static_cast<Homer2MqttPublisher*>(arg);
+
+                that->_lastProgressMillis = now();
+                return that->flush();
+            }
+        );
+
+        tcp_recv(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                struct pbuf* const pBuf,
+                const err_t err
+            ) {
+                (void) err;
+                auto that = static_cast<Homer2MqttPublisher*>(arg);
+
+                if (nullptr == pBuf) {
+                    W(TAG, "connection closed by broker, will reconnect on next reading");
+                    that->incTcpErr();
+                    return that->close();
+                }
+
+                return that->onReceived(tcpPcb, pBuf);
+            }
+        );
+
+        tcp_err(
+            this->_tcpPcb,
+            [](
+                void* const arg,
+                const err_t err
+            ) {
+                auto that = static_cast<Homer2MqttPublisher*>(arg);
+
+                E(TAG, "TCP fatal error: " << std::to_string(err));
+
+                // The pcb is already freed by lwIP when this callback is invoked.
+                that->_tcpPcb = nullptr;
+                that->incTcpErr();
+                (void) that->close();
+            }
+        );
+
+        return true;
+    }
+
+    [[nodiscard]]
+    bool Homer2MqttPublisher::connect() noexcept {
+
+        D(5, TAG, "connecting tcp");
+
+        const err_t err = tcp_connect(
+            this->_tcpPcb,
+            &this->_ip,
+            this->_port,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                const err_t err
+            ) {
+                (void) tcpPcb;
+                auto that = static_cast<Homer2MqttPublisher*>(arg);
+
+                if (ERR_OK != err) {
+                    E(TAG, "connection failed: " << std::to_string(err));
+                    that->incTcpErr();
+                    const auto closeErr = that->close();
+                    return ERR_OK == closeErr ? err : closeErr;
+                }
+
+                return that->handshake();
+            }
+        );
+
+        if (ERR_OK != err) {
+            E(TAG, "connection failed: " << std::to_string(err));
+            this->incTcpErr();
+            (void) this->close();
+            return false;
+        }
+
+        return true;
+    }
+
+    err_t Homer2MqttPublisher::handshake() noexcept {
+
+        D(4, TAG, "connected, sending connect");
+
+        this->transition(internal::MqttStatus::HANDSHAKE);
+        this->_reader.reset();
+        this->_lastReceivedMillis = now();
+
+        this->_out.clear();
+        this->_written = 0;
+        mqtt::append_connect(
+            this->_out,
+            this->_clientIdBuffer.data(),
+            this->_username,
+            this->_password,
+            this->_keepAliveSeconds
+        );
+
+        return this->flush();
+    }
+
+    // Renders a message per pending sensor, every one of them into a single write.
+    [[nodiscard]]
+    bool Homer2MqttPublisher::render(
+        const bool dup
+    ) noexcept {
+
+        const auto& table = sensor_table();
+        const auto timestamp = clock::epoch_millis(this->_readAtMillis);
+
+        this->_out.clear();
+        this->_written = 0;
+
+        for (size_t s = 0; s < table.count; s++) {
+            if (0 == (this->_pendingSensors & (1u << s)))
+                continue;
+
+            // {"timestamp":1700000000000,"temperature":21.5,"humidity":40.125}
+            Homer2Payload message{message_buffer.data(), message_buffer.size()};
+            message.append('{');
+            if (timestamp > 0)
+                message.append(R"("timestamp":)")
+                    .appendUnsigned(timestamp)
+                    .append(',');
+
+            for (size_t i = 0; i < METRIC_COUNT; i++) {
+                if (table.ofMetric[i] != s)
+                    continue;
+
+                const auto value = metric_value(this->_reading, metric_at(i));
+                if (!value.has_value())
+                    continue;
+
+                message.append('"')
+                    .append(metric_info(metric_at(i)).name)
+                    .append(R"(":)")
+                    .appendFloat(value.value(), FLOAT_DECIMALS)
+                    .append(',');
+            }
+            message.truncate(message.size() - 1);
+            message.append('}');
+
+            this->_topic.truncate(this->_topicPrefixSize);
+            this->_topic.append(table.names[s]);
+            this->_topicBuffer[this->_topic.size()] = '\0';
+
+            mqtt::append_publish(
+                this->_out,
+                this->_topicBuffer.data(),
+                message.data(),
+                message.size(),
+                this->_qos,
+                static_cast<uint16_t>(this->_firstPacketId + s),
+                dup
+            );
+
+            if (message.overflowed() || this->_topic.overflowed() || this->_out.overflowed()) {
+                E(TAG, "reading does not fit into buffer, dropping it");
+                this->_out.clear();
+                this->_pendingSensors = 0;
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    err_t Homer2MqttPublisher::startSend() noexcept {
+
+        if (0 == this->_pendingSensors || this->_inFlight)
+            return ERR_OK;
+
+        if (this->_written < this->_out.size()) {
+            D(4, TAG, "write in progress");
+            return ERR_OK;
+        }
+
+        // Sent before on a connection that dropped, the broker may have seen it already.
+        if (!this->render(this->_sentOnce))
+            return ERR_OK;
+
+        D(4, TAG, "publishing messages: " << __builtin_popcount(this->_pendingSensors)
+            << (this->_sentOnce ? ", again" : ""));
+
+        this->_publishedMessages += __builtin_popcount(this->_pendingSensors);
+        this->_sentOnce = true;
+        this->_inFlight = true;
+
+        return this->flush();
+    }
+
+    err_t Homer2MqttPublisher::ping() noexcept {
+
+        D(5, TAG, "keep alive, sending pingreq");
+
+        this->_out.clear();
+        this->_written = 0;
+        mqtt::append_pingreq(this->_out);
+
+        return this->flush();
+    }
+
+    // Writes as much as the send buffer takes, the rest follows as acks free it up.
+    err_t Homer2MqttPublisher::flush() noexcept {
+
+        if (nullptr == this->_tcpPcb)
+            return ERR_OK;
+
+        while (this->_written < this->_out.size()) {
+
+            const auto available = static_cast<size_t>(tcp_sndbuf(this->_tcpPcb));
+            if (0 == available)
+                break;
+
+            const auto left = this->_out.size() - this->_written;
+            const auto len = left < available ? left : available;
+
+            const auto err = tcp_write(
+                this->_tcpPcb,
+                this->_out.data() + this->_written,
+                static_cast<u16_t>(len),
+                TCP_WRITE_FLAG_COPY
+            );
+
+            if (ERR_MEM == err)
+                break;
+
+            if (ERR_OK != err) {
+                E(TAG, "could not write: " << std::to_string(err));
+                this->incTcpErr();
+                return this->close();
+            }
+
+            this->_written += len;
+            this->_lastSentMillis = now();
+        }
+
+        tcp_output(this->_tcpPcb);
+
+        // Nothing acknowledges qos 0, it is delivered as far as this side can tell once written.
+        if (this->_written == this->_out.size() &&
+            this->_status == internal::MqttStatus::CONNECTED &&
+            0 == this->_qos &&
+            this->_inFlight) {
+            this->_pendingSensors = 0;
+            this->_inFlight = false;
+        }
+
+        return ERR_OK;
+    }
+
+    err_t Homer2MqttPublisher::onPoll() noexcept {
+
+        const auto status = this->_status.load();
+
+        if (status == internal::MqttStatus::CONNECTING || status == internal::MqttStatus::HANDSHAKE) {
+            if (!is_expired(this->_lastProgressMillis, PENDING_TIMEOUT_MILLIS))
+                return ERR_OK;
+
+            E(TAG, "connection timeout");
+            this->incTcpErr();
+            return this->close();
+        }
+
+        if (status != internal::MqttStatus::CONNECTED)
+            return ERR_OK;
+
+        const auto writing = this->_written < this->_out.size();
+        const auto awaitingAcks = 0 != this->_pendingSensors && this->_inFlight;
+        if ((writing || awaitingAcks) && is_expired(this->_lastProgressMillis, PENDING_TIMEOUT_MILLIS)) {
+            E(TAG, "broker not progressing, reconnecting");
+            this->incTcpErr();
+            return this->close();
+        }
+
+        if (0 == this->_keepAliveSeconds)
+            return ERR_OK;
+
+        // The broker drops a client silent for 1.5 times the keep alive, the client should do
+        // the same to the broker.
+        const uint64_t keepAliveMillis = this->_keepAliveSeconds * 1000ULL;
+        if (is_expired(this->_lastReceivedMillis, keepAliveMillis + keepAliveMillis / 2)) {
+            E(TAG, "broker silent past keep alive, reconnecting");
+            this->incTcpErr();
+            return this->close();
+        }
+
+        if (!writing && is_expired(this->_lastSentMillis, keepAliveMillis / 2))
+            return this->ping();
+
+        return ERR_OK;
+    }
+
+    // Walks the segments in place, then always hands them back so the pbuf pool never runs dry.
+    err_t Homer2MqttPublisher::onReceived(
+        struct tcp_pcb* const tcpPcb,
+        struct pbuf* const pBuf
+    ) noexcept {
+
+        this->_lastReceivedMillis = now();
+
+        err_t err = ERR_OK;
+        auto malformed = false;
+
+        // A packet may close the connection, nothing after it is of interest then.
+        for (auto q = pBuf; nullptr != q && nullptr != this->_tcpPcb && !malformed; q = q->next) {
+            const auto data = static_cast<const char*>(q->payload);
+            size_t offset = 0;
+            while (offset < q->len && nullptr != this->_tcpPcb) {
+                offset += this->_reader.feed(data + offset, q->len - offset);
+
+                if (this->_reader.invalid()) {
+                    malformed = true;
+                    break;
+                }
+
+                if (this->_reader.complete())
+                    err = this->onPacket();
+            }
+        }
+
+        if (nullptr != this->_tcpPcb)
+            tcp_recved(tcpPcb, pBuf->tot_len);
+        pbuf_free(pBuf);
+
+        if (malformed) {
+            E(TAG, "malformed packet from broker");
+            this->incTcpErr();
+            return this->close();
+        }
+
+        return err;
+    }
+
+    err_t Homer2MqttPublisher::onPacket() noexcept {
+
+        switch (this->_reader.type()) {
+            case mqtt::PacketType::CONNACK: {
+                if (this->_status != internal::MqttStatus::HANDSHAKE) {
+                    W(TAG, "unexpected connack, ignoring");
+                    return ERR_OK;
+                }
+
+                const auto code = this->_reader.returnCode();
+                if (0 != code) {
+                    E(TAG, "connection refused by broker, code: " << std::to_string(code));
+                    this->incTcpErr();
+                    return this->close();
+                }
+
+                I(TAG, "connected to broker");
+                this->_breaker.success();
+                this->transition(internal::MqttStatus::CONNECTED);
+
+                // Whatever was not acknowledged before the connection dropped is sent again.
+                return this->startSend();
+            }
+
+            case mqtt::PacketType::PUBACK: {
+                const auto id = this->_reader.packetId();
+                const auto index = static_cast<uint16_t>(id - this->_firstPacketId);
+                if (index < 32 && 0 != (this->_pendingSensors & (1u << index))) {
+                    this->_pendingSensors &= ~(1u << index);
+                    this->_lastProgressMillis = now();
+                }
+                else {
+                    D(4, TAG, "ack of unknown packet: " << id);
+                }
+
+                // Each reading takes a fresh range of ids, so that a late ack is not mistaken for
+                // one of the next reading. Id 0 is not allowed.
+                if (0 == this->_pendingSensors && this->_inFlight) {
+                    D(4, TAG, "reading acknowledged");
+                    const auto count = sensor_table().count;
+                    this->_inFlight = false;
+                    this->_firstPacketId = this->_firstPacketId + 2 * count > UINT16_MAX
+                                           ? 1
+                                           : static_cast<uint16_t>(this->_firstPacketId + count);
+                }
+
+                return ERR_OK;
+            }
+
+            case mqtt::PacketType::PINGRESP:
+                D(5, TAG, "pingresp");
+                return ERR_OK;
+
+            default:
+                W(TAG, "unexpected packet from broker: "
+                    << std::to_string(static_cast<uint8_t>(this->_reader.type())));
+                return ERR_OK;
+        }
+    }
+
+    err_t Homer2MqttPublisher::close() noexcept {
+
+        D(5, TAG, "tcp close");
+
+        // Qos 0 messages partly written are not sent again, nothing tells which ones made it.
+        if (0 == this->_qos && this->_sentOnce)
+            this->_pendingSensors = 0;
+
+        this->_inFlight = false;
+        this->_out.clear();
+        this->_written = 0;
+
+        if (this->_status == internal::MqttStatus::DISCONNECTED)
+            return ERR_OK;
+
+        // The broker was never reached on this address, try the next one the name resolved to.
+        if (this->_status == internal::MqttStatus::CONNECTING)
+            this->_resolver.failover();
+
+        this->transition(internal::MqttStatus::DISCONNECTED);
+
+        if (this->_tcpPcb == nullptr)
+            return ERR_OK;
+
+        auto pcb = this->_tcpPcb;
+        this->_tcpPcb = nullptr;
+
+        tcp_arg(pcb, nullptr);
+        tcp_poll(pcb, nullptr, 0);
+        tcp_sent(pcb, nullptr);
+        tcp_recv(pcb, nullptr);
+        tcp_err(pcb, nullptr);
+
+        if (ERR_OK != tcp_close(pcb)) {
+            E(TAG, "failed to close tcp connection, aborting");
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+
+        return ERR_OK;
+    }
+
+    void Homer2MqttPublisher::incTcpErr() noexcept {
+
+        this->_breaker.failure();
+    }
+
+}
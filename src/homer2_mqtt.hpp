@@ -0,0 +1,168 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <lwip/tcp.h>
+#include <lwip/ip_addr.h>
+
+#include "homer2_config.h"
+#include "homer2_sensor.hpp"
+#include "homer2_metric.hpp"
+#include "homer2_payload.hpp"
+#include "homer2_dns.hpp"
+#include "homer2_breaker.hpp"
+#include "homer2_mqtt_packet.hpp"
+
+namespace homer2 {
+
+    namespace internal {
+
+        // DISCONNECTED and CONNECTED are idle, every other state is left from lwIP callbacks.
+        enum class MqttStatus {
+            DISCONNECTED,
+            CONNECTING,
+            HANDSHAKE,
+            CONNECTED,
+        };
+
+    }
+
+    // Publishes every reading to an MQTT broker, one message per sensor on
+    // <prefix>/<device>/<sensor>, over a single connection kept open across readings.
+    //
+    // Only the latest reading is held: a reading arriving while the previous one is still being
+    // written, or with qos 1 acknowledged, is skipped. With qos 1 a reading not acknowledged is
+    // sent again, flagged as duplicate, once reconnected.
+    class Homer2MqttPublisher {
+    public:
+
+        Homer2MqttPublisher& operator=(const Homer2MqttPublisher& other) noexcept = delete;
+
+        Homer2MqttPublisher& operator=(Homer2MqttPublisher&& other) = delete;
+
+        Homer2MqttPublisher(Homer2MqttPublisher&& other) = delete;
+
+        Homer2MqttPublisher() = delete;
+
+        Homer2MqttPublisher(const Homer2MqttPublisher& other) noexcept = delete;
+
+
+        Homer2MqttPublisher(
+            const char* addr,
+            uint16_t port,
+            const char* topicPrefix,
+            const char* device,
+            const char* username,
+            const char* password,
+            uint8_t qos,
+            uint16_t keepAliveSeconds
+        );
+
+        ~Homer2MqttPublisher() noexcept;
+
+
+        void publish(
+            const Homer2SensorsData& data
+        );
+
+        void disconnect() noexcept;
+
+        [[nodiscard]]
+        uint64_t publishedMessages() const noexcept;
+
+        [[nodiscard]]
+        uint64_t skippedReadings() const noexcept;
+
+        [[nodiscard]]
+        BreakerState breakerState() const noexcept;
+
+    private:
+
+        void transition(
+            internal::MqttStatus status
+        ) noexcept;
+
+        void advance() noexcept;
+
+        [[nodiscard]]
+        bool open() noexcept;
+
+        [[nodiscard]]
+        bool connect() noexcept;
+
+        err_t handshake() noexcept;
+
+        [[nodiscard]]
+        bool render(
+            bool dup
+        ) noexcept;
+
+        err_t startSend() noexcept;
+
+        err_t ping() noexcept;
+
+        err_t flush() noexcept;
+
+        err_t onPoll() noexcept;
+
+        err_t onReceived(
+            struct tcp_pcb* tcpPcb,
+            struct pbuf* pBuf
+        ) noexcept;
+
+        err_t onPacket() noexcept;
+
+        err_t close() noexcept;
+
+        void incTcpErr() noexcept;
+
+        const char* _addr;
+        const uint16_t _port;
+        Homer2Resolver _resolver;
+        uint8_t _dnsFailures{0};
+        ip_addr_t _ip{.addr = IPADDR_ANY};
+        Homer2Breaker _breaker;
+
+        const uint8_t _qos;
+        const uint16_t _keepAliveSeconds;
+        const char* const _username;
+        const char* const _password;
+
+        std::array<char, 48> _clientIdBuffer{};
+        Homer2Payload _clientId;
+
+        // Holds <prefix>/<device>/, the sensor name is appended per message.
+        std::array<char, 96> _topicBuffer{};
+        Homer2Payload _topic;
+        size_t _topicPrefixSize{0};
+
+        struct tcp_pcb* _tcpPcb{nullptr};
+        std::atomic<internal::MqttStatus> _status{internal::MqttStatus::DISCONNECTED};
+        uint64_t _lastProgressMillis{0};
+        uint64_t _lastSentMillis{0};
+        uint64_t _lastReceivedMillis{0};
+
+        Homer2Reading _reading{};
+        uint64_t _readAtMillis{0};
+        uint64_t _lastCapturedMillis{0};
+
+        // Bit i is set while the message of the i-th sensor of the reading is not delivered yet.
+        uint32_t _pendingSensors{0};
+        // Written before, on this or an earlier connection.
+        bool _sentOnce{false};
+        // Written on this connection, now awaiting its acks.
+        bool _inFlight{false};
+        uint16_t _firstPacketId{1};
+
+        Homer2Payload _out;
+        size_t _written{0};
+        Homer2MqttReader _reader{};
+
+        uint64_t _publishedMessages{0};
+        uint64_t _skippedReadings{0};
+
+    };
+
+}
@@ -0,0 +1,221 @@
+#include <cstring>
+
+#include "homer2_mqtt_packet.hpp"
+
+namespace homer2::mqtt {
+
+    namespace {
+
+        constexpr uint8_t PROTOCOL_LEVEL = 4;
+
+        constexpr uint8_t FLAG_CLEAN_SESSION = 0x02;
+        constexpr uint8_t FLAG_PASSWORD = 0x40;
+        constexpr uint8_t FLAG_USERNAME = 0x80;
+
+        constexpr uint8_t FLAG_DUP = 0x08;
+
+        void append_fixed_header(
+            Homer2Payload& out,
+            const PacketType type,
+            const uint8_t flags,
+            size_t remaining
+        ) noexcept {
+            out.append(static_cast<char>((static_cast<uint8_t>(type) << 4) | flags));
+
+            do {
+                auto digit = static_cast<uint8_t>(remaining % 128);
+                remaining /= 128;
+                if (remaining > 0)
+                    digit |= 0x80;
+                out.append(static_cast<char>(digit));
+            } while (remaining > 0);
+        }
+
+        void append_u16(
+            Homer2Payload& out,
+            const uint16_t value
+        ) noexcept {
+            out.append(static_cast<char>(value >> 8))
+                .append(static_cast<char>(value & 0xff));
+        }
+
+        void append_string(
+            Homer2Payload& out,
+            const char* const value,
+            const size_t len
+        ) noexcept {
+            append_u16(out, static_cast<uint16_t>(len));
+            out.append(value, len);
+        }
+
+    }
+
+    void append_connect(
+        Homer2Payload& out,
+        const char* const clientId,
+        const char* const username,
+        const char* const password,
+        const uint16_t keepAliveSeconds
+    ) noexcept {
+
+        const auto clientIdLen = strlen(clientId);
+        const auto usernameLen = strlen(username);
+        const auto passwordLen = usernameLen > 0 ? strlen(password) : 0;
+
+        uint8_t flags = FLAG_CLEAN_SESSION;
+        size_t remaining = 10 + 2 + clientIdLen;
+        if (usernameLen > 0) {
+            flags |= FLAG_USERNAME;
+            remaining += 2 + usernameLen;
+        }
+        // A password without a username is not allowed by the protocol.
+        if (passwordLen > 0) {
+            flags |= FLAG_PASSWORD;
+            remaining += 2 + passwordLen;
+        }
+
+        append_fixed_header(out, PacketType::CONNECT, 0, remaining);
+        append_string(out, "MQTT", 4);
+        out.append(static_cast<char>(PROTOCOL_LEVEL))
+            .append(static_cast<char>(flags));
+        append_u16(out, keepAliveSeconds);
+        append_string(out, clientId, clientIdLen);
+        if (usernameLen > 0)
+            append_string(out, username, usernameLen);
+        if (passwordLen > 0)
+            append_string(out, password, passwordLen);
+    }
+
+    void append_publish(
+        Homer2Payload& out,
+        const char* const topic,
+        const char* const payload,
+        const size_t payloadLen,
+        const uint8_t qos,
+        const uint16_t packetId,
+        const bool dup
+    ) noexcept {
+
+        const auto topicLen = strlen(topic);
+        const auto remaining = 2 + topicLen + (qos > 0 ? 2 : 0) + payloadLen;
+
+        const auto flags = static_cast<uint8_t>((qos << 1) | (dup && qos > 0 ? FLAG_DUP : 0));
+
+        append_fixed_header(out, PacketType::PUBLISH, flags, remaining);
+        append_string(out, topic, topicLen);
+        if (qos > 0)
+            append_u16(out, packetId);
+        out.append(payload, payloadLen);
+    }
+
+    void append_pingreq(
+        Homer2Payload& out
+    ) noexcept {
+
+        append_fixed_header(out, PacketType::PINGREQ, 0, 0);
+    }
+
+    void append_disconnect(
+        Homer2Payload& out
+    ) noexcept {
+
+        append_fixed_header(out, PacketType::DISCONNECT, 0, 0);
+    }
+
+}
+
+namespace homer2 {
+
+    void Homer2MqttReader::reset() noexcept {
+
+        this->_state = State::FIXED_HEADER;
+        this->_header = 0;
+        this->_remaining = 0;
+        this->_multiplier = 1;
+        this->_bodyLen = 0;
+    }
+
+    size_t Homer2MqttReader::feed(
+        const char* const data,
+        const size_t len
+    ) noexcept {
+
+        if (this->_state == State::COMPLETE)
+            this->reset();
+
+        size_t i = 0;
+        while (i < len && this->_state != State::COMPLETE && this->_state != State::INVALID) {
+
+            const auto c = static_cast<uint8_t>(data[i]);
+
+            switch (this->_state) {
+                case State::FIXED_HEADER:
+                    this->_header = c;
+                    this->_state = State::REMAINING_LENGTH;
+                    i++;
+                    break;
+
+                case State::REMAINING_LENGTH:
+                    this->_remaining += (c & 0x7f) * this->_multiplier;
+                    this->_multiplier *= 128;
+                    i++;
+                    if (0 == (c & 0x80))
+                        this->_state = 0 == this->_remaining ? State::COMPLETE : State::BODY;
+                    else if (this->_multiplier > 128 * 128 * 128)
+                        this->_state = State::INVALID;
+                    break;
+
+                case State::BODY: {
+                    // Only the first bytes are of interest, the rest is skipped in one go.
+                    const auto left = len - i < this->_remaining ? len - i : this->_remaining;
+                    for (size_t j = 0; j < left && this->_bodyLen < sizeof(this->_body); j++)
+                        this->_body[this->_bodyLen++] = data[i + j];
+                    this->_remaining -= static_cast<uint32_t>(left);
+                    i += left;
+                    if (0 == this->_remaining)
+                        this->_state = State::COMPLETE;
+                }
+                    break;
+
+                case State::COMPLETE:
+                case State::INVALID:
+                    break;
+            }
+        }
+
+        return i;
+    }
+
+    [[nodiscard]]
+    bool Homer2MqttReader::complete() const noexcept {
+
+        return this->_state == State::COMPLETE;
+    }
+
+    [[nodiscard]]
+    bool Homer2MqttReader::invalid() const noexcept {
+
+        return this->_state == State::INVALID;
+    }
+
+    [[nodiscard]]
+    mqtt::PacketType Homer2MqttReader::type() const noexcept {
+
+        return static_cast<mqtt::PacketType>(this->_header >> 4);
+    }
+
+    [[nodiscard]]
+    uint8_t Homer2MqttReader::returnCode() const noexcept {
+
+        return this->_bodyLen >= 2 ? this->_body[1] : 0xff;
+    }
+
+    [[nodiscard]]
+    uint16_t Homer2MqttReader::packetId() const noexcept {
+
+        return this->_bodyLen >= 2
+               ? static_cast<uint16_t>((this->_body[0] << 8) | this->_body[1])
+               : 0;
+    }
+
+}
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "homer2_payload.hpp"
+
+// MQTT 3.1.1 packets, only those a publisher sends and receives. Free of any Pico or lwIP
+// dependency, so that it builds and runs against a broker on the host as well.
+namespace homer2::mqtt {
+
+    enum class PacketType : uint8_t {
+        CONNECT = 1,
+        CONNACK = 2,
+        PUBLISH = 3,
+        PUBACK = 4,
+        PINGREQ = 12,
+        PINGRESP = 13,
+        DISCONNECT = 14,
+    };
+
+    // A clean session, the broker keeps nothing for the client between connections. Empty
+    // username or password are left out.
+    void append_connect(
+        Homer2Payload& out,
+        const char* clientId,
+        const char* username,
+        const char* password,
+        uint16_t keepAliveSeconds
+    ) noexcept;
+
+    // The packet id is only written for qos 1.
+    void append_publish(
+        Homer2Payload& out,
+        const char* topic,
+        const char* payload,
+        size_t payloadLen,
+        uint8_t qos,
+        uint16_t packetId,
+        bool dup
+    ) noexcept;
+
+    void append_pingreq(
+        Homer2Payload& out
+    ) noexcept;
+
+    void append_disconnect(
+        Homer2Payload& out
+    ) noexcept;
+
+}
+
+namespace homer2 {
+
+    // Incremental parser of the packets a broker sends to a publisher, fed the received segments
+    // in place. Of each packet only the type and the first bytes of the variable header are kept.
+    class Homer2MqttReader {
+    public:
+
+        Homer2MqttReader& operator=(const Homer2MqttReader& other) noexcept = delete;
+
+        Homer2MqttReader& operator=(Homer2MqttReader&& other) = delete;
+
+        Homer2MqttReader(Homer2MqttReader&& other) = delete;
+
+        Homer2MqttReader(const Homer2MqttReader& other) noexcept = delete;
+
+
+        Homer2MqttReader() noexcept = default;
+
+
+        void reset() noexcept;
+
+        // Consumes up to the end of the next packet, returns the number of bytes consumed. Once
+        // complete() the packet is read and the next call to feed starts a new one.
+        size_t feed(
+            const char* data,
+            size_t len
+        ) noexcept;
+
+
+        [[nodiscard]]
+        bool complete() const noexcept;
+
+        [[nodiscard]]
+        bool invalid() const noexcept;
+
+        [[nodiscard]]
+        mqtt::PacketType type() const noexcept;
+
+        // The return code of a CONNACK.
+        [[nodiscard]]
+        uint8_t returnCode() const noexcept;
+
+        // The packet id of a PUBACK.
+        [[nodiscard]]
+        uint16_t packetId() const noexcept;
+
+    private:
+
+        enum class State : uint8_t {
+            FIXED_HEADER,
+            REMAINING_LENGTH,
+            BODY,
+            COMPLETE,
+            INVALID,
+        };
+
+        State _state{State::FIXED_HEADER};
+
+        uint8_t _header{0};
+        uint32_t _remaining{0};
+        uint32_t _multiplier{1};
+        uint8_t _body[2]{};
+        uint32_t _bodyLen{0};
+
+    };
+
+}
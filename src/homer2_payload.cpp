@@ -0,0 +1,211 @@
+#include <cstring>
+#include <cmath>
+
+#include "homer2_payload.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        constexpr uint64_t POW10[] = {
+            1ULL,
+            10ULL,
+            100ULL,
+            1'000ULL,
+            10'000ULL,
+            100'000ULL,
+            1'000'000ULL,
+        };
+
+        constexpr uint8_t MAX_DECIMALS = sizeof(POW10) / sizeof(POW10[0]) - 1;
+
+        // Scaled values are rounded to an integer, which they must fit with room to spare.
+        constexpr double MAX_SCALED = 1e18;
+
+        // A float carries about 7 significant digits, all of which are kept in the mantissa.
+        constexpr uint8_t MANTISSA_DECIMALS = 6;
+
+        // d.dddddde[-]x, understood by every format a float is written in.
+        Homer2Payload& append_exponent(
+            Homer2Payload& payload,
+            const float value
+        ) noexcept {
+
+            auto exponent = static_cast<int64_t>(std::floor(std::log10(std::fabs(static_cast<double>(value)))));
+            auto mantissa = static_cast<double>(value) / std::pow(10.0, static_cast<double>(exponent));
+
+            // Rounded up to the next power of ten.
+            if (std::fabs(mantissa) + 0.5 / static_cast<double>(POW10[MANTISSA_DECIMALS]) >= 10.0) {
+                mantissa /= 10.0;
+                exponent++;
+            }
+
+            return payload
+                .appendFloat(static_cast<float>(mantissa), MANTISSA_DECIMALS)
+                .append('e')
+                .appendSigned(exponent);
+        }
+
+    }
+
+    Homer2Payload::Homer2Payload(
+        char* const buffer,
+        const size_t capacity
+    ) noexcept:
+        _buffer{buffer},
+        _capacity{capacity} {
+    }
+
+
+    Homer2Payload& Homer2Payload::append(
+        const char value
+    ) noexcept {
+
+        if (this->_size >= this->_capacity) {
+            this->_overflowed = true;
+            return *this;
+        }
+
+        this->_buffer[this->_size++] = value;
+        return *this;
+    }
+
+    Homer2Payload& Homer2Payload::append(
+        const char* const value
+    ) noexcept {
+
+        return this->append(value, strlen(value));
+    }
+
+    Homer2Payload& Homer2Payload::append(
+        const char* const value,
+        const size_t len
+    ) noexcept {
+
+        if (this->_size + len > this->_capacity) {
+            this->_overflowed = true;
+            return *this;
+        }
+
+        memcpy(this->_buffer + this->_size, value, len);
+        this->_size += len;
+        return *this;
+    }
+
+    Homer2Payload& Homer2Payload::appendUnsigned(
+        uint64_t value
+    ) noexcept {
+
+        char digits[20];
+        size_t len = 0;
+
+        do {
+            digits[sizeof(digits) - 1 - len++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value > 0);
+
+        return this->append(digits + sizeof(digits) - len, len);
+    }
+
+    Homer2Payload& Homer2Payload::appendSigned(
+        const int64_t value
+    ) noexcept {
+
+        if (value >= 0)
+            return this->appendUnsigned(static_cast<uint64_t>(value));
+
+        this->append('-');
+        return this->appendUnsigned(static_cast<uint64_t>(-(value + 1)) + 1);
+    }
+
+    Homer2Payload& Homer2Payload::appendFloat(
+        const float value,
+        uint8_t decimals
+    ) noexcept {
+
+        // Never reached through metric_value(), which leaves non-finite values out.
+        if (!std::isfinite(value))
+            return this->append('0');
+
+        if (decimals > MAX_DECIMALS)
+            decimals = MAX_DECIMALS;
+
+        const auto scale = POW10[decimals];
+        const auto magnitude = std::fabs(static_cast<double>(value)) * static_cast<double>(scale);
+
+        if (magnitude >= MAX_SCALED)
+            return append_exponent(*this, value);
+
+        const auto scaled = std::llround(magnitude);
+        const auto integral = static_cast<uint64_t>(scaled) / scale;
+        auto fraction = static_cast<uint64_t>(scaled) % scale;
+
+        if (value < 0 && scaled != 0)
+            this->append('-');
+
+        this->appendUnsigned(integral);
+
+        if (0 == fraction)
+            return *this;
+
+        // Trailing zeros carry no information, drop them.
+        while (fraction % 10 == 0) {
+            fraction /= 10;
+            decimals--;
+        }
+
+        this->append('.');
+        for (auto i = static_cast<uint8_t>(decimals - 1); i > 0 && fraction < POW10[i]; i--)
+            this->append('0');
+
+        return this->appendUnsigned(fraction);
+    }
+
+
+    void Homer2Payload::truncate(
+        const size_t size
+    ) noexcept {
+
+        if (size < this->_size)
+            this->_size = size;
+
+        this->_overflowed = false;
+    }
+
+    void Homer2Payload::clear() noexcept {
+
+        this->truncate(0);
+    }
+
+
+    [[nodiscard]]
+    const char* Homer2Payload::data() const noexcept {
+
+        return this->_buffer;
+    }
+
+    [[nodiscard]]
+    size_t Homer2Payload::size() const noexcept {
+
+        return this->_size;
+    }
+
+    [[nodiscard]]
+    size_t Homer2Payload::capacity() const noexcept {
+
+        return this->_capacity;
+    }
+
+    [[nodiscard]]
+    bool Homer2Payload::overflowed() const noexcept {
+
+        return this->_overflowed;
+    }
+
+    [[nodiscard]]
+    char Homer2Payload::back() const noexcept {
+
+        return this->_size > 0 ? this->_buffer[this->_size - 1] : '\0';
+    }
+
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+namespace homer2 {
+
+    class Homer2Payload {
+    public:
+
+        Homer2Payload& operator=(const Homer2Payload& other) noexcept = delete;
+
+        Homer2Payload& operator=(Homer2Payload&& other) = delete;
+
+        Homer2Payload(Homer2Payload&& other) = delete;
+
+        Homer2Payload() = delete;
+
+        Homer2Payload(const Homer2Payload& other) noexcept = delete;
+
+
+        Homer2Payload(
+            char* buffer,
+            size_t capacity
+        ) noexcept;
+
+
+        Homer2Payload& append(
+            char value
+        ) noexcept;
+
+        Homer2Payload& append(
+            const char* value
+        ) noexcept;
+
+        Homer2Payload& append(
+            const char* value,
+            size_t len
+        ) noexcept;
+
+        Homer2Payload& appendUnsigned(
+            uint64_t value
+        ) noexcept;
+
+        Homer2Payload& appendSigned(
+            int64_t value
+        ) noexcept;
+
+        // Fixed point with at most the given decimals, values too large for it in exponent notation.
+        // Non-finite values have no representation and are to be skipped by the caller.
+        Homer2Payload& appendFloat(
+            float value,
+            uint8_t decimals
+        ) noexcept;
+
+
+        void truncate(
+            size_t size
+        ) noexcept;
+
+        void clear() noexcept;
+
+
+        [[nodiscard]]
+        const char* data() const noexcept;
+
+        [[nodiscard]]
+        size_t size() const noexcept;
+
+        [[nodiscard]]
+        size_t capacity() const noexcept;
+
+        [[nodiscard]]
+        bool overflowed() const noexcept;
+
+        [[nodiscard]]
+        char back() const noexcept;
+
+    private:
+
+        char* const _buffer;
+        const size_t _capacity;
+        size_t _size{0};
+        bool _overflowed{false};
+
+    };
+
+}
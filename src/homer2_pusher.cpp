@@ -1,9 +1,14 @@
+#include <algorithm>
+#include <limits>
+
 #include <pico/cyw43_arch.h>
-#include <lwip/dns.h>
 
 #include <homer2_logging.hpp>
 #include <homer2_util.hpp>
 
+#include "homer2_init.hpp"
+#include "homer2_clock.hpp"
+#include "homer2_deflate.hpp"
 #include "homer2_pusher.hpp"
 
 namespace homer2 {
@@ -12,634 +17,525 @@ namespace homer2 {
 
         const char* const TAG = "Pusher";
 
-        const char* translate(
-            const err_t err
-        ) {
-            switch (err) {
-                case ERR_OK:
-                    return "tcp - no error";
+        // Statically allocated so that serializing a push never touches the heap.
+        std::array<char, HOMER2_VICTORIA_MAX_PAYLOAD_BYTES> body_buffer{};
+        std::array<
+            char,
+            HOMER2_VICTORIA_GZIP ? gzip_max_compressed_length(HOMER2_VICTORIA_MAX_PAYLOAD_BYTES) : 0
+        > gzip_buffer{};
 
-                case ERR_MEM:
-                    return "tcp - out of memory";
+        static_assert(HOMER2_VICTORIA_MAX_ENDPOINTS <= 32, "writers mask too narrow");
 
-                case ERR_BUF:
-                    return "tcp - buffer error";
+    }
 
-                case ERR_TIMEOUT:
-                    return "tcp - timeout";
+}
 
-                case ERR_RTE:
-                    return "tcp - routing problem";
+namespace homer2 {
 
-                case ERR_INPROGRESS:
-                    return "tcp - in progress";
+    Homer2Pusher::Homer2Pusher(
+        const std::vector<net::VictoriaEndpoint>& endpoints,
+        const PushTransport transport,
+        const uint64_t pushFrequencyMillis,
+        const bool keepAlive,
+        const bool gzip,
+        const size_t batchSize,
+        const uint64_t heartbeatMillis,
+        const size_t maxPayloadBytes,
+        std::unique_ptr<Homer2Encoder> encoder,
+        const uint64_t pushStartAfterTimestamp
+    ) : _pushStartAfterTimestamp{pushStartAfterTimestamp},
+        _batchSize{batchSize > 0 ? batchSize : 1},
+        _gzip{gzip},
+        _encoder{std::move(encoder)},
+        _deadband{heartbeatMillis},
+        _log{flash_log_bytes()},
+        _body{
+            body_buffer.data(),
+            maxPayloadBytes < body_buffer.size() ? maxPayloadBytes : body_buffer.size()
+        },
+        _compressed{gzip_buffer.data(), gzip_buffer.size()} {
+
+        if (nullptr == this->_encoder)
+            throw std::logic_error{"encoder not set"};
+
+        if (endpoints.empty() || endpoints.size() > HOMER2_VICTORIA_MAX_ENDPOINTS)
+            throw std::logic_error{"invalid number of endpoints"};
+
+        if (gzip && this->_compressed.capacity() < gzip_max_compressed_length(this->_body.capacity()))
+            throw std::logic_error{"gzip buffer not allocated"};
+
+        this->_log.init();
+
+        // Allocated once, the endpoints' addresses are handed to lwIP callbacks.
+        this->_lanes.resize(endpoints.size());
+        this->_endpoints.reserve(endpoints.size());
+        for (size_t i = 0; i < endpoints.size(); i++)
+            this->_endpoints.push_back(std::make_unique<Homer2Endpoint>(
+                *this,
+                i,
+                endpoints[i].addr,
+                endpoints[i].port,
+                transport,
+                pushFrequencyMillis,
+                keepAlive,
+                gzip,
+                *this->_encoder,
+                pushStartAfterTimestamp
+            ));
+    }
 
-                case ERR_VAL:
-                    return "tcp - illegal value";
+    void Homer2Pusher::push(
+        const Homer2SensorsData& data,
+        const uint64_t urgentMask
+    ) {
+        D(4, TAG, "pushing data...");
 
-                case ERR_WOULDBLOCK:
-                    return "tcp - operation would block";
+        cyw43_arch_lwip_begin();
 
-                case ERR_USE:
-                    return "tcp - address in use";
+        if (now() > this->_pushStartAfterTimestamp && !data.empty()) {
+            // Stamped with when the values were read, not when they are pushed. Cached values
+            // captured before the previous sample are not reported again as if they were fresh.
+            const auto capturedAt = data.capturedAtMillis();
+            auto reading = make_reading(data);
+            this->_deadband.filter(
+                reading,
+                captured_after(data, this->_lastCapturedMillis),
+                urgentMask,
+                capturedAt
+            );
+
+            if (0 == reading.mask) {
+                D(4, TAG, "no fresh value moved past its deadband, skipping sample");
+            }
+            else {
+                // Dropped only when flash can not take the oldest sample, lowest priority first.
+                if (this->_queue.size() == this->_queue.capacity())
+                    this->spillOldest();
 
-                case ERR_ALREADY:
-                    return "tcp - already connecting";
+                this->_queue.push(capturedAt, reading);
 
-                case ERR_ISCONN:
-                    return "tcp - connection already established";
+                if (0 != (reading.mask & urgentMask)) {
+                    D(2, TAG, "threshold crossed, pushing right away");
+                    for (const auto& endpoint: this->_endpoints)
+                        endpoint->expedite();
+                }
+            }
 
-                case ERR_CONN:
-                    return "tcp - not connected";
+            this->_lastCapturedMillis = capturedAt;
+        }
 
-                case ERR_IF:
-                    return "tcp - low-level netif error";
+        this->advance();
 
-                case ERR_ABRT:
-                    return "tcp - connection aborted";
+        cyw43_arch_lwip_end();
+    }
 
-                case ERR_RST:
-                    return "tcp - connection reset";
+    // Everything shared with the lwIP callbacks is only touched while holding the lwIP lock,
+    // the callbacks never run concurrently with advance().
+    void Homer2Pusher::poll() noexcept {
 
-                case ERR_CLSD:
-                    return "tcp - connection closed";
+        cyw43_arch_lwip_begin();
+        this->advance();
+        cyw43_arch_lwip_end();
+    }
 
-                case ERR_ARG:
-                    return "tcp - illegal argument";
+    [[nodiscard]]
+    uint64_t Homer2Pusher::nextDeadlineMillis() const noexcept {
 
-                default:
-                    return "tcp - unknown error";
-            }
-        }
+        auto deadline = std::numeric_limits<uint64_t>::max();
 
-        std::string header(
-            const char* addr,
-            const uint16_t port
-        ) {
-
-            std::string buffer{};
-            buffer += "POST /api/put HTTP/1.1\nHost: ";
-            buffer += addr;
-            buffer += ':';
-            buffer += std::to_string(port);
-            buffer += "\nUser-Agent: homer2/";
-            buffer += std::to_string(HOMER2_VERSION_MAJOR);
-            buffer += '.';
-            buffer += std::to_string(HOMER2_VERSION_MINOR);
-            buffer +=
-                "\nAccept: */*\nContent-Type: application/json\nContent-Length: ";
-
-            return std::move(buffer);
-        }
+        cyw43_arch_lwip_begin();
+        for (const auto& endpoint: this->_endpoints)
+            deadline = std::min(deadline, endpoint->nextDeadlineMillis());
+        cyw43_arch_lwip_end();
 
-        bool addr_is_already_resolved(
-            const char* addr
-        ) {
-            if (strlen(addr) == 0)
-                return false;
+        return deadline;
+    }
 
-            ip_addr_t ip{};
-            return ip4addr_aton(addr, &ip) == 1;
-        }
+    void Homer2Pusher::recordHandoffs(
+        const uint64_t pushed,
+        const uint64_t dropped
+    ) noexcept {
 
+        cyw43_arch_lwip_begin();
+        this->_telemetry.coreHandoffs = pushed;
+        this->_telemetry.coreHandoffDrops = dropped;
+        cyw43_arch_lwip_end();
     }
 
-}
+    [[nodiscard]]
+    uint32_t Homer2Pusher::sentDatagrams() const noexcept {
 
-namespace homer2 {
+        uint32_t sum = 0;
+        for (const auto& endpoint: this->_endpoints)
+            sum += endpoint->sentDatagrams();
+        return sum;
+    }
 
-    Homer2Pusher::Homer2Pusher(
-        const char* addr,
-        const uint16_t port,
-        uint64_t pushFrequencyMillis,
-        uint64_t pushStartAfterTimestamp
-    ) : _addr{addr},
-        _port{port},
-        _pushFrequencyMillis{pushFrequencyMillis},
-        _header{header(addr, port)},
-        _pushStartAfterTimestamp{pushStartAfterTimestamp} {
+    [[nodiscard]]
+    uint64_t Homer2Pusher::sentBytes() const noexcept {
+
+        uint64_t sum = 0;
+        for (const auto& endpoint: this->_endpoints)
+            sum += endpoint->sentBytes();
+        return sum;
     }
 
-    void Homer2Pusher::push(
-        const Homer2SensorsData& data
-    ) {
-        D(4, TAG, "pushing data...");
+    [[nodiscard]]
+    uint64_t Homer2Pusher::deliveredSamples() const noexcept {
 
-        if (this->_tcpErrors >= net::tcp_max_tries()) {
-            E(TAG, "tcp max tries exhausted");
-            this->close();
-            throw std::runtime_error{"tcp max tries exhausted"};
-        }
+        uint64_t sum = 0;
+        for (const auto& endpoint: this->_endpoints)
+            sum += endpoint->deliveredSamples();
+        return sum;
+    }
 
-        if (this->_dnsErrors >= net::dns_max_tries()) {
-            E(TAG, "dns max tries exhausted");
-            this->close();
-            throw std::runtime_error{"dns max tries exhausted"};
-        }
+    [[nodiscard]]
+    uint64_t Homer2Pusher::rejectedSamples() const noexcept {
 
-        if (this->_connection != internal::ConnectionStatus::DISCONNECTED) {
-            D(4, TAG, "connection in progress");
-            return;
-        }
+        uint64_t sum = 0;
+        for (const auto& endpoint: this->_endpoints)
+            sum += endpoint->rejectedSamples();
+        return sum;
+    }
 
-        if (!is_expired(this->_lastPushMillis, this->_pushFrequencyMillis)) {
-            D(4, TAG, "next push time not arrived yet, ignoring cycle, remaining: "
-                << remaining(this->_lastPushMillis, this->_pushFrequencyMillis)
-                << "ms");
-            return;
-        }
+    void Homer2Pusher::advance() noexcept {
 
-        if (!this->resolve())
-            return;
+        this->_log.sync();
 
-        if (now() <= this->_pushStartAfterTimestamp) {
-            I(TAG, "still in warmup period, not writing to server. Left: "
-                << (this->_pushStartAfterTimestamp - now()) << "ms");
-            return;
-        }
+        for (const auto& endpoint: this->_endpoints)
+            endpoint->advance();
+    }
 
-        this->fillBuffer(data);
+    [[nodiscard]]
+    size_t Homer2Pusher::pending(
+        const size_t lane
+    ) const noexcept {
 
-        this->tryPush();
+        return this->_queue.size() - this->_queue.indexOf(this->_lanes[lane].cursor);
     }
 
-    void Homer2Pusher::fillBuffer(
-        const Homer2SensorsData& data
-    ) noexcept {
+    [[nodiscard]]
+    size_t Homer2Pusher::stored(
+        const size_t lane
+    ) const noexcept {
 
-        D(5, TAG, "filling data");
+        return 0 == lane ? this->_log.size() : 0;
+    }
 
-        this->_body = "[";
+    [[nodiscard]]
+    bool Homer2Pusher::ready(
+        const bool replaying
+    ) const noexcept {
 
-        if (data.sgp40Data().has_value()) {
-            this->_body +=
-                R"({"metric":"voc_index","tags":{"agent":"homer2","sensor":"sgp40"},"value":)";
-            this->_body += std::to_string(data.sgp40Data()->getVocIndex());
-            this->_body += "},";
-        }
+        return replaying || !this->_encoder->requiresTimestamps() || clock::is_synced();
+    }
 
-        if (data.sunriseData().has_value()) {
-            this->_body +=
-                R"({"metric":"co2","tags":{"agent":"homer2","sensor":"sunrise"},"value":)";
-            this->_body += std::to_string(data.sunriseData()->getCo2Ppm());
-            this->_body += "},";
-        }
+    [[nodiscard]]
+    size_t Homer2Pusher::inFlight(
+        const size_t lane
+    ) const noexcept {
 
-        if (data.bmp3xxData().has_value()) {
-            this->_body +=
-                R"({"metric":"pressure","tags":{"agent":"homer2","sensor":"bmp3xx"},"value":)";
-            this->_body += std::to_string(data.bmp3xxData()->getPressureHPa());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"temperature","tags":{"agent":"homer2","sensor":"bmp3xx"},"value":)";
-            this->_body += std::to_string(data.bmp3xxData()->getTemperatureCelsius());
-            this->_body += "},";
-        }
+        return this->_lanes[lane].inFlight;
+    }
 
-        if (data.bme68xData().has_value()) {
-            this->_body +=
-                R"({"metric":"pressure","tags":{"agent":"homer2","sensor":"bme68x"},"value":)";
-            this->_body += std::to_string(data.bme68xData()->getPressureHPa());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"temperature","tags":{"agent":"homer2","sensor":"bme68x"},"value":)";
-            this->_body += std::to_string(data.bme68xData()->getTemperatureCelsius());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"humidity","tags":{"agent":"homer2","sensor":"bme68x"},"value":)";
-            this->_body += std::to_string(data.bme68xData()->getRelativeHumidityPercent());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"gas_resistance","tags":{"agent":"homer2","sensor":"bme68x"},"value":)";
-            this->_body += std::to_string(data.bme68xData()->getGasResistanceOhms());
-            this->_body += "},";
-        }
+    [[nodiscard]]
+    size_t Homer2Pusher::fill(
+        const size_t lane,
+        const bool replaying
+    ) noexcept {
 
-        if (data.sht4xData().has_value()) {
-            this->_body +=
-                R"({"metric":"temperature","tags":{"agent":"homer2","sensor":"sht4x"},"value":)";
-            this->_body += std::to_string(data.sht4xData()->getTemperatureCelsius());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"humidity","tags":{"agent":"homer2","sensor":"sht4x"},"value":)";
-            this->_body += std::to_string(data.sht4xData()->getRelativeHumidityPercent());
-            this->_body += "},";
+        D(5, TAG, "filling data, queued samples: " << this->_queue.size()
+            << ", stored samples: " << this->_log.size());
+
+        if (!this->ready(replaying)) {
+            D(3, TAG, "clock not synced yet, holding samples: " << this->_queue.size());
+            return 0;
         }
 
-        if (data.pmsx00xData().has_value()) {
-            this->_body +=
-                R"({"metric":"pm1_0","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getPm10Env());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"pm2_5","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getPm25Env());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"pm10_0","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getPm100Env());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc0_3","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles03());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc0_5","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles05());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc1_0","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles10());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc2_5","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles25());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc5_0","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles50());
-            this->_body += "},";
-            this->_body +=
-                R"({"metric":"ptc10_0","tags":{"agent":"homer2","sensor":"pmsx00x","cat":"env"},"value":)";
-            this->_body += std::to_string(data.pmsx00xData()->getParticles100());
-            this->_body += "},";
+        // Without a wall clock the samples can not be told apart on the server, only the latest
+        // one is sent and stamped on arrival.
+        if (!replaying && !clock::is_synced() && this->_queue.size() > 1) {
+            D(3, TAG, "clock not synced yet, dropping older samples: " << (this->_queue.size() - 1));
+            this->_queue.keepLatest();
         }
 
-        if (this->_body.back() == ',')
-            this->_body.pop_back();
+        auto& l = this->_lanes[lane];
+        const auto first = replaying ? 0 : this->_queue.indexOf(l.cursor);
 
-        this->_body += ']';
+        if (!replaying && first == this->_queue.size())
+            return 0;
 
-        D(5, TAG, "data filled, len: " << this->_body.size());
-    }
+        const auto start = replaying ? 0 : this->_queue[first].sequence;
 
-    void Homer2Pusher::tryPush() noexcept {
+        // Set first, dropping samples that do not fit depends on it.
+        l.replaying = replaying;
 
-        if (!this->open())
-            return;
-
-        if (!this->connect())
-            return;
+        size_t count;
+        if (!replaying && this->_payloadCached && this->_payloadStart == start) {
+            D(5, TAG, "payload already holds the batch, samples: " << this->_payloadCount);
+            count = this->_payloadCount;
+        }
+        else {
+            if (0 != (this->_writers & ~(1UL << lane))) {
+                D(4, TAG, "payload still being written for another endpoint, deferring");
+                return 0;
+            }
 
-        if (!this->write())
-            return;
-    }
+            count = this->serialize(lane, first, replaying);
 
-    [[nodiscard]]
-    bool Homer2Pusher::resolve() noexcept {
+            this->_payloadCached = !replaying && count > 0;
+            this->_payloadStart = start;
+            this->_payloadEnd = replaying || 0 == count ? 0 : this->sequenceAfter(first, count);
+            this->_payloadCount = count;
 
-        if (this->_ip.addr != IPADDR_ANY && this->_ip.addr != IPADDR_NONE) {
-            D(5, TAG, "previously resolved: " << this->ipAddr());
-            return true;
+            if (0 == count)
+                return 0;
         }
 
-        I(TAG, "resolving: " << this->_addr);
-        if (addr_is_already_resolved(this->_addr))
-            this->resolve_ip();
-        else
-            this->resolve_addr();
+        l.end = this->_payloadEnd;
+        l.inFlight = count;
+        this->_writers |= 1UL << lane;
 
-        return false;
+        return count;
     }
 
-    void Homer2Pusher::resolve_addr() noexcept {
+    [[nodiscard]]
+    size_t Homer2Pusher::serialize(
+        const size_t lane,
+        const size_t first,
+        const bool replaying
+    ) noexcept {
 
-        D(4, TAG, "address is domain, resolving: " << this->_addr);
+        const auto available = replaying ? this->_log.size() : this->_queue.size() - first;
 
-        const auto start = now();
+        if (0 == available)
+            return 0;
 
-        cyw43_arch_lwip_begin();
-        const err_t lwip_err = dns_gethostbyname(
-            this->_addr,
-            &this->_ip,
-            [](
-                const char* const name,
-                const ip_addr_t* const ip_addr,
-                void* const arg
-            ) {
-                D(4, TAG, "on resolved: " << name);
-                auto that = static_cast<Homer2Pusher*>(arg);
-                if (ip_addr) {
-                    that->_ip.addr = ip_addr->addr;
-                    that->resetDnsErr();
-                }
-                else {
-                    E(TAG, "could not resolve");
-                    that->_ip.addr = IPADDR_NONE;
-                    that->incDnsErr();
-                }
-            },
-            this
-        );
-        cyw43_arch_lwip_end();
+        this->_body.clear();
+        this->_encoder->begin(this->_body);
 
-        switch (lwip_err) {
-            case ERR_OK: {
-                I(TAG, "resolved in "
-                    << std::to_string(now() - start) << "ms: "
-                    << this->_addr << " => " << this->ipAddr());
-                this->resetDnsErr();
-            }
-                break;
-
-            case ERR_ARG: {
-                E(TAG, "invalid domain: " << this->_addr);
-                this->incDnsErr();
-            }
-                break;
-
-            case ERR_INPROGRESS: {
-                D(4, TAG, "dns resolver in progress");
+        size_t count = 0;
+        for (; count < available && count < this->_batchSize; count++) {
 
-                while (IPADDR_ANY == this->_ip.addr)
-                    sleep_ms(1000);
+            const auto mark = this->_body.size();
 
-                if (IPADDR_NONE == this->_ip.addr)
-                    E(TAG, "failed to resolve address: " << this->_addr);
-                else
-                    I(TAG, "resolved in "
-                        << std::to_string(now() - start) << "ms: "
-                        << this->_addr << " => " << this->ipAddr());
+            bool appended;
+            if (replaying) {
+                const auto& record = this->_log[count];
+                appended = this->_encoder->append(this->_body, record.reading, record.timestampMillis);
             }
-                break;
-
-            default: {
-                E(TAG, "unknown dns resolver error: " << std::to_string(lwip_err));
-                this->incDnsErr();
+            else {
+                const auto& sample = this->_queue[first + count];
+                appended = this->_encoder->append(
+                    this->_body,
+                    sample.reading,
+                    clock::epoch_millis(sample.capturedAtMillis)
+                );
             }
+
+            if (!appended ||
+                this->_body.overflowed() ||
+                this->_body.size() + this->_encoder->trailerSize() > this->_body.capacity()) {
+                D(4, TAG, "payload size limit reached, deferring remaining samples");
+                this->_body.truncate(mark);
                 break;
+            }
         }
-    }
 
-    void Homer2Pusher::resolve_ip() noexcept {
-
-        D(4, TAG, "address is ip, parsing: " << this->_addr);
-
-        ip_addr_t already{};
-        auto ok = ipaddr_aton(this->_addr, &already);
-
-        if (ok == 0) {
-            E(TAG, "bad ip: " << this->_addr);
-            return;
+        if (0 == count) {
+            E(TAG, "sample does not fit into payload buffer, dropping it");
+            this->skip(lane, replaying ? 0 : this->sequenceAfter(first, 1), 1);
+            this->_telemetry.droppedBatches++;
+            return 0;
         }
 
-        this->_ip.addr = already.addr;
-    }
+        // Stored samples are replayed as they were, the telemetry goes with the current ones.
+        if (!replaying)
+            this->appendTelemetry();
 
-    [[nodiscard]]
-    bool Homer2Pusher::open() noexcept {
+        this->_encoder->end(this->_body);
 
-        D(5, TAG, "opening tcp");
-
-        this->_connection = internal::ConnectionStatus::CONNECTING;
-
-        this->_tcpPcb = tcp_new_ip_type(IP_GET_TYPE(&this->_ip));
-        if (!this->_tcpPcb) {
-            E(TAG, "failed to create tcp pcb");
-            this->incTcpErr();
-            this->close();
-            return false;
+        if (this->_body.overflowed()) {
+            E(TAG, "payload does not fit into payload buffer, dropping samples: " << count);
+            this->skip(lane, replaying ? 0 : this->sequenceAfter(first, count), count);
+            this->_telemetry.droppedBatches++;
+            return 0;
         }
 
-        tcp_arg(this->_tcpPcb, this);
-
-        tcp_poll(
-            this->_tcpPcb,
-            [](
-                void* const arg,
-                struct tcp_pcb* const tcpPcb
-            ) {
-                auto that = static_cast<Homer2Pusher*>(arg);
-
-                E(TAG, "connection timeout");
-                that->incTcpErr();
-                return that->close();
-            },
-            10
-        );
-
-        tcp_sent(
-            this->_tcpPcb,
-            [](
-                void* const arg,
-                struct tcp_pcb* const tcpPcb,
-                const u16_t len
-            ) {
-                auto that = static_cast<Homer2Pusher*>(arg);
-
-                I(TAG, "tcp sent, wrote to sever: " << std::to_string(len));
-                if (len == that->_writeBuffer.size()) {
-                    that->resetTcpErr();
-                    return that->close();
-                }
-                else {
-                    return static_cast<err_t>(ERR_OK);
-                }
-            }
-        );
+        D(5, TAG, "data filled, samples: " << count << ", len: " << this->_body.size());
 
-        tcp_recv(
-            this->_tcpPcb,
-            [](
-                void* const arg,
-                struct tcp_pcb* const tcpPcb,
-                struct pbuf* const pBuf,
-                const err_t err
-            ) {
-                D(4, TAG, "tcp recv");
-                // TODO check response for HTTP 2xx.
-                return static_cast<err_t>(ERR_OK);
+        if (this->_gzip) {
+            this->_compressed.clear();
+            if (!gzip_compress(this->_body.data(), this->_body.size(), this->_compressed)) {
+                E(TAG, "compressed payload does not fit into buffer, dropping samples: " << count);
+                this->skip(lane, replaying ? 0 : this->sequenceAfter(first, count), count);
+                this->_telemetry.droppedBatches++;
+                return 0;
             }
-        );
 
-        tcp_err(
-            this->_tcpPcb,
-            [](
-                void* const arg,
-                const err_t err
-            ) {
-                auto that = static_cast<Homer2Pusher*>(arg);
-
-                E(TAG, "TCP fatal error: " << translate(err));
-                if (ERR_ABRT != err)
-                    that->close();
-            }
-        );
+            D(5, TAG, "payload compressed, len: " << this->_body.size()
+                << " => " << this->_compressed.size());
+        }
 
-        return true;
+        return count;
     }
 
     [[nodiscard]]
-    bool Homer2Pusher::connect() noexcept {
+    const Homer2Payload& Homer2Pusher::wire() const noexcept {
 
-        D(5, TAG, "connecting tcp");
+        return this->_gzip ? this->_compressed : this->_body;
+    }
 
-        cyw43_arch_lwip_begin();
-        const err_t err = tcp_connect(
-            this->_tcpPcb,
-            &this->_ip,
-            this->_port,
-            [](
-                void* const arg,
-                struct tcp_pcb* const tcpPcb,
-                const err_t err
-            ) {
-                auto that = static_cast<Homer2Pusher*>(arg);
-
-                if (ERR_OK != err) {
-                    E(TAG, "connection failed: " << translate(err));
-                    that->incTcpErr();
-                    const auto closeErr = that->close();
-                    return ERR_OK == closeErr ? err : closeErr;
-                }
-                else {
-                    D(4, TAG, "connection successful");
-                    that->_connection = internal::ConnectionStatus::CONNECTED;
-                    return static_cast<err_t>(ERR_OK);
-                }
-            }
-        );
-        cyw43_arch_lwip_end();
+    void Homer2Pusher::release(
+        const size_t lane
+    ) noexcept {
 
-        if (ERR_OK != err) {
-            E(TAG, "connection failed: " << translate(err));
-            this->incTcpErr();
-            this->close();
-            return false;
-        }
+        this->_writers &= ~(1UL << lane);
+    }
 
-        this->waitForConnection();
+    void Homer2Pusher::consume(
+        const size_t lane
+    ) noexcept {
 
-        return true;
+        auto& l = this->_lanes[lane];
+        this->skip(lane, l.end, l.inFlight);
+        l.inFlight = 0;
+        this->release(lane);
     }
 
-    void Homer2Pusher::waitForConnection() const noexcept {
+    void Homer2Pusher::abandon(
+        const size_t lane
+    ) noexcept {
+
+        if (this->_lanes[lane].inFlight > 0)
+            this->_telemetry.retries++;
 
-#pragma clang diagnostic push
-#pragma ide diagnostic ignored "EndlessLoop"
-#pragma ide diagnostic ignored "ConstantConditionsOC"
-        while (internal::ConnectionStatus::CONNECTING == this->_connection)
-            sleep_us(100);
-#pragma clang diagnostic pop
+        this->_lanes[lane].inFlight = 0;
+        this->release(lane);
     }
 
     [[nodiscard]]
-    bool Homer2Pusher::write() noexcept {
+    Homer2Telemetry& Homer2Pusher::telemetry() noexcept {
 
-        D(5, TAG, "writing tcp");
+        return this->_telemetry;
+    }
 
-        this->_writeBuffer = this->_header;
-        this->_writeBuffer += std::to_string(this->_body.size());
-        this->_writeBuffer += "\n\n";
-        this->_writeBuffer += this->_body;
+    // Samples are numbered, so moving past them stays right even when some were dropped from
+    // the queue in the meantime.
+    void Homer2Pusher::skip(
+        const size_t lane,
+        const uint64_t end,
+        const size_t count
+    ) noexcept {
 
-        const auto available = tcp_sndbuf(this->_tcpPcb);
+        auto& l = this->_lanes[lane];
 
-        if (available < this->_writeBuffer.size()) {
-            W(TAG, "TCP buffer full, skipping");
-            this->close();
-            return false;
+        if (l.replaying) {
+            this->_log.pop(count);
+            return;
         }
 
-        cyw43_arch_lwip_begin();
-        const auto bodyErr = tcp_write(
-            this->_tcpPcb,
-            this->_writeBuffer.data(),
-            this->_writeBuffer.size(),
-            TCP_WRITE_FLAG_COPY
-        );
-        cyw43_arch_lwip_end();
+        l.cursor = std::max(l.cursor, end);
+        this->popDelivered();
+    }
 
-        if (ERR_OK != bodyErr) {
-            E(TAG, "could not write body: " << std::to_string(bodyErr));
-            this->close();
-            this->incTcpErr();
-            return false;
-        }
-        else {
-            D(0, TAG, "wrote to server");
-        }
+    [[nodiscard]]
+    uint64_t Homer2Pusher::sequenceAfter(
+        const size_t first,
+        const size_t count
+    ) const noexcept {
 
-        this->close();
+        return this->_queue[first + count - 1].sequence + 1;
+    }
 
-        return true;
+    // A queued sample is kept until every endpoint is done with it.
+    void Homer2Pusher::popDelivered() noexcept {
+
+        auto cursor = this->_lanes[0].cursor;
+        for (const auto& l: this->_lanes)
+            cursor = std::min(cursor, l.cursor);
+
+        this->_queue.pop(this->_queue.indexOf(cursor));
     }
 
-    err_t Homer2Pusher::close() noexcept {
+    // Called with a full queue, moves the oldest sample to flash instead of dropping it, unless
+    // the primary endpoint already has it. The other endpoints lose it.
+    void Homer2Pusher::spillOldest() noexcept {
 
-        D(5, TAG, "tcp close");
+        const auto& primary = this->_lanes[0];
+        const auto front = this->_queue.frontSequence();
 
-        if (this->_connection == internal::ConnectionStatus::DISCONNECTED) {
-            D(5, TAG, "already disconnected");
-            return ERR_OK;
-        }
-        this->_connection = internal::ConnectionStatus::DISCONNECTED;
-
-        if (this->_tcpPcb != nullptr) {
-
-            D(4, TAG, "closing tcp");
-
-            cyw43_arch_lwip_begin();
-            tcp_arg(this->_tcpPcb, nullptr);
-            tcp_poll(this->_tcpPcb, nullptr, 0);
-            tcp_sent(this->_tcpPcb, nullptr);
-            tcp_recv(this->_tcpPcb, nullptr);
-            tcp_err(this->_tcpPcb, nullptr);
-            const auto err = tcp_close(this->_tcpPcb);
-            cyw43_arch_lwip_end();
-
-            if (ERR_OK != err) {
-                E(TAG, "failed to close tcp connection, aborting: " << translate(err));
-                this->incTcpErr();
-                cyw43_arch_lwip_begin();
-                tcp_abort(this->_tcpPcb);
-                cyw43_arch_lwip_end();
-                this->_tcpPcb = nullptr;
-                return ERR_ABRT;
-            }
-            else {
-                this->_tcpPcb = nullptr;
-            }
+        if (primary.cursor > front)
+            return;
+
+        // Still being sent, were it stored and then delivered it would be replayed a second time.
+        // The queue makes room by dropping instead, until the request settles.
+        if (!primary.replaying && primary.inFlight > 0 && front < primary.end) {
+            D(4, TAG, "oldest sample in flight, not spilling");
+            return;
         }
 
-        this->_lastPushMillis = now();
-        return ERR_OK;
+        const auto& oldest = this->_queue[0];
+        if (this->store(clock::epoch_millis(oldest.capturedAtMillis), oldest.reading))
+            this->_queue.pop(1);
     }
 
+    // Taken anew for the batch rather than queued with the samples, so neither the deadband nor
+    // the flash log ever see them. Left for the next batch when the samples filled this one.
+    void Homer2Pusher::appendTelemetry() noexcept {
 
-    [[nodiscard]]
-    std::string Homer2Pusher::ipAddr() const noexcept {
+        auto breaker = BreakerState::CLOSED;
+        for (const auto& endpoint: this->_endpoints)
+            breaker = std::max(breaker, endpoint->breakerState());
 
-        cyw43_arch_lwip_begin();
-        const char* const addr = ipaddr_ntoa(&this->_ip);
-        std::string ipStr = std::move(std::string{addr});
-        cyw43_arch_lwip_end();
-
-        return std::move(ipStr);
-    }
+        const auto nowMillis = now();
+        if (nowMillis < this->_telemetryDueAtMillis && breaker == this->_reportedBreaker)
+            return;
 
-    void Homer2Pusher::incTcpErr() noexcept {
+        this->_telemetry.droppedSamples = this->_queue.dropped();
+        this->_telemetryReading = {};
+        this->_telemetry.fill(this->_telemetryReading, breaker);
 
-        if (this->_tcpErrors < std::numeric_limits<uint8_t>::max())
-            this->_tcpErrors++;
-    }
+        const auto mark = this->_body.size();
+        const auto appended = this->_encoder->append(
+            this->_body,
+            this->_telemetryReading,
+            clock::epoch_millis(nowMillis)
+        );
 
-    void Homer2Pusher::incDnsErr() noexcept {
+        if (!appended ||
+            this->_body.overflowed() ||
+            this->_body.size() + this->_encoder->trailerSize() > this->_body.capacity()) {
+            D(4, TAG, "payload size limit reached, deferring telemetry");
+            this->_body.truncate(mark);
+            return;
+        }
 
-        if (this->_dnsErrors < std::numeric_limits<uint8_t>::max())
-            this->_dnsErrors++;
+        this->_reportedBreaker = breaker;
+        this->_telemetryDueAtMillis = nowMillis + HOMER2_VICTORIA_CADENCE_TELEMETRY_MILLIS;
     }
 
-    void Homer2Pusher::resetTcpErr() noexcept {
+    [[nodiscard]]
+    bool Homer2Pusher::store(
+        const uint64_t timestampMillis,
+        const Homer2Reading& reading
+    ) noexcept {
+
+        // Without a wall clock a stored sample could never be placed in time.
+        if (0 == timestampMillis)
+            return false;
 
-        if (this->_tcpErrors > 0)
-            this->_tcpErrors--;
-    }
+        const auto before = this->_log.size();
+        if (!this->_log.append(timestampMillis, reading))
+            return false;
 
-    void Homer2Pusher::resetDnsErr() noexcept {
+        // A full log drops its oldest records, which may be those being replayed.
+        auto& primary = this->_lanes[0];
+        const auto dropped = before + 1 - this->_log.size();
+        if (primary.replaying && dropped > 0)
+            primary.inFlight = dropped < primary.inFlight ? primary.inFlight - dropped : 0;
 
-        if (this->_dnsErrors > 0)
-            this->_dnsErrors--;
+        return true;
     }
 
 }
@@ -1,97 +1,220 @@
 #pragma once
 
-#include <string>
-#include <array>
-
-#include <lwip/tcp.h>
-#include <lwip/ip_addr.h>
+#include <memory>
+#include <vector>
 
+#include "homer2_init.hpp"
 #include "homer2_sensor.hpp"
+#include "homer2_sample_queue.hpp"
+#include "homer2_flash_log.hpp"
+#include "homer2_deadband.hpp"
+#include "homer2_payload.hpp"
+#include "homer2_encoder.hpp"
+#include "homer2_endpoint.hpp"
+#include "homer2_telemetry.hpp"
 
 namespace homer2 {
 
-    namespace internal {
+    // Queues the samples and serializes them once for all endpoints, each endpoint delivering them
+    // over its own connection and at its own pace.
+    class Homer2Pusher {
+    public:
 
-        enum class ConnectionStatus {
-            DISCONNECTED,
-            CONNECTING,
-            CONNECTED,
-        };
+        Homer2Pusher& operator=(const Homer2Pusher& other) noexcept = delete;
 
-    }
+        Homer2Pusher& operator=(Homer2Pusher&& other) = delete;
+
+        Homer2Pusher(Homer2Pusher&& other) = delete;
+
+        Homer2Pusher(const Homer2Pusher& other) noexcept = delete;
 
-    class Homer2Pusher {
-    public:
 
         Homer2Pusher(
-            const char* addr,
-            uint16_t port,
+            const std::vector<net::VictoriaEndpoint>& endpoints,
+            PushTransport transport,
             uint64_t pushFrequencyMillis,
+            bool keepAlive,
+            bool gzip,
+            size_t batchSize,
+            uint64_t heartbeatMillis,
+            size_t maxPayloadBytes,
+            std::unique_ptr<Homer2Encoder> encoder,
             uint64_t pushStartAfterTimestamp
         );
 
+        // Queues the sample and advances the pusher, never blocks. When any of the values in
+        // urgentMask is fresh, it is pushed by every endpoint right away, see Homer2Alerts.
         void push(
-            const Homer2SensorsData& data
+            const Homer2SensorsData& data,
+            uint64_t urgentMask
         );
 
+        // Advances the pusher without queueing a sample, cheap enough to call on every loop.
+        void poll() noexcept;
 
-    private:
+        // When the pusher next has something to do without a new sample, see poll().
+        [[nodiscard]]
+        uint64_t nextDeadlineMillis() const noexcept;
 
-        void fillBuffer(
-            const Homer2SensorsData& data
+        // Readings handed off from core 0 and those dropped as the handoff was full, reported
+        // with the next sample, see Homer2Handoff.
+        void recordHandoffs(
+            uint64_t pushed,
+            uint64_t dropped
         ) noexcept;
 
-        void tryPush() noexcept;
+        [[nodiscard]]
+        uint32_t sentDatagrams() const noexcept;
+
+        [[nodiscard]]
+        uint64_t sentBytes() const noexcept;
+
+        [[nodiscard]]
+        uint64_t deliveredSamples() const noexcept;
 
         [[nodiscard]]
-        bool resolve() noexcept;
+        uint64_t rejectedSamples() const noexcept;
+
+
+    private:
+
+        friend class Homer2Endpoint;
+
+        // Delivery progress of one endpoint. Queued samples are numbered, so an endpoint lagging
+        // behind keeps its own position in the queue shared with the others.
+        struct Lane {
 
-        void resolve_ip() noexcept;
+            // Number of the first queued sample not yet delivered to the endpoint.
+            uint64_t cursor{0};
 
-        void resolve_addr() noexcept;
+            // Number following the last sample of the batch in flight.
+            uint64_t end{0};
+
+            size_t inFlight{0};
+
+            bool replaying{false};
+
+        };
+
+        void advance() noexcept;
 
         [[nodiscard]]
-        bool open() noexcept;
+        size_t pending(
+            size_t lane
+        ) const noexcept;
 
+        // Only the primary endpoint replays the samples stored in flash.
         [[nodiscard]]
-        bool connect() noexcept;
+        size_t stored(
+            size_t lane
+        ) const noexcept;
 
         [[nodiscard]]
-        bool write() noexcept;
+        bool ready(
+            bool replaying
+        ) const noexcept;
 
-        err_t close() noexcept;
+        [[nodiscard]]
+        size_t inFlight(
+            size_t lane
+        ) const noexcept;
 
+        // Takes the next batch of the endpoint, serializing it unless the payload already holds
+        // it. Returns 0 when there is nothing to send, or when the payload can not be rebuilt
+        // as another endpoint is still writing it.
+        [[nodiscard]]
+        size_t fill(
+            size_t lane,
+            bool replaying
+        ) noexcept;
 
-        void waitForConnection() const noexcept;
+        [[nodiscard]]
+        size_t serialize(
+            size_t lane,
+            size_t first,
+            bool replaying
+        ) noexcept;
 
-        void incTcpErr() noexcept;
+        [[nodiscard]]
+        const Homer2Payload& wire() const noexcept;
 
-        void incDnsErr() noexcept;
+        // The endpoint is done reading the payload, it may be rebuilt.
+        void release(
+            size_t lane
+        ) noexcept;
 
-        void resetTcpErr() noexcept;
+        // The batch in flight was delivered, or dropped for good.
+        void consume(
+            size_t lane
+        ) noexcept;
 
-        void resetDnsErr() noexcept;
+        // The batch in flight is kept for the next push.
+        void abandon(
+            size_t lane
+        ) noexcept;
+
+        // Moves the endpoint past the samples numbered below end, or past count stored samples.
+        void skip(
+            size_t lane,
+            uint64_t end,
+            size_t count
+        ) noexcept;
 
+        // Number following the last of count queued samples from the index on.
         [[nodiscard]]
-        std::string ipAddr() const noexcept;
+        uint64_t sequenceAfter(
+            size_t first,
+            size_t count
+        ) const noexcept;
+
+        [[nodiscard]]
+        Homer2Telemetry& telemetry() noexcept;
+
+        void popDelivered() noexcept;
+
+        void spillOldest() noexcept;
+
+        // Adds homer2's own metrics to the batch being serialized, once per their cadence or as
+        // soon as the breaker state changed.
+        void appendTelemetry() noexcept;
+
+        [[nodiscard]]
+        bool store(
+            uint64_t timestampMillis,
+            const Homer2Reading& reading
+        ) noexcept;
 
         const uint64_t _pushStartAfterTimestamp;
-        const uint64_t _pushFrequencyMillis;
-        uint64_t _lastPushMillis{0};
-        // uint8_t _httpErrors{0};
-        uint8_t _tcpErrors{0};
-        uint8_t _dnsErrors{0};
-
-        const char* _addr;
-        const uint16_t _port;
-        ip_addr_t _ip{.addr = IPADDR_ANY};
-
-        struct tcp_pcb* _tcpPcb{nullptr};
-        internal::ConnectionStatus _connection{internal::ConnectionStatus::DISCONNECTED};
-
-        const std::string _header;
-        std::string _body{};
-        std::string _writeBuffer{};
+        uint64_t _lastCapturedMillis{0};
+        const size_t _batchSize;
+        const bool _gzip;
+
+        const std::unique_ptr<Homer2Encoder> _encoder;
+        Homer2Deadband _deadband;
+        Homer2SampleQueue _queue{};
+
+        // Samples the queue could not hold, replayed once the primary endpoint is reachable again.
+        Homer2FlashLog _log;
+
+        Homer2Payload _body;
+        Homer2Payload _compressed;
+
+        Homer2Telemetry _telemetry{};
+
+        // Taken anew for each batch carrying it, the encoder refers to it until the batch is ended.
+        Homer2TelemetryReading _telemetryReading{};
+        uint64_t _telemetryDueAtMillis{0};
+        BreakerState _reportedBreaker{BreakerState::CLOSED};
+
+        // Bit i is set while the endpoint of lane i is writing the payload out.
+        uint32_t _writers{0};
+        bool _payloadCached{false};
+        uint64_t _payloadStart{0};
+        uint64_t _payloadEnd{0};
+        size_t _payloadCount{0};
+
+        std::vector<Lane> _lanes{};
+        std::vector<std::unique_ptr<Homer2Endpoint>> _endpoints{};
 
     };
 
@@ -0,0 +1,169 @@
+#include <stdexcept>
+
+#include <homer2_logging.hpp>
+
+#include "homer2_sample_queue.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Queue";
+
+    }
+
+    void Homer2SampleQueue::push(
+        const uint64_t capturedAtMillis,
+        const Homer2Reading& reading
+    ) noexcept {
+
+        const auto priority = reading_priority(reading);
+
+        if (this->_size == this->_samples.size()) {
+            // Strictly lower only, among equals the oldest goes.
+            size_t victim = 0;
+            for (size_t i = 1; i < this->_size && this->at(victim).priority > Homer2Priority::low; i++)
+                if (this->at(i).priority < this->at(victim).priority)
+                    victim = i;
+
+            if (priority < this->at(victim).priority) {
+                D(3, TAG, "queue full, dropping pushed sample of priority: " << static_cast<int>(priority));
+                this->drop(priority);
+                this->_nextSequence++;
+                return;
+            }
+
+            D(3, TAG, "queue full, dropping sample of priority: "
+                << static_cast<int>(this->at(victim).priority) << ", age: " << (this->_size - 1 - victim));
+            this->drop(this->at(victim).priority);
+            this->erase(victim);
+        }
+
+        auto& sample = this->at(this->_size);
+        sample.sequence = this->_nextSequence++;
+        sample.capturedAtMillis = capturedAtMillis;
+        sample.priority = priority;
+        sample.reading = reading;
+
+        this->_size++;
+    }
+
+    [[nodiscard]]
+    const Homer2Sample& Homer2SampleQueue::operator[](
+        const size_t index
+    ) const {
+
+        if (index >= this->_size)
+            throw std::out_of_range{"sample index out of range"};
+
+        return this->_samples[(this->_head + index) % this->_samples.size()];
+    }
+
+    void Homer2SampleQueue::pop(
+        const size_t count
+    ) noexcept {
+
+        const auto n = count < this->_size ? count : this->_size;
+
+        this->_head = (this->_head + n) % this->_samples.size();
+        this->_size -= n;
+    }
+
+    void Homer2SampleQueue::keepLatest() noexcept {
+
+        if (this->_size <= 1)
+            return;
+
+        for (size_t i = 0; i + 1 < this->_size; i++)
+            this->drop(this->at(i).priority);
+
+        this->pop(this->_size - 1);
+    }
+
+    [[nodiscard]]
+    size_t Homer2SampleQueue::size() const noexcept {
+
+        return this->_size;
+    }
+
+    [[nodiscard]]
+    bool Homer2SampleQueue::empty() const noexcept {
+
+        return 0 == this->_size;
+    }
+
+    [[nodiscard]]
+    size_t Homer2SampleQueue::capacity() const noexcept {
+
+        return this->_samples.size();
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SampleQueue::dropped() const noexcept {
+
+        uint64_t sum = 0;
+        for (const auto count: this->_dropped)
+            sum += count;
+        return sum;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SampleQueue::dropped(
+        const Homer2Priority priority
+    ) const noexcept {
+
+        return this->_dropped[static_cast<size_t>(priority)];
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SampleQueue::frontSequence() const noexcept {
+
+        return 0 == this->_size ? this->_nextSequence : (*this)[0].sequence;
+    }
+
+    [[nodiscard]]
+    size_t Homer2SampleQueue::indexOf(
+        const uint64_t sequence
+    ) const noexcept {
+
+        size_t lo = 0;
+        size_t hi = this->_size;
+
+        while (lo < hi) {
+            const auto mid = lo + (hi - lo) / 2;
+            if ((*this)[mid].sequence < sequence)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+
+        return lo;
+    }
+
+    [[nodiscard]]
+    Homer2Sample& Homer2SampleQueue::at(
+        const size_t index
+    ) noexcept {
+
+        return this->_samples[(this->_head + index) % this->_samples.size()];
+    }
+
+    void Homer2SampleQueue::drop(
+        const Homer2Priority priority
+    ) noexcept {
+
+        this->_dropped[static_cast<size_t>(priority)]++;
+    }
+
+    // The older samples are moved up by one, dropping the oldest ones moves the least.
+    void Homer2SampleQueue::erase(
+        const size_t index
+    ) noexcept {
+
+        for (auto i = index; i > 0; i--)
+            this->at(i) = this->at(i - 1);
+
+        this->pop(1);
+    }
+
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "homer2_config.h"
+#include "homer2_metric.hpp"
+
+namespace homer2 {
+
+    struct Homer2Sample {
+
+        // Samples are numbered in the order they were pushed, a number is never reused.
+        uint64_t sequence{0};
+
+        uint64_t capturedAtMillis{0};
+
+        Homer2Priority priority{Homer2Priority::low};
+
+        Homer2Reading reading{};
+
+    };
+
+    // Holds at most HOMER2_VICTORIA_QUEUE_CAPACITY samples, the lowest priority ones are dropped
+    // first to make room.
+
+    class Homer2SampleQueue {
+    public:
+
+        Homer2SampleQueue& operator=(const Homer2SampleQueue& other) noexcept = delete;
+
+        Homer2SampleQueue& operator=(Homer2SampleQueue&& other) = delete;
+
+        Homer2SampleQueue(Homer2SampleQueue&& other) = delete;
+
+        Homer2SampleQueue(const Homer2SampleQueue& other) noexcept = delete;
+
+
+        Homer2SampleQueue() noexcept = default;
+
+
+        // With the queue full, the sample of the lowest priority is dropped, the oldest of them if
+        // there is more than one. That may be the pushed sample itself.
+        void push(
+            uint64_t capturedAtMillis,
+            const Homer2Reading& reading
+        ) noexcept;
+
+        [[nodiscard]]
+        const Homer2Sample& operator[](size_t index) const;
+
+        void pop(
+            size_t count
+        ) noexcept;
+
+        void keepLatest() noexcept;
+
+        [[nodiscard]]
+        size_t size() const noexcept;
+
+        [[nodiscard]]
+        bool empty() const noexcept;
+
+        [[nodiscard]]
+        size_t capacity() const noexcept;
+
+        [[nodiscard]]
+        uint64_t dropped() const noexcept;
+
+        [[nodiscard]]
+        uint64_t dropped(
+            Homer2Priority priority
+        ) const noexcept;
+
+        // Number of the oldest sample, or of the next one to be pushed when empty.
+        [[nodiscard]]
+        uint64_t frontSequence() const noexcept;
+
+        // Index of the oldest sample numbered at least the given number, size() when there is
+        // none. Dropped samples leave gaps in the numbering.
+        [[nodiscard]]
+        size_t indexOf(
+            uint64_t sequence
+        ) const noexcept;
+
+    private:
+
+        [[nodiscard]]
+        Homer2Sample& at(
+            size_t index
+        ) noexcept;
+
+        void drop(
+            Homer2Priority priority
+        ) noexcept;
+
+        void erase(
+            size_t index
+        ) noexcept;
+
+        std::array<Homer2Sample, HOMER2_VICTORIA_QUEUE_CAPACITY> _samples{};
+        size_t _head{0};
+        size_t _size{0};
+        uint64_t _nextSequence{0};
+        std::array<uint64_t, static_cast<size_t>(Homer2Priority::high) + 1> _dropped{};
+
+    };
+
+}
@@ -0,0 +1,81 @@
+#include <algorithm>
+
+#include "homer2_config.h"
+#include "homer2_scheduler.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        [[nodiscard]]
+        uint64_t task_period_millis(
+            const Homer2Task task
+        ) noexcept {
+
+            switch (task) {
+                case Homer2Task::sgp40:
+                    return HOMER2_SGP40_PERIOD_MILLIS;
+
+                case Homer2Task::pmsx00x:
+                case Homer2Task::sunrise:
+                case Homer2Task::bmp3xx:
+                case Homer2Task::sht4x:
+                case Homer2Task::bme68x:
+                    return HOMER2_SENSOR_LOOP_DELAY_MILLIS;
+            }
+
+            return HOMER2_SENSOR_LOOP_DELAY_MILLIS;
+        }
+
+    }
+
+    Homer2Scheduler::Homer2Scheduler() noexcept: _timers{} {
+
+        for (size_t i = 0; i < TASK_COUNT; i++)
+            this->_timers[i].periodMillis = task_period_millis(static_cast<Homer2Task>(i));
+    }
+
+    [[nodiscard]]
+    bool Homer2Scheduler::isDue(
+        const Homer2Task task,
+        const uint64_t nowMillis
+    ) const noexcept {
+
+        return nowMillis >= this->_timers[static_cast<size_t>(task)].dueAtMillis;
+    }
+
+    void Homer2Scheduler::serviced(
+        const Homer2Task task,
+        const bool wasIdle,
+        const uint64_t readyAtMillis,
+        const uint64_t nowMillis
+    ) noexcept {
+
+        auto& timer = this->_timers[static_cast<size_t>(task)];
+
+        if (wasIdle) {
+            if (0 == timer.periodMillis || 0 == timer.tickAtMillis)
+                timer.tickAtMillis = nowMillis + timer.periodMillis;
+            // Missed ticks are skipped, keeping to the grid rather than drifting by the lateness.
+            else if (timer.tickAtMillis <= nowMillis)
+                timer.tickAtMillis +=
+                    ((nowMillis - timer.tickAtMillis) / timer.periodMillis + 1) * timer.periodMillis;
+        }
+
+        // Sensors polled for their data (PMSx00x waiting on a UART frame) report being ready in a
+        // millisecond, they are not worth waking up for any sooner than HOMER2_SENSOR_POLL_MILLIS.
+        timer.dueAtMillis = 0 == readyAtMillis
+                            ? timer.tickAtMillis
+                            : std::max(readyAtMillis, nowMillis + HOMER2_SENSOR_POLL_MILLIS);
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Scheduler::nextDeadlineMillis() const noexcept {
+
+        uint64_t deadline = this->_timers[0].dueAtMillis;
+        for (size_t i = 1; i < TASK_COUNT; i++)
+            deadline = std::min(deadline, this->_timers[i].dueAtMillis);
+        return deadline;
+    }
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace homer2 {
+
+    // In the order sensors are serviced, SGP40 last as it is compensated with the data of others.
+    enum class Homer2Task : uint8_t {
+        pmsx00x,
+        sunrise,
+        bmp3xx,
+        sht4x,
+        bme68x,
+        sgp40,
+    };
+
+    constexpr size_t TASK_COUNT = static_cast<size_t>(Homer2Task::sgp40) + 1;
+
+    // Deadline for each sensor, so that only those due are serviced and the loop sleeps until the
+    // earliest of them instead of for a fixed delay.
+    //
+    // A task starts a measurement on its tick, which stays on a grid of its period regardless of
+    // how late it was serviced, and is then due again when the sensor says the measurement can be
+    // read. A sensor not reporting when it is ready (readyAtMillis 0) is simply due on its next tick.
+    class Homer2Scheduler {
+    public:
+
+        Homer2Scheduler& operator=(const Homer2Scheduler& other) noexcept = delete;
+
+        Homer2Scheduler& operator=(Homer2Scheduler&& other) = delete;
+
+        Homer2Scheduler(Homer2Scheduler&& other) = delete;
+
+        Homer2Scheduler(const Homer2Scheduler& other) noexcept = delete;
+
+
+        Homer2Scheduler() noexcept;
+
+
+        [[nodiscard]]
+        bool isDue(
+            Homer2Task task,
+            uint64_t nowMillis
+        ) const noexcept;
+
+        // wasIdle: the sensor had no measurement in progress before being serviced, so this
+        // service started a new one and used up a tick.
+        void serviced(
+            Homer2Task task,
+            bool wasIdle,
+            uint64_t readyAtMillis,
+            uint64_t nowMillis
+        ) noexcept;
+
+        [[nodiscard]]
+        uint64_t nextDeadlineMillis() const noexcept;
+
+    private:
+
+        struct Timer {
+
+            uint64_t periodMillis;
+
+            uint64_t tickAtMillis;
+
+            uint64_t dueAtMillis;
+
+        };
+
+        std::array<Timer, TASK_COUNT> _timers;
+
+    };
+
+}
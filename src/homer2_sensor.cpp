@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <array>
 #include <map>
 
@@ -49,63 +50,125 @@ namespace homer2 {
     }
 
 
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::sgp40CapturedAtMillis() const noexcept {
+
+        return this->_sgp40CapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::bme68xCapturedAtMillis() const noexcept {
+
+        return this->_bme68xCapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::sht4xCapturedAtMillis() const noexcept {
+
+        return this->_sht4xCapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::bmp3xxCapturedAtMillis() const noexcept {
+
+        return this->_bmp3xxCapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::sunriseCapturedAtMillis() const noexcept {
+
+        return this->_sunriseCapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::pmsx00xCapturedAtMillis() const noexcept {
+
+        return this->_pmsx00xCapturedAtMillis;
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2SensorsData::capturedAtMillis() const noexcept {
+
+        return std::max({
+            this->_sgp40CapturedAtMillis,
+            this->_bme68xCapturedAtMillis,
+            this->_sht4xCapturedAtMillis,
+            this->_bmp3xxCapturedAtMillis,
+            this->_sunriseCapturedAtMillis,
+            this->_pmsx00xCapturedAtMillis,
+        });
+    }
+
+
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withSgp40Data(
-        const std::optional<SGP40Data> data
+        const std::optional<SGP40Data> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._sgp40Data = data;
+        newData._sgp40CapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withBme68xData(
-        const std::optional<BME68xData> data
+        const std::optional<BME68xData> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._bme68xData = data;
+        newData._bme68xCapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withSht4xData(
-        const std::optional<SHT4xData> data
+        const std::optional<SHT4xData> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._sht4xData = data;
+        newData._sht4xCapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withBmp3xxData(
-        const std::optional<BMP3xxData> data
+        const std::optional<BMP3xxData> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._bmp3xxData = data;
+        newData._bmp3xxCapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withSunriseData(
-        const std::optional<SunriseData> data
+        const std::optional<SunriseData> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._sunriseData = data;
+        newData._sunriseCapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
     [[nodiscard]]
     Homer2SensorsData Homer2SensorsData::withPmsx00xData(
-        const std::optional<PMSx00xData> data
+        const std::optional<PMSx00xData> data,
+        const uint64_t capturedAtMillis
     ) const noexcept {
 
         Homer2SensorsData newData{*this};
         newData._pmsx00xData = data;
+        newData._pmsx00xCapturedAtMillis = data.has_value() ? capturedAtMillis : 0;
         return newData;
     }
 
@@ -857,7 +920,7 @@ namespace homer2 {
             );
 
             if (value.has_value()) {
-                this->_data = this->_data.withSgp40Data(value.value());
+                this->_data = this->_data.withSgp40Data(value.value(), now);
                 this->_lastSgp40DataTime = now;
             }
 
@@ -884,7 +947,7 @@ namespace homer2 {
             auto value = this->_sht4x->measure(now);
 
             if (value.has_value()) {
-                this->_data = this->_data.withSht4xData(value.value());
+                this->_data = this->_data.withSht4xData(value.value(), now);
                 this->_lastSht4xDataTime = now;
             }
 
@@ -911,7 +974,7 @@ namespace homer2 {
             auto value = this->_sunrise->measure(now);
 
             if (value.has_value()) {
-                this->_data = this->_data.withSunriseData(value.value());
+                this->_data = this->_data.withSunriseData(value.value(), now);
                 this->_lastSunriseDataTime = now;
             }
 
@@ -938,7 +1001,7 @@ namespace homer2 {
             auto value = this->_bme68x->measure(now);
 
             if (value.has_value()) {
-                this->_data = this->_data.withBme68xData(value.value());
+                this->_data = this->_data.withBme68xData(value.value(), now);
                 this->_lastBme68xDataTime = now;
             }
 
@@ -965,7 +1028,7 @@ namespace homer2 {
             auto value = this->_bmp3xx->measure(now);
 
             if (value.has_value()) {
-                this->_data = this->_data.withBmp3xxData(value.value());
+                this->_data = this->_data.withBmp3xxData(value.value(), now);
                 this->_lastBmp3xxDataTime = now;
             }
 
@@ -983,7 +1046,7 @@ namespace homer2 {
 
     void Homer2Sensors::queryPmsx00x() noexcept {
 
-        if (nullptr == this->_bmp3xx)
+        if (nullptr == this->_pmsx00x)
             return;
 
         const auto now = now();
@@ -992,7 +1055,7 @@ namespace homer2 {
             auto value = this->_pmsx00x->measure(now);
 
             if (value.has_value()) {
-                this->_data = this->_data.withPmsx00xData(value.value());
+                this->_data = this->_data.withPmsx00xData(value.value(), now);
                 this->_lastPmsx00xDataTime = now;
             }
 
@@ -1008,23 +1071,56 @@ namespace homer2 {
         }
     }
 
-    void Homer2Sensors::querySensors() {
+    template<typename S>
+    void Homer2Sensors::service(
+        const Homer2Task task,
+        const std::unique_ptr<S>& sensor,
+        void (Homer2Sensors::*query)() noexcept
+    ) noexcept {
+
+        if (!this->_scheduler.isDue(task, now()))
+            return;
+
+        const auto wasIdle = nullptr == sensor || 0 == sensor->readyAtMillis();
+
+        (this->*query)();
+
+        this->_scheduler.serviced(
+            task,
+            wasIdle,
+            nullptr == sensor ? 0 : sensor->readyAtMillis(),
+            now()
+        );
+    }
+
+    [[nodiscard]]
+    bool Homer2Sensors::querySensors() {
 
         if (!this->hasAnySensor())
             throw std::logic_error{"no sensor available to query"};
 
-        this->queryPmsx00x();
+        const auto capturedAtMillis = this->_data.capturedAtMillis();
+
+        this->service(Homer2Task::pmsx00x, this->_pmsx00x, &Homer2Sensors::queryPmsx00x);
 
-        this->querySunrise();
+        this->service(Homer2Task::sunrise, this->_sunrise, &Homer2Sensors::querySunrise);
 
-        this->queryBmp3xx();
+        this->service(Homer2Task::bmp3xx, this->_bmp3xx, &Homer2Sensors::queryBmp3xx);
 
-        this->querySht4x();
+        this->service(Homer2Task::sht4x, this->_sht4x, &Homer2Sensors::querySht4x);
 
-        this->queryBme68x();
+        this->service(Homer2Task::bme68x, this->_bme68x, &Homer2Sensors::queryBme68x);
 
         // Must be after Sht4x & Bme68x as depends on their data.
-        this->querySgp40();
+        this->service(Homer2Task::sgp40, this->_sgp40, &Homer2Sensors::querySgp40);
+
+        return capturedAtMillis != this->_data.capturedAtMillis();
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Sensors::nextDeadlineMillis() const noexcept {
+
+        return this->_scheduler.nextDeadlineMillis();
     }
 
     Homer2SensorsData Homer2Sensors::data() const noexcept {
@@ -1032,22 +1128,22 @@ namespace homer2 {
         Homer2SensorsData data = this->_data;
 
         if (this->isBme68xDataExpired())
-            data = data.withBme68xData(std::nullopt);
+            data = data.withBme68xData(std::nullopt, 0);
 
         if (this->isSht4xDataExpired())
-            data = data.withSht4xData(std::nullopt);
+            data = data.withSht4xData(std::nullopt, 0);
 
         if (this->isBmp3xxDataExpired())
-            data = data.withBmp3xxData(std::nullopt);
+            data = data.withBmp3xxData(std::nullopt, 0);
 
         if (this->isPmsx00xDataExpired())
-            data = data.withPmsx00xData(std::nullopt);
+            data = data.withPmsx00xData(std::nullopt, 0);
 
         if (this->isSgp40DataExpired())
-            data = data.withSgp40Data(std::nullopt);
+            data = data.withSgp40Data(std::nullopt, 0);
 
         if (this->isSunriseDataExpired())
-            data = data.withSunriseData(std::nullopt);
+            data = data.withSunriseData(std::nullopt, 0);
 
         return data;
     }
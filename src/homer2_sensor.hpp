@@ -10,6 +10,7 @@
 #include <homer2_pmsx00x.hpp>
 
 #include "homer2_init.hpp"
+#include "homer2_scheduler.hpp"
 
 namespace homer2 {
 
@@ -71,34 +72,65 @@ namespace homer2 {
         const std::optional<PMSx00xData>& pmsx00xData() const noexcept;
 
 
+        // Monotonic time the value was read from the sensor, 0 when there is no value. A value is
+        // kept for up to HOMER2_CACHED_DATA_EXPIRY_MILLIS, so it may be older than the reading.
+        [[nodiscard]]
+        uint64_t sgp40CapturedAtMillis() const noexcept;
+
+        [[nodiscard]]
+        uint64_t bme68xCapturedAtMillis() const noexcept;
+
+        [[nodiscard]]
+        uint64_t sht4xCapturedAtMillis() const noexcept;
+
+        [[nodiscard]]
+        uint64_t bmp3xxCapturedAtMillis() const noexcept;
+
+        [[nodiscard]]
+        uint64_t sunriseCapturedAtMillis() const noexcept;
+
+        [[nodiscard]]
+        uint64_t pmsx00xCapturedAtMillis() const noexcept;
+
+        // The latest capture time of all the values, 0 when empty.
+        [[nodiscard]]
+        uint64_t capturedAtMillis() const noexcept;
+
+
         [[nodiscard]]
         Homer2SensorsData withSgp40Data(
-            std::optional<SGP40Data> data
+            std::optional<SGP40Data> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData withBme68xData(
-            std::optional<BME68xData> data
+            std::optional<BME68xData> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData withSht4xData(
-            std::optional<SHT4xData> data
+            std::optional<SHT4xData> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData withBmp3xxData(
-            std::optional<BMP3xxData> data
+            std::optional<BMP3xxData> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData withSunriseData(
-            std::optional<SunriseData> data
+            std::optional<SunriseData> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData withPmsx00xData(
-            std::optional<PMSx00xData> data
+            std::optional<PMSx00xData> data,
+            uint64_t capturedAtMillis
         ) const noexcept;
 
 
@@ -114,6 +146,13 @@ namespace homer2 {
         std::optional<SunriseData> _sunriseData{std::nullopt};
         std::optional<PMSx00xData> _pmsx00xData{std::nullopt};
 
+        uint64_t _sgp40CapturedAtMillis{0};
+        uint64_t _bme68xCapturedAtMillis{0};
+        uint64_t _sht4xCapturedAtMillis{0};
+        uint64_t _bmp3xxCapturedAtMillis{0};
+        uint64_t _sunriseCapturedAtMillis{0};
+        uint64_t _pmsx00xCapturedAtMillis{0};
+
     };
 
     class Homer2Sensors {
@@ -139,7 +178,13 @@ namespace homer2 {
         [[nodiscard]]
         bool hasAnySensor() const noexcept;
 
-        void querySensors();
+        // Services only the sensors that are due, true if any of them had new data.
+        [[nodiscard]]
+        bool querySensors();
+
+        // Time the next sensor is due at, the caller can sleep until then.
+        [[nodiscard]]
+        uint64_t nextDeadlineMillis() const noexcept;
 
         [[nodiscard]]
         Homer2SensorsData data() const noexcept;
@@ -196,6 +241,13 @@ namespace homer2 {
 
         void queryPmsx00x() noexcept;
 
+        template<typename S>
+        void service(
+            Homer2Task task,
+            const std::unique_ptr<S>& sensor,
+            void (Homer2Sensors::*query)() noexcept
+        ) noexcept;
+
 
         void connectBme68x() noexcept;
 
@@ -240,6 +292,8 @@ namespace homer2 {
 
         Homer2SensorsData _data;
 
+        Homer2Scheduler _scheduler;
+
         std::unique_ptr<BME68x> _bme68x{nullptr};
         std::unique_ptr<SHT4x> _sht4x{nullptr};
         std::unique_ptr<SGP40> _sgp40{nullptr};
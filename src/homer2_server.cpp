@@ -0,0 +1,512 @@
+#include <cstring>
+
+#include <pico/cyw43_arch.h>
+
+#include <homer2_logging.hpp>
+#include <homer2_util.hpp>
+
+#include "homer2_clock.hpp"
+#include "homer2_server.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        const char* const TAG = "Server";
+
+        constexpr uint8_t FLOAT_DECIMALS = 3;
+
+        // A client not sending its request, or not reading the response, for this long is dropped.
+        constexpr uint64_t IDLE_TIMEOUT_MILLIS = 5'000;
+
+        // Statically allocated, one per connection, so that serving never touches the heap.
+        std::array<
+            std::array<char, HOMER2_HTTP_SERVER_BUFFER_BYTES>,
+            HOMER2_HTTP_SERVER_MAX_CONNECTIONS
+        > client_buffers{};
+
+        const char* const METRICS_HEADER = "HTTP/1.1 200 OK\r\n"
+                                           "Content-Type: text/plain; version=0.0.4\r\n"
+                                           "Connection: close\r\n"
+                                           "\r\n";
+
+        const char* const STREAM_HEADER = "HTTP/1.1 200 OK\r\n"
+                                          "Content-Type: text/event-stream\r\n"
+                                          "Cache-Control: no-cache\r\n"
+                                          "Connection: keep-alive\r\n"
+                                          "\r\n";
+
+        const char* const NOT_FOUND = "HTTP/1.1 404 Not Found\r\n"
+                                      "Content-Length: 0\r\n"
+                                      "Connection: close\r\n"
+                                      "\r\n";
+
+        const char* const NOT_ALLOWED = "HTTP/1.1 405 Method Not Allowed\r\n"
+                                        "Allow: GET\r\n"
+                                        "Content-Length: 0\r\n"
+                                        "Connection: close\r\n"
+                                        "\r\n";
+
+        bool is_request(
+            const char* const line,
+            const size_t len,
+            const char* const path
+        ) noexcept {
+            const auto pathLen = strlen(path);
+            return len > pathLen &&
+                   0 == strncmp(line, path, pathLen) &&
+                   (' ' == line[pathLen] || '?' == line[pathLen]);
+        }
+
+    }
+
+    Homer2Server::Homer2Server(
+        const uint16_t port
+    ) noexcept: _port{port} {
+
+        for (size_t i = 0; i < this->_clients.size(); i++) {
+            this->_clients[i].server = this;
+            this->_clients[i].buffer = client_buffers[i].data();
+        }
+    }
+
+    [[nodiscard]]
+    bool Homer2Server::start() noexcept {
+
+        I(TAG, "listening on port: " << this->_port);
+
+        cyw43_arch_lwip_begin();
+
+        auto pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+        if (nullptr == pcb) {
+            cyw43_arch_lwip_end();
+            E(TAG, "failed to create tcp pcb");
+            return false;
+        }
+
+        const auto err = tcp_bind(pcb, IP_ANY_TYPE, this->_port);
+        if (ERR_OK != err) {
+            tcp_close(pcb);
+            cyw43_arch_lwip_end();
+            E(TAG, "failed to bind port: " << this->_port);
+            return false;
+        }
+
+        this->_listenPcb = tcp_listen_with_backlog(pcb, HOMER2_HTTP_SERVER_MAX_CONNECTIONS);
+        if (nullptr == this->_listenPcb) {
+            tcp_close(pcb);
+            cyw43_arch_lwip_end();
+            E(TAG, "failed to listen on port: " << this->_port);
+            return false;
+        }
+
+        tcp_arg(this->_listenPcb, this);
+        tcp_accept(
+            this->_listenPcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const newPcb,
+                const err_t err
+            ) {
+                if (ERR_OK != err || nullptr == newPcb)
+                    return static_cast<err_t>(ERR_VAL);
+
+                return static_cast<Homer2Server*>(arg)->accept(newPcb);
+            }
+        );
+
+        cyw43_arch_lwip_end();
+
+        return true;
+    }
+
+    void Homer2Server::publish(
+        const Homer2SensorsData& data
+    ) noexcept {
+
+        cyw43_arch_lwip_begin();
+
+        this->_reading = make_reading(data);
+        this->_readAtMillis = data.capturedAtMillis();
+        this->_hasReading = true;
+
+        for (auto& client: this->_clients) {
+            if (client.state != internal::ClientState::STREAMING)
+                continue;
+
+            // A stream still sending the previous event skips this one, so a slow client costs
+            // neither memory nor time.
+            if (client.written < client.outSize) {
+                D(4, TAG, "stream behind, skipping event");
+                this->_skippedEvents++;
+                continue;
+            }
+
+            Homer2Payload out{client.buffer, HOMER2_HTTP_SERVER_BUFFER_BYTES};
+            this->renderEvent(out);
+            client.outSize = out.size();
+            client.written = 0;
+            (void) flush(client);
+        }
+
+        cyw43_arch_lwip_end();
+    }
+
+    [[nodiscard]]
+    uint64_t Homer2Server::skippedEvents() const noexcept {
+
+        return this->_skippedEvents;
+    }
+
+    [[nodiscard]]
+    err_t Homer2Server::accept(
+        struct tcp_pcb* const pcb
+    ) noexcept {
+
+        Client* client = nullptr;
+        for (auto& candidate: this->_clients) {
+            if (candidate.state == internal::ClientState::FREE) {
+                client = &candidate;
+                break;
+            }
+        }
+
+        if (nullptr == client) {
+            W(TAG, "too many connections, refusing");
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+
+        D(4, TAG, "accepted connection");
+
+        client->pcb = pcb;
+        client->state = internal::ClientState::REQUEST;
+        client->lineLen = 0;
+        client->outSize = 0;
+        client->written = 0;
+        client->lastProgressMillis = now();
+
+        tcp_arg(pcb, client);
+
+        tcp_recv(
+            pcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                struct pbuf* const pBuf,
+                const err_t err
+            ) {
+                (void) tcpPcb;
+                (void) err;
+                auto& client = *static_cast<Client*>(arg);
+
+                if (nullptr == pBuf)
+                    return close(client);
+
+                return receive(client, pBuf);
+            }
+        );
+
+        tcp_sent(
+            pcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb,
+                const u16_t len
+            ) {
+                (void) tcpPcb;
+                (void) len;
+                auto& client = *static_cast<Client*>(arg);
+
+                client.lastProgressMillis = now();
+                return flush(client);
+            }
+        );
+
+        tcp_poll(
+            pcb,
+            [](
+                void* const arg,
+                struct tcp_pcb* const tcpPcb
+            ) {
+                (void) tcpPcb;
+                auto& client = *static_cast<Client*>(arg);
+
+                const auto waiting = client.state == internal::ClientState::REQUEST ||
+                                     client.written < client.outSize;
+                if (!waiting || !is_expired(client.lastProgressMillis, IDLE_TIMEOUT_MILLIS))
+                    return static_cast<err_t>(ERR_OK);
+
+                D(4, TAG, "client idle, closing");
+                return close(client);
+            },
+            2
+        );
+
+        tcp_err(
+            pcb,
+            [](
+                void* const arg,
+                const err_t err
+            ) {
+                (void) err;
+                auto& client = *static_cast<Client*>(arg);
+
+                D(4, TAG, "client connection error: " << std::to_string(err));
+
+                // The pcb is already freed by lwIP when this callback is invoked.
+                client.pcb = nullptr;
+                client.state = internal::ClientState::FREE;
+            }
+        );
+
+        return ERR_OK;
+    }
+
+    [[nodiscard]]
+    err_t Homer2Server::receive(
+        Client& client,
+        struct pbuf* const pBuf
+    ) noexcept {
+
+        auto requestLine = false;
+
+        if (client.state == internal::ClientState::REQUEST) {
+            for (auto q = pBuf; nullptr != q && !requestLine; q = q->next) {
+                const auto data = static_cast<const char*>(q->payload);
+                for (size_t i = 0; i < q->len; i++) {
+                    if ('\n' == data[i]) {
+                        requestLine = true;
+                        break;
+                    }
+                    if (client.lineLen < client.line.size())
+                        client.line[client.lineLen] = data[i];
+                    client.lineLen++;
+                }
+            }
+        }
+
+        // The rest of the request is of no interest, but must be acknowledged all the same.
+        tcp_recved(client.pcb, pBuf->tot_len);
+        pbuf_free(pBuf);
+
+        client.lastProgressMillis = now();
+
+        if (!requestLine)
+            return ERR_OK;
+
+        return respond(client);
+    }
+
+    [[nodiscard]]
+    err_t Homer2Server::respond(
+        Client& client
+    ) noexcept {
+
+        auto& server = *client.server;
+        const auto len = client.lineLen < client.line.size() ? client.lineLen : client.line.size();
+        const char* const line = client.line.data();
+
+        Homer2Payload out{client.buffer, HOMER2_HTTP_SERVER_BUFFER_BYTES};
+
+        if (len < 4 || 0 != strncmp(line, "GET ", 4)) {
+            out.append(NOT_ALLOWED);
+            client.state = internal::ClientState::RESPONDING;
+        }
+        else if (is_request(line + 4, len - 4, "/metrics")) {
+            D(4, TAG, "serving metrics");
+            out.append(METRICS_HEADER);
+            server.renderMetrics(out);
+            client.state = internal::ClientState::RESPONDING;
+        }
+        else if (is_request(line + 4, len - 4, "/stream")) {
+            D(4, TAG, "starting stream");
+            out.append(STREAM_HEADER);
+            if (server._hasReading)
+                server.renderEvent(out);
+            client.state = internal::ClientState::STREAMING;
+        }
+        else {
+            out.append(NOT_FOUND);
+            client.state = internal::ClientState::RESPONDING;
+        }
+
+        if (out.overflowed())
+            E(TAG, "response does not fit into buffer, truncated");
+
+        client.outSize = out.size();
+        client.written = 0;
+
+        return flush(client);
+    }
+
+    // Writes as much as the send buffer takes, the rest follows as acks free it up.
+    [[nodiscard]]
+    err_t Homer2Server::flush(
+        Client& client
+    ) noexcept {
+
+        while (client.written < client.outSize) {
+
+            const auto available = static_cast<size_t>(tcp_sndbuf(client.pcb));
+            if (0 == available)
+                break;
+
+            const auto left = client.outSize - client.written;
+            const auto len = left < available ? left : available;
+
+            const auto err = tcp_write(
+                client.pcb,
+                client.buffer + client.written,
+                static_cast<u16_t>(len),
+                TCP_WRITE_FLAG_COPY
+            );
+
+            if (ERR_MEM == err)
+                break;
+
+            if (ERR_OK != err) {
+                D(4, TAG, "could not write to client: " << std::to_string(err));
+                return close(client);
+            }
+
+            client.written += len;
+        }
+
+        tcp_output(client.pcb);
+
+        // Closing keeps what is already queued, it is still sent.
+        if (client.written == client.outSize && client.state == internal::ClientState::RESPONDING)
+            return close(client);
+
+        return ERR_OK;
+    }
+
+    err_t Homer2Server::close(
+        Client& client
+    ) noexcept {
+
+        if (client.state == internal::ClientState::FREE || nullptr == client.pcb)
+            return ERR_OK;
+
+        auto pcb = client.pcb;
+        client.pcb = nullptr;
+        client.state = internal::ClientState::FREE;
+
+        tcp_arg(pcb, nullptr);
+        tcp_poll(pcb, nullptr, 0);
+        tcp_sent(pcb, nullptr);
+        tcp_recv(pcb, nullptr);
+        tcp_err(pcb, nullptr);
+
+        if (ERR_OK != tcp_close(pcb)) {
+            tcp_abort(pcb);
+            return ERR_ABRT;
+        }
+
+        return ERR_OK;
+    }
+
+    // Families are written together, as the format requires: the table lists metrics by sensor,
+    // so each name is looked up across the whole table at its first appearance.
+    void Homer2Server::renderMetrics(
+        Homer2Payload& out
+    ) const noexcept {
+
+        if (!this->_hasReading)
+            return;
+
+        for (size_t i = 0; i < METRIC_COUNT; i++) {
+
+            const auto& family = metric_info(metric_at(i));
+
+            auto first = true;
+            for (size_t j = 0; j < i; j++)
+                if (0 == strcmp(metric_info(metric_at(j)).name, family.name))
+                    first = false;
+            if (!first)
+                continue;
+
+            auto typed = false;
+            for (size_t j = i; j < METRIC_COUNT; j++) {
+
+                const auto metric = metric_at(j);
+                const auto& info = metric_info(metric);
+                const auto value = metric_value(this->_reading, metric);
+                if (!value.has_value() || 0 != strcmp(info.name, family.name))
+                    continue;
+
+                if (!typed) {
+                    out.append("# TYPE ")
+                        .append(family.name)
+                        .append(" gauge\n");
+                    typed = true;
+                }
+
+                out.append(info.name)
+                    .append(R"({agent="homer2",sensor=")")
+                    .append(info.sensor);
+                if (nullptr != info.cat)
+                    out.append(R"(",cat=")")
+                        .append(info.cat);
+                if (nullptr != info.le)
+                    out.append(R"(",le=")")
+                        .append(info.le);
+                out.append("\"} ")
+                    .appendFloat(value.value(), FLOAT_DECIMALS)
+                    .append('\n');
+            }
+        }
+    }
+
+    // data: {"timestamp":1700000000000,"bme68x":{"temperature":21.5,...},...}
+    void Homer2Server::renderEvent(
+        Homer2Payload& out
+    ) const noexcept {
+
+        out.append("data: {");
+
+        const auto timestamp = clock::epoch_millis(this->_readAtMillis);
+        if (timestamp > 0)
+            out.append(R"("timestamp":)")
+                .appendUnsigned(timestamp)
+                .append(',');
+
+        const char* sensor = nullptr;
+        for (size_t i = 0; i < METRIC_COUNT; i++) {
+
+            const auto metric = metric_at(i);
+            const auto value = metric_value(this->_reading, metric);
+            if (!value.has_value())
+                continue;
+
+            const auto& info = metric_info(metric);
+
+            if (nullptr == sensor || 0 != strcmp(sensor, info.sensor)) {
+                if (nullptr != sensor)
+                    out.append("},");
+                sensor = info.sensor;
+                out.append('"')
+                    .append(info.sensor)
+                    .append(R"(":{)");
+            }
+            else {
+                out.append(',');
+            }
+
+            out.append('"')
+                .append(info.name)
+                .append(R"(":)")
+                .appendFloat(value.value(), FLOAT_DECIMALS);
+        }
+
+        if (nullptr != sensor)
+            out.append('}');
+
+        if (out.back() == ',')
+            out.truncate(out.size() - 1);
+
+        out.append("}\n\n");
+    }
+
+}
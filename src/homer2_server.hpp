@@ -0,0 +1,127 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <lwip/tcp.h>
+
+#include "homer2_config.h"
+#include "homer2_sensor.hpp"
+#include "homer2_metric.hpp"
+#include "homer2_payload.hpp"
+
+namespace homer2 {
+
+    namespace internal {
+
+        enum class ClientState : uint8_t {
+            FREE,
+            REQUEST,
+            RESPONDING,
+            STREAMING,
+        };
+
+    }
+
+    // Serves the latest reading for pulling: /metrics in the Prometheus text format, and /stream
+    // as Server-Sent Events, one event per reading. Connections and their buffers are allocated
+    // statically, a connection past HOMER2_HTTP_SERVER_MAX_CONNECTIONS is refused.
+    class Homer2Server {
+    public:
+
+        Homer2Server& operator=(const Homer2Server& other) noexcept = delete;
+
+        Homer2Server& operator=(Homer2Server&& other) = delete;
+
+        Homer2Server(Homer2Server&& other) = delete;
+
+        Homer2Server() = delete;
+
+        Homer2Server(const Homer2Server& other) noexcept = delete;
+
+
+        explicit Homer2Server(
+            uint16_t port
+        ) noexcept;
+
+
+        [[nodiscard]]
+        bool start() noexcept;
+
+        // Keeps the reading for /metrics and sends it to every stream keeping up.
+        void publish(
+            const Homer2SensorsData& data
+        ) noexcept;
+
+        [[nodiscard]]
+        uint64_t skippedEvents() const noexcept;
+
+    private:
+
+        struct Client {
+
+            Homer2Server* server{nullptr};
+
+            struct tcp_pcb* pcb{nullptr};
+
+            internal::ClientState state{internal::ClientState::FREE};
+
+            // Only the start of the request line is kept, enough to tell the paths apart.
+            std::array<char, 32> line{};
+            size_t lineLen{0};
+
+            char* buffer{nullptr};
+            size_t outSize{0};
+            size_t written{0};
+
+            uint64_t lastProgressMillis{0};
+
+        };
+
+        [[nodiscard]]
+        err_t accept(
+            struct tcp_pcb* pcb
+        ) noexcept;
+
+        [[nodiscard]]
+        static err_t receive(
+            Client& client,
+            struct pbuf* pBuf
+        ) noexcept;
+
+        [[nodiscard]]
+        static err_t respond(
+            Client& client
+        ) noexcept;
+
+        [[nodiscard]]
+        static err_t flush(
+            Client& client
+        ) noexcept;
+
+        static err_t close(
+            Client& client
+        ) noexcept;
+
+        void renderMetrics(
+            Homer2Payload& out
+        ) const noexcept;
+
+        void renderEvent(
+            Homer2Payload& out
+        ) const noexcept;
+
+        const uint16_t _port;
+        struct tcp_pcb* _listenPcb{nullptr};
+
+        std::array<Client, HOMER2_HTTP_SERVER_MAX_CONNECTIONS> _clients{};
+
+        bool _hasReading{false};
+        Homer2Reading _reading{};
+        uint64_t _readAtMillis{0};
+
+        uint64_t _skippedEvents{0};
+
+    };
+
+}
@@ -0,0 +1,172 @@
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "homer2_snappy.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        // Copies can reach at most 64KiB back, so the input is compressed in blocks that size.
+        constexpr size_t BLOCK_SIZE = 1 << 16;
+
+        constexpr size_t HASH_BITS = 12;
+
+        constexpr uint8_t TAG_LITERAL = 0x00;
+        constexpr uint8_t TAG_COPY_1 = 0x01;
+        constexpr uint8_t TAG_COPY_2 = 0x02;
+
+        // Offsets relative to the current block, statically allocated to keep the heap untouched.
+        std::array<uint16_t, 1 << HASH_BITS> hash_table{};
+
+        uint32_t load32(
+            const char* const p
+        ) noexcept {
+            uint32_t value;
+            memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        uint32_t hash(
+            const uint32_t value
+        ) noexcept {
+            return (value * 0x1e35a7bdu) >> (32 - HASH_BITS);
+        }
+
+        void emit_varint(
+            Homer2Payload& output,
+            uint32_t value
+        ) noexcept {
+            while (value >= 0x80) {
+                output.append(static_cast<char>(value | 0x80));
+                value >>= 7;
+            }
+            output.append(static_cast<char>(value));
+        }
+
+        void emit_literal(
+            Homer2Payload& output,
+            const char* const literal,
+            const size_t len
+        ) noexcept {
+            if (0 == len)
+                return;
+
+            const auto n = len - 1;
+            if (n < 60) {
+                output.append(static_cast<char>(TAG_LITERAL | (n << 2)));
+            }
+            else if (n < 0x100) {
+                output.append(static_cast<char>(TAG_LITERAL | (60 << 2)))
+                    .append(static_cast<char>(n));
+            }
+            else {
+                output.append(static_cast<char>(TAG_LITERAL | (61 << 2)))
+                    .append(static_cast<char>(n))
+                    .append(static_cast<char>(n >> 8));
+            }
+
+            output.append(literal, len);
+        }
+
+        void emit_copy_upto_64(
+            Homer2Payload& output,
+            const size_t offset,
+            const size_t len
+        ) noexcept {
+            if (len < 12 && offset < 2048) {
+                output.append(static_cast<char>(TAG_COPY_1 | ((len - 4) << 2) | ((offset >> 8) << 5)))
+                    .append(static_cast<char>(offset));
+            }
+            else {
+                output.append(static_cast<char>(TAG_COPY_2 | ((len - 1) << 2)))
+                    .append(static_cast<char>(offset))
+                    .append(static_cast<char>(offset >> 8));
+            }
+        }
+
+        void emit_copy(
+            Homer2Payload& output,
+            const size_t offset,
+            size_t len
+        ) noexcept {
+            // Keep at least 4 bytes for the last copy, shorter ones can not be encoded.
+            while (len >= 68) {
+                emit_copy_upto_64(output, offset, 64);
+                len -= 64;
+            }
+
+            if (len > 64) {
+                emit_copy_upto_64(output, offset, 60);
+                len -= 60;
+            }
+
+            emit_copy_upto_64(output, offset, len);
+        }
+
+        void compress_block(
+            const char* const block,
+            const size_t len,
+            Homer2Payload& output
+        ) noexcept {
+            hash_table.fill(0);
+
+            size_t literalStart = 0;
+            size_t ip = 0;
+
+            while (ip + 4 <= len) {
+                const auto current = load32(block + ip);
+                auto& slot = hash_table[hash(current)];
+                const size_t candidate = slot;
+                slot = static_cast<uint16_t>(ip);
+
+                if (candidate >= ip || load32(block + candidate) != current) {
+                    // Skip faster through data that does not compress.
+                    ip += 1 + ((ip - literalStart) >> 5);
+                    continue;
+                }
+
+                emit_literal(output, block + literalStart, ip - literalStart);
+
+                size_t matched = 4;
+                while (ip + matched < len && block[candidate + matched] == block[ip + matched])
+                    matched++;
+
+                emit_copy(output, ip - candidate, matched);
+
+                ip += matched;
+                literalStart = ip;
+            }
+
+            emit_literal(output, block + literalStart, len - literalStart);
+        }
+
+    }
+
+    [[nodiscard]]
+    size_t snappy_max_compressed_length(
+        const size_t len
+    ) noexcept {
+
+        return 32 + len + len / 6;
+    }
+
+    [[nodiscard]]
+    bool snappy_compress(
+        const char* const input,
+        const size_t len,
+        Homer2Payload& output
+    ) noexcept {
+
+        emit_varint(output, static_cast<uint32_t>(len));
+
+        for (size_t offset = 0; offset < len; offset += BLOCK_SIZE) {
+            const auto blockLen = len - offset < BLOCK_SIZE ? len - offset : BLOCK_SIZE;
+            compress_block(input + offset, blockLen, output);
+        }
+
+        return !output.overflowed();
+    }
+
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+
+#include "homer2_payload.hpp"
+
+namespace homer2 {
+
+    // Upper bound of the snappy block format output for an input of the given length.
+    [[nodiscard]]
+    size_t snappy_max_compressed_length(
+        size_t len
+    ) noexcept;
+
+    // Compresses into the snappy block format (not the framing format), as used by Prometheus
+    // remote-write. Returns false if the output did not fit.
+    [[nodiscard]]
+    bool snappy_compress(
+        const char* input,
+        size_t len,
+        Homer2Payload& output
+    ) noexcept;
+
+}
@@ -0,0 +1,98 @@
+#include "homer2_telemetry.hpp"
+
+namespace homer2 {
+
+    namespace {
+
+        constexpr Homer2HistogramBounds DNS_MILLIS{10, 50, 250, 1'000};
+        constexpr Homer2HistogramBounds CONNECT_MILLIS{10, 50, 250, 1'000};
+        constexpr Homer2HistogramBounds ACK_MILLIS{50, 250, 1'000, 5'000};
+        constexpr Homer2HistogramBounds PAYLOAD_BYTES{256, 1'024, 4'096, 16'384};
+
+        void set(
+            Homer2TelemetryReading& telemetry,
+            const Homer2Metric metric,
+            const uint64_t value
+        ) noexcept {
+            const auto index = static_cast<size_t>(metric);
+            telemetry.values[index - SENSOR_METRIC_COUNT] = value;
+            telemetry.mask |= 1ULL << index;
+        }
+
+    }
+
+    [[nodiscard]]
+    std::optional<uint64_t> metric_value(
+        const Homer2TelemetryReading& telemetry,
+        const Homer2Metric metric
+    ) noexcept {
+
+        const auto index = static_cast<size_t>(metric);
+        if (index < SENSOR_METRIC_COUNT || 0 == (telemetry.mask & (1ULL << index)))
+            return std::nullopt;
+
+        return telemetry.values[index - SENSOR_METRIC_COUNT];
+    }
+
+    Homer2Histogram::Homer2Histogram(
+        const Homer2HistogramBounds& bounds,
+        const Homer2Metric firstMetric
+    ) noexcept: _bounds{bounds},
+                _firstMetric{static_cast<size_t>(firstMetric)} {
+    }
+
+    void Homer2Histogram::observe(
+        const uint64_t value
+    ) noexcept {
+
+        for (size_t i = 0; i < this->_bounds.size(); i++)
+            if (value <= this->_bounds[i])
+                this->_buckets[i]++;
+
+        this->_buckets[HISTOGRAM_BUCKETS - 1]++;
+        this->_sum += value;
+    }
+
+    void Homer2Histogram::fill(
+        Homer2TelemetryReading& telemetry
+    ) const noexcept {
+
+        for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++)
+            set(telemetry, metric_at(this->_firstMetric + i), this->_buckets[i]);
+
+        set(telemetry, metric_at(this->_firstMetric + HISTOGRAM_BUCKETS), this->_sum);
+
+        // The last bucket counts every observation.
+        set(telemetry, metric_at(this->_firstMetric + HISTOGRAM_BUCKETS + 1),
+            this->_buckets[HISTOGRAM_BUCKETS - 1]);
+    }
+
+    Homer2Telemetry::Homer2Telemetry() noexcept:
+        dns{DNS_MILLIS, Homer2Metric::homer2_dns_millis_bucket_0},
+        connect{CONNECT_MILLIS, Homer2Metric::homer2_connect_millis_bucket_0},
+        ack{ACK_MILLIS, Homer2Metric::homer2_ack_millis_bucket_0},
+        payload{PAYLOAD_BYTES, Homer2Metric::homer2_payload_bytes_bucket_0} {
+    }
+
+    void Homer2Telemetry::fill(
+        Homer2TelemetryReading& telemetry,
+        const BreakerState breaker
+    ) const noexcept {
+
+        set(telemetry, Homer2Metric::homer2_breaker_state, static_cast<uint64_t>(breaker));
+        this->dns.fill(telemetry);
+        this->connect.fill(telemetry);
+        this->ack.fill(telemetry);
+        this->payload.fill(telemetry);
+        set(telemetry, Homer2Metric::homer2_push_attempts, this->attempts);
+        set(telemetry, Homer2Metric::homer2_push_successes, this->successes);
+        set(telemetry, Homer2Metric::homer2_push_retries, this->retries);
+        set(telemetry, Homer2Metric::homer2_http_errors, this->httpErrors);
+        set(telemetry, Homer2Metric::homer2_dropped_batches, this->droppedBatches);
+        set(telemetry, Homer2Metric::homer2_sent_bytes, this->sentBytes);
+        set(telemetry, Homer2Metric::homer2_dropped_samples, this->droppedSamples);
+        set(telemetry, Homer2Metric::homer2_core_handoffs, this->coreHandoffs);
+        set(telemetry, Homer2Metric::homer2_core_handoff_drops, this->coreHandoffDrops);
+    }
+
+}
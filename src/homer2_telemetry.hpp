@@ -0,0 +1,137 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+#include "homer2_metric.hpp"
+#include "homer2_breaker.hpp"
+
+namespace homer2 {
+
+    constexpr size_t HISTOGRAM_BUCKETS = 5;
+
+    constexpr size_t TELEMETRY_METRIC_COUNT = METRIC_COUNT - SENSOR_METRIC_COUNT;
+
+    // Homer2's own metrics at the time of a push. Neither queued nor stored along with the
+    // readings but taken anew for each batch, and kept as integers: as floats the counters would
+    // stop counting past 2^24.
+    struct Homer2TelemetryReading {
+
+        // Bit i is set when the value of metric_at(i) is present.
+        uint64_t mask{0};
+
+        // Indexed from SENSOR_METRIC_COUNT on.
+        std::array<uint64_t, TELEMETRY_METRIC_COUNT> values{};
+
+    };
+
+    [[nodiscard]]
+    std::optional<uint64_t> metric_value(
+        const Homer2TelemetryReading& telemetry,
+        Homer2Metric metric
+    ) noexcept;
+
+    // Upper bounds of the buckets but the last, which takes everything. The le labels of the
+    // bucket metrics in the metrics table must match them.
+    using Homer2HistogramBounds = std::array<uint32_t, HISTOGRAM_BUCKETS - 1>;
+
+    // Fixed buckets counted the Prometheus way: each bucket counts every observation not above
+    // its bound, so counts only ever grow and rates can be taken of them on the server.
+    class Homer2Histogram {
+    public:
+
+        Homer2Histogram& operator=(const Homer2Histogram& other) noexcept = delete;
+
+        Homer2Histogram& operator=(Homer2Histogram&& other) = delete;
+
+        Homer2Histogram(Homer2Histogram&& other) = delete;
+
+        Homer2Histogram(const Homer2Histogram& other) noexcept = delete;
+
+
+        Homer2Histogram(
+            const Homer2HistogramBounds& bounds,
+            Homer2Metric firstMetric
+        ) noexcept;
+
+
+        void observe(
+            uint64_t value
+        ) noexcept;
+
+        // Sets the bucket metrics, followed by the sum and the count.
+        void fill(
+            Homer2TelemetryReading& telemetry
+        ) const noexcept;
+
+    private:
+
+        const Homer2HistogramBounds& _bounds;
+        const size_t _firstMetric;
+
+        std::array<uint32_t, HISTOGRAM_BUCKETS> _buckets{};
+        uint64_t _sum{0};
+
+    };
+
+    // How the pushes of every endpoint went, reported by the pusher as metrics of its own.
+    class Homer2Telemetry {
+    public:
+
+        Homer2Telemetry& operator=(const Homer2Telemetry& other) noexcept = delete;
+
+        Homer2Telemetry& operator=(Homer2Telemetry&& other) = delete;
+
+        Homer2Telemetry(Homer2Telemetry&& other) = delete;
+
+        Homer2Telemetry(const Homer2Telemetry& other) noexcept = delete;
+
+        Homer2Telemetry() noexcept;
+
+
+        // breaker: the worst state of all endpoints, a healthy one delivers the state of the others.
+        void fill(
+            Homer2TelemetryReading& telemetry,
+            BreakerState breaker
+        ) const noexcept;
+
+        // From sending the query to the answer, millis.
+        Homer2Histogram dns;
+
+        // From opening the connection to it being established, millis.
+        Homer2Histogram connect;
+
+        // From starting to write a batch to the server's response, millis.
+        Homer2Histogram ack;
+
+        // Size of a batch on the wire, bytes.
+        Homer2Histogram payload;
+
+        uint64_t attempts{0};
+
+        uint64_t successes{0};
+
+        // Batches kept for another push after the server failed to take them.
+        uint64_t retries{0};
+
+        // Responses other than a 2xx, or not a valid HTTP response at all.
+        uint64_t httpErrors{0};
+
+        // Batches dropped for good, either refused by the server or not fitting the payload.
+        uint64_t droppedBatches{0};
+
+        uint64_t sentBytes{0};
+
+        // Samples dropped from a full queue, see Homer2SampleQueue::push().
+        uint64_t droppedSamples{0};
+
+        // Readings handed from core 0 to core 1, see Homer2Handoff.
+        uint64_t coreHandoffs{0};
+
+        // Readings core 0 could not hand off, core 1 being too far behind.
+        uint64_t coreHandoffDrops{0};
+
+    };
+
+}